@@ -0,0 +1,6 @@
+# Assumes compiler is on your PATH (which it should be)
+
+$IncludePath = Resolve-Path -Path "$PSScriptRoot\.."
+$CommonArgs = "-I", $IncludePath, "-target", "spirv", "-profile", "spirv_1_5"
+
+../../../slang/bin/slangc.exe "$PSScriptRoot\precompute.slang" @CommonArgs -fvk-use-entrypoint-name -entry cs_transmittance -entry cs_direct_irradiance -entry cs_single_scattering -entry cs_scattering_density -entry cs_indirect_irradiance -entry cs_multiple_scattering -o "$PSScriptRoot\precompute.spv"
@@ -1,5 +1,10 @@
 # Assumes compiler is on your PATH (which it should be)
 ../../../slang/bin/slangc.exe  "$PSScriptRoot\prepass.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry vs_main -entry fs_main -o "$PSScriptRoot\prepass.spv"
+../../../slang/bin/slangc.exe  "$PSScriptRoot\prepass.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry vs_indirect -entry fs_main -o "$PSScriptRoot\prepass_indirect.spv"
 ../../../slang/bin/slangc.exe  "$PSScriptRoot\lighting.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry vs_main -entry fs_main -o "$PSScriptRoot\lighting.spv"
 ../../../slang/bin/slangc.exe  "$PSScriptRoot\depth_prepass.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry vs_main -entry fs_main -o "$PSScriptRoot\depth_prepass.spv"
-../../../slang/bin/slangc.exe  "$PSScriptRoot\pp_test.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry cs_pp_test -o "$PSScriptRoot\pp_test.spv"
\ No newline at end of file
+../../../slang/bin/slangc.exe  "$PSScriptRoot\depth_prepass.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry vs_indirect -entry fs_main -o "$PSScriptRoot\depth_prepass_indirect.spv"
+../../../slang/bin/slangc.exe  "$PSScriptRoot\pp_test.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry cs_pp_test -o "$PSScriptRoot\pp_test.spv"
+../../../slang/bin/slangc.exe  "$PSScriptRoot\cull.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry cull -entry cull_meshlets -o "$PSScriptRoot\cull.spv"
+../../../slang/bin/slangc.exe  "$PSScriptRoot\hiz.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry build_hiz_from_depth -entry build_hiz -o "$PSScriptRoot\hiz.spv"
+../../../slang/bin/slangc.exe  "$PSScriptRoot\skinning.slang" -target spirv -profile spirv_1_4 -emit-spirv-directly -g2 -fvk-use-entrypoint-name -entry skin -o "$PSScriptRoot\skinning.spv"
\ No newline at end of file
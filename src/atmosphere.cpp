@@ -1,5 +1,6 @@
 #include "atmosphere.hpp"
 
+#include "atmosphere_precompute.hpp"
 #include "engine/images.hpp"
 #include "engine/ub_data.hpp"
 #include "exception.hpp"
@@ -7,20 +8,25 @@
 
 #include <glm/gtc/constants.hpp>
 
+#include <chrono>
 #include <cmath>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <optional>
 #include <string>
 
 namespace racecar::atmosphere {
 
+/// Baked offline for Earth's atmosphere, the fallback for when precompute.spv hasn't been built.
+/// scattering.dat is too big for the repository and has to be put there by hand.
 constexpr std::string_view IRRADIANCE_DAT_PATH = "../assets/atmosphere/irradiance.dat";
 constexpr std::string_view SCATTERING_DAT_PATH = "../assets/atmosphere/scattering.dat";
 constexpr std::string_view TRANSMITTANCE_DAT_PATH = "../assets/atmosphere/transmittance.dat";
 
 namespace {
 
-std::vector<float> read_data( std::string_view path )
+std::vector<float> read_data( std::string_view path, VkExtent3D extent )
 {
     std::string absolute = std::filesystem::absolute( path ).string();
 
@@ -36,8 +42,15 @@ std::vector<float> read_data( std::string_view path )
 
     static_assert( sizeof( float ) == 4, "float data type is not 32 bits (somehow)" );
 
+    // RGBA32F, same as the cache
+    size_t num_floats = static_cast<size_t>( extent.width ) * extent.height * extent.depth * 4;
     std::streampos file_size = file.tellg();
-    size_t num_floats = static_cast<size_t>( file_size ) / sizeof( float );
+
+    if ( static_cast<size_t>( file_size ) != num_floats * sizeof( float ) ) {
+        throw Exception( "[atmosphere] \"{}\" is {} bytes instead of {}", absolute,
+            static_cast<size_t>( file_size ), num_floats * sizeof( float ) );
+    }
+
     std::vector<float> dat_buffer( num_floats );
 
     file.seekg( 0, std::ios::beg );
@@ -47,9 +60,37 @@ std::vector<float> read_data( std::string_view path )
     return dat_buffer;
 }
 
+LutData read_baked_luts()
+{
+    return {
+        .irradiance = read_data( IRRADIANCE_DAT_PATH, IRRADIANCE_LUT_EXTENT ),
+        .scattering = read_data( SCATTERING_DAT_PATH, SCATTERING_LUT_EXTENT ),
+        .transmittance = read_data( TRANSMITTANCE_DAT_PATH, TRANSMITTANCE_LUT_EXTENT ),
+    };
+}
+
+void upload_luts( vk::Common& vulkan, engine::State& engine, Atmosphere& atms, LutData& luts )
+{
+    VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    VkImageUsageFlags usage_flags = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    atms.irradiance = engine::create_image( vulkan, engine, luts.irradiance.data(),
+        IRRADIANCE_LUT_EXTENT, format, VK_IMAGE_TYPE_2D, usage_flags, false );
+    atms.scattering = engine::create_image( vulkan, engine, luts.scattering.data(),
+        SCATTERING_LUT_EXTENT, format, VK_IMAGE_TYPE_3D, usage_flags, false );
+    atms.transmittance = engine::create_image( vulkan, engine, luts.transmittance.data(),
+        TRANSMITTANCE_LUT_EXTENT, format, VK_IMAGE_TYPE_2D, usage_flags, false );
+}
+
+float elapsed_ms( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<float, std::milli>( std::chrono::steady_clock::now() - start )
+        .count();
+}
+
 }
 
-Atmosphere initialize( vk::Common& vulkan, engine::State& engine )
+Atmosphere initialize( vk::Common& vulkan, engine::State& engine, const Parameters& parameters )
 {
     Atmosphere atms;
 
@@ -61,48 +102,6 @@ Atmosphere initialize( vk::Common& vulkan, engine::State& engine )
     engine::update_descriptor_set_uniform(
         vulkan, engine, atms.uniform_desc_set, atms.uniform_buffer, 0 );
 
-    try {
-        VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        VkImageUsageFlags usage_flags = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-        {
-            std::vector<float> irradiance = read_data( IRRADIANCE_DAT_PATH );
-            atms.irradiance = engine::create_image( vulkan, engine,
-                static_cast<void*>( irradiance.data() ), { .width = 64, .height = 16, .depth = 1 },
-                format, VK_IMAGE_TYPE_2D, usage_flags, false );
-            log::info( "[atmosphere] Created irradiance image" );
-        }
-
-        {
-            std::vector<float> scattering = read_data( SCATTERING_DAT_PATH );
-            atms.scattering
-                = engine::create_image( vulkan, engine, static_cast<void*>( scattering.data() ),
-                    { .width = 256, .height = 128, .depth = 32 }, format, VK_IMAGE_TYPE_3D,
-                    usage_flags, false );
-            log::info( "[atmosphere] Created scattering image" );
-        }
-
-        {
-            std::vector<float> transmittance = read_data( TRANSMITTANCE_DAT_PATH );
-            atms.transmittance
-                = engine::create_image( vulkan, engine, static_cast<void*>( transmittance.data() ),
-                    { .width = 256, .height = 64, .depth = 1 }, format, VK_IMAGE_TYPE_2D,
-                    usage_flags, false );
-            log::info( "[atmosphere] Created irradiance image" );
-        }
-    } catch ( const Exception& ex ) {
-        log::error( "[atmosphere] Failed to create LUTs: {}", ex.what() );
-        throw;
-    }
-
-    atms.lut_desc_set = engine::generate_descriptor_set( vulkan, engine,
-        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-            VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE },
-        VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT );
-    engine::update_descriptor_set_image( vulkan, engine, atms.lut_desc_set, atms.irradiance, 0 );
-    engine::update_descriptor_set_image( vulkan, engine, atms.lut_desc_set, atms.scattering, 1 );
-    engine::update_descriptor_set_image( vulkan, engine, atms.lut_desc_set, atms.transmittance, 2 );
-
     VkSampler sampler = VK_NULL_HANDLE;
     {
         VkSamplerCreateInfo sampler_info = {
@@ -122,6 +121,59 @@ Atmosphere initialize( vk::Common& vulkan, engine::State& engine )
             VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT );
     engine::update_descriptor_set_sampler( vulkan, engine, atms.sampler_desc_set, sampler, 0 );
 
+    atms.parameters = parameters;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if ( !has_precompute_shader() ) {
+        ub_data::AtmosphereParameters requested = to_ub_data( parameters );
+        ub_data::AtmosphereParameters earth = to_ub_data( Parameters {} );
+
+        log::warn( "[atmosphere] precompute.spv is missing, build it with "
+                   "compile_atms_precompute.ps1. Loading the LUTs baked for Earth instead" );
+        if ( std::memcmp( &requested, &earth, sizeof( requested ) ) != 0 ) {
+            log::warn( "[atmosphere] The baked LUTs ignore the requested parameters" );
+        }
+
+        try {
+            LutData luts = read_baked_luts();
+            upload_luts( vulkan, engine, atms, luts );
+        } catch ( const Exception& ex ) {
+            log::error( "[atmosphere] Failed to create LUTs: {}", ex.what() );
+            throw;
+        }
+
+        log::info( "[atmosphere] Loaded baked LUTs in {:.1f} ms", elapsed_ms( start ) );
+    } else {
+        uint64_t parameters_hash = hash_parameters( parameters );
+        std::filesystem::path cache_path = lut_cache_path( parameters_hash );
+
+        if ( std::optional<LutData> cached = read_lut_cache( cache_path, parameters_hash ) ) {
+            upload_luts( vulkan, engine, atms, *cached );
+            log::info( "[atmosphere] Loaded LUTs from \"{}\" in {:.1f} ms", cache_path.string(),
+                elapsed_ms( start ) );
+        } else {
+            LutData luts = precompute_luts( vulkan, engine, atms, parameters );
+            log::info( "[atmosphere] Precomputed LUTs in {:.1f} ms", elapsed_ms( start ) );
+
+            // Not being able to cache only costs the next launch the same wait
+            try {
+                write_lut_cache( cache_path, parameters_hash, luts );
+                log::info( "[atmosphere] Cached LUTs to \"{}\"", cache_path.string() );
+            } catch ( const std::exception& ex ) {
+                log::warn( "[atmosphere] Failed to cache LUTs: {}", ex.what() );
+            }
+        }
+    }
+
+    atms.lut_desc_set = engine::generate_descriptor_set( vulkan, engine,
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE },
+        VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT );
+    engine::update_descriptor_set_image( vulkan, engine, atms.lut_desc_set, atms.irradiance, 0 );
+    engine::update_descriptor_set_image( vulkan, engine, atms.lut_desc_set, atms.scattering, 1 );
+    engine::update_descriptor_set_image( vulkan, engine, atms.lut_desc_set, atms.transmittance, 2 );
+
     // Some default states
     atms.sun_azimuth = 2.9f;
     atms.sun_zenith = 1.3f;
@@ -7,12 +7,58 @@
 
 #include <volk.h>
 
+#include <array>
 #include <string_view>
 
 namespace racecar::atmosphere {
 
 constexpr std::string_view SHADER_PATH = "../shaders/atmosphere/sky/atmosphere.spv";
 
+struct DensityProfileLayer {
+    float width = 0.f;
+    float exp_term = 0.f;
+    float exp_scale = 0.f;
+    float linear_term = 0.f;
+    float constant_term = 0.f;
+};
+
+/// Two layers, for the lower and upper atmosphere. Density is the first layer's below its width.
+using DensityProfile = std::array<DensityProfileLayer, 2>;
+
+/// What the LUTs get precomputed from, lengths in km. Defaults to Earth's atmosphere like `EARTH`
+/// in `constants.slang`, which the sky shaders still use to look the LUTs up, so the radii and
+/// `mu_s_min` should stay put. Scattering, absorption and densities are fair game.
+struct Parameters {
+    glm::vec3 solar_irradiance = { 1.474f, 1.8504f, 1.91198f };
+    float sun_angular_radius = 0.004675f;
+    float bottom_radius = 6360.f;
+    float top_radius = 6420.f;
+
+    DensityProfile rayleigh_density = { {
+        {},
+        { .exp_term = 1.f, .exp_scale = -0.125f },
+    } };
+    glm::vec3 rayleigh_scattering = { 0.005802f, 0.013558f, 0.0331f };
+
+    DensityProfile mie_density = { {
+        {},
+        { .exp_term = 1.f, .exp_scale = -0.833333f },
+    } };
+    glm::vec3 mie_scattering = glm::vec3( 0.003996f );
+    glm::vec3 mie_extinction = glm::vec3( 0.00444f );
+    float mie_phase_function_g = 0.8f;
+
+    /// Ozone, a tent between 10 and 40 km.
+    DensityProfile absorption_density = { {
+        { .width = 25.f, .linear_term = 0.066667f, .constant_term = -0.666667f },
+        { .linear_term = -0.066667f, .constant_term = 2.666667f },
+    } };
+    glm::vec3 absorption_extinction = { 0.00065f, 0.001881f, 0.000085f };
+
+    glm::vec3 ground_albedo = glm::vec3( 0.1f );
+    float mu_s_min = -0.207912f; ///< Cosine of the lowest sun the LUTs cover, 102 degrees.
+};
+
 struct Atmosphere {
     vk::mem::AllocatedImage irradiance;
     vk::mem::AllocatedImage scattering;
@@ -24,11 +70,17 @@ struct Atmosphere {
     engine::DescriptorSet lut_desc_set;
     engine::DescriptorSet sampler_desc_set;
 
+    Parameters parameters;
+
     float sun_zenith = 0.f; ///< Stored in radians. Bound between [-π/2, π/2].
     float sun_azimuth = 0.f; ///< Stored in radians. Roughly clamped between [0, 2π].
 };
 
-Atmosphere initialize( vk::Common& vulkan, engine::State& engine );
+/// Loads the LUTs for `parameters` from the cache, or precomputes and caches them if there are none
+/// yet, see `atmosphere_precompute.hpp`. Without precompute.spv, falls back to the .dat LUTs baked
+/// for Earth.
+Atmosphere initialize(
+    vk::Common& vulkan, engine::State& engine, const Parameters& parameters = {} );
 
 glm::vec3 compute_sun_direction( const Atmosphere& atms );
 
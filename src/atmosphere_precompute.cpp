@@ -0,0 +1,402 @@
+#include "atmosphere_precompute.hpp"
+
+#include "engine/images.hpp"
+#include "engine/imm_submit.hpp"
+#include "engine/pipeline.hpp"
+#include "exception.hpp"
+#include "log.hpp"
+#include "vk/create.hpp"
+#include "vk/utility.hpp"
+
+#include <array>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <span>
+
+namespace racecar::atmosphere {
+
+namespace {
+
+/// Every pass is an entry point of its own in here.
+constexpr std::string_view PRECOMPUTE_SHADER_PATH
+    = "../shaders/atmosphere/precompute/precompute.spv";
+
+constexpr VkFormat LUT_FORMAT = VK_FORMAT_R32G32B32A32_SFLOAT;
+
+constexpr std::array<char, 4> MAGIC = { 'R', 'C', 'S', 'K' };
+
+struct Header {
+    std::array<char, 4> magic = MAGIC;
+    uint32_t version = LUT_CACHE_VERSION;
+    uint64_t parameters_hash = 0;
+};
+
+size_t texel_float_count( VkExtent3D extent )
+{
+    return static_cast<size_t>( extent.width ) * extent.height * extent.depth * 4;
+}
+
+ub_data::AtmosphereDensityLayer to_ub_data( const DensityProfileLayer& layer )
+{
+    return {
+        .width = layer.width,
+        .exp_term = layer.exp_term,
+        .exp_scale = layer.exp_scale,
+        .linear_term = layer.linear_term,
+        .constant_term = layer.constant_term,
+    };
+}
+
+void fnv1a( uint64_t& hash, const void* data, size_t size )
+{
+    constexpr uint64_t FNV_PRIME = 0x100000001b3;
+
+    const unsigned char* bytes = static_cast<const unsigned char*>( data );
+
+    for ( size_t i = 0; i < size; i++ ) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+/// Every pass reads what the ones before it wrote. Images stay in `VK_IMAGE_LAYOUT_GENERAL` the
+/// whole time, so this is all it takes between them.
+void compute_barrier( VkCommandBuffer cmd_buf )
+{
+    VkMemoryBarrier2 barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+    };
+    VkDependencyInfo dependency_info = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &barrier,
+    };
+    vkCmdPipelineBarrier2( cmd_buf, &dependency_info );
+}
+
+void dispatch( VkCommandBuffer cmd_buf, const engine::Pipeline& pipeline,
+    std::span<const VkDescriptorSet> desc_sets, VkExtent3D extent )
+{
+    vkCmdBindPipeline( cmd_buf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.handle );
+    vkCmdBindDescriptorSets( cmd_buf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0,
+        static_cast<uint32_t>( desc_sets.size() ), desc_sets.data(), 0, nullptr );
+
+    // Every entry point is 8x8x1
+    vkCmdDispatch( cmd_buf, ( extent.width + 7 ) / 8, ( extent.height + 7 ) / 8, extent.depth );
+    compute_barrier( cmd_buf );
+}
+
+}
+
+ub_data::AtmosphereParameters to_ub_data( const Parameters& parameters )
+{
+    ub_data::AtmosphereParameters ub = {
+        .solar_irradiance = parameters.solar_irradiance,
+        .sun_angular_radius = parameters.sun_angular_radius,
+        .bottom_radius = parameters.bottom_radius,
+        .top_radius = parameters.top_radius,
+        .rayleigh_scattering = parameters.rayleigh_scattering,
+        .mie_scattering = parameters.mie_scattering,
+        .mie_extinction = parameters.mie_extinction,
+        .mie_phase_function_g = parameters.mie_phase_function_g,
+        .absorption_extinction = parameters.absorption_extinction,
+        .ground_albedo = parameters.ground_albedo,
+        .mu_s_min = parameters.mu_s_min,
+    };
+
+    for ( size_t i = 0; i < 2; i++ ) {
+        ub.rayleigh_density[i] = to_ub_data( parameters.rayleigh_density[i] );
+        ub.mie_density[i] = to_ub_data( parameters.mie_density[i] );
+        ub.absorption_density[i] = to_ub_data( parameters.absorption_density[i] );
+    }
+
+    return ub;
+}
+
+bool has_precompute_shader()
+{
+    return std::filesystem::exists( PRECOMPUTE_SHADER_PATH );
+}
+
+uint64_t hash_parameters( const Parameters& parameters )
+{
+    constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    ub_data::AtmosphereParameters ub = to_ub_data( parameters );
+    std::array<VkExtent3D, 3> extents
+        = { IRRADIANCE_LUT_EXTENT, SCATTERING_LUT_EXTENT, TRANSMITTANCE_LUT_EXTENT };
+
+    fnv1a( hash, &ub, sizeof( ub ) );
+    fnv1a( hash, extents.data(), sizeof( extents ) );
+    fnv1a( hash, &SCATTERING_ORDERS, sizeof( SCATTERING_ORDERS ) );
+    fnv1a( hash, &LUT_CACHE_VERSION, sizeof( LUT_CACHE_VERSION ) );
+
+    // So a rebuilt shader doesn't keep finding caches the old one made
+    std::ifstream shader( std::filesystem::path( PRECOMPUTE_SHADER_PATH ), std::ios::binary );
+    std::vector<char> shader_bytes(
+        ( std::istreambuf_iterator<char>( shader ) ), std::istreambuf_iterator<char>() );
+    fnv1a( hash, shader_bytes.data(), shader_bytes.size() );
+
+    return hash;
+}
+
+std::filesystem::path lut_cache_path( uint64_t parameters_hash )
+{
+    return std::filesystem::path( LUT_CACHE_DIRECTORY )
+        / std::format( "{:016x}{}", parameters_hash, LUT_CACHE_EXTENSION );
+}
+
+std::optional<LutData> read_lut_cache(
+    const std::filesystem::path& cache_path, uint64_t parameters_hash )
+{
+    std::ifstream file( cache_path, std::ios::binary );
+
+    if ( !file.is_open() ) {
+        return std::nullopt;
+    }
+
+    Header header;
+    file.read( reinterpret_cast<char*>( &header ), sizeof( Header ) );
+
+    if ( !file || header.magic != MAGIC || header.version != LUT_CACHE_VERSION
+        || header.parameters_hash != parameters_hash ) {
+        log::warn( "[atmosphere] LUT cache \"{}\" is from other parameters, ignoring it",
+            cache_path.string() );
+        return std::nullopt;
+    }
+
+    LutData luts = {
+        .irradiance = std::vector<float>( texel_float_count( IRRADIANCE_LUT_EXTENT ) ),
+        .scattering = std::vector<float>( texel_float_count( SCATTERING_LUT_EXTENT ) ),
+        .transmittance = std::vector<float>( texel_float_count( TRANSMITTANCE_LUT_EXTENT ) ),
+    };
+
+    for ( std::vector<float>* lut : { &luts.irradiance, &luts.scattering, &luts.transmittance } ) {
+        file.read( reinterpret_cast<char*>( lut->data() ),
+            static_cast<std::streamsize>( lut->size() * sizeof( float ) ) );
+    }
+
+    if ( !file ) {
+        log::warn(
+            "[atmosphere] LUT cache \"{}\" is truncated, ignoring it", cache_path.string() );
+        return std::nullopt;
+    }
+
+    return luts;
+}
+
+void write_lut_cache(
+    const std::filesystem::path& cache_path, uint64_t parameters_hash, const LutData& luts )
+{
+    std::error_code error;
+    std::filesystem::create_directories( cache_path.parent_path(), error );
+
+    // Write next to it first, so a launch that gets cut short never leaves half a cache behind
+    std::filesystem::path temp_path = cache_path;
+    temp_path += ".tmp";
+
+    {
+        std::ofstream file( temp_path, std::ios::binary | std::ios::trunc );
+
+        if ( !file.is_open() ) {
+            throw Exception( "[atmosphere] Could not open \"{}\" for writing", temp_path.string() );
+        }
+
+        Header header = { .parameters_hash = parameters_hash };
+        file.write( reinterpret_cast<const char*>( &header ), sizeof( Header ) );
+
+        for ( const std::vector<float>* lut :
+            { &luts.irradiance, &luts.scattering, &luts.transmittance } ) {
+            file.write( reinterpret_cast<const char*>( lut->data() ),
+                static_cast<std::streamsize>( lut->size() * sizeof( float ) ) );
+        }
+
+        if ( !file ) {
+            throw Exception( "[atmosphere] Failed to write \"{}\"", temp_path.string() );
+        }
+    }
+
+    std::filesystem::rename( temp_path, cache_path );
+}
+
+LutData precompute_luts(
+    vk::Common& vulkan, engine::State& engine, Atmosphere& atms, const Parameters& parameters )
+{
+    VkImageUsageFlags usage_flags = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    VkImageUsageFlags lut_usage_flags = usage_flags | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    atms.irradiance = engine::allocate_image( vulkan, IRRADIANCE_LUT_EXTENT, LUT_FORMAT,
+        VK_IMAGE_TYPE_2D, 1, 1, VK_SAMPLE_COUNT_1_BIT, lut_usage_flags, false );
+    atms.scattering = engine::allocate_image( vulkan, SCATTERING_LUT_EXTENT, LUT_FORMAT,
+        VK_IMAGE_TYPE_3D, 1, 1, VK_SAMPLE_COUNT_1_BIT, lut_usage_flags, false );
+    atms.transmittance = engine::allocate_image( vulkan, TRANSMITTANCE_LUT_EXTENT, LUT_FORMAT,
+        VK_IMAGE_TYPE_2D, 1, 1, VK_SAMPLE_COUNT_1_BIT, lut_usage_flags, false );
+
+    // Per order of scattering. Multiple scattering goes into `delta_rayleigh` once single
+    // scattering is done with it, like in the reference implementation.
+    vk::mem::AllocatedImage delta_irradiance = engine::allocate_image( vulkan,
+        IRRADIANCE_LUT_EXTENT, LUT_FORMAT, VK_IMAGE_TYPE_2D, 1, 1, VK_SAMPLE_COUNT_1_BIT,
+        usage_flags, false );
+    vk::mem::AllocatedImage delta_rayleigh = engine::allocate_image( vulkan, SCATTERING_LUT_EXTENT,
+        LUT_FORMAT, VK_IMAGE_TYPE_3D, 1, 1, VK_SAMPLE_COUNT_1_BIT, usage_flags, false );
+    vk::mem::AllocatedImage delta_mie = engine::allocate_image( vulkan, SCATTERING_LUT_EXTENT,
+        LUT_FORMAT, VK_IMAGE_TYPE_3D, 1, 1, VK_SAMPLE_COUNT_1_BIT, usage_flags, false );
+    vk::mem::AllocatedImage delta_scattering_density = engine::allocate_image( vulkan,
+        SCATTERING_LUT_EXTENT, LUT_FORMAT, VK_IMAGE_TYPE_3D, 1, 1, VK_SAMPLE_COUNT_1_BIT,
+        usage_flags, false );
+
+    std::array<const vk::mem::AllocatedImage*, 7> images = { &atms.transmittance,
+        &atms.irradiance, &atms.scattering, &delta_irradiance, &delta_rayleigh, &delta_mie,
+        &delta_scattering_density };
+
+    UniformBuffer<ub_data::AtmospherePrecompute> uniform_buffer
+        = create_uniform_buffer<ub_data::AtmospherePrecompute>( vulkan,
+            { .atmosphere = to_ub_data( parameters ) },
+            static_cast<size_t>( engine.frame_overlap ) );
+
+    engine::DescriptorSet uniform_desc_set = engine::generate_descriptor_set(
+        vulkan, engine, { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }, VK_SHADER_STAGE_COMPUTE_BIT );
+    engine::update_descriptor_set_uniform( vulkan, engine, uniform_desc_set, uniform_buffer, 0 );
+
+    // The same images are sampled and written, just never the same one in one pass
+    engine::DescriptorSet read_desc_set = engine::generate_descriptor_set( vulkan, engine,
+        std::vector<VkDescriptorType>( 5, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ),
+        VK_SHADER_STAGE_COMPUTE_BIT );
+    engine::DescriptorSet write_desc_set = engine::generate_descriptor_set( vulkan, engine,
+        std::vector<VkDescriptorType>( images.size(), VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ),
+        VK_SHADER_STAGE_COMPUTE_BIT );
+
+    std::array<const vk::mem::AllocatedImage*, 5> read_images = { &atms.transmittance,
+        &delta_irradiance, &delta_rayleigh, &delta_mie, &delta_scattering_density };
+
+    for ( size_t i = 0; i < read_images.size(); i++ ) {
+        engine::update_descriptor_set_image( vulkan, engine, read_desc_set, *read_images[i],
+            static_cast<int>( i ), VK_IMAGE_LAYOUT_GENERAL );
+    }
+
+    for ( size_t i = 0; i < images.size(); i++ ) {
+        engine::update_descriptor_set_write_image(
+            vulkan, engine, write_desc_set, *images[i], static_cast<int>( i ) );
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts = {
+        uniform_desc_set.layouts[0],
+        read_desc_set.layouts[0],
+        atms.sampler_desc_set.layouts[0],
+        write_desc_set.layouts[0],
+    };
+    std::array<VkDescriptorSet, 4> desc_sets = {
+        uniform_desc_set.descriptor_sets[0],
+        read_desc_set.descriptor_sets[0],
+        atms.sampler_desc_set.descriptor_sets[0],
+        write_desc_set.descriptor_sets[0],
+    };
+
+    VkShaderModule shader_module = vk::create::shader_module( vulkan, PRECOMPUTE_SHADER_PATH );
+    auto create_pipeline = [&]( std::string_view entry_name ) {
+        return engine::create_compute_pipeline( vulkan, layouts, shader_module, entry_name );
+    };
+
+    engine::Pipeline transmittance_pipeline = create_pipeline( "cs_transmittance" );
+    engine::Pipeline direct_irradiance_pipeline = create_pipeline( "cs_direct_irradiance" );
+    engine::Pipeline single_scattering_pipeline = create_pipeline( "cs_single_scattering" );
+    engine::Pipeline scattering_density_pipeline = create_pipeline( "cs_scattering_density" );
+    engine::Pipeline indirect_irradiance_pipeline = create_pipeline( "cs_indirect_irradiance" );
+    engine::Pipeline multiple_scattering_pipeline = create_pipeline( "cs_multiple_scattering" );
+
+    engine::immediate_submit( vulkan, engine.immediate_submit, [&]( VkCommandBuffer cmd_buf ) {
+        for ( const vk::mem::AllocatedImage* image : images ) {
+            vk::utility::transition_image( cmd_buf, image->image, VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT );
+        }
+
+        dispatch( cmd_buf, transmittance_pipeline, desc_sets, TRANSMITTANCE_LUT_EXTENT );
+        dispatch( cmd_buf, direct_irradiance_pipeline, desc_sets, IRRADIANCE_LUT_EXTENT );
+        dispatch( cmd_buf, single_scattering_pipeline, desc_sets, SCATTERING_LUT_EXTENT );
+    } );
+
+    // One submission per order, the scattering density pass alone can take a good while on
+    // slower GPUs. Waiting on each also makes the uniform buffer safe to overwrite.
+    for ( int32_t order = 2; order <= SCATTERING_ORDERS; order++ ) {
+        uniform_buffer.set_data( {
+            .atmosphere = to_ub_data( parameters ),
+            .scattering_order = order,
+        } );
+        uniform_buffer.update( vulkan, 0 );
+
+        engine::immediate_submit( vulkan, engine.immediate_submit, [&]( VkCommandBuffer cmd_buf ) {
+            dispatch( cmd_buf, scattering_density_pipeline, desc_sets, SCATTERING_LUT_EXTENT );
+            dispatch( cmd_buf, indirect_irradiance_pipeline, desc_sets, IRRADIANCE_LUT_EXTENT );
+            dispatch( cmd_buf, multiple_scattering_pipeline, desc_sets, SCATTERING_LUT_EXTENT );
+        } );
+    }
+
+    // Read the LUTs back for the cache, and leave them ready for sampling
+    std::array<const vk::mem::AllocatedImage*, 3> luts
+        = { &atms.irradiance, &atms.scattering, &atms.transmittance };
+    std::array<size_t, 3> offsets = {};
+    size_t readback_size = 0;
+
+    for ( size_t i = 0; i < luts.size(); i++ ) {
+        offsets[i] = readback_size;
+        readback_size += texel_float_count( luts[i]->image_extent ) * sizeof( float );
+    }
+
+    vk::mem::AllocatedBuffer readback_buffer = vk::mem::create_buffer(
+        vulkan, readback_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU );
+
+    engine::immediate_submit( vulkan, engine.immediate_submit, [&]( VkCommandBuffer cmd_buf ) {
+        for ( size_t i = 0; i < luts.size(); i++ ) {
+            vk::utility::transition_image( cmd_buf, luts[i]->image, VK_IMAGE_LAYOUT_GENERAL,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_IMAGE_ASPECT_COLOR_BIT );
+
+            VkBufferImageCopy copy_region = {
+                .bufferOffset = offsets[i],
+                .imageSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = 0,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+                .imageExtent = luts[i]->image_extent,
+            };
+            vkCmdCopyImageToBuffer( cmd_buf, luts[i]->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                readback_buffer.handle, 1, &copy_region );
+
+            vk::utility::transition_image( cmd_buf, luts[i]->image,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT );
+        }
+    } );
+
+    vmaInvalidateAllocation( vulkan.allocator, readback_buffer.allocation, 0, VK_WHOLE_SIZE );
+
+    LutData lut_data;
+    std::array<std::vector<float>*, 3> outputs
+        = { &lut_data.irradiance, &lut_data.scattering, &lut_data.transmittance };
+    const unsigned char* mapped
+        = static_cast<const unsigned char*>( readback_buffer.info.pMappedData );
+
+    for ( size_t i = 0; i < luts.size(); i++ ) {
+        outputs[i]->resize( texel_float_count( luts[i]->image_extent ) );
+        std::memcpy(
+            outputs[i]->data(), mapped + offsets[i], outputs[i]->size() * sizeof( float ) );
+    }
+
+    return lut_data;
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "atmosphere.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+/// In-engine precomputation of the sky LUTs ("Precomputed Atmospheric Scattering", Bruneton and
+/// Neyret 2008, after the 2017 reference implementation), and an on-disk cache of the results.
+///
+/// The passes run once per set of parameters: transmittance, direct irradiance and single
+/// scattering, then scattering density, indirect irradiance and multiple scattering for each
+/// higher order. The results are read back and cached under a hash of the parameters, so the next
+/// launch with the same atmosphere only has to upload them.
+namespace racecar::atmosphere {
+
+/// Bump whenever the layout of the cache or the host side of the precomputation changes, like the
+/// order of the passes or their formats. Goes into the hash, so older caches just stop being
+/// found. Edits to precompute.slang don't need a bump, the built precompute.spv is hashed as well.
+constexpr uint32_t LUT_CACHE_VERSION = 1;
+
+constexpr std::string_view LUT_CACHE_DIRECTORY = "../assets/atmosphere/cache";
+constexpr std::string_view LUT_CACHE_EXTENSION = ".rcsky";
+
+/// Orders of scattering the LUTs include, single scattering being the first.
+constexpr int32_t SCATTERING_ORDERS = 4;
+
+/// Mirrors the sizes in `constants.slang`.
+constexpr VkExtent3D IRRADIANCE_LUT_EXTENT = { .width = 64, .height = 16, .depth = 1 };
+constexpr VkExtent3D SCATTERING_LUT_EXTENT = { .width = 256, .height = 128, .depth = 32 };
+constexpr VkExtent3D TRANSMITTANCE_LUT_EXTENT = { .width = 256, .height = 64, .depth = 1 };
+
+/// RGBA32F texels, rows tightly packed.
+struct LutData {
+    std::vector<float> irradiance;
+    std::vector<float> scattering;
+    std::vector<float> transmittance;
+};
+
+ub_data::AtmosphereParameters to_ub_data( const Parameters& parameters );
+
+/// Whether precompute.spv has been built, see compile_atms_precompute.ps1.
+bool has_precompute_shader();
+
+/// FNV-1a over the parameters as the shaders see them, the LUT sizes, `LUT_CACHE_VERSION` and the
+/// contents of precompute.spv.
+uint64_t hash_parameters( const Parameters& parameters );
+
+std::filesystem::path lut_cache_path( uint64_t parameters_hash );
+
+/// Returns nothing if the cache is missing, from other parameters, or truncated.
+std::optional<LutData> read_lut_cache(
+    const std::filesystem::path& cache_path, uint64_t parameters_hash );
+
+void write_lut_cache(
+    const std::filesystem::path& cache_path, uint64_t parameters_hash, const LutData& luts );
+
+/// Creates `atms.irradiance`, `atms.scattering` and `atms.transmittance` and runs every pass into
+/// them, blocking until they're done. Returns their texels for the cache.
+LutData precompute_luts(
+    vk::Common& vulkan, engine::State& engine, Atmosphere& atms, const Parameters& parameters );
+
+}
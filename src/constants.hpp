@@ -1,8 +1,15 @@
 #pragma once
 
+#include <cstdint>
+
 namespace racecar::constant {
 
 constexpr int SCREEN_W = 1920;
 constexpr int SCREEN_H = 1080;
 
+/// How many frames the CPU is allowed to record ahead of the GPU. Everything that's touched per
+/// frame (command buffers, uniform buffer slices, descriptor sets, RWImages and depth) is allocated
+/// this many times, no matter how many images the swapchain ended up with.
+constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+
 } // namespace racecar::constant
@@ -1,5 +1,7 @@
 #include "deferred.hpp"
 
+#include "engine/transient.hpp"
+
 namespace racecar::deferred {
 
 GBuffers initialize_GBuffers( vk::Common& vulkan, engine::State& engine )
@@ -25,19 +27,19 @@ GBuffers initialize_GBuffers( vk::Common& vulkan, engine::State& engine )
     gbuffers.GBuffer_Packed_Data = engine::create_gbuffer_image(
         vulkan, engine, VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT );
 
-    gbuffers.GBuffer_Depth = engine::create_rwimage( vulkan, engine,
+    gbuffers.GBuffer_Depth = engine::create_transient_rwimage( vulkan, engine,
         VkExtent3D( engine.swapchain.extent.width, engine.swapchain.extent.height, 1 ),
-        VkFormat::VK_FORMAT_D32_SFLOAT, VkImageType::VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+        VkFormat::VK_FORMAT_D32_SFLOAT, VK_SAMPLE_COUNT_1_BIT,
         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT );
 
-    gbuffers.GBuffer_DepthMS = engine::create_rwimage( vulkan, engine,
+    gbuffers.GBuffer_DepthMS = engine::create_transient_rwimage( vulkan, engine,
         VkExtent3D( engine.swapchain.extent.width, engine.swapchain.extent.height, 1 ),
-        VkFormat::VK_FORMAT_D32_SFLOAT, VkImageType::VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_4_BIT,
+        VkFormat::VK_FORMAT_D32_SFLOAT, VK_SAMPLE_COUNT_4_BIT,
         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT );
 
-    gbuffers.GBuffer_Velocity = engine::create_rwimage( vulkan, engine,
+    gbuffers.GBuffer_Velocity = engine::create_transient_rwimage( vulkan, engine,
         VkExtent3D( engine.swapchain.extent.width, engine.swapchain.extent.height, 1 ),
-        VkFormat::VK_FORMAT_R16G16_SFLOAT, VkImageType::VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+        VkFormat::VK_FORMAT_R16G16_SFLOAT, VK_SAMPLE_COUNT_1_BIT,
         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT );
 
     gbuffers.desc_set = engine::generate_descriptor_set( vulkan, engine,
@@ -0,0 +1,156 @@
+#include "bindless.hpp"
+
+#include "../exception.hpp"
+#include "../log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace racecar::engine {
+
+namespace {
+
+constexpr uint32_t TEXTURES_BINDING = 0;
+constexpr uint32_t MATERIALS_BINDING = 1;
+constexpr uint32_t INSTANCES_BINDING = 2;
+
+void write_buffer( vk::Common& vulkan, VkDescriptorSet desc_set, uint32_t binding,
+    const vk::mem::AllocatedBuffer& buffer )
+{
+    VkDescriptorBufferInfo buffer_info = {
+        .buffer = buffer.handle,
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = desc_set,
+        .dstBinding = binding,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = &buffer_info,
+    };
+
+    vkUpdateDescriptorSets( vulkan.device, 1, &write, 0, nullptr );
+}
+
+}
+
+Bindless create_bindless( vk::Common& vulkan, const State& engine,
+    std::span<const std::optional<vk::mem::AllocatedImage>> textures, size_t num_materials )
+{
+    Bindless bindless;
+
+    // Zero-sized bindings and buffers aren't allowed, keep at least one slot of each
+    bindless.texture_capacity = std::max( static_cast<uint32_t>( textures.size() ), 1u );
+    bindless.num_materials = num_materials;
+
+    uint32_t num_sets = engine.frame_overlap;
+
+    std::vector<DescriptorAllocator::PoolSizeRatio> pool_sizes = {
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, static_cast<float>( bindless.texture_capacity ) },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 },
+    };
+
+    descriptor_allocator::init_pool( vulkan, bindless.allocator, num_sets, pool_sizes,
+        VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT );
+
+    DescriptorLayoutBuilder builder;
+    descriptor_layout_builder::add_bindless_binding(
+        builder, TEXTURES_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, bindless.texture_capacity );
+    descriptor_layout_builder::add_binding(
+        builder, MATERIALS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER );
+    descriptor_layout_builder::add_binding(
+        builder, INSTANCES_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER );
+
+    VkDescriptorSetLayout layout = descriptor_layout_builder::build( vulkan,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT,
+        builder, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT );
+
+    bindless.desc_set.layouts.assign( num_sets, layout );
+
+    for ( uint32_t i = 0; i < num_sets; i++ ) {
+        bindless.desc_set.descriptor_sets.push_back(
+            descriptor_allocator::allocate( vulkan, bindless.allocator, layout ) );
+
+        bindless.material_buffers.push_back( vk::mem::create_buffer( vulkan,
+            std::max( num_materials, size_t( 1 ) ) * sizeof( ub_data::Material ),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU ) );
+
+        write_buffer( vulkan, bindless.desc_set.descriptor_sets[i], MATERIALS_BINDING,
+            bindless.material_buffers[i] );
+    }
+
+    uint32_t num_textures = 0;
+
+    for ( size_t i = 0; i < textures.size(); i++ ) {
+        if ( textures[i].has_value() ) {
+            update_bindless_texture( vulkan, bindless, static_cast<uint32_t>( i ), *textures[i] );
+            num_textures++;
+        }
+    }
+
+    log::info( "[Bindless] {} textures and {} materials", num_textures, num_materials );
+
+    return bindless;
+}
+
+void update_bindless_texture( vk::Common& vulkan, Bindless& bindless, uint32_t index,
+    const vk::mem::AllocatedImage& texture )
+{
+    if ( index >= bindless.texture_capacity ) {
+        throw Exception( "[Bindless] Texture {} is past the capacity of {}", index,
+            bindless.texture_capacity );
+    }
+
+    VkDescriptorImageInfo image_info = {
+        .sampler = VK_NULL_HANDLE,
+        .imageView = texture.image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    for ( VkDescriptorSet desc_set : bindless.desc_set.descriptor_sets ) {
+        VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = desc_set,
+            .dstBinding = TEXTURES_BINDING,
+            .dstArrayElement = index,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            .pImageInfo = &image_info,
+        };
+
+        vkUpdateDescriptorSets( vulkan.device, 1, &write, 0, nullptr );
+    }
+}
+
+void update_bindless_instances( vk::Common& vulkan, const State& engine, Bindless& bindless,
+    std::span<const ub_data::Instance> instances )
+{
+    size_t size = std::max( instances.size_bytes(), sizeof( ub_data::Instance ) );
+
+    bindless.instance_buffer = vk::mem::create_buffer(
+        vulkan, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU );
+
+    std::memcpy(
+        bindless.instance_buffer.info.pMappedData, instances.data(), instances.size_bytes() );
+    vmaFlushAllocation( vulkan.allocator, bindless.instance_buffer.allocation, 0, VK_WHOLE_SIZE );
+
+    for ( size_t i = 0; i < engine.frame_overlap; i++ ) {
+        write_buffer( vulkan, bindless.desc_set.descriptor_sets[i], INSTANCES_BINDING,
+            bindless.instance_buffer );
+    }
+}
+
+void update_bindless_materials( vk::Common& vulkan, const State& engine, Bindless& bindless,
+    std::span<const ub_data::Material> materials )
+{
+    const vk::mem::AllocatedBuffer& buffer = bindless.material_buffers[engine.get_frame_index()];
+    size_t count = std::min( materials.size(), bindless.num_materials );
+
+    std::memcpy( buffer.info.pMappedData, materials.data(), count * sizeof( ub_data::Material ) );
+    vmaFlushAllocation( vulkan.allocator, buffer.allocation, 0, VK_WHOLE_SIZE );
+}
+
+} // namespace racecar::engine
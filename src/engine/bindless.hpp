@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../vk/common.hpp"
+#include "../vk/mem.hpp"
+#include "descriptor_set.hpp"
+#include "descriptors.hpp"
+#include "state.hpp"
+#include "ub_data.hpp"
+
+#include <volk.h>
+
+#include <optional>
+#include <span>
+#include <vector>
+
+/// Every scene texture and material in one descriptor set that the prepass, the lighting pass and
+/// the reflections all bind as is. Shaders index the textures with the indices in
+/// `ub_data::Material`, the materials with the material id, and the instances with the instance
+/// index of a draw or of a ray hit. Nothing about it changes between draws.
+///
+/// | Binding | Contents                                          |
+/// |---------|---------------------------------------------------|
+/// | 0       | `Texture2D[]`, partially bound, update after bind |
+/// | 1       | `StructuredBuffer<ub_data::Material>`, per frame  |
+/// | 2       | `StructuredBuffer<ub_data::Instance>`             |
+namespace racecar::engine {
+
+struct Bindless {
+    /// Update-after-bind sets can't come from the frame allocators.
+    DescriptorAllocator allocator;
+    DescriptorSet desc_set;
+
+    uint32_t texture_capacity = 0;
+    size_t num_materials = 0;
+
+    std::vector<vk::mem::AllocatedBuffer> material_buffers;
+    vk::mem::AllocatedBuffer instance_buffer;
+};
+
+/// `textures` takes the same indices as `scene.textures`, the ones without an image are left
+/// unwritten.
+Bindless create_bindless( vk::Common& vulkan, const State& engine,
+    std::span<const std::optional<vk::mem::AllocatedImage>> textures, size_t num_materials );
+
+/// Can be called while a frame using the set is in flight, as long as the shaders in flight never
+/// read slot `index`.
+void update_bindless_texture( vk::Common& vulkan, Bindless& bindless, uint32_t index,
+    const vk::mem::AllocatedImage& texture );
+
+/// Has to be called before the set is first used.
+void update_bindless_instances( vk::Common& vulkan, const State& engine, Bindless& bindless,
+    std::span<const ub_data::Instance> instances );
+
+/// Copies the materials into the current frame's buffer. Only once the frame's previous
+/// submission is done, i.e. after `engine::begin_frame`.
+void update_bindless_materials( vk::Common& vulkan, const State& engine, Bindless& bindless,
+    std::span<const ub_data::Material> materials );
+
+} // namespace racecar::engine
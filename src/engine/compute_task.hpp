@@ -2,6 +2,7 @@
 
 #include "descriptor_set.hpp"
 #include "pipeline.hpp"
+#include "render_graph.hpp"
 
 #include <glm/glm.hpp>
 
@@ -13,6 +14,11 @@ struct ComputeTask {
 
     glm::ivec3 group_size;
 
+    /// Every image the task reads or writes. Leaving this empty opts the task out of the render
+    /// graph: it keeps whatever hand-placed barriers are around it and is never culled. Declared
+    /// tasks also have to declare everything they write, or they may get culled.
+    std::vector<ImageUse> image_uses;
+
     // temporary addition
     bool is_single_run = false;
     bool ran = false;
@@ -0,0 +1,205 @@
+#include "dds.hpp"
+
+#include "../exception.hpp"
+#include "../log.hpp"
+#include "texture_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace racecar::engine {
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x20534444; // "DDS "
+constexpr uint32_t FOURCC_DX10 = 0x30315844; // "DX10"
+
+constexpr uint32_t DDSD_CAPS = 0x1;
+constexpr uint32_t DDSD_HEIGHT = 0x2;
+constexpr uint32_t DDSD_WIDTH = 0x4;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+constexpr uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+struct PixelFormat {
+    uint32_t size = sizeof( PixelFormat );
+    uint32_t flags = 0;
+    uint32_t four_cc = 0;
+    uint32_t rgb_bit_count = 0;
+    std::array<uint32_t, 4> bit_masks = {};
+};
+
+struct Header {
+    uint32_t magic = MAGIC;
+    uint32_t size = 124; ///< Of the DDS_HEADER part, which doesn't count the magic.
+    uint32_t flags = 0;
+    uint32_t height = 0;
+    uint32_t width = 0;
+    uint32_t pitch_or_linear_size = 0;
+    uint32_t depth = 0;
+    uint32_t mip_map_count = 0;
+    std::array<uint32_t, 11> reserved1 = {};
+    PixelFormat pixel_format;
+    uint32_t caps = 0;
+    uint32_t caps2 = 0;
+    uint32_t caps3 = 0;
+    uint32_t caps4 = 0;
+    uint32_t reserved2 = 0;
+
+    // DDS_HEADER_DXT10
+    uint32_t dxgi_format = 0;
+    uint32_t resource_dimension = 0;
+    uint32_t misc_flag = 0;
+    uint32_t array_size = 0;
+    uint32_t misc_flags2 = 0;
+};
+
+static_assert( sizeof( PixelFormat ) == 32 );
+static_assert( sizeof( Header ) == 4 + 124 + 20 );
+static_assert( std::is_trivially_copyable_v<Header> );
+
+struct FormatMapping {
+    VkFormat format;
+    uint32_t dxgi_format;
+};
+
+constexpr std::array<FormatMapping, 7> FORMAT_MAPPINGS = { {
+    { VK_FORMAT_BC1_RGB_UNORM_BLOCK, 71 },
+    { VK_FORMAT_BC1_RGB_SRGB_BLOCK, 72 },
+    { VK_FORMAT_BC4_UNORM_BLOCK, 80 },
+    { VK_FORMAT_BC5_UNORM_BLOCK, 83 },
+    { VK_FORMAT_BC6H_UFLOAT_BLOCK, 95 },
+    { VK_FORMAT_BC7_UNORM_BLOCK, 98 },
+    { VK_FORMAT_BC7_SRGB_BLOCK, 99 },
+} };
+
+uint32_t to_dxgi( VkFormat format )
+{
+    for ( const FormatMapping& mapping : FORMAT_MAPPINGS ) {
+        if ( mapping.format == format ) {
+            return mapping.dxgi_format;
+        }
+    }
+
+    return 0;
+}
+
+VkFormat from_dxgi( uint32_t dxgi_format )
+{
+    for ( const FormatMapping& mapping : FORMAT_MAPPINGS ) {
+        if ( mapping.dxgi_format == dxgi_format ) {
+            return mapping.format;
+        }
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+}
+
+std::filesystem::path baked_texture_path( const std::filesystem::path& source_path )
+{
+    std::filesystem::path path = source_path;
+    path.replace_extension( ".dds" );
+    return path;
+}
+
+void write_dds( const std::filesystem::path& path, const CompressedImage& image )
+{
+    uint32_t dxgi_format = to_dxgi( image.format );
+    if ( dxgi_format == 0 ) {
+        throw Exception( "[DDS] Format {} isn't supported", static_cast<int>( image.format ) );
+    }
+
+    if ( image.data.size()
+        != compressed_size( image.format, image.width, image.height, image.mip_levels ) ) {
+        throw Exception( "[DDS] {} bytes don't match a {}x{} image with {} mips",
+            image.data.size(), image.width, image.height, image.mip_levels );
+    }
+
+    Header header = {
+        .flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT
+            | DDSD_LINEARSIZE,
+        .height = image.height,
+        .width = image.width,
+        .pitch_or_linear_size
+        = static_cast<uint32_t>( compressed_size( image.format, image.width, image.height, 1 ) ),
+        .mip_map_count = image.mip_levels,
+        .pixel_format = { .flags = DDPF_FOURCC, .four_cc = FOURCC_DX10 },
+        .caps = DDSCAPS_TEXTURE | ( image.mip_levels > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0 ),
+        .dxgi_format = dxgi_format,
+        .resource_dimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D,
+        .array_size = 1,
+    };
+
+    std::ofstream file( path, std::ios::binary | std::ios::trunc );
+    if ( !file.is_open() ) {
+        throw Exception( "[DDS] Could not open \"{}\" for writing", path.string() );
+    }
+
+    file.write( reinterpret_cast<const char*>( &header ), sizeof( Header ) );
+    file.write( reinterpret_cast<const char*>( image.data.data() ),
+        static_cast<std::streamsize>( image.data.size() ) );
+
+    if ( !file.good() ) {
+        throw Exception( "[DDS] Failed writing \"{}\"", path.string() );
+    }
+}
+
+std::optional<CompressedImage> read_dds( const std::filesystem::path& path )
+{
+    std::ifstream file( path, std::ios::binary | std::ios::ate );
+    if ( !file.is_open() ) {
+        return std::nullopt;
+    }
+
+    size_t file_size = static_cast<size_t>( file.tellg() );
+    file.seekg( 0 );
+
+    Header header;
+    if ( file_size < sizeof( Header )
+        || !file.read( reinterpret_cast<char*>( &header ), sizeof( Header ) ) ) {
+        log::warn( "[DDS] \"{}\" is too small, ignoring it", path.string() );
+        return std::nullopt;
+    }
+
+    CompressedImage image = {
+        .format = from_dxgi( header.dxgi_format ),
+        .width = header.width,
+        .height = header.height,
+        .mip_levels = std::max( header.mip_map_count, 1u ),
+    };
+
+    bool is_supported = header.magic == MAGIC && header.pixel_format.four_cc == FOURCC_DX10
+        && header.resource_dimension == D3D10_RESOURCE_DIMENSION_TEXTURE2D
+        && header.array_size == 1 && image.format != VK_FORMAT_UNDEFINED && image.width > 0
+        && image.height > 0;
+
+    if ( !is_supported ) {
+        log::warn( "[DDS] \"{}\" isn't a block-compressed 2D texture, ignoring it", path.string() );
+        return std::nullopt;
+    }
+
+    size_t data_size
+        = compressed_size( image.format, image.width, image.height, image.mip_levels );
+    if ( file_size - sizeof( Header ) < data_size ) {
+        log::warn( "[DDS] \"{}\" is truncated, ignoring it", path.string() );
+        return std::nullopt;
+    }
+
+    image.data.resize( data_size );
+    file.read( reinterpret_cast<char*>( image.data.data() ),
+        static_cast<std::streamsize>( data_size ) );
+
+    return image;
+}
+
+} // namespace racecar::engine
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "texture_compression.hpp"
+
+#include <filesystem>
+#include <optional>
+
+/// Minimal DDS (DX10 header) reading and writing, just enough for the block-compressed 2D textures
+/// racecar-bake produces. Anything else is rejected.
+namespace racecar::engine {
+
+/// Where the baked version of a source image lives, i.e. right next to it.
+std::filesystem::path baked_texture_path( const std::filesystem::path& source_path );
+
+void write_dds( const std::filesystem::path& path, const CompressedImage& image );
+
+/// Returns nothing if the file is missing, malformed or in a format we don't handle.
+std::optional<CompressedImage> read_dds( const std::filesystem::path& path );
+
+} // namespace racecar::engine
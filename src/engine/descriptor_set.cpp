@@ -2,13 +2,14 @@
 
 #include "descriptors.hpp"
 #include "state.hpp"
+#include "transient.hpp"
 
 namespace racecar::engine {
 
 DescriptorSet generate_descriptor_set( vk::Common& vulkan, const engine::State& engine,
     const std::vector<VkDescriptorType>& types, VkShaderStageFlags shader_stage_flags )
 {
-    const size_t num_frames = engine.swapchain_images.size();
+    const size_t num_frames = engine.frame_overlap;
 
     DescriptorSet desc_set = {
         .descriptor_sets = std::vector<VkDescriptorSet>( num_frames ),
@@ -20,6 +21,10 @@ DescriptorSet generate_descriptor_set( vk::Common& vulkan, const engine::State&
 
         for ( uint32_t i = 0; i < static_cast<uint32_t>( types.size() ); ++i ) {
             engine::descriptor_layout_builder::add_binding( builder, i, types[i] );
+
+            if ( types[i] == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ) {
+                desc_set.num_dynamic_offsets++;
+            }
         }
 
         for ( size_t i = 0; i < num_frames; ++i ) {
@@ -39,7 +44,7 @@ DescriptorSet generate_descriptor_set( vk::Common& vulkan, const engine::State&
 DescriptorSet generate_array_descriptor_set( vk::Common& vulkan, const engine::State& engine,
     const std::vector<VkDescriptorType>& types, VkShaderStageFlags shader_stage_flags, uint32_t count )
 {
-    const size_t num_frames = engine.swapchain_images.size();
+    const size_t num_frames = engine.frame_overlap;
 
     DescriptorSet desc_set = {
         .descriptor_sets = std::vector<VkDescriptorSet>( num_frames ),
@@ -68,13 +73,13 @@ DescriptorSet generate_array_descriptor_set( vk::Common& vulkan, const engine::S
 }
 
 void update_descriptor_set_image( vk::Common& vulkan, State& engine, DescriptorSet& desc_set,
-    vk::mem::AllocatedImage img, int binding_idx )
+    vk::mem::AllocatedImage img, int binding_idx, VkImageLayout img_layout )
 {
     for ( size_t i = 0; i < engine.frame_overlap; ++i ) {
         VkDescriptorImageInfo desc_image_info = {
             .sampler = VK_NULL_HANDLE,
             .imageView = img.image_view,
-            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .imageLayout = img_layout,
         };
 
         VkWriteDescriptorSet write_desc_set = {
@@ -118,6 +123,18 @@ void update_descriptor_set_image_array( vk::Common& vulkan, State& engine, Descr
 void update_descriptor_set_rwimage( vk::Common& vulkan, const State& engine,
     DescriptorSet& desc_set, const RWImage& rw_img, VkImageLayout img_layout, int binding_idx )
 {
+    if ( is_unbound( rw_img ) ) {
+        desc_set.deferred_writes.push_back( {
+            .image = rw_img.images[0].image,
+            .layout = img_layout,
+            .type = ( img_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL )
+                ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+                : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .binding = static_cast<uint32_t>( binding_idx ),
+        } );
+        return;
+    }
+
     for ( size_t i = 0; i < engine.frame_overlap; ++i ) {
         const vk::mem::AllocatedImage& alloc_image = rw_img.images[i];
 
@@ -173,6 +190,16 @@ void update_descriptor_set_rwimage_mip( vk::Common& vulkan, const State& engine,
 void update_descriptor_set_depth_image(
     vk::Common& vulkan, State& engine, DescriptorSet& desc_set, RWImage depth_img, int binding_idx )
 {
+    if ( is_unbound( depth_img ) ) {
+        desc_set.deferred_writes.push_back( {
+            .image = depth_img.images[0].image,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+            .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            .binding = static_cast<uint32_t>( binding_idx ),
+        } );
+        return;
+    }
+
     for ( size_t i = 0; i < engine.frame_overlap; ++i ) {
         vk::mem::AllocatedImage& img = depth_img.images[i];
         VkDescriptorImageInfo desc_image_info = {
@@ -217,6 +244,39 @@ void update_descriptor_set_write_image( vk::Common& vulkan, State& engine, Descr
     }
 }
 
+void flush_deferred_writes( vk::Common& vulkan, const State& engine, DescriptorSet& desc_set )
+{
+    for ( const DeferredImageWrite& deferred_write : desc_set.deferred_writes ) {
+        const TransientImage* transient = find_transient_image( engine, deferred_write.image );
+
+        if ( transient == nullptr || transient->image.image_view == VK_NULL_HANDLE ) {
+            throw Exception( "[DescriptorSet] Deferred write of binding {} has no image to go to",
+                deferred_write.binding );
+        }
+
+        for ( size_t i = 0; i < engine.frame_overlap; ++i ) {
+            VkDescriptorImageInfo desc_image_info = {
+                .sampler = VK_NULL_HANDLE,
+                .imageView = transient->image.image_view,
+                .imageLayout = deferred_write.layout,
+            };
+
+            VkWriteDescriptorSet write_desc_set = {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = desc_set.descriptor_sets[i],
+                .dstBinding = deferred_write.binding,
+                .descriptorCount = 1,
+                .descriptorType = deferred_write.type,
+                .pImageInfo = &desc_image_info,
+            };
+
+            vkUpdateDescriptorSets( vulkan.device, 1, &write_desc_set, 0, nullptr );
+        }
+    }
+
+    desc_set.deferred_writes.clear();
+}
+
 void update_descriptor_set_sampler( vk::Common& vulkan, const State& engine,
     DescriptorSet& desc_set, VkSampler sampler, int binding_idx )
 {
@@ -288,4 +348,51 @@ void update_descriptor_set_const_storage_buffer( vk::Common& vulkan, const State
     }
 }
 
+void update_descriptor_set_uniform_ring( vk::Common& vulkan, const State& engine,
+    DescriptorSet& desc_set, const UniformRing& ring, VkDeviceSize range, int binding_idx )
+{
+    for ( size_t i = 0; i < engine.frame_overlap; ++i ) {
+        VkDescriptorBufferInfo buffer_info = {
+            .buffer = ring.buffer.handle,
+            .offset = ring.region_size * i,
+            .range = range,
+        };
+
+        VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = desc_set.descriptor_sets[i],
+            .dstBinding = static_cast<uint32_t>( binding_idx ),
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .pBufferInfo = &buffer_info,
+        };
+
+        vkUpdateDescriptorSets( vulkan.device, 1, &write, 0, nullptr );
+    }
+}
+
+void update_descriptor_set_frame_buffers( vk::Common& vulkan, const State& engine,
+    DescriptorSet& desc_set, const std::vector<vk::mem::AllocatedBuffer>& buffers,
+    VkDescriptorType type, int binding_idx )
+{
+    for ( size_t i = 0; i < engine.frame_overlap; ++i ) {
+        VkDescriptorBufferInfo buffer_info = {
+            .buffer = buffers[i].handle,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = desc_set.descriptor_sets[i],
+            .dstBinding = static_cast<uint32_t>( binding_idx ),
+            .descriptorCount = 1,
+            .descriptorType = type,
+            .pBufferInfo = &buffer_info,
+        };
+
+        vkUpdateDescriptorSets( vulkan.device, 1, &write, 0, nullptr );
+    }
+}
+
 } // namespace racecar::engine
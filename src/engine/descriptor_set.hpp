@@ -4,6 +4,7 @@
 #include "rwimage.hpp"
 #include "state.hpp"
 #include "uniform_buffer.hpp"
+#include "uniform_ring.hpp"
 
 #include <volk.h>
 
@@ -11,9 +12,23 @@
 
 namespace racecar::engine {
 
+/// Points a binding at a transient image that has no memory, and so no view, yet.
+struct DeferredImageWrite {
+    VkImage image = VK_NULL_HANDLE;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkDescriptorType type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    uint32_t binding = 0;
+};
+
 struct DescriptorSet {
     std::vector<VkDescriptorSet> descriptor_sets;
     std::vector<VkDescriptorSetLayout> layouts;
+
+    /// How many of a draw's dynamic offsets go to this set, one per dynamic uniform buffer.
+    uint32_t num_dynamic_offsets = 0;
+
+    /// Written by `flush_deferred_writes` once the images are bound, see `bind_transient_images`.
+    std::vector<DeferredImageWrite> deferred_writes;
 };
 
 DescriptorSet generate_descriptor_set( vk::Common& vulkan, const engine::State& engine,
@@ -27,11 +42,9 @@ template <typename UBData>
 void update_descriptor_set_uniform( vk::Common& vulkan, const State& engine,
     DescriptorSet& desc_set, UniformBuffer<UBData> uniform_buffer, int binding_idx )
 {
-    VkBuffer buffer = uniform_buffer.buffer( engine.get_frame_index() ).handle;
-
     for ( size_t i = 0; i < engine.frame_overlap; ++i ) {
         VkDescriptorBufferInfo buffer_info = {
-            .buffer = buffer,
+            .buffer = uniform_buffer.buffer( i ).handle,
             .offset = 0,
             .range = sizeof( UBData ),
         };
@@ -49,11 +62,22 @@ void update_descriptor_set_uniform( vk::Common& vulkan, const State& engine,
     }
 }
 
+/// Points a `VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC` binding at each frame's region of the ring.
+/// Draws pick the allocation with their dynamic offset, `range` is how much one of them reads.
+void update_descriptor_set_uniform_ring( vk::Common& vulkan, const State& engine,
+    DescriptorSet& desc_set, const UniformRing& ring, VkDeviceSize range, int binding_idx );
+
 void update_descriptor_set_const_storage_buffer( vk::Common& vulkan, const State& engine,
     DescriptorSet& desc_set, vk::mem::AllocatedBuffer storage_buffer, int binding_idx );
 
+/// Writes `buffers[i]` to the set of frame `i`, for buffers there's one of per frame in flight.
+void update_descriptor_set_frame_buffers( vk::Common& vulkan, const State& engine,
+    DescriptorSet& desc_set, const std::vector<vk::mem::AllocatedBuffer>& buffers,
+    VkDescriptorType type, int binding_idx );
+
 void update_descriptor_set_image( vk::Common& vulkan, State& engine, DescriptorSet& desc_set,
-    vk::mem::AllocatedImage img, int binding_idx );
+    vk::mem::AllocatedImage img, int binding_idx,
+    VkImageLayout img_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
 
 void update_descriptor_set_image_array( vk::Common& vulkan, State& engine, DescriptorSet& desc_set,
     std::vector<vk::mem::AllocatedImage> imgs, int binding_idx );
@@ -71,6 +95,9 @@ void update_descriptor_set_rwimage_mip( vk::Common& vulkan, const State& engine,
     DescriptorSet& desc_set, const RWImage& rw_img, VkImageLayout img_layout, int binding_idx,
     size_t mip );
 
+/// Performs the writes that had to wait for transient images to get their memory.
+void flush_deferred_writes( vk::Common& vulkan, const State& engine, DescriptorSet& desc_set );
+
 void update_descriptor_set_sampler( vk::Common& vulkan, const State& engine,
     DescriptorSet& desc_set, VkSampler sampler, int binding_idx );
 
@@ -2,6 +2,8 @@
 
 #include "../log.hpp"
 
+#include <algorithm>
+
 namespace racecar::engine {
 
 void create_descriptor_system(
@@ -9,6 +11,7 @@ void create_descriptor_system(
 {
     std::vector<DescriptorAllocator::PoolSizeRatio> pool_sizes = {
         { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4 },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
         { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4 },
         { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 4 },
         { VK_DESCRIPTOR_TYPE_SAMPLER, 4 },
@@ -41,6 +44,7 @@ void add_binding(
     };
 
     ds_layout_builder.bindings.push_back( std::move( new_binding ) );
+    ds_layout_builder.binding_flags.push_back( 0 );
 }
 
 void add_array_binding( DescriptorLayoutBuilder& ds_layout_builder, uint32_t binding,
@@ -54,9 +58,22 @@ void add_array_binding( DescriptorLayoutBuilder& ds_layout_builder, uint32_t bin
     };
 
     ds_layout_builder.bindings.push_back( std::move( new_binding ) );
+    ds_layout_builder.binding_flags.push_back( 0 );
+}
+
+void add_bindless_binding( DescriptorLayoutBuilder& ds_layout_builder, uint32_t binding,
+    VkDescriptorType type, uint32_t count )
+{
+    add_array_binding( ds_layout_builder, binding, type, count );
+    ds_layout_builder.binding_flags.back()
+        = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
 }
 
-void clear( DescriptorLayoutBuilder& ds_layout_builder ) { ds_layout_builder.bindings.clear(); }
+void clear( DescriptorLayoutBuilder& ds_layout_builder )
+{
+    ds_layout_builder.bindings.clear();
+    ds_layout_builder.binding_flags.clear();
+}
 
 VkDescriptorSetLayout build( vk::Common& vulkan, VkShaderStageFlags shader_stage_flags,
     DescriptorLayoutBuilder& ds_layout_builder, VkDescriptorSetLayoutCreateFlags ds_layout_flags )
@@ -65,8 +82,19 @@ VkDescriptorSetLayout build( vk::Common& vulkan, VkShaderStageFlags shader_stage
         binding.stageFlags |= shader_stage_flags;
     }
 
+    bool has_binding_flags = std::any_of( ds_layout_builder.binding_flags.begin(),
+        ds_layout_builder.binding_flags.end(),
+        []( VkDescriptorBindingFlags flags ) { return flags != 0; } );
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>( ds_layout_builder.binding_flags.size() ),
+        .pBindingFlags = ds_layout_builder.binding_flags.data(),
+    };
+
     VkDescriptorSetLayoutCreateInfo ds_layout_create_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = has_binding_flags ? &binding_flags_create_info : nullptr,
         .flags = ds_layout_flags,
         .bindingCount = static_cast<uint32_t>( ds_layout_builder.bindings.size() ),
         .pBindings = ds_layout_builder.bindings.data(),
@@ -86,7 +114,8 @@ VkDescriptorSetLayout build( vk::Common& vulkan, VkShaderStageFlags shader_stage
 namespace descriptor_allocator {
 
 void init_pool( vk::Common& vulkan, DescriptorAllocator& ds_allocator, uint32_t max_sets,
-    std::span<DescriptorAllocator::PoolSizeRatio> pool_ratios )
+    std::span<DescriptorAllocator::PoolSizeRatio> pool_ratios,
+    VkDescriptorPoolCreateFlags pool_flags )
 {
     std::vector<VkDescriptorPoolSize> pool_sizes;
     for ( DescriptorAllocator::PoolSizeRatio ratio : pool_ratios ) {
@@ -98,7 +127,7 @@ void init_pool( vk::Common& vulkan, DescriptorAllocator& ds_allocator, uint32_t
 
     VkDescriptorPoolCreateInfo pool_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .flags = 0,
+        .flags = pool_flags,
         .maxSets = max_sets,
         .poolSizeCount = static_cast<uint32_t>( pool_sizes.size() ),
         .pPoolSizes = pool_sizes.data(),
@@ -18,6 +18,8 @@ struct DescriptorAllocator {
 
 struct DescriptorLayoutBuilder {
     std::vector<VkDescriptorSetLayoutBinding> bindings;
+    /// One per binding, only chained onto the layout if any of them are set.
+    std::vector<VkDescriptorBindingFlags> binding_flags;
 };
 
 struct DescriptorSystem {
@@ -56,6 +58,11 @@ void add_binding(
 void add_array_binding(
     DescriptorLayoutBuilder& ds_layout_builder, uint32_t binding, VkDescriptorType type, uint32_t count );
 
+/// An array that can be written while in use and doesn't need every element written. The layout
+/// has to be built with `VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT`.
+void add_bindless_binding( DescriptorLayoutBuilder& ds_layout_builder, uint32_t binding,
+    VkDescriptorType type, uint32_t count );
+
 
 void clear( DescriptorLayoutBuilder& ds_layout_builder );
 
@@ -70,7 +77,8 @@ VkDescriptorSetLayout build( vk::Common& vulkan, VkShaderStageFlags shader_stage
 namespace descriptor_allocator {
 
 void init_pool( vk::Common& vulkan, DescriptorAllocator& ds_allocator, uint32_t max_sets,
-    std::span<DescriptorAllocator::PoolSizeRatio> pool_ratios );
+    std::span<DescriptorAllocator::PoolSizeRatio> pool_ratios,
+    VkDescriptorPoolCreateFlags pool_flags = 0 );
 
 void clear_descriptors( const vk::Common& vulkan, DescriptorAllocator& ds_allocator );
 
@@ -38,3 +38,8 @@ void DestructorStack::push_free_vmaimage(
         vmaDestroyImage( allocator, allocated_image.image, allocated_image.allocation );
     } );
 }
+
+void DestructorStack::push_free_vmamemory( const VmaAllocator allocator, VmaAllocation allocation )
+{
+    destructors.push( [=]() -> void { vmaFreeMemory( allocator, allocation ); } );
+}
@@ -36,5 +36,7 @@ struct DestructorStack {
     void push_free_vmaimage(
         const VmaAllocator allocator, racecar::vk::mem::AllocatedImage allocated_image );
 
+    void push_free_vmamemory( const VmaAllocator allocator, VmaAllocation allocation );
+
     void execute_cleanup();
 };
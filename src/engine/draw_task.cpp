@@ -2,50 +2,158 @@
 
 #include "pipeline.hpp"
 
+#include <algorithm>
+#include <tuple>
+
 namespace racecar::engine {
 
 void draw( const engine::State& engine, const DrawTask& draw_task, const VkCommandBuffer& cmd_buf,
-    const VkExtent2D extent )
+    const VkExtent2D extent, BoundState& bound )
 {
-    vkCmdBindPipeline( cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_task.pipeline.handle );
-
-    // Dynamically set viewport state
-    VkViewport viewport = {
-        .x = 0.0f,
-        .y = 0.0f,
-        .width = static_cast<float>( extent.width ),
-        .height = static_cast<float>( extent.height ),
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f,
-    };
-    vkCmdSetViewport( cmd_buf, 0, 1, &viewport );
+    const DrawResourceDescriptor& resources = draw_task.draw_resource_descriptor;
+    bound.stats.draws++;
 
-    // Dynamically set scissor state
-    VkRect2D scissor = {
-        .offset = { .x = 0, .y = 0 },
-        .extent = extent,
-    };
-    vkCmdSetScissor( cmd_buf, 0, 1, &scissor );
+    if ( bound.pipeline != draw_task.pipeline.handle ) {
+        vkCmdBindPipeline( cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_task.pipeline.handle );
+        bound.pipeline = draw_task.pipeline.handle;
+        bound.stats.binds++;
+    } else {
+        bound.stats.skipped_binds++;
+    }
 
-    for ( size_t i = 0; i < draw_task.descriptor_sets.size(); ++i ) {
-        DescriptorSet* descriptor_set = draw_task.descriptor_sets[i];
+    // Sets bound through another layout aren't necessarily compatible with this one
+    if ( bound.layout != draw_task.pipeline.layout ) {
+        bound.layout = draw_task.pipeline.layout;
+        bound.descriptor_sets.clear();
+        bound.dynamic_offsets.clear();
+    }
+
+    // Every pipeline has a dynamic viewport and scissor, so these outlive pipeline binds
+    if ( !bound.extent || bound.extent->width != extent.width
+        || bound.extent->height != extent.height ) {
+        VkViewport viewport = {
+            .x = 0.0f,
+            .y = 0.0f,
+            .width = static_cast<float>( extent.width ),
+            .height = static_cast<float>( extent.height ),
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+        };
+        vkCmdSetViewport( cmd_buf, 0, 1, &viewport );
 
-        vkCmdBindDescriptorSets( cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
-            draw_task.pipeline.layout, static_cast<uint32_t>( i ), 1,
-            &descriptor_set->descriptor_sets[engine.get_frame_index()], 0, nullptr );
+        VkRect2D scissor = {
+            .offset = { .x = 0, .y = 0 },
+            .extent = extent,
+        };
+        vkCmdSetScissor( cmd_buf, 0, 1, &scissor );
+
+        bound.extent = extent;
+        bound.stats.binds += 2;
+    } else {
+        bound.stats.skipped_binds += 2;
     }
 
-    vkCmdBindVertexBuffers( cmd_buf, vk::binding::VERTEX_BUFFER,
-        static_cast<uint32_t>( draw_task.draw_resource_descriptor.vertex_buffers.size() ),
-        draw_task.draw_resource_descriptor.vertex_buffers.data(),
-        draw_task.draw_resource_descriptor.vertex_buffer_offsets.data() );
+    {
+        size_t frame_index = engine.get_frame_index();
+        size_t num_sets = draw_task.descriptor_sets.size();
+
+        if ( bound.descriptor_sets.size() < num_sets ) {
+            bound.descriptor_sets.resize( num_sets, VK_NULL_HANDLE );
+            bound.dynamic_offsets.resize( num_sets );
+        }
+
+        // Consecutive sets that changed go in one call, a set bound with different dynamic
+        // offsets counts as changed
+        size_t i = 0;
+        size_t offset_idx = 0;
+        while ( i < num_sets ) {
+            size_t run_end = i;
+            size_t run_offset_idx = offset_idx;
+
+            for ( ; run_end < num_sets; run_end++ ) {
+                const DescriptorSet& desc_set = *draw_task.descriptor_sets[run_end];
+                VkDescriptorSet set = desc_set.descriptor_sets[frame_index];
+
+                auto offsets_begin = draw_task.dynamic_offsets.begin()
+                    + static_cast<std::ptrdiff_t>( offset_idx );
+                auto offsets_end = offsets_begin + desc_set.num_dynamic_offsets;
+
+                if ( bound.descriptor_sets[run_end] == set
+                    && std::equal( offsets_begin, offsets_end,
+                        bound.dynamic_offsets[run_end].begin(),
+                        bound.dynamic_offsets[run_end].end() ) ) {
+                    break;
+                }
+
+                bound.descriptor_sets[run_end] = set;
+                bound.dynamic_offsets[run_end].assign( offsets_begin, offsets_end );
+                offset_idx += desc_set.num_dynamic_offsets;
+            }
+
+            if ( run_end == i ) {
+                bound.stats.skipped_binds++;
+                offset_idx += draw_task.descriptor_sets[i]->num_dynamic_offsets;
+                i++;
+                continue;
+            }
+
+            vkCmdBindDescriptorSets( cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                draw_task.pipeline.layout, static_cast<uint32_t>( i ),
+                static_cast<uint32_t>( run_end - i ), &bound.descriptor_sets[i],
+                static_cast<uint32_t>( offset_idx - run_offset_idx ),
+                draw_task.dynamic_offsets.data() + run_offset_idx );
 
-    vkCmdBindIndexBuffer(
-        cmd_buf, draw_task.draw_resource_descriptor.index_buffer, 0, VK_INDEX_TYPE_UINT32 );
+            bound.stats.binds += run_end - i;
+            i = run_end;
+        }
+    }
+
+    if ( bound.vertex_buffers != resources.vertex_buffers
+        || bound.vertex_buffer_offsets != resources.vertex_buffer_offsets ) {
+        vkCmdBindVertexBuffers( cmd_buf, vk::binding::VERTEX_BUFFER,
+            static_cast<uint32_t>( resources.vertex_buffers.size() ),
+            resources.vertex_buffers.data(), resources.vertex_buffer_offsets.data() );
+
+        bound.vertex_buffers = resources.vertex_buffers;
+        bound.vertex_buffer_offsets = resources.vertex_buffer_offsets;
+        bound.stats.binds++;
+    } else {
+        bound.stats.skipped_binds++;
+    }
+
+    if ( bound.index_buffer != resources.index_buffer ) {
+        vkCmdBindIndexBuffer( cmd_buf, resources.index_buffer, 0, VK_INDEX_TYPE_UINT32 );
+        bound.index_buffer = resources.index_buffer;
+        bound.stats.binds++;
+    } else {
+        bound.stats.skipped_binds++;
+    }
+
+    if ( draw_task.indirect ) {
+        const IndirectDraw& indirect = draw_task.indirect.value();
+        size_t frame_index = engine.get_frame_index();
+
+        vkCmdDrawIndexedIndirectCount( cmd_buf, indirect.command_buffers[frame_index],
+            indirect.command_offset, indirect.count_buffers[frame_index], indirect.count_offset,
+            indirect.max_draw_count, sizeof( VkDrawIndexedIndirectCommand ) );
+        return;
+    }
+
+    vkCmdDrawIndexed( cmd_buf, resources.index_count, 1, uint32_t( resources.index_offset ),
+        resources.vertex_offset, resources.first_instance );
+}
+
+void sort_draw_tasks( std::vector<DrawTask>& draw_tasks )
+{
+    auto key = []( const DrawTask& draw_task ) {
+        return std::tie( draw_task.pipeline.handle, draw_task.pipeline.layout,
+            draw_task.descriptor_sets, draw_task.dynamic_offsets,
+            draw_task.draw_resource_descriptor.vertex_buffers,
+            draw_task.draw_resource_descriptor.index_buffer );
+    };
 
-    vkCmdDrawIndexed( cmd_buf, draw_task.draw_resource_descriptor.index_count, 1,
-        uint32_t( draw_task.draw_resource_descriptor.index_offset ),
-        draw_task.draw_resource_descriptor.vertex_offset, 0 );
+    std::stable_sort( draw_tasks.begin(), draw_tasks.end(),
+        [&]( const DrawTask& a, const DrawTask& b ) { return key( a ) < key( b ); } );
 }
 
 DrawResourceDescriptor DrawResourceDescriptor::from_mesh( VkBuffer vertex_buffer,
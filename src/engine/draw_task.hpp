@@ -7,6 +7,7 @@
 #include <volk.h>
 
 #include <optional>
+#include <vector>
 
 namespace racecar::engine {
 
@@ -19,21 +20,62 @@ struct DrawResourceDescriptor {
     int32_t index_offset = 0;
 
     uint32_t index_count = 0;
+    /// Shows up as the instance index, shaders use it to find the draw's entry in a buffer.
+    uint32_t first_instance = 0;
 
     static DrawResourceDescriptor from_mesh( VkBuffer vertex_buffer, VkBuffer index_buffer,
         uint32_t num_indices, const std::optional<scene::Primitive>& primitive );
 };
 
+/// Draws whose commands and count are written on the GPU, see `gpu_driven.hpp`. There's a buffer
+/// of each per frame in flight, like with descriptor sets.
+struct IndirectDraw {
+    std::vector<VkBuffer> command_buffers;
+    VkDeviceSize command_offset = 0;
+
+    std::vector<VkBuffer> count_buffers;
+    VkDeviceSize count_offset = 0;
+
+    uint32_t max_draw_count = 0;
+};
+
 /// A draw task represents one Vulkan pipeline, and more specifically, the shader to be used
 /// in the pipeline. For example, you would use one draw task for each material, because each
 /// material uses its own shader module.
 struct DrawTask {
     DrawResourceDescriptor draw_resource_descriptor;
     std::vector<DescriptorSet*> descriptor_sets;
+    /// For the dynamic uniform buffers of the sets, in set order. See
+    /// `DescriptorSet::num_dynamic_offsets`.
+    std::vector<uint32_t> dynamic_offsets;
     Pipeline pipeline = {};
+
+    /// Draws with `vkCmdDrawIndexedIndirectCount` instead, only the buffers of
+    /// `draw_resource_descriptor` are used.
+    std::optional<IndirectDraw> indirect;
+};
+
+/// What `draw` last bound on a command buffer, so following draws only bind what changed. Only
+/// good for the one command buffer and rendering scope it was made for.
+struct BoundState {
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    std::optional<VkExtent2D> extent;
+
+    std::vector<VkDescriptorSet> descriptor_sets;
+    std::vector<std::vector<uint32_t>> dynamic_offsets;
+    std::vector<VkBuffer> vertex_buffers;
+    std::vector<VkDeviceSize> vertex_buffer_offsets;
+    VkBuffer index_buffer = VK_NULL_HANDLE;
+
+    DrawStats stats;
 };
 
 void draw( const engine::State& engine, const DrawTask& draw_task, const VkCommandBuffer& cmd_buf,
-    const VkExtent2D extent );
+    const VkExtent2D extent, BoundState& bound );
+
+/// Stable sorts draw tasks by pipeline, then descriptor sets, then buffers, so that draws sharing
+/// state end up next to each other. Only for draws whose order doesn't matter.
+void sort_draw_tasks( std::vector<DrawTask>& draw_tasks );
 
 } // namespace racecar::engine
@@ -2,34 +2,174 @@
 
 #include "../imgui/imgui.h"
 #include "../imgui/imgui_impl_vulkan.h"
+#include "../parallel.hpp"
 #include "../vk/create.hpp"
 #include "../vk/utility.hpp"
 #include "task_list.hpp"
+#include "transient.hpp"
 
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+
 namespace racecar::engine {
 
-void execute( State& engine, Context& ctx, TaskList& task_list, const gui::Gui& gui )
+namespace {
+
+/// Fewer draws than this aren't worth a secondary command buffer of their own.
+constexpr size_t MIN_DRAWS_PER_SECONDARY = 16;
+
+/// A range of one graphics task's draws, recorded by a worker into a secondary command buffer.
+struct DrawJob {
+    size_t step = 0;
+    size_t draws_begin = 0;
+    size_t draws_end = 0;
+    VkCommandBuffer cmd_buf = VK_NULL_HANDLE;
+    DrawStats stats;
+};
+
+VkCommandBuffer next_secondary_cmd_buf( vk::Common& vulkan, WorkerCommands& worker_commands )
 {
-    vk::Common& vulkan = ctx.vulkan;
+    if ( worker_commands.num_used == worker_commands.cmdbufs.size() ) {
+        VkCommandBufferAllocateInfo cmd_buf_info
+            = vk::create::command_buffer_allocate_info( worker_commands.cmd_pool, 1 );
+        cmd_buf_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+        VkCommandBuffer cmd_buf = VK_NULL_HANDLE;
+        vk::check( vkAllocateCommandBuffers( vulkan.device, &cmd_buf_info, &cmd_buf ),
+            "Failed to allocate secondary command buffer" );
+        worker_commands.cmdbufs.push_back( cmd_buf );
+    }
+
+    return worker_commands.cmdbufs[worker_commands.num_used++];
+}
+
+/// Records the draws of the graphics tasks from `steps_begin` up to the next CPU task across
+/// worker threads, filling in `secondary_cmd_bufs` for the steps that got any. CPU tasks can
+/// change what later tasks draw, so recording never runs ahead of one. Returns the step it
+/// stopped at.
+size_t record_draws_in_parallel( vk::Common& vulkan, const State& engine, FrameData& frame,
+    const TaskList& task_list, size_t steps_begin,
+    std::vector<std::vector<VkCommandBuffer>>& secondary_cmd_bufs, DrawStats& draw_stats )
+{
+    const std::vector<ScheduleStep>& steps = task_list.graph->steps;
+    size_t steps_end = steps_begin;
+
+    for ( ; steps_end < steps.size(); steps_end++ ) {
+        const ScheduleStep& step = steps[steps_end];
+
+        if ( step.task && task_list.tasks[step.task.value()].type == Task::CPU_CALL ) {
+            break;
+        }
+    }
+
+    if ( steps_end == steps_begin ) {
+        return steps_begin + 1;
+    }
+
+    if ( !engine.parallel_recording ) {
+        return steps_end;
+    }
+
+    size_t num_workers = frame.worker_commands.size();
+    std::vector<DrawJob> jobs;
+
+    for ( size_t i = steps_begin; i < steps_end; i++ ) {
+        const ScheduleStep& step = steps[i];
+
+        if ( !step.task ) {
+            continue;
+        }
+
+        const Task& task = task_list.tasks[step.task.value()];
+
+        if ( task.type != Task::GFX || ( task.is_single_run && task.is_ran ) ) {
+            continue;
+        }
+
+        size_t num_draws = task_list.gfx_tasks[step.list_index].draw_tasks.size();
+        size_t draws_per_job = std::max( MIN_DRAWS_PER_SECONDARY,
+            ( num_draws + num_workers - 1 ) / num_workers );
+
+        for ( size_t begin = 0; begin < num_draws; begin += draws_per_job ) {
+            jobs.push_back( {
+                .step = i,
+                .draws_begin = begin,
+                .draws_end = std::min( begin + draws_per_job, num_draws ),
+            } );
+        }
+    }
+
+    // A single job would just be the main thread's work with extra steps
+    if ( jobs.size() < 2 ) {
+        return steps_end;
+    }
 
-    size_t frame_number = engine.get_frame_index();
-    FrameData& frame = engine.frames[frame_number];
+    engine.workers->for_each_with_worker( jobs.size(), [&]( size_t worker, size_t i ) {
+        DrawJob& job = jobs[i];
+        job.cmd_buf = next_secondary_cmd_buf( vulkan, frame.worker_commands[worker] );
+
+        job.stats = record_gfx_task_draws( engine, job.cmd_buf,
+            task_list.gfx_tasks[steps[job.step].list_index], job.draws_begin, job.draws_end );
+    } );
+
+    for ( const DrawJob& job : jobs ) {
+        secondary_cmd_bufs[job.step].push_back( job.cmd_buf );
+        draw_stats += job.stats;
+    }
+
+    return steps_end;
+}
+
+}
+
+uint64_t completed_timeline_value( const State& engine, const vk::Common& vulkan )
+{
+    uint64_t value = 0;
+    vk::check( vkGetSemaphoreCounterValue( vulkan.device, engine.timeline, &value ),
+        "Failed to read frame timeline value" );
+
+    return value;
+}
+
+void wait_for_timeline( const State& engine, const vk::Common& vulkan, uint64_t value )
+{
+    VkSemaphoreWaitInfo wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &engine.timeline,
+        .pValues = &value,
+    };
 
     // Using the maximum 64-bit unsigned integer value effectively disables the timeout
-    vk::check( vkWaitForFences( vulkan.device, 1, &frame.render_fence, VK_TRUE,
-                   std::numeric_limits<uint64_t>::max() ),
-        "Failed to wait for frame render fence" );
+    vk::check( vkWaitSemaphores( vulkan.device, &wait_info, std::numeric_limits<uint64_t>::max() ),
+        "Failed to wait on frame timeline" );
+}
+
+void begin_frame( State& engine, const vk::Common& vulkan )
+{
+    const FrameData& frame = engine.frames[engine.get_frame_index()];
 
-    // Manually reset previous frame's render fence to an unsignaled state
-    vk::check( vkResetFences( vulkan.device, 1, &frame.render_fence ),
-        "Failed to reset frame render fence" );
+    auto wait_start = std::chrono::steady_clock::now();
 
-    vkResetCommandBuffer( frame.start_cmdbuf, 0 );
-    vkResetCommandBuffer( frame.render_cmdbuf, 0 );
-    vkResetCommandBuffer( frame.end_cmdbuf, 0 );
+    // This only blocks if the GPU is still `frame_overlap` frames behind.
+    wait_for_timeline( engine, vulkan, frame.timeline_value );
+
+    std::chrono::duration<double> waited = std::chrono::steady_clock::now() - wait_start;
+    engine.gpu_wait = waited.count();
+}
+
+void execute( State& engine, Context& ctx, TaskList& task_list, const gui::Gui& gui )
+{
+    vk::Common& vulkan = ctx.vulkan;
+
+    size_t frame_index = engine.get_frame_index();
+    FrameData& frame = engine.frames[frame_index];
+
+    vkResetCommandBuffer( frame.cmdbuf, 0 );
 
     VkCommandBufferBeginInfo command_buffer_begin_info
         = vk::create::command_buffer_begin_info( VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT );
@@ -38,13 +178,13 @@ void execute( State& engine, Context& ctx, TaskList& task_list, const gui::Gui&
     uint32_t output_swapchain_index = 0;
 
     vk::check( vkAcquireNextImageKHR( vulkan.device, engine.swapchain,
-                   std::numeric_limits<uint64_t>::max(), frame.acquire_start_smp, nullptr,
+                   std::numeric_limits<uint64_t>::max(), frame.acquire_smp, nullptr,
                    &output_swapchain_index ),
         "Failed to acquire next image from swapchain" );
 
     const VkImage& output_image = engine.swapchain_images[output_swapchain_index];
     const VkImageView& output_image_view = engine.swapchain_image_views[output_swapchain_index];
-    const vk::mem::AllocatedImage& out_depth_image = engine.depth_images[output_swapchain_index];
+    const vk::mem::AllocatedImage& out_depth_image = engine.depth_images[frame_index];
 
     SwapchainSemaphores& swapchain_semaphores = engine.swapchain_semaphores[output_swapchain_index];
 
@@ -52,45 +192,34 @@ void execute( State& engine, Context& ctx, TaskList& task_list, const gui::Gui&
     for ( GfxTask& gfx_task : task_list.gfx_tasks ) {
         if ( gfx_task.render_target_is_swapchain ) {
             gfx_task.color_attachments = {
-                RWImage {
-                    .images = { { .image = output_image, .image_view = output_image_view } } },
+                RWImage { .images = { {
+                    .image = output_image,
+                    .image_view = output_image_view,
+                    .image_format = engine.swapchain.image_format,
+                } } },
             };
             gfx_task.depth_image = { { out_depth_image } };
         }
     }
 
+    vkBeginCommandBuffer( frame.cmdbuf, &command_buffer_begin_info );
+
     {
-        // Make swapchain image writeable ( and clear! )
-        vkBeginCommandBuffer( frame.start_cmdbuf, &command_buffer_begin_info );
-        vk::utility::transition_image( frame.start_cmdbuf, output_image, VK_IMAGE_LAYOUT_UNDEFINED,
+        // Make swapchain image writeable ( and clear! ). The acquire semaphore is waited on at the
+        // color attachment output stage, so this has to chain off of that same stage.
+        vk::utility::transition_image( frame.cmdbuf, output_image, VK_IMAGE_LAYOUT_UNDEFINED,
             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 0, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-            VK_PIPELINE_STAGE_2_NONE, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_IMAGE_ASPECT_COLOR_BIT );
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_IMAGE_ASPECT_COLOR_BIT );
 
-        // Pair in the depth here. Use start cmd_buf to ensure such is done before the draw call.
-        vk::utility::transition_image( frame.start_cmdbuf, out_depth_image.image,
+        // Pair in the depth here, before any of the tasks get to it.
+        vk::utility::transition_image( frame.cmdbuf, out_depth_image.image,
             VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, 0,
             VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_NONE,
             VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT, VK_IMAGE_ASPECT_DEPTH_BIT );
-
-        vkEndCommandBuffer( frame.start_cmdbuf );
     }
 
-    vk::create::AllSubmitInfo start_submit_info_all = vk::create::all_submit_info( {
-        .command_buffer = frame.start_cmdbuf,
-        .wait_semaphore = frame.acquire_start_smp,
-        .wait_flag_bits = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-        .signal_semaphore = frame.start_render_smp,
-        .signal_flag_bits = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-    } );
-    VkSubmitInfo2 start_submit_info = vk::create::submit_info_from_all( start_submit_info_all );
-
-    vk::check( vkQueueSubmit2( vulkan.graphics_queue, 1, &start_submit_info, VK_NULL_HANDLE ),
-        "Graphics queue submit failed" );
-
     {
-        vkBeginCommandBuffer( frame.render_cmdbuf, &command_buffer_begin_info );
-
         // THIS IS VERY BAD. THIS IS TEMPORARILY HERE SO I CAN RUN ANY ARBITRARY FUNCTION I WANT
         // WITH THE COMFORT OF KNOWING THE FRAME'S RENDER COMMAND BUFFER CAN BE USED. APOLOGIES.
         // LEAVING THIS HERE FOR NOW UNTIL WE HAVE A DECENT SOLUTION FOR COMPUTE TASKS THAT CAN RUN
@@ -102,98 +231,96 @@ void execute( State& engine, Context& ctx, TaskList& task_list, const gui::Gui&
             }
         }
 
-        size_t task_ptr = 0;
-        size_t gfx_ptr = 0;
-        size_t cs_ptr = 0;
-        size_t blit_ptr = 0;
-        size_t cpu_ptr = 0;
-        for ( task_ptr = 0; task_ptr < task_list.tasks.size(); task_ptr++ ) {
-            Task& task = task_list.tasks[task_ptr];
-
-#if 0
-            // I'm leaving this chunk of code here in-case we want to loop back to its
-            // ideas for refactoring later on. For now, the O(n) search work just fine as long
-            // as we don't have a crazy amount of pipline barrieres per frame.
-            auto search = std::find_if( task_list.pipeline_barriers.begin(),
-                task_list.pipeline_barriers.end(),
-                [=]( const std::pair<int, PipelineBarrierDescriptor>& v ) -> bool {
-                    return v.first == int( task_ptr );
-                } );
-
-            if ( search != task_list.pipeline_barriers.end() ) {
-                run_pipeline_barrier( engine, ( *search ).second, frame.render_cmdbuf );
+        if ( !task_list.graph ) {
+            task_list.graph = compile_render_graph( engine, task_list );
+            bind_transient_images( vulkan, engine, task_list );
+
+            for ( GfxTask& gfx_task : task_list.gfx_tasks ) {
+                if ( gfx_task.sort_draws ) {
+                    sort_draw_tasks( gfx_task.draw_tasks );
+                }
             }
-#else
-            // Current implementation only handles 1 pipeline barrier for a given task_ptr.
-            // Builder design assumes that you can append several, but that's not handled.
+        }
 
-            // Naive for loop search.
-            int task_index = static_cast<int>( task_ptr );
+        RenderGraph& graph = task_list.graph.value();
 
-            for ( auto& [barrier_index, barrier] : task_list.pipeline_barriers ) {
-                if ( barrier_index == task_index ) {
-                    run_pipeline_barrier( engine, barrier, frame.render_cmdbuf );
-                }
+        for ( WorkerCommands& worker_commands : frame.worker_commands ) {
+            vk::check( vkResetCommandPool( vulkan.device, worker_commands.cmd_pool, 0 ),
+                "Failed to reset worker command pool" );
+            worker_commands.num_used = 0;
+        }
+
+        // Secondary command buffers per step, for graphics tasks whose draws were recorded on
+        // worker threads. Steps without any are recorded right into the frame's command buffer.
+        std::vector<std::vector<VkCommandBuffer>> secondary_cmd_bufs( graph.steps.size() );
+        size_t recorded_until = 0;
+        DrawStats draw_stats;
+
+        for ( size_t step_index = 0; step_index < graph.steps.size(); step_index++ ) {
+            const ScheduleStep& step = graph.steps[step_index];
+
+            if ( step_index >= recorded_until ) {
+                recorded_until = record_draws_in_parallel( vulkan, engine, frame, task_list,
+                    step_index, secondary_cmd_bufs, draw_stats );
             }
-#endif
-            switch ( task.type ) {
-            case Task::GFX: {
-                GfxTask& gfx_task = task_list.gfx_tasks[gfx_ptr++];
 
-                // Brain-dead solution. We need to ensure the pointers advance
-                if ( task.is_single_run && task.is_ran ) {
-                    break;
-                }
+            record_barriers( graph, step, frame_index, frame.cmdbuf );
 
-                execute_gfx_task( engine, frame.render_cmdbuf, gfx_task );
-                break;
+            if ( !step.task ) {
+                continue;
             }
 
-            case Task::COMP: {
-                ComputeTask& cs_task = task_list.cs_tasks[cs_ptr++];
+            Task& task = task_list.tasks[step.task.value()];
+
+            if ( task.is_single_run && task.is_ran ) {
+                continue;
+            }
 
-                // Brain-dead solution. We need to ensure the pointers advance
-                if ( task.is_single_run && task.is_ran ) {
-                    break;
+            switch ( task.type ) {
+            case Task::GFX:
+                if ( secondary_cmd_bufs[step_index].empty() ) {
+                    draw_stats += execute_gfx_task(
+                        engine, frame.cmdbuf, task_list.gfx_tasks[step.list_index] );
+                } else {
+                    execute_gfx_task_secondary( engine, frame.cmdbuf,
+                        task_list.gfx_tasks[step.list_index], secondary_cmd_bufs[step_index] );
                 }
+                break;
 
-                execute_cs_task( engine, frame.render_cmdbuf, cs_task );
+            case Task::COMP:
+                execute_cs_task( engine, frame.cmdbuf, task_list.cs_tasks[step.list_index] );
                 break;
-            }
 
             case Task::BLIT: {
-                BlitTask& blit_task = task_list.blit_tasks[blit_ptr++];
-
-                // Brain-dead solution. We need to ensure the pointers advance
-                if ( task.is_single_run && task.is_ran ) {
-                    break;
-                }
+                BlitTask& blit_task = task_list.blit_tasks[step.list_index];
 
                 const VkImage& dst_image = blit_task.out_color.has_value()
-                    ? blit_task.out_color.value().images[output_swapchain_index].image
+                    ? blit_task.out_color.value().images[frame_index].image
                     : output_image;
 
-                execute_blit_task( engine, frame.render_cmdbuf, blit_task, dst_image );
+                execute_blit_task( engine, frame.cmdbuf, blit_task, dst_image );
                 break;
             }
 
-            case Task::CPU_CALL: {
-                CPUTask& descriptor_task = task_list.cpu_tasks[cpu_ptr++];
-
+            case Task::CPU_CALL:
                 // This is not ran on the GPU! This is a purely CPU-side call.
-                descriptor_task.task();
+                task_list.cpu_tasks[step.list_index].task();
+                break;
+
+            case Task::RECORD:
+                task_list.record_tasks[step.list_index].record( frame.cmdbuf );
                 break;
-            }
 
             default:
                 throw Exception( "Unknown task type" );
             }
 
-            if ( !task.is_ran ) {
-                task.is_ran = true;
-            }
+            task.is_ran = true;
         }
 
+        graph.has_run[frame_index] = true;
+        engine.draw_stats = draw_stats;
+
         // GUI render pass
         if ( gui.show_window ) {
             VkRenderingAttachmentInfo gui_color_attachment_info = {
@@ -212,52 +339,52 @@ void execute( State& engine, Context& ctx, TaskList& task_list, const gui::Gui&
                 .pColorAttachments = &gui_color_attachment_info,
             };
 
-            vkCmdBeginRendering( frame.render_cmdbuf, &gui_rendering_info );
-            ImGui_ImplVulkan_RenderDrawData( ImGui::GetDrawData(), frame.render_cmdbuf );
-            vkCmdEndRendering( frame.render_cmdbuf );
+            vkCmdBeginRendering( frame.cmdbuf, &gui_rendering_info );
+            ImGui_ImplVulkan_RenderDrawData( ImGui::GetDrawData(), frame.cmdbuf );
+            vkCmdEndRendering( frame.cmdbuf );
         }
-
-        vkEndCommandBuffer( frame.render_cmdbuf );
     }
 
-    vk::create::AllSubmitInfo render_submit_info_all = vk::create::all_submit_info( {
-        .command_buffer = frame.render_cmdbuf,
-        .wait_semaphore = frame.start_render_smp,
-        .wait_flag_bits = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-        .signal_semaphore = frame.render_end_smp,
-        .signal_flag_bits = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-    } );
-    VkSubmitInfo2 render_submit_info = vk::create::submit_info_from_all( render_submit_info_all );
+    vk::utility::transition_image( frame.cmdbuf, output_image,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, 0, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, VK_IMAGE_ASPECT_COLOR_BIT );
 
-    vk::check( vkQueueSubmit2( vulkan.graphics_queue, 1, &render_submit_info, VK_NULL_HANDLE ),
-        "Graphics queue submit failed" );
+    vkEndCommandBuffer( frame.cmdbuf );
 
-    {
-        vkBeginCommandBuffer( frame.end_cmdbuf, &command_buffer_begin_info );
-        vk::utility::transition_image( frame.end_cmdbuf, output_image,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, 0,
-            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
-            VK_IMAGE_ASPECT_COLOR_BIT );
-        vkEndCommandBuffer( frame.end_cmdbuf );
-    }
+    // One submission for the whole frame. It signals the present semaphore for the swapchain and
+    // the next timeline value, which is what `begin_frame` waits on before reusing the frame.
+    frame.timeline_value = ++engine.timeline_value;
 
-    vk::create::AllSubmitInfo end_submit_info_all = vk::create::all_submit_info( {
-        .command_buffer = frame.end_cmdbuf,
-        .wait_semaphore = frame.render_end_smp,
-        .wait_flag_bits = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-        .signal_semaphore = swapchain_semaphores.end_present_smp,
-        .signal_flag_bits = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-    } );
-    VkSubmitInfo2 end_submit_info = vk::create::submit_info_from_all( end_submit_info_all );
+    VkSemaphoreSubmitInfo wait_info = vk::create::semaphore_submit_info(
+        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, frame.acquire_smp );
+
+    std::array<VkSemaphoreSubmitInfo, 2> signal_infos = {
+        vk::create::semaphore_submit_info(
+            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, swapchain_semaphores.present_smp ),
+        vk::create::semaphore_submit_info(
+            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, engine.timeline, frame.timeline_value ),
+    };
+
+    VkCommandBufferSubmitInfo command_info = vk::create::command_buffer_submit_info( frame.cmdbuf );
+
+    VkSubmitInfo2 submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+        .waitSemaphoreInfoCount = 1,
+        .pWaitSemaphoreInfos = &wait_info,
+        .commandBufferInfoCount = 1,
+        .pCommandBufferInfos = &command_info,
+        .signalSemaphoreInfoCount = static_cast<uint32_t>( signal_infos.size() ),
+        .pSignalSemaphoreInfos = signal_infos.data(),
+    };
 
-    vk::check( vkQueueSubmit2( vulkan.graphics_queue, 1, &end_submit_info, frame.render_fence ),
+    vk::check( vkQueueSubmit2( vulkan.graphics_queue, 1, &submit_info, VK_NULL_HANDLE ),
         "Graphics queue submit failed" );
 
     VkPresentInfoKHR present_info = {
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
         .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &swapchain_semaphores.end_present_smp,
+        .pWaitSemaphores = &swapchain_semaphores.present_smp,
         .swapchainCount = 1,
         .pSwapchains = &engine.swapchain.swapchain,
         .pImageIndices = &output_swapchain_index,
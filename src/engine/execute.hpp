@@ -7,8 +7,20 @@
 
 namespace racecar::engine {
 
+/// The last frame timeline value the GPU has finished. Frame N (as in `State::timeline_value` right
+/// after its `execute`) is done once this is >= N.
+uint64_t completed_timeline_value( const State& engine, const vk::Common& vulkan );
+
+/// Blocks until the GPU has finished every frame up to and including timeline value `value`.
+void wait_for_timeline( const State& engine, const vk::Common& vulkan, uint64_t value );
+
+/// Call at the very start of a frame, before anything writes to the current frame's uniform buffer
+/// slices or descriptor sets. Waits until the GPU is done with the last frame that used them.
+void begin_frame( State& engine, const vk::Common& vulkan );
+
 /// Performed every frame. Calls everything (compute and graphics).
 /// If you want to run any call, add it into execute (this will be loooong).
+/// Expects `begin_frame` to have been called first.
 void execute( State& engine, Context& ctx, TaskList& task_list, const gui::Gui& gui );
 
 } // namespace racecar::engine
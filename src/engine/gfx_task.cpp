@@ -1,16 +1,30 @@
 #include "gfx_task.hpp"
 
+#include "../vk/create.hpp"
+
 namespace racecar::engine {
 
-void execute_gfx_task(
-    const engine::State& engine, const VkCommandBuffer& cmd_buf, GfxTask& gfx_task )
+namespace {
+
+struct RenderingAttachments {
+    std::vector<VkRenderingAttachmentInfo> color;
+    std::optional<VkRenderingAttachmentInfo> depth;
+};
+
+/// The swapchain/depth image view is hardcoded to be at index 0 in `engine::execute()`
+size_t get_image_index( const engine::State& engine, const GfxTask& gfx_task )
+{
+    return gfx_task.render_target_is_swapchain ? 0 : engine.get_frame_index();
+}
+
+RenderingAttachments get_rendering_attachments(
+    const engine::State& engine, const GfxTask& gfx_task )
 {
-    // The swapchain/depth image view is hardcoded to be at index 0 in `engine::execute()`
-    size_t swapchain_idx = gfx_task.render_target_is_swapchain ? 0 : engine.get_frame_index();
+    size_t swapchain_idx = get_image_index( engine, gfx_task );
+    RenderingAttachments attachments;
 
-    std::vector<VkRenderingAttachmentInfo> color_attachment_infos;
     for ( const RWImage& img : gfx_task.color_attachments ) {
-        color_attachment_infos.push_back( {
+        attachments.color.push_back( {
             .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
             .imageView = img.images[swapchain_idx].image_view,
             .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
@@ -21,10 +35,8 @@ void execute_gfx_task(
         } );
     }
 
-    std::optional<VkRenderingAttachmentInfo> depth_attachment_info;
-
     if ( gfx_task.depth_image ) {
-        depth_attachment_info = {
+        attachments.depth = {
             .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
             .imageView = gfx_task.depth_image.value().images[swapchain_idx].image_view,
             .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
@@ -35,22 +47,108 @@ void execute_gfx_task(
         };
     }
 
+    return attachments;
+}
+
+void begin_rendering( const engine::State& engine, const VkCommandBuffer& cmd_buf,
+    const GfxTask& gfx_task, VkRenderingFlags flags )
+{
+    RenderingAttachments attachments = get_rendering_attachments( engine, gfx_task );
+
     VkRenderingInfo rendering_info = {
         .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .flags = flags,
         .renderArea = { .offset = { .x = 0, .y = 0 }, .extent = gfx_task.extent },
         .layerCount = 1,
-        .colorAttachmentCount = static_cast<uint32_t>( color_attachment_infos.size() ),
-        .pColorAttachments = color_attachment_infos.data(),
-        .pDepthAttachment = depth_attachment_info ? &( *depth_attachment_info ) : nullptr,
+        .colorAttachmentCount = static_cast<uint32_t>( attachments.color.size() ),
+        .pColorAttachments = attachments.color.data(),
+        .pDepthAttachment = attachments.depth ? &( *attachments.depth ) : nullptr,
         .pStencilAttachment = nullptr,
     };
 
     vkCmdBeginRendering( cmd_buf, &rendering_info );
+}
+
+}
+
+DrawStats execute_gfx_task(
+    const engine::State& engine, const VkCommandBuffer& cmd_buf, GfxTask& gfx_task )
+{
+    begin_rendering( engine, cmd_buf, gfx_task, 0 );
+
+    BoundState bound;
 
     for ( const DrawTask& draw_task : gfx_task.draw_tasks ) {
-        draw( engine, draw_task, cmd_buf, gfx_task.extent );
+        draw( engine, draw_task, cmd_buf, gfx_task.extent, bound );
+    }
+
+    vkCmdEndRendering( cmd_buf );
+
+    return bound.stats;
+}
+
+DrawStats record_gfx_task_draws( const engine::State& engine, const VkCommandBuffer& cmd_buf,
+    const GfxTask& gfx_task, size_t draws_begin, size_t draws_end )
+{
+    size_t swapchain_idx = get_image_index( engine, gfx_task );
+
+    std::vector<VkFormat> color_formats;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+    for ( const RWImage& img : gfx_task.color_attachments ) {
+        color_formats.push_back( img.images[swapchain_idx].image_format );
+        samples = img.images[swapchain_idx].samples;
+    }
+
+    VkFormat depth_format = VK_FORMAT_UNDEFINED;
+
+    if ( gfx_task.depth_image ) {
+        depth_format = gfx_task.depth_image.value().images[swapchain_idx].image_format;
+        samples = gfx_task.depth_image.value().images[swapchain_idx].samples;
+    }
+
+    VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .colorAttachmentCount = static_cast<uint32_t>( color_formats.size() ),
+        .pColorAttachmentFormats = color_formats.data(),
+        .depthAttachmentFormat = depth_format,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+        .rasterizationSamples = samples,
+    };
+
+    VkCommandBufferInheritanceInfo inheritance_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = &inheritance_rendering_info,
+    };
+
+    VkCommandBufferBeginInfo begin_info = vk::create::command_buffer_begin_info(
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+        | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT );
+    begin_info.pInheritanceInfo = &inheritance_info;
+
+    vk::check( vkBeginCommandBuffer( cmd_buf, &begin_info ),
+        "Failed to begin secondary command buffer" );
+
+    BoundState bound;
+
+    for ( size_t i = draws_begin; i < draws_end; i++ ) {
+        draw( engine, gfx_task.draw_tasks[i], cmd_buf, gfx_task.extent, bound );
     }
 
+    vk::check( vkEndCommandBuffer( cmd_buf ), "Failed to end secondary command buffer" );
+
+    return bound.stats;
+}
+
+void execute_gfx_task_secondary( const engine::State& engine, const VkCommandBuffer& cmd_buf,
+    GfxTask& gfx_task, const std::vector<VkCommandBuffer>& secondary_cmd_bufs )
+{
+    begin_rendering(
+        engine, cmd_buf, gfx_task, VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT );
+
+    vkCmdExecuteCommands( cmd_buf, static_cast<uint32_t>( secondary_cmd_bufs.size() ),
+        secondary_cmd_bufs.data() );
+
     vkCmdEndRendering( cmd_buf );
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "draw_task.hpp"
+#include "render_graph.hpp"
 #include "rwimage.hpp"
 
 #include <glm/glm.hpp>
@@ -22,10 +23,29 @@ struct GfxTask {
     std::vector<RWImage> color_attachments;
     std::optional<RWImage> depth_image;
 
+    /// Images sampled by the draws. The attachments above are declared already, but the task only
+    /// counts as fully declared, and can be culled, once this isn't empty.
+    std::vector<ImageUse> image_uses;
+
     VkExtent2D extent = {};
+
+    /// Whether the draws can be reordered so the ones sharing state are recorded back to back.
+    /// Fine for opaque, depth tested geometry; not for anything blended.
+    bool sort_draws = false;
 };
 
-void execute_gfx_task(
+DrawStats execute_gfx_task(
     const engine::State& engine, const VkCommandBuffer& cmd_buf, GfxTask& gfx_task );
 
+/// Records draws `[draws_begin, draws_end)` of `gfx_task` into a secondary command buffer, meant
+/// to be executed by `execute_gfx_task_secondary`. Safe to call from any thread, as long as every
+/// thread records into buffers from its own command pool.
+DrawStats record_gfx_task_draws( const engine::State& engine, const VkCommandBuffer& cmd_buf,
+    const GfxTask& gfx_task, size_t draws_begin, size_t draws_end );
+
+/// Same as `execute_gfx_task`, but the draws come from secondary command buffers recorded with
+/// `record_gfx_task_draws`, executed in the order given.
+void execute_gfx_task_secondary( const engine::State& engine, const VkCommandBuffer& cmd_buf,
+    GfxTask& gfx_task, const std::vector<VkCommandBuffer>& secondary_cmd_bufs );
+
 } // namespace racecar::engine
@@ -3,11 +3,73 @@
 #include "../log.hpp"
 #include "../vk/create.hpp"
 #include "../vk/utility.hpp"
+#include "dds.hpp"
+#include "texture_compression.hpp"
 
 #include <stb_image.h>
 
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+#include <optional>
+
 namespace racecar::engine {
 
+/// Size of the staging ring used by `create_images`. Grows to fit images bigger than this.
+constexpr VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+
+namespace {
+
+/// The racecar-bake output for `source_path`, if there is one in `format` that's at least as new
+/// as the source.
+std::optional<CompressedImage> read_baked_texture(
+    const std::filesystem::path& source_path, VkFormat format )
+{
+    std::filesystem::path baked_path = baked_texture_path( source_path );
+
+    std::error_code error;
+    std::filesystem::file_time_type baked_time
+        = std::filesystem::last_write_time( baked_path, error );
+    if ( error ) {
+        return std::nullopt;
+    }
+
+    std::filesystem::file_time_type source_time
+        = std::filesystem::last_write_time( source_path, error );
+    if ( !error && source_time > baked_time ) {
+        log::warn( "[IMAGE LOADER] \"{}\" is older than \"{}\", rebake it", baked_path.string(),
+            source_path.string() );
+        return std::nullopt;
+    }
+
+    std::optional<CompressedImage> baked = read_dds( baked_path );
+    if ( baked && baked->format != format ) {
+        log::warn( "[IMAGE LOADER] \"{}\" is in format {} instead of {}, rebake it",
+            baked_path.string(), static_cast<int>( baked->format ), static_cast<int>( format ) );
+        return std::nullopt;
+    }
+
+    return baked;
+}
+
+/// Prefers the baked .dds next to the image, and otherwise compresses it right here. That's a lot
+/// slower, but keeps unbaked assets working.
+CompressedImage read_compressed_image(
+    const std::filesystem::path& file_path, VkFormat image_format, bool is_mipmapped )
+{
+    std::optional<CompressedImage> image = read_baked_texture( file_path, image_format );
+
+    if ( !image ) {
+        log::info( "[IMAGE LOADER] No baked \"{}\", compressing \"{}\" at load time",
+            baked_texture_path( file_path ).string(), file_path.string() );
+        image = compress_image_file( file_path, image_format, is_mipmapped );
+    }
+
+    return std::move( *image );
+}
+
+}
+
 void generate_mipmaps(
     VkImage image, VkExtent3D extent, uint32_t mip_levels, VkCommandBuffer cmd_buffer )
 {
@@ -88,11 +150,18 @@ vk::mem::AllocatedImage create_image( vk::Common& vulkan, engine::State& engine,
     VkExtent3D extent, VkFormat format, VkImageType image_type, VkImageUsageFlags usage_flags,
     bool mipmapped )
 {
-    const size_t data_size
-        = extent.depth * extent.width * extent.height * vk::utility::bytes_from_format( format );
+    const size_t data_size = vk::utility::image_data_size( format, extent, 1 );
 
     vk::mem::AllocatedImage new_image;
 
+    // Block-compressed images can't be blitted to, their mips have to come from the CPU through
+    // `create_images` instead.
+    if ( mipmapped && vk::utility::is_block_compressed( format ) ) {
+        log::warn( "[AllocatedImage] Can't generate mips for block-compressed format {}",
+            static_cast<int>( format ) );
+        mipmapped = false;
+    }
+
     uint32_t mip_levels = 1;
     if ( mipmapped ) {
         // Auto generate the miplevels
@@ -157,6 +226,182 @@ vk::mem::AllocatedImage create_image( vk::Common& vulkan, engine::State& engine,
     return new_image;
 };
 
+std::vector<vk::mem::AllocatedImage> create_images(
+    vk::Common& vulkan, engine::State& engine, std::span<const ImageUpload> uploads )
+{
+    if ( uploads.empty() ) {
+        return {};
+    }
+
+    std::vector<VkDeviceSize> data_sizes( uploads.size() );
+    VkDeviceSize largest_size = 0;
+
+    for ( size_t i = 0; i < uploads.size(); i++ ) {
+        const ImageUpload& upload = uploads[i];
+        data_sizes[i]
+            = vk::utility::image_data_size( upload.format, upload.extent, upload.mip_levels );
+
+        if ( data_sizes[i] == 0 ) {
+            throw Exception( "[AllocatedImage] Unsupported format {} in batched upload",
+                static_cast<int>( upload.format ) );
+        }
+
+        largest_size = std::max( largest_size, data_sizes[i] );
+    }
+
+    // Copy offsets have to be a multiple of the texel (or block) size, and keeping them 16 byte
+    // aligned on top of that doesn't hurt.
+    auto align = []( VkDeviceSize offset, VkFormat format ) {
+        VkDeviceSize texel_size = vk::utility::bytes_from_format( format );
+        VkDeviceSize alignment = std::lcm( VkDeviceSize( 16 ), texel_size );
+        return ( offset + alignment - 1 ) / alignment * alignment;
+    };
+
+    // Only as big as the whole batch packed together, so a few small images don't get the full
+    // ring, but never smaller than the largest image.
+    VkDeviceSize total_size = 0;
+    for ( size_t i = 0; i < uploads.size(); i++ ) {
+        total_size = align( total_size, uploads[i].format ) + data_sizes[i];
+    }
+
+    VkDeviceSize ring_size = std::max( std::min( STAGING_RING_SIZE, total_size ), largest_size );
+
+    // Not from `vk::mem::create_buffer`, which keeps buffers until shutdown. The ring is done
+    // with once the last batch has gone through, so it gets freed right here.
+    vk::mem::AllocatedBuffer staging_ring;
+    {
+        VkBufferCreateInfo buffer_info = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = ring_size,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        };
+        VmaAllocationCreateInfo allocation_info = {
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+        };
+        vk::check( vmaCreateBuffer( vulkan.allocator, &buffer_info, &allocation_info,
+                       &staging_ring.handle, &staging_ring.allocation, &staging_ring.info ),
+            "[VMA] Failed to create staging ring" );
+    }
+
+    std::vector<vk::mem::AllocatedImage> images( uploads.size() );
+    std::vector<uint32_t> mip_levels( uploads.size(), 1 );
+
+    for ( size_t i = 0; i < uploads.size(); i++ ) {
+        const ImageUpload& upload = uploads[i];
+        if ( upload.mip_levels > 1 ) {
+            mip_levels[i] = upload.mip_levels;
+        } else if ( upload.mipmapped && !vk::utility::is_block_compressed( upload.format ) ) {
+            uint32_t max_dimension = std::max( upload.extent.width, upload.extent.height );
+            mip_levels[i] = static_cast<uint32_t>( std::floor( std::log2( max_dimension ) ) ) + 1;
+        }
+
+        images[i] = allocate_image( vulkan, upload.extent, upload.format, VK_IMAGE_TYPE_2D,
+            mip_levels[i], 1, VK_SAMPLE_COUNT_1_BIT,
+            upload.usage_flags | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            upload.mipmapped );
+    }
+
+    size_t num_submissions = 0;
+    size_t batch_begin = 0;
+
+    while ( batch_begin < uploads.size() ) {
+        // Pack as many images as fit into the ring. immediate_submit waits on its fence, so the
+        // ring is free to be overwritten again by the next batch.
+        std::vector<VkDeviceSize> offsets;
+        VkDeviceSize ring_offset = 0;
+        size_t batch_end = batch_begin;
+
+        while ( batch_end < uploads.size() ) {
+            VkDeviceSize offset = align( ring_offset, uploads[batch_end].format );
+            if ( offset + data_sizes[batch_end] > ring_size ) {
+                break;
+            }
+
+            std::memcpy( static_cast<std::byte*>( staging_ring.info.pMappedData ) + offset,
+                uploads[batch_end].data, data_sizes[batch_end] );
+
+            offsets.push_back( offset );
+            ring_offset = offset + data_sizes[batch_end];
+            batch_end++;
+        }
+
+        vk::check( vmaFlushAllocation( vulkan.allocator, staging_ring.allocation, 0, ring_offset ),
+            "[VMA] Failed to flush staging ring" );
+
+        engine::immediate_submit(
+            vulkan, engine.immediate_submit, [&]( VkCommandBuffer command_buffer ) {
+                for ( size_t i = batch_begin; i < batch_end; i++ ) {
+                    vk::utility::transition_image_mips( command_buffer, images[i].image,
+                        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                        VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_IMAGE_ASPECT_COLOR_BIT, mip_levels[i] );
+
+                    const ImageUpload& upload = uploads[i];
+
+                    // One region per level that's already in the data.
+                    std::vector<VkBufferImageCopy> copy_regions;
+                    VkDeviceSize level_offset = offsets[i - batch_begin];
+
+                    for ( uint32_t mip = 0; mip < upload.mip_levels; mip++ ) {
+                        VkExtent3D level_extent = {
+                            std::max( upload.extent.width >> mip, 1u ),
+                            std::max( upload.extent.height >> mip, 1u ),
+                            std::max( upload.extent.depth >> mip, 1u ),
+                        };
+
+                        copy_regions.push_back( {
+                            .bufferOffset = level_offset,
+                            .bufferRowLength = 0,
+                            .bufferImageHeight = 0,
+                            .imageSubresource = {
+                                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                .mipLevel = mip,
+                                .baseArrayLayer = 0,
+                                .layerCount = 1,
+                            },
+                            .imageOffset = { 0, 0, 0 },
+                            .imageExtent = level_extent,
+                        } );
+
+                        level_offset
+                            += vk::utility::image_data_size( upload.format, level_extent, 1 );
+                    }
+
+                    vkCmdCopyBufferToImage( command_buffer, staging_ring.handle, images[i].image,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        static_cast<uint32_t>( copy_regions.size() ), copy_regions.data() );
+
+                    // generate_mipmaps leaves every level in SHADER_READ_ONLY_OPTIMAL itself.
+                    if ( mip_levels[i] > upload.mip_levels ) {
+                        generate_mipmaps(
+                            images[i].image, upload.extent, mip_levels[i], command_buffer );
+                    } else {
+                        vk::utility::transition_image_mips( command_buffer, images[i].image,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                            VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                            mip_levels[i] );
+                    }
+                }
+            } );
+
+        num_submissions++;
+        batch_begin = batch_end;
+    }
+
+    // immediate_submit waited on the last batch, nothing reads the ring anymore
+    vmaDestroyBuffer( vulkan.allocator, staging_ring.handle, staging_ring.allocation );
+
+    log::info( "[AllocatedImage] Uploaded {} images in {} submissions through a {} byte staging "
+               "ring",
+        uploads.size(), num_submissions, ring_size );
+
+    return images;
+}
+
 vk::mem::AllocatedImage allocate_vma_image( vk::Common& vulkan, VkExtent3D extent, VkFormat format,
     VkImageType image_type, uint32_t mip_levels, uint32_t array_layers,
     VkSampleCountFlagBits samples, VkImageUsageFlags usage_flags )
@@ -164,6 +409,7 @@ vk::mem::AllocatedImage allocate_vma_image( vk::Common& vulkan, VkExtent3D exten
     vk::mem::AllocatedImage allocated_image = {
         .image_extent = extent,
         .image_format = format,
+        .samples = samples,
     };
 
     VkImageCreateInfo image_info = vk::create::image_info(
@@ -262,6 +508,42 @@ std::vector<float> load_image_to_float( const std::string& global_path )
     return float_data;
 }
 
+std::vector<vk::mem::AllocatedImage> load_compressed_images(
+    vk::Common& vulkan, engine::State& engine, std::span<const CompressedImageLoad> loads )
+{
+    // Kept alive for `create_images`, which only points into them.
+    std::vector<CompressedImage> images;
+    std::vector<ImageUpload> uploads;
+    images.reserve( loads.size() );
+    uploads.reserve( loads.size() );
+
+    for ( const CompressedImageLoad& load : loads ) {
+        if ( !vk::utility::is_block_compressed( load.format ) ) {
+            throw Exception( "[IMAGE LOADER] \"{}\" requested in format {}, which isn't block "
+                             "compressed",
+                load.file_path.string(), static_cast<int>( load.format ) );
+        }
+
+        const CompressedImage& image = images.emplace_back(
+            read_compressed_image( load.file_path, load.format, load.mipmapped ) );
+
+        // Baked textures always come with the full chain, the first level is all we need without
+        // mips.
+        uint32_t mip_levels = load.mipmapped ? image.mip_levels : 1;
+
+        uploads.push_back( {
+            .data = image.data.data(),
+            .extent = { image.width, image.height, 1 },
+            .format = load.format,
+            .usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT,
+            .mipmapped = mip_levels > 1,
+            .mip_levels = mip_levels,
+        } );
+    }
+
+    return create_images( vulkan, engine, uploads );
+}
+
 std::vector<uint16_t> load_image_to_float16( const std::string& global_path )
 {
     int width, height, channels;
@@ -281,6 +563,15 @@ std::vector<uint16_t> load_image_to_float16( const std::string& global_path )
 vk::mem::AllocatedImage load_image( std::filesystem::path file_path, vk::Common& vulkan,
     engine::State& engine, size_t desired_channels, VkFormat image_format, bool is_mipmapped )
 {
+    if ( vk::utility::is_block_compressed( image_format ) ) {
+        CompressedImageLoad load = {
+            .file_path = file_path,
+            .format = image_format,
+            .mipmapped = is_mipmapped,
+        };
+        return load_compressed_images( vulkan, engine, { &load, 1 } ).front();
+    }
+
     std::string abs_file_path = std::filesystem::absolute( file_path ).string();
 
     int width, height, channels;
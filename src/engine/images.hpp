@@ -4,6 +4,7 @@
 #include "state.hpp"
 
 #include <filesystem>
+#include <span>
 
 enum class FormatType { UNORM8, FLOAT16 };
 enum class MIP_TYPE : uint32_t { AUTO_GENERATE = 0 };
@@ -14,13 +15,43 @@ vk::mem::AllocatedImage create_image( vk::Common& vulkan, engine::State& engine,
     VkExtent3D size, VkFormat format, VkImageType image_type, VkImageUsageFlags usage_flags,
     bool mipmapped );
 
+/// One image for `create_images`. `data` has to stay alive until `create_images` returns.
+struct ImageUpload {
+    const void* data = nullptr;
+    VkExtent3D extent = {};
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkImageUsageFlags usage_flags = 0;
+    bool mipmapped = false;
+    uint32_t mip_levels = 1; ///< Levels packed in `data`. If 1 and mipmapped, generated on the GPU.
+};
+
+/// Batched `create_image`. Pixels get packed into a single staging ring that is reused between
+/// submissions, and all copies and mip generation are recorded into as few submissions as the
+/// ring allows instead of one blocking submission per image.
+std::vector<vk::mem::AllocatedImage> create_images(
+    vk::Common& vulkan, engine::State& engine, std::span<const ImageUpload> uploads );
+
 vk::mem::AllocatedImage allocate_image( vk::Common& vulkan, VkExtent3D extent, VkFormat format,
     VkImageType image_type, uint32_t mip_levels, uint32_t array_layers,
     VkSampleCountFlagBits samples, VkImageUsageFlags usage_flags, bool mipmapped );
 
+/// Loads an image file into `image_format`. Block-compressed formats come from the .dds that
+/// racecar-bake writes next to the file if there is one, and are compressed at load time otherwise.
 vk::mem::AllocatedImage load_image( std::filesystem::path file_path, vk::Common& vulkan,
     engine::State& engine, size_t desired_channels, VkFormat image_format, bool is_mipmapped );
 
+/// One image for `load_compressed_images`, same as the arguments to `load_image`.
+struct CompressedImageLoad {
+    std::filesystem::path file_path;
+    VkFormat format = VK_FORMAT_UNDEFINED; ///< Has to be block-compressed.
+    bool mipmapped = false;
+};
+
+/// Batched `load_image` for block-compressed formats. Everything is read first and then uploaded
+/// through one `create_images`, so the images share a staging ring and submissions.
+std::vector<vk::mem::AllocatedImage> load_compressed_images(
+    vk::Common& vulkan, engine::State& engine, std::span<const CompressedImageLoad> loads );
+
 std::vector<uint16_t> load_image_to_float16( const std::string& global_path );
 std::vector<float> load_image_to_float( const std::string& global_path );
 
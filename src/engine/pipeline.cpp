@@ -8,16 +8,12 @@
 
 namespace racecar::engine {
 
-constexpr std::string_view VERTEX_ENTRY_NAME = "vs_main";
-constexpr std::string_view TESS_CONTROL_ENTRY_NAME = "ts_control_main";
-constexpr std::string_view TESS_EVAL_ENTRY_NAME = "ts_eval_main";
-constexpr std::string_view FRAGMENT_ENTRY_NAME = "fs_main";
-
 Pipeline create_gfx_pipeline( const engine::State& engine, vk::Common& vulkan,
     std::optional<VkPipelineVertexInputStateCreateInfo> vertex_input_state_create_info,
     const std::vector<VkDescriptorSetLayout>& layouts,
     const std::vector<VkFormat> color_attachment_formats, VkSampleCountFlagBits samples, bool blend,
-    bool depth_test, VkShaderModule shader_module, bool enable_tessellation_shaders )
+    bool depth_test, VkShaderModule shader_module, bool enable_tessellation_shaders,
+    std::string_view vertex_entry_name, const VkSpecializationInfo* specialization_info )
 {
     if ( enable_tessellation_shaders ) {
         log::info("[TESSELLATION] Creating pipeline with tessellation shaders enabled");
@@ -129,7 +125,7 @@ Pipeline create_gfx_pipeline( const engine::State& engine, vk::Common& vulkan,
     if (!enable_tessellation_shaders) {   
         shader_stages = {
             vk::create::pipeline_shader_stage_info(
-                VK_SHADER_STAGE_VERTEX_BIT, shader_module, VERTEX_ENTRY_NAME ),
+                VK_SHADER_STAGE_VERTEX_BIT, shader_module, vertex_entry_name ),
             vk::create::pipeline_shader_stage_info(
                 VK_SHADER_STAGE_FRAGMENT_BIT, shader_module, FRAGMENT_ENTRY_NAME ),
         };
@@ -137,7 +133,7 @@ Pipeline create_gfx_pipeline( const engine::State& engine, vk::Common& vulkan,
     else {
         shader_stages = {
             vk::create::pipeline_shader_stage_info(
-                VK_SHADER_STAGE_VERTEX_BIT, shader_module, VERTEX_ENTRY_NAME ),
+                VK_SHADER_STAGE_VERTEX_BIT, shader_module, vertex_entry_name ),
             vk::create::pipeline_shader_stage_info(
                 VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT, shader_module, TESS_CONTROL_ENTRY_NAME ),
             vk::create::pipeline_shader_stage_info(
@@ -147,6 +143,11 @@ Pipeline create_gfx_pipeline( const engine::State& engine, vk::Common& vulkan,
         };
     }
 
+    // Every stage gets the same constants, the ones a stage doesn't declare are ignored
+    for ( VkPipelineShaderStageCreateInfo& stage : shader_stages ) {
+        stage.pSpecializationInfo = specialization_info;
+    }
+
     // Use dynamic rendering instead of manually creating render passes
     VkPipelineRenderingCreateInfo pipeline_rendering_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
@@ -183,7 +184,7 @@ Pipeline create_gfx_pipeline( const engine::State& engine, vk::Common& vulkan,
 
 Pipeline create_compute_pipeline( vk::Common& vulkan,
     const std::vector<VkDescriptorSetLayout>& layouts, VkShaderModule shader_module,
-    std::string_view entry_name )
+    std::string_view entry_name, const VkSpecializationInfo* specialization_info )
 {
     Pipeline compute_pipeline;
 
@@ -216,7 +217,7 @@ Pipeline create_compute_pipeline( vk::Common& vulkan,
     };
 
     create_pipeline_info.stage = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-        VK_SHADER_STAGE_COMPUTE_BIT, shader_module, entry_name.data(), nullptr };
+        VK_SHADER_STAGE_COMPUTE_BIT, shader_module, entry_name.data(), specialization_info };
 
     VkPipeline compute_pipeline_handle;
     vk::check( vkCreateComputePipelines( vulkan.device, VK_NULL_HANDLE, 1, &create_pipeline_info,
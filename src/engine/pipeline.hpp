@@ -4,9 +4,15 @@
 #include "state.hpp"
 
 #include <optional>
+#include <string_view>
 
 namespace racecar::engine {
 
+constexpr std::string_view VERTEX_ENTRY_NAME = "vs_main";
+constexpr std::string_view TESS_CONTROL_ENTRY_NAME = "ts_control_main";
+constexpr std::string_view TESS_EVAL_ENTRY_NAME = "ts_eval_main";
+constexpr std::string_view FRAGMENT_ENTRY_NAME = "fs_main";
+
 struct Pipeline {
     VkPipeline handle = nullptr;
     VkPipelineLayout layout = nullptr;
@@ -16,11 +22,13 @@ Pipeline create_gfx_pipeline( const engine::State& engine, vk::Common& vulkan,
     std::optional<VkPipelineVertexInputStateCreateInfo> vertex_input_state_create_info,
     const std::vector<VkDescriptorSetLayout>& layouts,
     const std::vector<VkFormat> color_attachment_formats, VkSampleCountFlagBits samples, bool blend,
-    bool depth_test, VkShaderModule shader_module, bool enable_tessellation_shaders );
+    bool depth_test, VkShaderModule shader_module, bool enable_tessellation_shaders,
+    std::string_view vertex_entry_name = VERTEX_ENTRY_NAME,
+    const VkSpecializationInfo* specialization_info = nullptr );
 
 Pipeline create_compute_pipeline( vk::Common& vulkan,
     const std::vector<VkDescriptorSetLayout>& layouts, VkShaderModule shader_module,
-    std::string_view entry_name );
+    std::string_view entry_name, const VkSpecializationInfo* specialization_info = nullptr );
 
 template <typename Mesh>
 VkPipelineVertexInputStateCreateInfo get_vertex_input_state_create_info( const Mesh& mesh )
@@ -78,11 +78,15 @@ AAPass add_aa( vk::Common& vulkan, State& engine, const RWImage& input,
             .descriptor_sets = { pass.uniform_desc_set.get() },
             .group_size = glm::ivec3( ( engine.swapchain.extent.width + 7 ) / 8,
                 ( engine.swapchain.extent.height + 7 ) / 8, 1 ),
+            .image_uses = {
+                { input, ImageAccess::COMPUTE_SAMPLED },
+                { history, ImageAccess::COMPUTE_SAMPLED },
+                { GBuffer_Depth, ImageAccess::COMPUTE_SAMPLED },
+                { GBuffer_Velocity, ImageAccess::COMPUTE_SAMPLED },
+                { output, ImageAccess::COMPUTE_STORAGE_WRITE },
+            },
         } );
 
-    transition_cs_write_to_read( task_list, output );
-    transition_cs_read_to_write( task_list, history );
-
     engine::add_cs_task( task_list,
         {
             .pipeline
@@ -91,11 +95,14 @@ AAPass add_aa( vk::Common& vulkan, State& engine, const RWImage& input,
             .descriptor_sets = { pass.history_desc_set.get() },
             .group_size = glm::ivec3( ( engine.swapchain.extent.width + 7 ) / 8,
                 ( engine.swapchain.extent.height + 7 ) / 8, 1 ),
+            .image_uses = {
+                { output, ImageAccess::COMPUTE_SAMPLED },
+                { history, ImageAccess::COMPUTE_STORAGE_WRITE },
+            },
         } );
 
-    // Ensure write for the proper transition before... uh... the blit
-    transition_cs_read_to_write( task_list, output );
-    transition_cs_write_to_read( task_list, history );
+    // Nothing reads the history until next frame
+    keep_image( task_list, history );
 
     return pass;
 }
@@ -66,6 +66,12 @@ void add_ao( AoPass& ao_pass, vk::Common& vulkan, engine::State& engine, TaskLis
             &ao_pass.texture_desc_set,
         },
         glm::ivec3( dim_x, dim_y, 1 ),
+        {
+            { *ao_pass.in_color, ImageAccess::COMPUTE_SAMPLED },
+            { *ao_pass.GBuffer_Normal, ImageAccess::COMPUTE_SAMPLED },
+            { *ao_pass.GBuffer_Depth, ImageAccess::COMPUTE_SAMPLED },
+            { *ao_pass.out_color, ImageAccess::COMPUTE_STORAGE_WRITE },
+        },
     };
 
     engine::add_cs_task( task_list, cs_ao_task );
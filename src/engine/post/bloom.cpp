@@ -2,6 +2,7 @@
 
 #include "../../log.hpp"
 #include "../../vk/create.hpp"
+#include "../transient.hpp"
 
 namespace racecar::engine::post {
 
@@ -13,14 +14,11 @@ constexpr std::string_view UPSAMPLE_SHADER_PATH = "../shaders/post/bloom/upsampl
 
 }
 
-BloomPass add_bloom( vk::Common& vulkan, const State& engine, TaskList& task_list, RWImage& inout,
+BloomPass add_bloom( vk::Common& vulkan, State& engine, TaskList& task_list, RWImage& inout,
     RWImage& write_only )
 {
     BloomPass pass;
 
-    engine::transition_cs_read_to_rw( task_list, inout );
-    engine::transition_cs_write_to_rw( task_list, write_only );
-
     log::info( "[Post] [Bloom] Number of passes: {}", BloomPass::NUM_PASSES );
 
     {
@@ -28,23 +26,11 @@ BloomPass add_bloom( vk::Common& vulkan, const State& engine, TaskList& task_lis
             = { engine.swapchain.extent.width / 2, engine.swapchain.extent.height / 2, 1 };
 
         for ( size_t i = 0; i < BloomPass::NUM_PASSES; ++i ) {
-            pass.images[i] = engine::create_rwimage( vulkan, engine, current_extent,
-                VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+            pass.images[i] = engine::create_transient_rwimage( vulkan, engine, current_extent,
+                VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT,
                 VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT
                     | VK_IMAGE_USAGE_TRANSFER_SRC_BIT );
 
-            engine::add_pipeline_barrier( task_list,
-                { .image_barriers = { {
-                      .src_stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-                      .src_access = VK_ACCESS_2_NONE,
-                      .src_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                      .dst_stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-                      .dst_access = VK_ACCESS_2_SHADER_READ_BIT,
-                      .dst_layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
-                      .image = pass.images[i],
-                      .range = engine::VK_IMAGE_SUBRESOURCE_RANGE_DEFAULT_COLOR,
-                  } } } );
-
             // Each progressive image has half resolution
             log::info( "[Post] [Bloom] Created intermediate image of size {}×{}",
                 current_extent.width, current_extent.height );
@@ -78,9 +64,9 @@ BloomPass add_bloom( vk::Common& vulkan, const State& engine, TaskList& task_lis
             { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE },
             VK_SHADER_STAGE_COMPUTE_BIT );
         engine::update_descriptor_set_rwimage( vulkan, engine, threshold_desc_set, inout,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0 );
+            VK_IMAGE_LAYOUT_GENERAL, 0 );
         engine::update_descriptor_set_rwimage( vulkan, engine, threshold_desc_set, write_only,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1 );
+            VK_IMAGE_LAYOUT_GENERAL, 1 );
 
         engine::Pipeline threshold_pipeline = engine::create_compute_pipeline( vulkan,
             { threshold_desc_set.layouts[0], pass.uniform_desc_set->layouts[0] },
@@ -95,20 +81,17 @@ BloomPass add_bloom( vk::Common& vulkan, const State& engine, TaskList& task_lis
                 .descriptor_sets = { pass.threshold_desc_set.get(), pass.uniform_desc_set.get() },
                 .group_size = { ( engine.swapchain.extent.width + 7 ) / 8,
                     ( engine.swapchain.extent.height + 7 ) / 8, 1 },
+                .image_uses = {
+                    { inout, ImageAccess::COMPUTE_STORAGE_READ },
+                    { write_only, ImageAccess::COMPUTE_STORAGE_WRITE },
+                },
             } );
     }
 
     VkShaderModule downsample_shader = vk::create::shader_module( vulkan, DOWNSAMPLE_SHADER_PATH );
 
     for ( size_t i = 0; i < BloomPass::NUM_PASSES; ++i ) {
-        if ( i == 0 ) {
-            // We'll be reading from the full resolution input texture
-            engine::transition_cs_read_to_write( task_list, pass.images[0] );
-        } else {
-            engine::transition_cs_write_to_read( task_list, pass.images[i - 1] );
-            engine::transition_cs_read_to_write( task_list, pass.images[i] );
-        }
-
+        // The first pass reads from the full resolution input texture
         const RWImage& input_image = i == 0 ? write_only : pass.images[i - 1];
         VkExtent3D output_extent = pass.images[i].images[0].image_extent;
 
@@ -135,28 +118,19 @@ BloomPass add_bloom( vk::Common& vulkan, const State& engine, TaskList& task_lis
                     pass.uniform_desc_set.get(), pass.sampler_desc_set.get() },
                 .group_size
                 = { ( output_extent.width + 7 ) / 8, ( output_extent.height + 7 ) / 8, 1 },
+                .image_uses = {
+                    { input_image, ImageAccess::COMPUTE_SAMPLED },
+                    { pass.images[i], ImageAccess::COMPUTE_STORAGE_WRITE },
+                },
             } );
-
-        if ( i == 0 ) {
-            engine::transition_cs_rw_to_write( task_list, write_only );
-        }
     }
 
-    engine::transition_cs_write_to_rw( task_list, pass.images[BloomPass::NUM_PASSES - 1] );
-
     VkShaderModule upsample_shader = vk::create::shader_module( vulkan, UPSAMPLE_SHADER_PATH );
 
     for ( int signed_i = BloomPass::NUM_PASSES - 1; signed_i >= 0; --signed_i ) {
         size_t i = static_cast<size_t>( signed_i );
 
-        if ( i == 0 ) {
-            // We'll be writing to the full resolution output texture
-            engine::transition_cs_rw_to_read( task_list, pass.images[0] );
-        } else {
-            engine::transition_cs_rw_to_read( task_list, pass.images[i] );
-            engine::transition_cs_read_to_rw( task_list, pass.images[i - 1] );
-        }
-
+        // The last pass writes to the full resolution output texture
         const RWImage& output_image = i == 0 ? inout : pass.images[i - 1];
         VkExtent3D output_extent = output_image.images[0].image_extent;
 
@@ -184,11 +158,13 @@ BloomPass add_bloom( vk::Common& vulkan, const State& engine, TaskList& task_lis
                     pass.uniform_desc_set.get(), pass.sampler_desc_set.get() },
                 .group_size
                 = { ( output_extent.width + 7 ) / 8, ( output_extent.height + 7 ) / 8, 1 },
+                .image_uses = {
+                    { pass.images[i], ImageAccess::COMPUTE_SAMPLED },
+                    { output_image, ImageAccess::COMPUTE_STORAGE_READ_WRITE },
+                },
             } );
     }
 
-    engine::transition_cs_rw_to_read( task_list, inout );
-
     log::info( "[Post] Added bloom pass!" );
 
     return pass;
@@ -27,7 +27,7 @@ struct BloomPass {
 };
 
 /// Assumes that `input` is already in `VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL`.
-BloomPass add_bloom( vk::Common& vulkan, const State& engine, TaskList& task_list, RWImage& inout,
+BloomPass add_bloom( vk::Common& vulkan, State& engine, TaskList& task_list, RWImage& inout,
     RWImage& write_only );
 
 }
@@ -39,6 +39,10 @@ TonemappingPass add_tonemapping( vk::Common& vulkan, const State& engine, const
             .descriptor_sets = { pass.uniform_desc_set.get() },
             .group_size = glm::ivec3( ( engine.swapchain.extent.width + 7 ) / 8,
                 ( engine.swapchain.extent.height + 7 ) / 8, 1 ),
+            .image_uses = {
+                { input, ImageAccess::COMPUTE_SAMPLED },
+                { output, ImageAccess::COMPUTE_STORAGE_WRITE },
+            },
         } );
 
     return pass;
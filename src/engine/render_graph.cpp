@@ -0,0 +1,1015 @@
+#include "render_graph.hpp"
+
+#include "../exception.hpp"
+#include "../log.hpp"
+#include "../vk/utility.hpp"
+#include "task_list.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace racecar::engine {
+
+namespace {
+
+constexpr VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT
+    | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT
+    | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT
+    | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+struct AccessInfo {
+    VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 access = VK_ACCESS_2_NONE;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    bool discards = false; ///< The previous contents are overwritten entirely.
+};
+
+/// Everything a task does with images that the graph knows of.
+struct TaskUses {
+    std::vector<ImageUse> uses;
+
+    /// Whether `uses` is everything the task reads. If not, the task has to be assumed to read
+    /// anything and nothing before it can be culled.
+    bool is_complete = false;
+
+    /// Writes to the swapchain, which is what the whole frame is for.
+    bool is_output = false;
+};
+
+/// Everything in here is written with barriers that cover every mip and layer in mind.
+struct BarrierTemplate {
+    RWImage image;
+    VkPipelineStageFlags2 src_stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 src_access = VK_ACCESS_2_NONE;
+    VkPipelineStageFlags2 dst_stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 dst_access = VK_ACCESS_2_NONE;
+    VkImageLayout old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout new_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageSubresourceRange range = {};
+    bool from_previous_frame = false;
+};
+
+/// What the graph knows about an image at a given point in the frame.
+struct ImageState {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    bool is_known = false; ///< Whether `layout` was set earlier in the frame.
+    bool is_partial = false; ///< Some barrier only covered part of its mips or layers.
+
+    /// The last write, and the stages/accesses it's already been made visible to.
+    VkPipelineStageFlags2 write_stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 write_access = VK_ACCESS_2_NONE;
+    VkPipelineStageFlags2 visible_stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 visible_access = VK_ACCESS_2_NONE;
+
+    /// Reads since the last write or barrier, which a write has to wait for.
+    VkPipelineStageFlags2 read_stages = VK_PIPELINE_STAGE_2_NONE;
+
+    /// Destination scope of a hand-placed barrier right before the current task. That's taken as
+    /// what the task does with the image, unless the task says otherwise.
+    VkPipelineStageFlags2 pending_stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 pending_access = VK_ACCESS_2_NONE;
+};
+
+struct Scope {
+    VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 access = VK_ACCESS_2_NONE;
+};
+
+/// Steps an image is used in, first and last included.
+struct Lifetime {
+    size_t first_step = 0;
+    size_t last_step = 0;
+
+    /// Touched by a hand-placed barrier or a task that doesn't declare its uses, so it may also
+    /// be read by undeclared tasks that come later without the graph knowing.
+    bool is_undeclared = false;
+};
+
+VkImage key_of( const RWImage& image )
+{
+    return image.images.empty() ? VK_NULL_HANDLE : image.images[0].image;
+}
+
+AccessInfo get_access_info( ImageAccess access, bool is_depth )
+{
+    VkImageLayout read_only_layout = is_depth ? VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL
+                                              : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    using enum ImageAccess;
+
+    switch ( access ) {
+    case COMPUTE_SAMPLED:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+            read_only_layout };
+
+    case COMPUTE_STORAGE_READ:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL };
+
+    case COMPUTE_STORAGE_WRITE:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, true };
+
+    case COMPUTE_STORAGE_READ_WRITE:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL };
+
+    case FRAGMENT_SAMPLED:
+        return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+            read_only_layout };
+
+    case COLOR_ATTACHMENT:
+        return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+    case DEPTH_ATTACHMENT:
+        return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT
+                | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+                | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL };
+
+    case TRANSFER_SRC:
+        return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+
+    case TRANSFER_DST:
+        return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
+    }
+
+    throw Exception( "[RenderGraph] Unknown image access {}", static_cast<int>( access ) );
+}
+
+AccessInfo get_access_info( const ImageUse& use )
+{
+    return get_access_info( use.access,
+        !use.image.images.empty()
+            && vk::utility::is_depth_format( use.image.images[0].image_format ) );
+}
+
+/// Only for checking whether one scope covers another: also counts what's implied by a stage or
+/// access, like depth writes coming with depth reads.
+VkPipelineStageFlags2 expand_stages( VkPipelineStageFlags2 stages )
+{
+    if ( stages
+        & ( VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT
+            | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT ) ) {
+        stages |= VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT
+            | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    }
+
+    if ( stages & VK_PIPELINE_STAGE_2_TRANSFER_BIT ) {
+        stages |= VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+    }
+
+    return stages;
+}
+
+VkAccessFlags2 expand_access( VkAccessFlags2 access )
+{
+    if ( access & ( VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_MEMORY_READ_BIT ) ) {
+        access |= VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+    }
+
+    if ( access & ( VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT ) ) {
+        access |= VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    }
+
+    if ( access & VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT ) {
+        access |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+    }
+
+    if ( access & VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT ) {
+        access |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    }
+
+    return access;
+}
+
+bool covers( VkPipelineStageFlags2 stages, VkAccessFlags2 access, const AccessInfo& info )
+{
+    bool covers_stages = ( stages & VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT )
+        || ( info.stages & ~expand_stages( stages ) ) == 0;
+
+    return covers_stages && ( info.access & ~expand_access( access ) ) == 0;
+}
+
+/// READ_ONLY_OPTIMAL is what the other read-only layouts turn into depending on the aspect, so
+/// going between them doesn't need a barrier.
+bool same_layout( VkImageLayout a, VkImageLayout b )
+{
+    auto is_read_only = []( VkImageLayout layout ) {
+        return layout == VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL
+            || layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            || layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+    };
+
+    return a == b
+        || ( ( a == VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL || b == VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL )
+            && is_read_only( a ) && is_read_only( b ) );
+}
+
+VkImageSubresourceRange full_range( const RWImage& image )
+{
+    return {
+        .aspectMask = vk::utility::is_depth_format( image.images[0].image_format )
+            ? VK_IMAGE_ASPECT_DEPTH_BIT
+            : VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0,
+        .levelCount = VK_REMAINING_MIP_LEVELS,
+        .baseArrayLayer = 0,
+        .layerCount = VK_REMAINING_ARRAY_LAYERS,
+    };
+}
+
+bool is_full_range( const RWImage& image, const VkImageSubresourceRange& range )
+{
+    uint32_t mip_levels
+        = std::max( static_cast<uint32_t>( image.images[0].mip_levels.size() ), uint32_t( 1 ) );
+
+    return range.baseMipLevel == 0 && range.baseArrayLayer == 0
+        && ( range.levelCount == VK_REMAINING_MIP_LEVELS || range.levelCount >= mip_levels );
+}
+
+TaskUses get_task_uses( const TaskList& task_list, Task::Type type, size_t list_index )
+{
+    TaskUses task_uses;
+
+    switch ( type ) {
+    case Task::GFX: {
+        const GfxTask& gfx_task = task_list.gfx_tasks[list_index];
+
+        // Swapchain attachments get swapped in every frame and transitioned by `execute()`
+        if ( !gfx_task.render_target_is_swapchain ) {
+            for ( const RWImage& attachment : gfx_task.color_attachments ) {
+                task_uses.uses.push_back( { attachment, ImageAccess::COLOR_ATTACHMENT } );
+            }
+
+            if ( gfx_task.depth_image ) {
+                task_uses.uses.push_back(
+                    { gfx_task.depth_image.value(), ImageAccess::DEPTH_ATTACHMENT } );
+            }
+        }
+
+        task_uses.uses.insert(
+            task_uses.uses.end(), gfx_task.image_uses.begin(), gfx_task.image_uses.end() );
+        task_uses.is_complete = !gfx_task.image_uses.empty();
+        task_uses.is_output = gfx_task.render_target_is_swapchain;
+        break;
+    }
+
+    case Task::COMP: {
+        const ComputeTask& cs_task = task_list.cs_tasks[list_index];
+        task_uses.uses = cs_task.image_uses;
+        task_uses.is_complete = !cs_task.image_uses.empty();
+        break;
+    }
+
+    case Task::BLIT: {
+        const BlitTask& blit_task = task_list.blit_tasks[list_index];
+        task_uses.uses.push_back( { blit_task.in_color, ImageAccess::TRANSFER_SRC } );
+
+        if ( blit_task.out_color ) {
+            task_uses.uses.push_back( { blit_task.out_color.value(), ImageAccess::TRANSFER_DST } );
+        }
+
+        task_uses.is_complete = true;
+        task_uses.is_output = !blit_task.out_color.has_value();
+        break;
+    }
+
+    case Task::CPU_CALL:
+        task_uses.is_output = true;
+        break;
+
+    case Task::RECORD:
+        task_uses.is_complete = true;
+        task_uses.is_output = true;
+        break;
+    }
+
+    return task_uses;
+}
+
+std::vector<size_t> get_list_indices( const TaskList& task_list )
+{
+    std::array<size_t, 5> counts = {};
+    std::vector<size_t> list_indices( task_list.tasks.size() );
+
+    for ( size_t i = 0; i < task_list.tasks.size(); i++ ) {
+        list_indices[i] = counts[static_cast<size_t>( task_list.tasks[i].type )]++;
+    }
+
+    return list_indices;
+}
+
+/// Walks the tasks backwards and culls the ones whose writes nobody reads. Anything that doesn't
+/// declare its uses could read anything, so nothing before it is ever culled.
+std::vector<bool> find_culled_tasks(
+    const TaskList& task_list, const std::vector<size_t>& list_indices )
+{
+    std::vector<bool> is_culled( task_list.tasks.size(), false );
+    std::unordered_set<VkImage> needed;
+    bool needs_everything = false;
+
+    for ( const RWImage& image : task_list.kept_images ) {
+        needed.insert( key_of( image ) );
+    }
+
+    for ( size_t i = task_list.tasks.size(); i-- > 0; ) {
+        TaskUses task_uses = get_task_uses( task_list, task_list.tasks[i].type, list_indices[i] );
+
+        if ( !task_uses.is_complete ) {
+            needs_everything = true;
+            continue;
+        }
+
+        bool has_writes = false;
+        bool is_needed = task_uses.is_output || needs_everything;
+
+        for ( const ImageUse& use : task_uses.uses ) {
+            if ( get_access_info( use ).access & WRITE_ACCESS ) {
+                has_writes = true;
+                is_needed = is_needed || needed.contains( key_of( use.image ) );
+            }
+        }
+
+        if ( has_writes && !is_needed ) {
+            is_culled[i] = true;
+            continue;
+        }
+
+        // Anything overwritten here is dead before this task, anything read is alive
+        for ( const ImageUse& use : task_uses.uses ) {
+            if ( get_access_info( use ).discards ) {
+                needed.erase( key_of( use.image ) );
+            }
+        }
+
+        for ( const ImageUse& use : task_uses.uses ) {
+            if ( !get_access_info( use ).discards ) {
+                needed.insert( key_of( use.image ) );
+            }
+        }
+    }
+
+    return is_culled;
+}
+
+/// Walks the tasks forwards, tracking the state of every image and turning hand-placed barriers
+/// and declared uses into one batch of barriers per task.
+struct ScheduleBuilder {
+    const TaskList& task_list;
+    const std::vector<size_t>& list_indices;
+    const std::vector<bool>& is_culled;
+
+    /// Transient images, mapped to their index in `State::transient_images`. Their contents never
+    /// make it to the next use of their memory, so their first use in a frame always starts from
+    /// VK_IMAGE_LAYOUT_UNDEFINED.
+    const std::unordered_map<VkImage, size_t>& transient_indices;
+
+    /// Layouts images are left in at the end of a frame, which is where the next one starts.
+    std::unordered_map<VkImage, VkImageLayout> previous_frame_layouts;
+
+    /// What the first use of a transient image has to wait for: the last use of whatever had its
+    /// memory before it, this frame or the one before.
+    std::unordered_map<VkImage, Scope> alias_sources;
+
+    std::unordered_map<VkImage, Lifetime> lifetimes;
+    std::optional<size_t> last_undeclared_step;
+
+    std::unordered_map<VkImage, ImageState> states;
+    std::vector<VkImage> pending_images;
+
+    std::vector<BarrierTemplate> batch;
+    std::vector<VkBufferMemoryBarrier2> buffer_batch;
+
+    std::vector<ScheduleStep> steps;
+    std::vector<BarrierTemplate> barriers;
+    std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+
+    size_t hand_placed_barriers = 0;
+
+    void build();
+    void add_barrier( const BarrierTemplate& barrier );
+    void apply_barrier( const ImageBarrier& barrier );
+    void apply_use( const ImageUse& use, bool is_undeclared );
+    void settle_pending();
+    void flush( std::optional<size_t> task, size_t list_index );
+    void touch( VkImage key, bool is_undeclared );
+
+    Scope alias_source( VkImage key ) const;
+    std::unordered_map<VkImage, VkImageLayout> final_layouts() const;
+    std::optional<Lifetime> get_lifetime( VkImage key ) const;
+    Scope last_use( VkImage key ) const;
+};
+
+void ScheduleBuilder::build()
+{
+    size_t num_tasks = task_list.tasks.size();
+
+    // Barriers are stored with the index of the task they go before
+    std::vector<std::vector<const PipelineBarrierDescriptor*>> barriers_before( num_tasks + 1 );
+
+    for ( const auto& [task_index, barrier] : task_list.pipeline_barriers ) {
+        barriers_before[static_cast<size_t>( task_index )].push_back( &barrier );
+    }
+
+    for ( size_t i = 0; i < num_tasks; i++ ) {
+        for ( const PipelineBarrierDescriptor* descriptor : barriers_before[i] ) {
+            for ( const ImageBarrier& barrier : descriptor->image_barriers ) {
+                apply_barrier( barrier );
+            }
+
+            for ( BufferBarrier barrier : descriptor->buffer_barriers ) {
+                buffer_batch.push_back( barrier.get_vk() );
+            }
+        }
+
+        // A culled task's barriers go in front of the next task that does run
+        if ( !is_culled[i] ) {
+            TaskUses task_uses
+                = get_task_uses( task_list, task_list.tasks[i].type, list_indices[i] );
+
+            for ( const ImageUse& use : task_uses.uses ) {
+                apply_use( use, !task_uses.is_complete );
+            }
+
+            if ( !task_uses.is_complete ) {
+                last_undeclared_step = steps.size();
+            }
+        }
+
+        settle_pending();
+
+        if ( !is_culled[i] ) {
+            flush( i, list_indices[i] );
+        }
+    }
+
+    if ( !batch.empty() || !buffer_batch.empty() ) {
+        flush( std::nullopt, 0 );
+    }
+
+    if ( !barriers_before[num_tasks].empty() ) {
+        log::warn( "[RenderGraph] Ignoring {} barrier(s) placed after the last task",
+            barriers_before[num_tasks].size() );
+    }
+}
+
+void ScheduleBuilder::add_barrier( const BarrierTemplate& barrier )
+{
+    // Two barriers on the same image with no task in between become one
+    for ( BarrierTemplate& existing : batch ) {
+        if ( key_of( existing.image ) != key_of( barrier.image )
+            || existing.range.baseMipLevel != barrier.range.baseMipLevel
+            || existing.range.levelCount != barrier.range.levelCount ) {
+            continue;
+        }
+
+        bool changes_layout = !same_layout( existing.new_layout, barrier.new_layout );
+
+        existing.src_stages |= barrier.src_stages;
+        existing.src_access |= barrier.src_access;
+        existing.dst_stages
+            = changes_layout ? barrier.dst_stages : existing.dst_stages | barrier.dst_stages;
+        existing.dst_access
+            = changes_layout ? barrier.dst_access : existing.dst_access | barrier.dst_access;
+        existing.new_layout = barrier.new_layout;
+
+        return;
+    }
+
+    batch.push_back( barrier );
+}
+
+void ScheduleBuilder::apply_barrier( const ImageBarrier& barrier )
+{
+    hand_placed_barriers++;
+    touch( key_of( barrier.image ), true );
+
+    ImageState& state = states[key_of( barrier.image )];
+
+    BarrierTemplate barrier_template = {
+        .image = barrier.image,
+        .src_stages = barrier.src_stage,
+        .src_access = barrier.src_access,
+        .dst_stages = barrier.dst_stage,
+        .dst_access = barrier.dst_access,
+        .old_layout = barrier.src_layout,
+        .new_layout = barrier.dst_layout,
+        .range = barrier.range,
+    };
+
+    if ( !is_full_range( barrier.image, barrier.range ) ) {
+        state.is_partial = true;
+        add_barrier( barrier_template );
+        return;
+    }
+
+    // UNDEFINED is on purpose, to throw the contents away. Anything else should match what the
+    // image is actually in.
+    if ( barrier.src_layout != VK_IMAGE_LAYOUT_UNDEFINED && state.is_known
+        && !same_layout( state.layout, barrier.src_layout ) ) {
+        barrier_template.old_layout = state.layout;
+    }
+
+    if ( !state.is_known && transient_indices.contains( key_of( barrier.image ) ) ) {
+        Scope source = alias_source( key_of( barrier.image ) );
+        barrier_template.src_stages |= source.stages;
+        barrier_template.src_access |= source.access;
+        barrier_template.old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    // Going from reads to more reads in the same layout, with any writes already visible
+    bool is_redundant = state.is_known && barrier.src_layout != VK_IMAGE_LAYOUT_UNDEFINED
+        && same_layout( state.layout, barrier.dst_layout )
+        && ( barrier.dst_access & WRITE_ACCESS ) == 0
+        && ( state.write_stages == VK_PIPELINE_STAGE_2_NONE
+            || covers( state.visible_stages, state.visible_access,
+                { .stages = barrier.dst_stage, .access = barrier.dst_access } ) );
+
+    if ( is_redundant ) {
+        state.read_stages |= barrier.dst_stage;
+        return;
+    }
+
+    add_barrier( barrier_template );
+
+    if ( barrier.src_access & WRITE_ACCESS ) {
+        state.write_stages |= barrier.src_stage;
+        state.write_access |= barrier.src_access & WRITE_ACCESS;
+    }
+
+    state.layout = barrier.dst_layout;
+    state.is_known = true;
+    state.read_stages = VK_PIPELINE_STAGE_2_NONE;
+    state.visible_stages = barrier.dst_stage;
+    state.visible_access = barrier.dst_access;
+    state.pending_stages = barrier.dst_stage;
+    state.pending_access = barrier.dst_access;
+
+    pending_images.push_back( key_of( barrier.image ) );
+}
+
+void ScheduleBuilder::apply_use( const ImageUse& use, bool is_undeclared )
+{
+    if ( use.image.images.empty() ) {
+        return;
+    }
+
+    VkImage key = key_of( use.image );
+    touch( key, is_undeclared );
+
+    ImageState& state = states[key];
+
+    if ( state.is_partial ) {
+        throw Exception( "[RenderGraph] Image {} is declared by a task, but some barrier only "
+                         "covers part of it",
+            static_cast<void*>( key ) );
+    }
+
+    AccessInfo info = get_access_info( use );
+    bool writes = ( info.access & WRITE_ACCESS ) != 0;
+
+    bool is_covered_by_pending = state.pending_stages != VK_PIPELINE_STAGE_2_NONE
+        && same_layout( state.layout, info.layout )
+        && covers( state.pending_stages, state.pending_access, info );
+
+    state.pending_stages = VK_PIPELINE_STAGE_2_NONE;
+    state.pending_access = VK_ACCESS_2_NONE;
+
+    if ( !is_covered_by_pending ) {
+        bool changes_layout = !state.is_known || !same_layout( state.layout, info.layout );
+
+        BarrierTemplate barrier = {
+            .image = use.image,
+            .dst_stages = info.stages,
+            .dst_access = info.access,
+            .old_layout = state.layout,
+            .new_layout = changes_layout ? info.layout : state.layout,
+            .range = full_range( use.image ),
+        };
+
+        if ( !state.is_known && transient_indices.contains( key ) ) {
+            Scope source = alias_source( key );
+            barrier.src_stages = source.stages;
+            barrier.src_access = source.access;
+            barrier.old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        } else if ( !state.is_known ) {
+            // First use this frame. The previous use of this image was at least a whole frame
+            // ago, which the CPU already waited on, so there's nothing to wait for here.
+            auto previous = previous_frame_layouts.find( key );
+
+            if ( !info.discards && previous != previous_frame_layouts.end() ) {
+                barrier.old_layout = previous->second;
+                barrier.from_previous_frame = true;
+            } else {
+                barrier.old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+        } else if ( changes_layout ) {
+            barrier.src_stages = state.write_stages | state.read_stages;
+            barrier.src_access = state.write_access;
+        } else if ( !covers( state.visible_stages, state.visible_access, info ) ) {
+            // Read-after-write or write-after-write, plus write-after-read for writes
+            barrier.src_stages = state.write_stages | ( writes ? state.read_stages : 0 );
+            barrier.src_access = state.write_access;
+        } else if ( writes ) {
+            barrier.src_stages = state.read_stages;
+        }
+
+        bool is_needed = changes_layout || barrier.src_stages != VK_PIPELINE_STAGE_2_NONE;
+
+        if ( is_needed ) {
+            add_barrier( barrier );
+
+            state.read_stages = VK_PIPELINE_STAGE_2_NONE;
+            state.visible_stages |= info.stages;
+            state.visible_access |= info.access;
+        }
+
+        state.layout = barrier.new_layout;
+        state.is_known = true;
+    }
+
+    if ( writes ) {
+        state.write_stages = info.stages;
+        state.write_access = info.access & WRITE_ACCESS;
+        state.visible_stages = VK_PIPELINE_STAGE_2_NONE;
+        state.visible_access = VK_ACCESS_2_NONE;
+        state.read_stages = VK_PIPELINE_STAGE_2_NONE;
+    } else {
+        state.read_stages |= info.stages;
+    }
+}
+
+/// Hand-placed barriers whose image the task didn't declare: assume the task did whatever the
+/// barrier made way for.
+void ScheduleBuilder::settle_pending()
+{
+    for ( VkImage key : pending_images ) {
+        ImageState& state = states[key];
+
+        if ( state.pending_stages == VK_PIPELINE_STAGE_2_NONE ) {
+            continue;
+        }
+
+        if ( state.pending_access & WRITE_ACCESS ) {
+            state.write_stages = state.pending_stages;
+            state.write_access = state.pending_access & WRITE_ACCESS;
+            state.visible_stages = VK_PIPELINE_STAGE_2_NONE;
+            state.visible_access = VK_ACCESS_2_NONE;
+            state.read_stages = VK_PIPELINE_STAGE_2_NONE;
+        } else {
+            state.read_stages |= state.pending_stages;
+        }
+
+        state.pending_stages = VK_PIPELINE_STAGE_2_NONE;
+        state.pending_access = VK_ACCESS_2_NONE;
+    }
+
+    pending_images.clear();
+}
+
+void ScheduleBuilder::flush( std::optional<size_t> task, size_t list_index )
+{
+    steps.push_back( {
+        .task = task,
+        .list_index = list_index,
+        .image_barriers_begin = barriers.size(),
+        .image_barriers_end = barriers.size() + batch.size(),
+        .buffer_barriers_begin = buffer_barriers.size(),
+        .buffer_barriers_end = buffer_barriers.size() + buffer_batch.size(),
+    } );
+
+    barriers.insert( barriers.end(), batch.begin(), batch.end() );
+    buffer_barriers.insert( buffer_barriers.end(), buffer_batch.begin(), buffer_batch.end() );
+
+    batch.clear();
+    buffer_batch.clear();
+}
+
+void ScheduleBuilder::touch( VkImage key, bool is_undeclared )
+{
+    size_t step = steps.size();
+    auto [lifetime, is_new] = lifetimes.try_emplace( key, Lifetime { step, step, is_undeclared } );
+
+    if ( !is_new ) {
+        lifetime->second.last_step = step;
+        lifetime->second.is_undeclared = lifetime->second.is_undeclared || is_undeclared;
+    }
+}
+
+Scope ScheduleBuilder::alias_source( VkImage key ) const
+{
+    auto source = alias_sources.find( key );
+    return source != alias_sources.end() ? source->second : Scope {};
+}
+
+std::optional<Lifetime> ScheduleBuilder::get_lifetime( VkImage key ) const
+{
+    auto found = lifetimes.find( key );
+
+    if ( found == lifetimes.end() ) {
+        return std::nullopt;
+    }
+
+    // Undeclared tasks might read it without a barrier in between, so it has to stay alive
+    // through all of them
+    Lifetime lifetime = found->second;
+
+    if ( lifetime.is_undeclared && last_undeclared_step ) {
+        lifetime.last_step = std::max( lifetime.last_step, last_undeclared_step.value() );
+    }
+
+    return lifetime;
+}
+
+/// Everything a later use of the image's memory has to wait for, once the frame is done with it.
+Scope ScheduleBuilder::last_use( VkImage key ) const
+{
+    std::optional<Lifetime> lifetime = get_lifetime( key );
+
+    if ( !lifetime ) {
+        return {};
+    }
+
+    if ( lifetime->is_undeclared ) {
+        return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT };
+    }
+
+    const ImageState& state = states.at( key );
+    return { state.write_stages | state.read_stages, state.write_access };
+}
+
+std::unordered_map<VkImage, VkImageLayout> ScheduleBuilder::final_layouts() const
+{
+    std::unordered_map<VkImage, VkImageLayout> layouts;
+
+    for ( const auto& [key, state] : states ) {
+        if ( state.is_known && !state.is_partial && !transient_indices.contains( key ) ) {
+            layouts[key] = state.layout;
+        }
+    }
+
+    return layouts;
+}
+
+bool overlaps( const Lifetime& a, const Lifetime& b )
+{
+    return a.first_step <= b.last_step && b.first_step <= a.last_step;
+}
+
+void sort_by_first_use( std::vector<std::vector<size_t>>& regions,
+    const std::vector<std::optional<Lifetime>>& lifetimes )
+{
+    for ( std::vector<size_t>& region : regions ) {
+        std::stable_sort( region.begin(), region.end(), [&]( size_t a, size_t b ) {
+            size_t first_a = lifetimes[a] ? lifetimes[a]->first_step : SIZE_MAX;
+            size_t first_b = lifetimes[b] ? lifetimes[b]->first_step : SIZE_MAX;
+            return first_a < first_b;
+        } );
+    }
+}
+
+/// Packs transient images into as few memory regions as it can, biggest first: each one goes into
+/// the first region it can live in whose images are all dead while it's alive. Images nothing
+/// uses get a region to themselves.
+std::vector<std::vector<size_t>> plan_transient_regions(
+    const State& engine, const std::vector<std::optional<Lifetime>>& lifetimes )
+{
+    std::vector<size_t> order( engine.transient_images.size() );
+    std::iota( order.begin(), order.end(), size_t( 0 ) );
+    std::stable_sort( order.begin(), order.end(), [&]( size_t a, size_t b ) {
+        return engine.transient_images[a].requirements.size
+            > engine.transient_images[b].requirements.size;
+    } );
+
+    std::vector<std::vector<size_t>> regions;
+    std::vector<uint32_t> memory_types;
+
+    for ( size_t index : order ) {
+        uint32_t image_memory_types = engine.transient_images[index].requirements.memoryTypeBits;
+        std::optional<size_t> found;
+
+        for ( size_t region = 0; region < regions.size() && lifetimes[index] && !found; region++ ) {
+            bool is_free = std::none_of(
+                regions[region].begin(), regions[region].end(), [&]( size_t other ) {
+                    return !lifetimes[other]
+                        || overlaps( lifetimes[index].value(), lifetimes[other].value() );
+                } );
+
+            if ( is_free && ( memory_types[region] & image_memory_types ) != 0 ) {
+                found = region;
+            }
+        }
+
+        if ( found ) {
+            regions[found.value()].push_back( index );
+            memory_types[found.value()] &= image_memory_types;
+        } else {
+            regions.push_back( { index } );
+            memory_types.push_back( image_memory_types );
+        }
+    }
+
+    sort_by_first_use( regions, lifetimes );
+    return regions;
+}
+
+/// The regions transient images were bound to by an earlier compile. Memory can't be rebound, so
+/// the new schedule has to keep them apart the same way.
+std::vector<std::vector<size_t>> get_bound_regions(
+    const State& engine, const std::vector<std::optional<Lifetime>>& lifetimes )
+{
+    std::vector<std::vector<size_t>> regions;
+
+    for ( size_t index = 0; index < engine.transient_images.size(); index++ ) {
+        std::optional<size_t> region = engine.transient_images[index].region;
+
+        if ( !region ) {
+            throw Exception(
+                "[RenderGraph] Transient image {} was created after memory got bound", index );
+        }
+
+        regions.resize( std::max( regions.size(), region.value() + 1 ) );
+        regions[region.value()].push_back( index );
+    }
+
+    for ( const std::vector<size_t>& region : regions ) {
+        for ( size_t a = 0; a < region.size(); a++ ) {
+            for ( size_t b = a + 1; b < region.size(); b++ ) {
+                const std::optional<Lifetime>& lifetime_a = lifetimes[region[a]];
+                const std::optional<Lifetime>& lifetime_b = lifetimes[region[b]];
+
+                if ( lifetime_a && lifetime_b
+                    && overlaps( lifetime_a.value(), lifetime_b.value() ) ) {
+                    throw Exception( "[RenderGraph] Transient images {} and {} share memory, but "
+                                     "are now used at the same time",
+                        region[a], region[b] );
+                }
+            }
+        }
+    }
+
+    sort_by_first_use( regions, lifetimes );
+    return regions;
+}
+
+}
+
+RenderGraph compile_render_graph( const State& engine, const TaskList& task_list )
+{
+    std::vector<size_t> list_indices = get_list_indices( task_list );
+    std::vector<bool> is_culled = find_culled_tasks( task_list, list_indices );
+
+    std::unordered_map<VkImage, size_t> transient_indices;
+    for ( size_t i = 0; i < engine.transient_images.size(); i++ ) {
+        transient_indices[engine.transient_images[i].image.image] = i;
+    }
+
+    // Run through the frame once to see where every image ends up, which is where it will be when
+    // the next frame starts, and when each transient image is alive
+    ScheduleBuilder first_pass = {
+        .task_list = task_list,
+        .list_indices = list_indices,
+        .is_culled = is_culled,
+        .transient_indices = transient_indices,
+    };
+    first_pass.build();
+
+    std::vector<std::optional<Lifetime>> lifetimes;
+    for ( const TransientImage& transient : engine.transient_images ) {
+        lifetimes.push_back( first_pass.get_lifetime( transient.image.image ) );
+    }
+
+    bool is_bound = std::any_of( engine.transient_images.begin(), engine.transient_images.end(),
+        []( const TransientImage& transient ) { return transient.region.has_value(); } );
+
+    std::vector<std::vector<size_t>> transient_regions = is_bound
+        ? get_bound_regions( engine, lifetimes )
+        : plan_transient_regions( engine, lifetimes );
+
+    ScheduleBuilder builder = {
+        .task_list = task_list,
+        .list_indices = list_indices,
+        .is_culled = is_culled,
+        .transient_indices = transient_indices,
+        .previous_frame_layouts = first_pass.final_layouts(),
+    };
+
+    // Every image waits for the one before it in its region. The first one waits for the last one,
+    // from the frame before, since all frames in flight share them.
+    for ( const std::vector<size_t>& region : transient_regions ) {
+        for ( size_t i = 0; i < region.size(); i++ ) {
+            size_t previous = region[( i + region.size() - 1 ) % region.size()];
+
+            builder.alias_sources[engine.transient_images[region[i]].image.image]
+                = first_pass.last_use( engine.transient_images[previous].image.image );
+        }
+    }
+
+    builder.build();
+
+    RenderGraph graph = {
+        .steps = std::move( builder.steps ),
+        .image_barriers = std::vector<std::vector<VkImageMemoryBarrier2>>( engine.frame_overlap ),
+        .buffer_barriers = std::move( builder.buffer_barriers ),
+        .has_run = std::vector<bool>( engine.frame_overlap, false ),
+        .transient_regions = std::move( transient_regions ),
+    };
+
+    for ( size_t i = 0; i < builder.barriers.size(); i++ ) {
+        if ( builder.barriers[i].from_previous_frame ) {
+            graph.previous_frame_barriers.push_back( i );
+        }
+    }
+
+    for ( size_t frame_index = 0; frame_index < engine.frame_overlap; frame_index++ ) {
+        for ( const BarrierTemplate& barrier : builder.barriers ) {
+            graph.image_barriers[frame_index].push_back( {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = barrier.src_stages,
+                .srcAccessMask = barrier.src_access,
+                .dstStageMask = barrier.dst_stages,
+                .dstAccessMask = barrier.dst_access,
+                .oldLayout = barrier.old_layout,
+                .newLayout = barrier.new_layout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = barrier.image.images[frame_index].image,
+                .subresourceRange = barrier.range,
+            } );
+        }
+    }
+
+    for ( bool culled : is_culled ) {
+        if ( culled ) {
+            graph.culled_tasks++;
+        }
+    }
+
+    size_t num_batches = 0;
+    for ( const ScheduleStep& step : graph.steps ) {
+        if ( step.image_barriers_end > step.image_barriers_begin
+            || step.buffer_barriers_end > step.buffer_barriers_begin ) {
+            num_batches++;
+        }
+    }
+
+    log::info( "[RenderGraph] Compiled {} tasks ({} culled): {} image barriers in {} batches, "
+               "{} of them hand-placed",
+        task_list.tasks.size(), graph.culled_tasks, builder.barriers.size(), num_batches,
+        builder.hand_placed_barriers );
+
+    return graph;
+}
+
+void record_barriers( const RenderGraph& graph, const ScheduleStep& step, size_t frame_index,
+    VkCommandBuffer cmd_buf )
+{
+    size_t image_count = step.image_barriers_end - step.image_barriers_begin;
+    size_t buffer_count = step.buffer_barriers_end - step.buffer_barriers_begin;
+
+    if ( image_count == 0 && buffer_count == 0 ) {
+        return;
+    }
+
+    const VkImageMemoryBarrier2* image_barriers
+        = graph.image_barriers[frame_index].data() + step.image_barriers_begin;
+
+    std::vector<VkImageMemoryBarrier2> first_run_barriers;
+
+    if ( !graph.has_run[frame_index] ) {
+        first_run_barriers.assign( image_barriers, image_barriers + image_count );
+
+        for ( size_t index : graph.previous_frame_barriers ) {
+            if ( index >= step.image_barriers_begin && index < step.image_barriers_end ) {
+                first_run_barriers[index - step.image_barriers_begin].oldLayout
+                    = VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+        }
+
+        image_barriers = first_run_barriers.data();
+    }
+
+    VkDependencyInfo info = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+        .bufferMemoryBarrierCount = static_cast<uint32_t>( buffer_count ),
+        .pBufferMemoryBarriers = graph.buffer_barriers.data() + step.buffer_barriers_begin,
+        .imageMemoryBarrierCount = static_cast<uint32_t>( image_count ),
+        .pImageMemoryBarriers = image_barriers,
+    };
+
+    vkCmdPipelineBarrier2( cmd_buf, &info );
+}
+
+} // namespace racecar::engine
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "rwimage.hpp"
+
+#include <volk.h>
+
+#include <optional>
+#include <vector>
+
+/// Turns a `TaskList` into a flat schedule: which barriers to record before which task, already
+/// batched per task and baked per frame in flight, so `execute()` only has to walk it.
+///
+/// Tasks can declare how they use images (`ImageUse`), and the graph derives the barriers for
+/// those from what came before. Hand-placed `PipelineBarrierDescriptor`s still work and are taken
+/// into account, so tasks can be moved over one at a time.
+namespace racecar::engine {
+
+struct TaskList;
+
+/// How a task touches an image. Each one implies a pipeline stage, access mask and layout.
+enum class ImageAccess {
+    COMPUTE_SAMPLED,
+    COMPUTE_STORAGE_READ,
+    COMPUTE_STORAGE_WRITE, ///< Every texel gets overwritten, previous contents don't matter.
+    COMPUTE_STORAGE_READ_WRITE,
+    FRAGMENT_SAMPLED,
+    COLOR_ATTACHMENT,
+    DEPTH_ATTACHMENT,
+    TRANSFER_SRC,
+    TRANSFER_DST, ///< Every texel gets overwritten, previous contents don't matter.
+};
+
+struct ImageUse {
+    RWImage image;
+    ImageAccess access = ImageAccess::COMPUTE_SAMPLED;
+};
+
+struct ScheduleStep {
+    /// Index into `TaskList::tasks`. Nothing for a step that only records barriers, which happens
+    /// when the tasks after them were culled.
+    std::optional<size_t> task;
+
+    /// Index into the list for the task's type, e.g. `TaskList::cs_tasks`.
+    size_t list_index = 0;
+
+    size_t image_barriers_begin = 0;
+    size_t image_barriers_end = 0;
+    size_t buffer_barriers_begin = 0;
+    size_t buffer_barriers_end = 0;
+};
+
+struct RenderGraph {
+    std::vector<ScheduleStep> steps;
+
+    /// All image barriers of the schedule back to back, once per frame in flight since every
+    /// frame has its own images. Steps index into these.
+    std::vector<std::vector<VkImageMemoryBarrier2>> image_barriers;
+    std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+
+    /// Image barriers whose old layout is whatever the previous frame left the image in. The
+    /// first time a frame in flight runs there is no previous frame, so these transition from
+    /// VK_IMAGE_LAYOUT_UNDEFINED instead.
+    std::vector<size_t> previous_frame_barriers;
+    std::vector<bool> has_run;
+
+    /// Transient images that share memory, as indices into `State::transient_images`, in the
+    /// order they're used in.
+    std::vector<std::vector<size_t>> transient_regions;
+
+    size_t culled_tasks = 0;
+};
+
+RenderGraph compile_render_graph( const State& engine, const TaskList& task_list );
+
+/// Records the barriers that go before `step`, if any, as a single `vkCmdPipelineBarrier2`.
+void record_barriers( const RenderGraph& graph, const ScheduleStep& step, size_t frame_index,
+    VkCommandBuffer cmd_buf );
+
+} // namespace racecar::engine
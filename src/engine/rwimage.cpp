@@ -2,6 +2,7 @@
 
 #include "../log.hpp"
 #include "images.hpp"
+#include "transient.hpp"
 
 #include <SDL3/SDL.h>
 
@@ -14,7 +15,7 @@ RWImage allocate_rwimage( vk::Common& vulkan, const engine::State& engine, VkExt
     RWImage rwimage;
 
     try {
-        for ( size_t i = 0; i < engine.swapchain_images.size(); ++i ) {
+        for ( size_t i = 0; i < engine.frame_overlap; ++i ) {
             rwimage.images.push_back( allocate_image( vulkan, extent, format, image_type,
                 mip_levels, 1, samples, usage_flags, mipmapped ) );
         }
@@ -34,13 +35,12 @@ RWImage create_rwimage( vk::Common& vulkan, const engine::State& engine, VkExten
         vulkan, engine, extent, format, image_type, samples, usage_flags, 1, false );
 }
 
-RWImage create_gbuffer_image( vk::Common& vulkan, const engine::State& engine, VkFormat format,
-    VkSampleCountFlagBits samples )
+RWImage create_gbuffer_image(
+    vk::Common& vulkan, engine::State& engine, VkFormat format, VkSampleCountFlagBits samples )
 {
-    return engine::create_rwimage( vulkan, engine,
+    return engine::create_transient_rwimage( vulkan, engine,
         VkExtent3D( engine.swapchain.extent.width, engine.swapchain.extent.height, 1 ), format,
-        VkImageType::VK_IMAGE_TYPE_2D, samples,
-        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT );
+        samples, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT );
 }
 
 RWImage create_rwimage_mips( vk::Common& vulkan, const engine::State& engine, VkExtent3D extent,
@@ -23,7 +23,8 @@ RWImage create_rwimage_mips( vk::Common& vulkan, const engine::State& engine, Vk
     VkFormat format, VkImageType image_type, VkSampleCountFlagBits samples,
     VkImageUsageFlags usage_flags, uint32_t mip_levels );
 
-RWImage create_gbuffer_image( vk::Common& vulkan, const engine::State& engine, VkFormat format,
-    VkSampleCountFlagBits samples );
+/// A screen-sized color attachment that's only alive during the frame, see `transient.hpp`.
+RWImage create_gbuffer_image(
+    vk::Common& vulkan, engine::State& engine, VkFormat format, VkSampleCountFlagBits samples );
 
 } // namespace racecar::engine
@@ -2,6 +2,7 @@
 
 #include "../constants.hpp"
 #include "../log.hpp"
+#include "../parallel.hpp"
 #include "../vk/create.hpp"
 
 #include <algorithm>
@@ -73,57 +74,66 @@ void create_frame_data( State& engine, vk::Common& vulkan )
 {
     size_t num_images = engine.swapchain_images.size();
 
-    engine.frames = std::vector<FrameData>( num_images );
-    engine.swapchain_semaphores = std::vector<SwapchainSemaphores>( num_images );
-    engine.frame_overlap = static_cast<uint32_t>( num_images );
+    engine.frame_overlap = constant::FRAMES_IN_FLIGHT;
     engine.frame_number = 0;
+    engine.frames = std::vector<FrameData>( engine.frame_overlap );
+    engine.swapchain_semaphores = std::vector<SwapchainSemaphores>( num_images );
 
     const VkCommandBufferAllocateInfo cmd_buf_info
         = vk::create::command_buffer_allocate_info( engine.cmd_pool, 1 );
     const VkSemaphoreCreateInfo semaphore_info = vk::create::semaphore_info();
-    const VkFenceCreateInfo fence_info = vk::create::fence_info( VK_FENCE_CREATE_SIGNALED_BIT );
 
     for ( uint32_t i = 0; i < engine.frame_overlap; i++ ) {
         FrameData& frame = engine.frames[i];
-        SwapchainSemaphores& swapchain_semaphores = engine.swapchain_semaphores[i];
-
-        vk::check( vkAllocateCommandBuffers( vulkan.device, &cmd_buf_info, &frame.start_cmdbuf ),
-            "Failed to create start command buffer" );
-        vk::check( vkAllocateCommandBuffers( vulkan.device, &cmd_buf_info, &frame.render_cmdbuf ),
-            "Failed to create render command buffer" );
-        vk::check( vkAllocateCommandBuffers( vulkan.device, &cmd_buf_info, &frame.end_cmdbuf ),
-            "Failed to create end command buffer" );
-
-        vulkan.destructor_stack.push_free_cmd_bufs( vulkan.device, engine.cmd_pool,
-            { frame.start_cmdbuf, frame.render_cmdbuf, frame.end_cmdbuf } );
-
-        vk::check(
-            vkCreateSemaphore( vulkan.device, &semaphore_info, nullptr, &frame.start_render_smp ),
-            "Failed to create start render state semaphore" );
-        vulkan.destructor_stack.push( vulkan.device, frame.start_render_smp, vkDestroySemaphore );
-
-        vk::check(
-            vkCreateSemaphore( vulkan.device, &semaphore_info, nullptr, &frame.render_end_smp ),
-            "Failed to create end render state semaphore" );
-        vulkan.destructor_stack.push( vulkan.device, frame.render_end_smp, vkDestroySemaphore );
-
-        vk::check(
-            vkCreateSemaphore( vulkan.device, &semaphore_info, nullptr, &frame.acquire_start_smp ),
-            "Failed to create acquire start state semaphore" );
-        vulkan.destructor_stack.push( vulkan.device, frame.acquire_start_smp, vkDestroySemaphore );
-
-        vk::check( vkCreateSemaphore( vulkan.device, &semaphore_info, nullptr,
-                       &swapchain_semaphores.end_present_smp ),
-            "Failed to create end present state semaphore" );
+
+        vk::check( vkAllocateCommandBuffers( vulkan.device, &cmd_buf_info, &frame.cmdbuf ),
+            "Failed to create frame command buffer" );
+        vulkan.destructor_stack.push_free_cmd_bufs(
+            vulkan.device, engine.cmd_pool, { frame.cmdbuf } );
+
+        vk::check( vkCreateSemaphore( vulkan.device, &semaphore_info, nullptr, &frame.acquire_smp ),
+            "Failed to create acquire semaphore" );
+        vulkan.destructor_stack.push( vulkan.device, frame.acquire_smp, vkDestroySemaphore );
+
+        // Reset all at once every frame, so no per-buffer reset bit
+        frame.worker_commands = std::vector<WorkerCommands>( engine.workers->size() );
+
+        for ( WorkerCommands& worker_commands : frame.worker_commands ) {
+            VkCommandPoolCreateInfo worker_cmd_pool_info = vk::create::command_pool_info(
+                vulkan.graphics_queue_family, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT );
+
+            vk::check( vkCreateCommandPool( vulkan.device, &worker_cmd_pool_info, nullptr,
+                           &worker_commands.cmd_pool ),
+                "Failed to create worker command pool" );
+            vulkan.destructor_stack.push(
+                vulkan.device, worker_commands.cmd_pool, vkDestroyCommandPool );
+        }
+    }
+
+    for ( SwapchainSemaphores& swapchain_semaphores : engine.swapchain_semaphores ) {
+        vk::check( vkCreateSemaphore(
+                       vulkan.device, &semaphore_info, nullptr, &swapchain_semaphores.present_smp ),
+            "Failed to create present semaphore" );
         vulkan.destructor_stack.push(
-            vulkan.device, swapchain_semaphores.end_present_smp, vkDestroySemaphore );
+            vulkan.device, swapchain_semaphores.present_smp, vkDestroySemaphore );
+    }
+
+    {
+        VkSemaphoreTypeCreateInfo timeline_type_info
+            = vk::create::timeline_semaphore_type_info( 0 );
+        VkSemaphoreCreateInfo timeline_info = vk::create::semaphore_info();
+        timeline_info.pNext = &timeline_type_info;
+
+        vk::check( vkCreateSemaphore( vulkan.device, &timeline_info, nullptr, &engine.timeline ),
+            "Failed to create frame timeline semaphore" );
+        vulkan.destructor_stack.push( vulkan.device, engine.timeline, vkDestroySemaphore );
 
-        vk::check( vkCreateFence( vulkan.device, &fence_info, nullptr, &frame.render_fence ),
-            "Failed to create render fence" );
-        vulkan.destructor_stack.push( vulkan.device, frame.render_fence, vkDestroyFence );
+        engine.timeline_value = 0;
     }
 
-    log::info( "[engine] Created all frame data" );
+    log::info( "[engine] Created frame data for {} frames in flight ({} swapchain images, {} "
+               "recording threads)",
+        engine.frame_overlap, num_images, engine.workers->size() );
 }
 
 /// Generalized depth buffer creation per frame; for more robust depth textures, we may need a more
@@ -178,6 +188,15 @@ size_t State::get_frame_index() const
     return static_cast<size_t>( frame_number % frame_overlap );
 }
 
+DrawStats& DrawStats::operator+=( const DrawStats& other )
+{
+    draws += other.draws;
+    binds += other.binds;
+    skipped_binds += other.skipped_binds;
+
+    return *this;
+}
+
 State initialize( Context& ctx )
 {
     vk::Common& vulkan = ctx.vulkan;
@@ -220,6 +239,7 @@ State initialize( Context& ctx )
             vulkan.destructor_stack.push( vulkan.device, engine.cmd_pool, vkDestroyCommandPool );
         }
 
+        engine.workers = std::make_unique<parallel::WorkerPool>();
         create_frame_data( engine, vulkan );
         create_depth_images( engine, vulkan );
 
@@ -250,6 +270,7 @@ State initialize( Context& ctx )
 
 void free( State& engine )
 {
+    engine.workers.reset();
     engine.swapchain.destroy_image_views( engine.swapchain_image_views );
     vkb::destroy_swapchain( engine.swapchain );
 }
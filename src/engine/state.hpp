@@ -2,28 +2,69 @@
 
 #include "../context.hpp"
 #include "../orbit_camera.hpp"
+#include "../parallel.hpp"
 #include "../vk/mem.hpp"
 #include "descriptors.hpp"
 #include "imm_submit.hpp"
 
 #include <SDL3/SDL.h>
 
+#include <memory>
+#include <optional>
+
 namespace racecar::engine {
 
+/// Secondary command buffers one recording thread uses for one frame in flight. A command pool
+/// can't be used by two threads at once, so every worker gets a pool of its own.
+struct WorkerCommands {
+    VkCommandPool cmd_pool = VK_NULL_HANDLE;
+
+    /// Allocated as needed and kept around. The first `num_used` have been recorded this frame.
+    std::vector<VkCommandBuffer> cmdbufs;
+    size_t num_used = 0;
+};
+
 struct FrameData {
-    VkFence render_fence = VK_NULL_HANDLE;
+    /// Everything the frame does goes into this one command buffer and a single submission.
+    VkCommandBuffer cmdbuf = VK_NULL_HANDLE;
 
-    VkCommandBuffer start_cmdbuf = VK_NULL_HANDLE;
-    VkCommandBuffer render_cmdbuf = VK_NULL_HANDLE;
-    VkCommandBuffer end_cmdbuf = VK_NULL_HANDLE;
+    /// One per `State::workers` worker, for draws recorded off the main thread, which
+    /// `cmdbuf` then executes.
+    std::vector<WorkerCommands> worker_commands;
 
-    VkSemaphore acquire_start_smp = VK_NULL_HANDLE;
-    VkSemaphore start_render_smp = VK_NULL_HANDLE;
-    VkSemaphore render_end_smp = VK_NULL_HANDLE;
+    VkSemaphore acquire_smp = VK_NULL_HANDLE;
+
+    /// Value `State::timeline` reaches once the GPU is done with this frame. 0 if the frame
+    /// hasn't been submitted yet.
+    uint64_t timeline_value = 0;
 };
 
+/// Present has to wait on a semaphore that's tied to the swapchain image rather than the frame, as
+/// the image is only guaranteed to be done with it once it's acquired again. Presentation can't
+/// wait on timeline semaphores, so this stays a binary one.
 struct SwapchainSemaphores {
-    VkSemaphore end_present_smp = VK_NULL_HANDLE;
+    VkSemaphore present_smp = VK_NULL_HANDLE;
+};
+
+/// An image from `create_transient_rwimage`. Its contents only matter within a frame, so it has no
+/// memory of its own: once the render graph knows when every transient image is used, the ones
+/// that are never alive at the same time get bound to the same memory (`bind_transient_images`).
+struct TransientImage {
+    vk::mem::AllocatedImage image;
+    VkMemoryRequirements requirements = {};
+
+    /// Transient images in the same region share memory. Set once bound.
+    std::optional<size_t> region;
+};
+
+/// How many binds `draw` recorded in a frame, and how many it left out because the command
+/// buffer had that state bound already. Every descriptor set counts as a bind of its own.
+struct DrawStats {
+    size_t draws = 0;
+    size_t binds = 0;
+    size_t skipped_binds = 0;
+
+    DrawStats& operator+=( const DrawStats& other );
 };
 
 /// Global engine state.
@@ -35,10 +76,24 @@ struct State {
 
     camera::OrbitCamera camera;
 
-    uint32_t frame_overlap = 1;
+    uint32_t frame_overlap = 1; ///< Frames in flight, see `constant::FRAMES_IN_FLIGHT`.
     uint32_t frame_number = 1;
     uint32_t rendered_frames = 0;
 
+    /// Time spent in `begin_frame` waiting for the GPU to give the frame's resources back.
+    /// Expressed in seconds.
+    double gpu_wait = 0.f;
+
+    DrawStats draw_stats; ///< Of the last frame `execute` recorded.
+
+    /// Whether `execute` spreads the draws of graphics tasks over worker threads. Tasks with only
+    /// a few draws are recorded on the main thread regardless.
+    bool parallel_recording = true;
+
+    /// Threads `execute` records secondary command buffers on. Created once up front, since
+    /// spawning them per frame would eat most of what recording in parallel saves.
+    std::unique_ptr<parallel::WorkerPool> workers;
+
     ImmediateSubmit immediate_submit = {};
 
     VkCommandPool cmd_pool = VK_NULL_HANDLE;
@@ -46,12 +101,15 @@ struct State {
     std::vector<FrameData> frames;
     std::vector<SwapchainSemaphores> swapchain_semaphores;
 
+    /// Timeline semaphore signaled once per submitted frame, with the value the frame was given.
+    VkSemaphore timeline = VK_NULL_HANDLE;
+    uint64_t timeline_value = 0; ///< Last value handed out, i.e. the most recently submitted frame.
+
     DescriptorSystem descriptor_system = {};
 
-    size_t get_frame_index() const;
+    std::vector<TransientImage> transient_images;
 
-    std::vector<vk::rt::AccelerationStructure> blas;
-    vk::rt::AccelerationStructure tlas;
+    size_t get_frame_index() const;
 
     double time = 0.f; ///< Expressed in seconds.
     double delta = 0.f; ///< Expressed in seconds.
@@ -12,6 +12,7 @@ void add_gfx_task( TaskList& task_list, GfxTask task )
 
     task_list.tasks.push_back( new_task );
     task_list.gfx_tasks.push_back( task );
+    task_list.graph.reset();
 }
 
 void add_cs_task( TaskList& task_list, ComputeTask task )
@@ -23,6 +24,7 @@ void add_cs_task( TaskList& task_list, ComputeTask task )
 
     task_list.tasks.push_back( new_task );
     task_list.cs_tasks.push_back( task );
+    task_list.graph.reset();
 }
 
 void add_blit_task( TaskList& task_list, BlitTask task )
@@ -33,12 +35,14 @@ void add_blit_task( TaskList& task_list, BlitTask task )
 
     task_list.tasks.push_back( new_task );
     task_list.blit_tasks.push_back( task );
+    task_list.graph.reset();
 }
 
 void add_pipeline_barrier( TaskList& task_list, PipelineBarrierDescriptor barrier )
 {
     task_list.pipeline_barriers.push_back(
         std::pair( static_cast<int>( task_list.tasks.size() ), barrier ) );
+    task_list.graph.reset();
 }
 
 void add_cpu_task( TaskList& task_list, std::function<void()> task )
@@ -49,6 +53,24 @@ void add_cpu_task( TaskList& task_list, std::function<void()> task )
 
     task_list.tasks.push_back( new_task );
     task_list.cpu_tasks.push_back( { task } );
+    task_list.graph.reset();
+}
+
+void add_record_task( TaskList& task_list, std::function<void( VkCommandBuffer cmd_buf )> record )
+{
+    Task new_task;
+    new_task.index = static_cast<int>( task_list.tasks.size() );
+    new_task.type = Task::RECORD;
+
+    task_list.tasks.push_back( new_task );
+    task_list.record_tasks.push_back( { record } );
+    task_list.graph.reset();
+}
+
+void keep_image( TaskList& task_list, const RWImage& image )
+{
+    task_list.kept_images.push_back( image );
+    task_list.graph.reset();
 }
 
 /// TODO: Modify this to only add to the pipeline barrier descriptor, since we can run a batch
@@ -4,7 +4,9 @@
 #include "compute_task.hpp"
 #include "gfx_task.hpp"
 #include "pipeline_barrier.hpp"
+#include "render_graph.hpp"
 
+#include <optional>
 #include <vector>
 
 namespace racecar::engine {
@@ -12,7 +14,7 @@ namespace racecar::engine {
 /// To be space-efficient, a `Task` only stores the type (graphics, compute, blit)
 /// and then an index into the corresponding list which is owned by `TaskList`.
 struct Task {
-    enum class Type { GFX, COMP, BLIT, CPU_CALL } type = Type::GFX;
+    enum class Type { GFX, COMP, BLIT, CPU_CALL, RECORD } type = Type::GFX;
 
     int index = -1;
 
@@ -27,6 +29,13 @@ struct CPUTask {
     std::function<void()> task;
 };
 
+/// Records whatever commands it likes into the frame's command buffer, for work that isn't a draw,
+/// dispatch or blit, like acceleration structure builds. Touches no images as far as the render
+/// graph knows, so it has to place its own buffer barriers and is never culled.
+struct RecordTask {
+    std::function<void( VkCommandBuffer cmd_buf )> record;
+};
+
 struct TaskList {
     std::vector<Task> tasks;
 
@@ -34,9 +43,16 @@ struct TaskList {
     std::vector<ComputeTask> cs_tasks;
     std::vector<BlitTask> blit_tasks;
     std::vector<CPUTask> cpu_tasks;
+    std::vector<RecordTask> record_tasks;
 
     std::vector<std::pair<int, PipelineBarrierDescriptor>> pipeline_barriers;
 
+    /// Images whose contents are read again next frame, so the tasks writing them are never culled.
+    std::vector<RWImage> kept_images;
+
+    /// Compiled on the first `execute()` and thrown away whenever something is added.
+    std::optional<RenderGraph> graph;
+
     // Very dangerous. DON'T CHECK IN this code!
     std::vector<std::function<void( State&, Context&, FrameData& )>> junk_tasks;
 };
@@ -46,6 +62,8 @@ void add_cs_task( TaskList& task_list, ComputeTask task );
 void add_blit_task( TaskList& task_list, BlitTask task );
 void add_pipeline_barrier( TaskList& task_list, PipelineBarrierDescriptor barrier );
 void add_cpu_task( TaskList& task_list, std::function<void()> task );
+void add_record_task( TaskList& task_list, std::function<void( VkCommandBuffer cmd_buf )> record );
+void keep_image( TaskList& task_list, const RWImage& image );
 
 void transition_cs_read_to_write( engine::TaskList& task_list, engine::RWImage& image );
 void transition_cs_write_to_read( engine::TaskList& task_list, engine::RWImage& image );
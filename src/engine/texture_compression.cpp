@@ -0,0 +1,821 @@
+#include "texture_compression.hpp"
+
+#include "../exception.hpp"
+#include "../parallel.hpp"
+
+#include <glm/gtc/packing.hpp>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+
+namespace racecar::engine {
+
+namespace {
+
+/// How texels are laid out in one of the uncompressed formats handled here.
+struct TexelLayout {
+    size_t num_channels = 0;
+    size_t channel_size = 1;
+    bool is_float = false;
+    bool is_srgb = false;
+};
+
+std::optional<TexelLayout> texel_layout( VkFormat format )
+{
+    switch ( format ) {
+    case VK_FORMAT_R8_UNORM:
+        return TexelLayout { .num_channels = 1 };
+    case VK_FORMAT_R8G8_UNORM:
+        return TexelLayout { .num_channels = 2 };
+    case VK_FORMAT_R8G8B8_UNORM:
+        return TexelLayout { .num_channels = 3 };
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        return TexelLayout { .num_channels = 4 };
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return TexelLayout { .num_channels = 4, .is_srgb = true };
+    case VK_FORMAT_R16G16B16A16_UNORM:
+        return TexelLayout { .num_channels = 4, .channel_size = 2 };
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return TexelLayout { .num_channels = 4, .channel_size = 4, .is_float = true };
+    default:
+        return std::nullopt;
+    }
+}
+
+/// UNORM channels come back normalized, float ones as they are.
+float read_channel( const TexelLayout& layout, const unsigned char* level, size_t index )
+{
+    switch ( layout.channel_size ) {
+    case 1:
+        return static_cast<float>( level[index] ) / 255.f;
+    case 2: {
+        uint16_t value = 0;
+        std::memcpy( &value, level + index * 2, sizeof( value ) );
+        return static_cast<float>( value ) / 65535.f;
+    }
+    default: {
+        float value = 0.f;
+        std::memcpy( &value, level + index * 4, sizeof( value ) );
+        return value;
+    }
+    }
+}
+
+void write_channel( const TexelLayout& layout, unsigned char* level, size_t index, float value )
+{
+    switch ( layout.channel_size ) {
+    case 1:
+        level[index]
+            = static_cast<unsigned char>( std::round( std::clamp( value, 0.f, 1.f ) * 255.f ) );
+        break;
+    case 2: {
+        uint16_t scaled
+            = static_cast<uint16_t>( std::round( std::clamp( value, 0.f, 1.f ) * 65535.f ) );
+        std::memcpy( level + index * 2, &scaled, sizeof( scaled ) );
+        break;
+    }
+    default:
+        std::memcpy( level + index * 4, &value, sizeof( value ) );
+        break;
+    }
+}
+
+float srgb_to_linear( float value )
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow( ( value + 0.055f ) / 1.055f, 2.4f );
+}
+
+float linear_to_srgb( float value )
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow( value, 1.f / 2.4f ) - 0.055f;
+}
+
+size_t block_bytes( VkFormat format )
+{
+    switch ( format ) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        return 8;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+using Color = std::array<float, 4>;
+
+/// 4x4 texels, row by row.
+using Block = std::array<Color, 16>;
+
+/// Interpolation weights (out of 64) for 4 bit indices, shared by BC6H and BC7.
+constexpr std::array<uint32_t, 16> WEIGHTS_4
+    = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+/// Writes fields LSB first, which is how every BC format packs its bits. `out` has to be zeroed.
+struct BitWriter {
+    unsigned char* out = nullptr;
+    size_t position = 0;
+
+    void write( uint32_t value, size_t num_bits )
+    {
+        for ( size_t i = 0; i < num_bits; i++, position++ ) {
+            if ( ( value >> i ) & 1 ) {
+                out[position / 8] |= static_cast<unsigned char>( 1u << ( position % 8 ) );
+            }
+        }
+    }
+};
+
+/// Reads the 4x4 block at (`block_x`, `block_y`), clamping to the edges of the level. Channels
+/// are multiplied by `scale`, missing ones read as 0 and missing alpha as `scale`.
+Block fetch_block( const TexelLayout& layout, const unsigned char* level, uint32_t width,
+    uint32_t height, uint32_t block_x, uint32_t block_y, float scale )
+{
+    Block block;
+
+    for ( uint32_t i = 0; i < 16; i++ ) {
+        size_t x = std::min( block_x * 4 + i % 4, width - 1 );
+        size_t y = std::min( block_y * 4 + i / 4, height - 1 );
+        size_t texel = y * width + x;
+
+        for ( size_t channel = 0; channel < 4; channel++ ) {
+            if ( channel < layout.num_channels ) {
+                block[i][channel]
+                    = read_channel( layout, level, texel * layout.num_channels + channel ) * scale;
+            } else {
+                block[i][channel] = channel == 3 ? scale : 0.f;
+            }
+        }
+    }
+
+    return block;
+}
+
+float distance_sq( const Color& a, const Color& b, size_t num_channels )
+{
+    float distance = 0.f;
+    for ( size_t channel = 0; channel < num_channels; channel++ ) {
+        float delta = a[channel] - b[channel];
+        distance += delta * delta;
+    }
+
+    return distance;
+}
+
+/// Index of the closest palette entry to `texel`, its squared distance goes to `out_error`.
+template <size_t N>
+uint32_t nearest_index( const std::array<Color, N>& palette, const Color& texel,
+    size_t num_channels, float& out_error )
+{
+    uint32_t best_index = 0;
+    out_error = std::numeric_limits<float>::max();
+
+    for ( uint32_t i = 0; i < N; i++ ) {
+        float error = distance_sq( palette[i], texel, num_channels );
+        if ( error < out_error ) {
+            out_error = error;
+            best_index = i;
+        }
+    }
+
+    return best_index;
+}
+
+/// Fits a line through the first `num_channels` channels of the block along their principal axis
+/// and returns the two ends that just cover every texel.
+void fit_endpoints( const Block& block, size_t num_channels, Color& out_low, Color& out_high )
+{
+    Color mean = {};
+    Color min = block[0];
+    Color max = block[0];
+
+    for ( const Color& texel : block ) {
+        for ( size_t channel = 0; channel < num_channels; channel++ ) {
+            mean[channel] += texel[channel] / 16.f;
+            min[channel] = std::min( min[channel], texel[channel] );
+            max[channel] = std::max( max[channel], texel[channel] );
+        }
+    }
+
+    std::array<Color, 4> covariance = {};
+    for ( const Color& texel : block ) {
+        for ( size_t a = 0; a < num_channels; a++ ) {
+            for ( size_t b = 0; b < num_channels; b++ ) {
+                covariance[a][b] += ( texel[a] - mean[a] ) * ( texel[b] - mean[b] );
+            }
+        }
+    }
+
+    // A few rounds of power iteration, starting from the bounding box diagonal.
+    Color axis = {};
+    for ( size_t channel = 0; channel < num_channels; channel++ ) {
+        axis[channel] = max[channel] - min[channel];
+    }
+
+    for ( int iteration = 0; iteration < 8; iteration++ ) {
+        Color next = {};
+        float largest = 0.f;
+
+        for ( size_t a = 0; a < num_channels; a++ ) {
+            for ( size_t b = 0; b < num_channels; b++ ) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+
+            largest = std::max( largest, std::abs( next[a] ) );
+        }
+
+        if ( largest <= 0.f ) {
+            break;
+        }
+
+        for ( size_t channel = 0; channel < num_channels; channel++ ) {
+            axis[channel] = next[channel] / largest;
+        }
+    }
+
+    out_low = mean;
+    out_high = mean;
+
+    float length_sq = 0.f;
+    for ( size_t channel = 0; channel < num_channels; channel++ ) {
+        length_sq += axis[channel] * axis[channel];
+    }
+
+    if ( length_sq <= 0.f ) {
+        return;
+    }
+
+    float t_min = std::numeric_limits<float>::max();
+    float t_max = std::numeric_limits<float>::lowest();
+
+    for ( const Color& texel : block ) {
+        float t = 0.f;
+        for ( size_t channel = 0; channel < num_channels; channel++ ) {
+            t += ( texel[channel] - mean[channel] ) * axis[channel];
+        }
+
+        t_min = std::min( t_min, t / length_sq );
+        t_max = std::max( t_max, t / length_sq );
+    }
+
+    for ( size_t channel = 0; channel < num_channels; channel++ ) {
+        out_low[channel] = mean[channel] + axis[channel] * t_min;
+        out_high[channel] = mean[channel] + axis[channel] * t_max;
+    }
+}
+
+/// Least squares fit of the endpoints for fixed indices, `weights[index]` being how far (out of
+/// 64) each index sits between them. Returns false if every texel got the same weight.
+bool refine_endpoints( const Block& block, const std::array<uint32_t, 16>& indices,
+    const std::array<uint32_t, 16>& weights, size_t num_channels, Color& out_low,
+    Color& out_high )
+{
+    float aa = 0.f, ab = 0.f, bb = 0.f;
+    Color ax = {};
+    Color bx = {};
+
+    for ( size_t i = 0; i < 16; i++ ) {
+        float b = static_cast<float>( weights[indices[i]] ) / 64.f;
+        float a = 1.f - b;
+
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+
+        for ( size_t channel = 0; channel < num_channels; channel++ ) {
+            ax[channel] += a * block[i][channel];
+            bx[channel] += b * block[i][channel];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if ( std::abs( determinant ) < 1e-6f ) {
+        return false;
+    }
+
+    for ( size_t channel = 0; channel < num_channels; channel++ ) {
+        out_low[channel] = ( ax[channel] * bb - bx[channel] * ab ) / determinant;
+        out_high[channel] = ( aa * bx[channel] - ab * ax[channel] ) / determinant;
+    }
+
+    return true;
+}
+
+uint16_t to_rgb565( const Color& color )
+{
+    auto quantize = []( float value, float max ) {
+        return static_cast<uint32_t>( std::round( std::clamp( value, 0.f, 255.f ) * max / 255.f ) );
+    };
+
+    return static_cast<uint16_t>(
+        quantize( color[0], 31.f ) << 11 | quantize( color[1], 63.f ) << 5
+        | quantize( color[2], 31.f ) );
+}
+
+Color from_rgb565( uint16_t value )
+{
+    uint32_t r = ( value >> 11 ) & 31;
+    uint32_t g = ( value >> 5 ) & 63;
+    uint32_t b = value & 31;
+
+    return { static_cast<float>( r << 3 | r >> 2 ), static_cast<float>( g << 2 | g >> 4 ),
+        static_cast<float>( b << 3 | b >> 2 ), 255.f };
+}
+
+/// BC1 in four color mode, alpha is dropped.
+void encode_bc1( const Block& block, unsigned char* out )
+{
+    Color low, high;
+    fit_endpoints( block, 3, low, high );
+
+    uint16_t color0 = to_rgb565( high );
+    uint16_t color1 = to_rgb565( low );
+    if ( color0 < color1 ) {
+        std::swap( color0, color1 );
+    }
+
+    BitWriter writer = { .out = out };
+    writer.write( color0, 16 );
+    writer.write( color1, 16 );
+
+    // color0 > color1 picks the four color mode. When they're equal, index 0 is all we need.
+    if ( color0 == color1 ) {
+        return;
+    }
+
+    std::array<Color, 4> palette = { from_rgb565( color0 ), from_rgb565( color1 ) };
+    for ( size_t channel = 0; channel < 3; channel++ ) {
+        palette[2][channel] = ( 2.f * palette[0][channel] + palette[1][channel] ) / 3.f;
+        palette[3][channel] = ( palette[0][channel] + 2.f * palette[1][channel] ) / 3.f;
+    }
+
+    for ( const Color& texel : block ) {
+        float error = 0.f;
+        writer.write( nearest_index( palette, texel, 3, error ), 2 );
+    }
+}
+
+/// BC4 in eight value mode, encoding `channel` of the block. BC5 is just two of these.
+void encode_bc4( const Block& block, size_t channel, unsigned char* out )
+{
+    float low = 255.f;
+    float high = 0.f;
+
+    for ( const Color& texel : block ) {
+        low = std::min( low, std::clamp( texel[channel], 0.f, 255.f ) );
+        high = std::max( high, std::clamp( texel[channel], 0.f, 255.f ) );
+    }
+
+    uint32_t value0 = static_cast<uint32_t>( std::round( high ) );
+    uint32_t value1 = static_cast<uint32_t>( std::round( low ) );
+
+    BitWriter writer = { .out = out };
+    writer.write( value0, 8 );
+    writer.write( value1, 8 );
+
+    if ( value0 == value1 ) {
+        return;
+    }
+
+    std::array<Color, 8> palette = {};
+    palette[0][0] = static_cast<float>( value0 );
+    palette[1][0] = static_cast<float>( value1 );
+    for ( size_t i = 1; i < 7; i++ ) {
+        palette[i + 1][0] = ( static_cast<float>( 7 - i ) * palette[0][0]
+                                + static_cast<float>( i ) * palette[1][0] )
+            / 7.f;
+    }
+
+    for ( const Color& texel : block ) {
+        float error = 0.f;
+        writer.write( nearest_index( palette, { texel[channel] }, 1, error ), 3 );
+    }
+}
+
+struct Bc7Mode6 {
+    std::array<std::array<uint32_t, 4>, 2> endpoints = {}; ///< 7 bits per channel.
+    std::array<uint32_t, 2> p_bits = {};
+    std::array<uint32_t, 16> indices = {};
+    float error = std::numeric_limits<float>::max();
+};
+
+/// Quantizes the endpoints for BC7 mode 6 (RGBA 7.7.7.7 + p-bit, 4 bit indices), trying every
+/// p-bit combination and keeping whichever reproduces the block best.
+Bc7Mode6 quantize_bc7_mode6( const Block& block, const Color& low, const Color& high )
+{
+    Bc7Mode6 best;
+
+    for ( uint32_t p_bits = 0; p_bits < 4; p_bits++ ) {
+        Bc7Mode6 candidate = { .p_bits = { p_bits & 1, p_bits >> 1 } };
+        std::array<std::array<uint32_t, 4>, 2> expanded;
+
+        for ( size_t e = 0; e < 2; e++ ) {
+            const Color& endpoint = e == 0 ? low : high;
+            float p_bit = static_cast<float>( candidate.p_bits[e] );
+
+            for ( size_t channel = 0; channel < 4; channel++ ) {
+                float value = std::clamp( endpoint[channel], 0.f, 255.f );
+                uint32_t quantized = static_cast<uint32_t>(
+                    std::clamp( std::round( ( value - p_bit ) / 2.f ), 0.f, 127.f ) );
+
+                candidate.endpoints[e][channel] = quantized;
+                expanded[e][channel] = quantized << 1 | candidate.p_bits[e];
+            }
+        }
+
+        std::array<Color, 16> palette;
+        for ( size_t i = 0; i < 16; i++ ) {
+            for ( size_t channel = 0; channel < 4; channel++ ) {
+                uint32_t weight = WEIGHTS_4[i];
+                palette[i][channel] = static_cast<float>(
+                    ( ( 64 - weight ) * expanded[0][channel] + weight * expanded[1][channel] + 32 )
+                    >> 6 );
+            }
+        }
+
+        candidate.error = 0.f;
+        for ( size_t i = 0; i < 16; i++ ) {
+            float error = 0.f;
+            candidate.indices[i] = nearest_index( palette, block[i], 4, error );
+            candidate.error += error;
+        }
+
+        if ( candidate.error < best.error ) {
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+/// BC7, always in mode 6. A single subset with 4 bit indices and alpha in the same line as color,
+/// which is the best of the modes for smooth albedo/roughness/normal data and by far the
+/// cheapest one to search.
+void encode_bc7( const Block& block, unsigned char* out )
+{
+    Color low, high;
+    fit_endpoints( block, 4, low, high );
+    Bc7Mode6 best = quantize_bc7_mode6( block, low, high );
+
+    // One round of least squares now that the indices are known usually shaves off a bit more.
+    if ( refine_endpoints( block, best.indices, WEIGHTS_4, 4, low, high ) ) {
+        Bc7Mode6 refined = quantize_bc7_mode6( block, low, high );
+        if ( refined.error < best.error ) {
+            best = refined;
+        }
+    }
+
+    // The first index is stored with its top bit implied to be 0.
+    if ( best.indices[0] >= 8 ) {
+        std::swap( best.endpoints[0], best.endpoints[1] );
+        std::swap( best.p_bits[0], best.p_bits[1] );
+        for ( uint32_t& index : best.indices ) {
+            index = 15 - index;
+        }
+    }
+
+    BitWriter writer = { .out = out };
+    writer.write( 1u << 6, 7 );
+
+    for ( size_t channel = 0; channel < 4; channel++ ) {
+        writer.write( best.endpoints[0][channel], 7 );
+        writer.write( best.endpoints[1][channel], 7 );
+    }
+
+    writer.write( best.p_bits[0], 1 );
+    writer.write( best.p_bits[1], 1 );
+
+    for ( size_t i = 0; i < 16; i++ ) {
+        writer.write( best.indices[i], i == 0 ? 3 : 4 );
+    }
+}
+
+/// Undoes the 10 bit endpoint quantization of BC6H the way the hardware does, so that errors are
+/// measured against what actually gets sampled.
+uint32_t unquantize_bc6h( uint32_t value )
+{
+    if ( value == 0 ) {
+        return 0;
+    }
+
+    if ( value == 1023 ) {
+        return 0xFFFF;
+    }
+
+    return ( ( value << 16 ) + 0x8000 ) >> 10;
+}
+
+uint32_t finish_bc6h( uint32_t value ) { return ( value * 31 ) >> 6; }
+
+uint32_t quantize_bc6h( float half_bits )
+{
+    // finish( unquantize( q ) ) is close to 31 q + 15.5, just check the neighbours as well.
+    int32_t guess = static_cast<int32_t>( std::round( ( half_bits - 15.5f ) / 31.f ) );
+    uint32_t best = 0;
+    float best_error = std::numeric_limits<float>::max();
+
+    for ( int32_t candidate = guess - 1; candidate <= guess + 1; candidate++ ) {
+        uint32_t quantized = static_cast<uint32_t>( std::clamp( candidate, 0, 1023 ) );
+        float error = std::abs(
+            static_cast<float>( finish_bc6h( unquantize_bc6h( quantized ) ) ) - half_bits );
+
+        if ( error < best_error ) {
+            best = quantized;
+            best_error = error;
+        }
+    }
+
+    return best;
+}
+
+/// BC6H (unsigned), always in mode 11: one region with plain 10 bit endpoints and 4 bit indices.
+void encode_bc6h( const Block& block, unsigned char* out )
+{
+    // Work on the bit patterns of the halves. For positive values they're monotonic and roughly
+    // logarithmic, and they're what the hardware interpolates.
+    Block halves = {};
+    for ( size_t i = 0; i < 16; i++ ) {
+        for ( size_t channel = 0; channel < 3; channel++ ) {
+            float value = block[i][channel];
+            value = std::isnan( value ) ? 0.f : std::clamp( value, 0.f, 65504.f );
+            halves[i][channel] = static_cast<float>( glm::packHalf1x16( value ) );
+        }
+    }
+
+    Color low, high;
+    fit_endpoints( halves, 3, low, high );
+
+    std::array<std::array<uint32_t, 3>, 2> endpoints;
+    for ( size_t channel = 0; channel < 3; channel++ ) {
+        endpoints[0][channel] = quantize_bc6h( low[channel] );
+        endpoints[1][channel] = quantize_bc6h( high[channel] );
+    }
+
+    std::array<Color, 16> palette = {};
+    for ( size_t i = 0; i < 16; i++ ) {
+        for ( size_t channel = 0; channel < 3; channel++ ) {
+            uint32_t weight = WEIGHTS_4[i];
+            uint32_t value = ( ( 64 - weight ) * unquantize_bc6h( endpoints[0][channel] )
+                                 + weight * unquantize_bc6h( endpoints[1][channel] ) + 32 )
+                >> 6;
+            palette[i][channel] = static_cast<float>( finish_bc6h( value ) );
+        }
+    }
+
+    std::array<uint32_t, 16> indices;
+    for ( size_t i = 0; i < 16; i++ ) {
+        float error = 0.f;
+        indices[i] = nearest_index( palette, halves[i], 3, error );
+    }
+
+    // Same as BC7, the first index has its top bit implied to be 0.
+    if ( indices[0] >= 8 ) {
+        std::swap( endpoints[0], endpoints[1] );
+        for ( uint32_t& index : indices ) {
+            index = 15 - index;
+        }
+    }
+
+    BitWriter writer = { .out = out };
+    writer.write( 0x03, 5 );
+
+    for ( size_t e = 0; e < 2; e++ ) {
+        for ( size_t channel = 0; channel < 3; channel++ ) {
+            writer.write( endpoints[e][channel], 10 );
+        }
+    }
+
+    for ( size_t i = 0; i < 16; i++ ) {
+        writer.write( indices[i], i == 0 ? 3 : 4 );
+    }
+}
+
+}
+
+uint32_t generate_mip_chain(
+    std::vector<unsigned char>& pixels, uint32_t width, uint32_t height, VkFormat format )
+{
+    std::optional<TexelLayout> layout = texel_layout( format );
+    if ( !layout ) {
+        return 1;
+    }
+
+    size_t num_channels = layout->num_channels;
+
+    auto read = [&]( const unsigned char* level, size_t texel, size_t channel ) {
+        float value = read_channel( *layout, level, texel * num_channels + channel );
+        return layout->is_srgb && channel < 3 ? srgb_to_linear( value ) : value;
+    };
+
+    auto write = [&]( unsigned char* level, size_t texel, size_t channel, float value ) {
+        if ( layout->is_srgb && channel < 3 ) {
+            value = linear_to_srgb( value );
+        }
+
+        write_channel( *layout, level, texel * num_channels + channel, value );
+    };
+
+    uint32_t mip_levels
+        = static_cast<uint32_t>( std::floor( std::log2( std::max( width, height ) ) ) ) + 1;
+    size_t texel_size = num_channels * layout->channel_size;
+    size_t level_offset = 0;
+
+    for ( uint32_t mip = 1; mip < mip_levels; mip++ ) {
+        uint32_t next_width = std::max( width / 2, 1u );
+        uint32_t next_height = std::max( height / 2, 1u );
+        std::vector<unsigned char> next_level(
+            static_cast<size_t>( next_width ) * next_height * texel_size );
+
+        const unsigned char* level = pixels.data() + level_offset;
+
+        for ( uint32_t y = 0; y < next_height; y++ ) {
+            for ( uint32_t x = 0; x < next_width; x++ ) {
+                // Clamp for odd sizes, the last row/column just gets counted twice.
+                size_t x0 = std::min( x * 2, width - 1 );
+                size_t x1 = std::min( x * 2 + 1, width - 1 );
+                size_t y0 = std::min( y * 2, height - 1 );
+                size_t y1 = std::min( y * 2 + 1, height - 1 );
+
+                for ( size_t channel = 0; channel < num_channels; channel++ ) {
+                    float sum = read( level, y0 * width + x0, channel )
+                        + read( level, y0 * width + x1, channel )
+                        + read( level, y1 * width + x0, channel )
+                        + read( level, y1 * width + x1, channel );
+
+                    write( next_level.data(), static_cast<size_t>( y ) * next_width + x, channel,
+                        sum * 0.25f );
+                }
+            }
+        }
+
+        level_offset = pixels.size();
+        pixels.insert( pixels.end(), next_level.begin(), next_level.end() );
+        width = next_width;
+        height = next_height;
+    }
+
+    return mip_levels;
+}
+
+VkFormat compressed_format_for( VkFormat format )
+{
+    switch ( format ) {
+    case VK_FORMAT_R8_UNORM:
+        return VK_FORMAT_BC4_UNORM_BLOCK;
+    case VK_FORMAT_R8G8_UNORM:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case VK_FORMAT_R8G8B8_UNORM:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        return VK_FORMAT_BC7_UNORM_BLOCK;
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return VK_FORMAT_BC7_SRGB_BLOCK;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+size_t compressed_size( VkFormat format, uint32_t width, uint32_t height, uint32_t mip_levels )
+{
+    size_t size = 0;
+
+    for ( uint32_t mip = 0; mip < mip_levels; mip++ ) {
+        size_t blocks_x = ( std::max( width >> mip, 1u ) + 3 ) / 4;
+        size_t blocks_y = ( std::max( height >> mip, 1u ) + 3 ) / 4;
+        size += blocks_x * blocks_y * block_bytes( format );
+    }
+
+    return size;
+}
+
+std::vector<unsigned char> compress_texture( std::span<const unsigned char> pixels, uint32_t width,
+    uint32_t height, uint32_t mip_levels, VkFormat source_format, VkFormat target_format )
+{
+    std::optional<TexelLayout> layout = texel_layout( source_format );
+    size_t block_size = block_bytes( target_format );
+
+    if ( !layout || block_size == 0 ) {
+        throw Exception( "[TextureCompression] Can't compress format {} to {}",
+            static_cast<int>( source_format ), static_cast<int>( target_format ) );
+    }
+
+    // The LDR encoders work in 0-255, BC6H on the raw values.
+    float scale = target_format == VK_FORMAT_BC6H_UFLOAT_BLOCK ? 1.f : 255.f;
+    size_t texel_size = layout->num_channels * layout->channel_size;
+
+    std::vector<unsigned char> compressed(
+        compressed_size( target_format, width, height, mip_levels ) );
+    size_t source_offset = 0;
+    size_t target_offset = 0;
+
+    for ( uint32_t mip = 0; mip < mip_levels; mip++ ) {
+        uint32_t level_width = std::max( width >> mip, 1u );
+        uint32_t level_height = std::max( height >> mip, 1u );
+        size_t level_size = static_cast<size_t>( level_width ) * level_height * texel_size;
+
+        if ( source_offset + level_size > pixels.size() ) {
+            throw Exception( "[TextureCompression] Source pixels end before mip {}", mip );
+        }
+
+        const unsigned char* level = pixels.data() + source_offset;
+        unsigned char* blocks = compressed.data() + target_offset;
+        uint32_t blocks_x = ( level_width + 3 ) / 4;
+        uint32_t blocks_y = ( level_height + 3 ) / 4;
+
+        parallel::for_each( blocks_y, [&]( size_t row ) {
+            for ( uint32_t column = 0; column < blocks_x; column++ ) {
+                Block block = fetch_block( *layout, level, level_width, level_height, column,
+                    static_cast<uint32_t>( row ), scale );
+                unsigned char* out = blocks + ( row * blocks_x + column ) * block_size;
+
+                switch ( target_format ) {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                    encode_bc1( block, out );
+                    break;
+                case VK_FORMAT_BC4_UNORM_BLOCK:
+                    encode_bc4( block, 0, out );
+                    break;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                    encode_bc4( block, 0, out );
+                    encode_bc4( block, 1, out + 8 );
+                    break;
+                case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+                    encode_bc6h( block, out );
+                    break;
+                default:
+                    encode_bc7( block, out );
+                    break;
+                }
+            }
+        } );
+
+        source_offset += level_size;
+        target_offset += static_cast<size_t>( blocks_x ) * blocks_y * block_size;
+    }
+
+    return compressed;
+}
+
+CompressedImage compress_image_file(
+    const std::filesystem::path& file_path, VkFormat format, bool mipmapped )
+{
+    std::string abs_file_path = std::filesystem::absolute( file_path ).string();
+    int width = 0, height = 0, channels = 0;
+
+    std::vector<unsigned char> pixels;
+    VkFormat source_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    if ( format == VK_FORMAT_BC6H_UFLOAT_BLOCK ) {
+        float* data = stbi_loadf( abs_file_path.c_str(), &width, &height, &channels, 4 );
+        if ( !data ) {
+            throw Exception( "[TextureCompression] Failed to load \"{}\": {}", abs_file_path,
+                stbi_failure_reason() );
+        }
+
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>( data );
+        pixels.assign( bytes, bytes + static_cast<size_t>( width ) * height * 4 * sizeof( float ) );
+        stbi_image_free( data );
+        source_format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    } else {
+        unsigned char* data = stbi_load( abs_file_path.c_str(), &width, &height, &channels, 4 );
+        if ( !data ) {
+            throw Exception( "[TextureCompression] Failed to load \"{}\": {}", abs_file_path,
+                stbi_failure_reason() );
+        }
+
+        pixels.assign( data, data + static_cast<size_t>( width ) * height * 4 );
+        stbi_image_free( data );
+
+        if ( format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK ) {
+            source_format = VK_FORMAT_R8G8B8A8_SRGB;
+        }
+    }
+
+    CompressedImage image = {
+        .format = format,
+        .width = static_cast<uint32_t>( width ),
+        .height = static_cast<uint32_t>( height ),
+    };
+
+    if ( mipmapped ) {
+        image.mip_levels = generate_mip_chain( pixels, image.width, image.height, source_format );
+    }
+
+    image.data = compress_texture(
+        pixels, image.width, image.height, image.mip_levels, source_format, format );
+    return image;
+}
+
+} // namespace racecar::engine
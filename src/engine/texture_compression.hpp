@@ -0,0 +1,48 @@
+#pragma once
+
+#include <volk.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+/// CPU-side texture processing shared by racecar-bake and the load-time fallback in `load_image`:
+/// mip chain generation and BC1/BC4/BC5/BC6H/BC7 encoding. Nothing in here touches the GPU.
+namespace racecar::engine {
+
+/// A block-compressed image, every mip packed one after the other.
+struct CompressedImage {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mip_levels = 1;
+    std::vector<unsigned char> data;
+};
+
+/// Box-filters a full mip chain onto the end of `pixels`. sRGB color channels are averaged in
+/// linear space. Returns the number of levels in `pixels` afterwards, 1 if the format isn't
+/// handled.
+uint32_t generate_mip_chain(
+    std::vector<unsigned char>& pixels, uint32_t width, uint32_t height, VkFormat format );
+
+/// The block-compressed format a texture stored as `format` should be baked to, or
+/// VK_FORMAT_UNDEFINED if it's better left alone (16 bit UNORM data, for example).
+VkFormat compressed_format_for( VkFormat format );
+
+/// Size of a packed mip chain in one of the BC formats, 0 for anything else.
+size_t compressed_size( VkFormat format, uint32_t width, uint32_t height, uint32_t mip_levels );
+
+/// Encodes a packed mip chain from `source_format` into `target_format`, one level after the
+/// other, with the blocks of each level spread over worker threads. BC6H expects
+/// R32G32B32A32_SFLOAT sources, the other formats any 8 or 16 bit UNORM/sRGB one. Channels the
+/// source doesn't have read as 0, alpha as 1.
+std::vector<unsigned char> compress_texture( std::span<const unsigned char> pixels, uint32_t width,
+    uint32_t height, uint32_t mip_levels, VkFormat source_format, VkFormat target_format );
+
+/// Loads an image file through stb (as floats for BC6H, RGBA8 otherwise) and compresses it into
+/// `format`, with a full mip chain if `mipmapped`. Throws if the file can't be loaded.
+CompressedImage compress_image_file(
+    const std::filesystem::path& file_path, VkFormat format, bool mipmapped );
+
+} // namespace racecar::engine
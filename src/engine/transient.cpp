@@ -0,0 +1,168 @@
+#include "transient.hpp"
+
+#include "../log.hpp"
+#include "../vk/create.hpp"
+#include "../vk/utility.hpp"
+#include "task_list.hpp"
+
+#include <algorithm>
+
+namespace racecar::engine {
+
+namespace {
+
+void fill_in_views( const State& engine, RWImage& image )
+{
+    for ( vk::mem::AllocatedImage& allocated_image : image.images ) {
+        const TransientImage* transient = find_transient_image( engine, allocated_image.image );
+
+        if ( transient != nullptr ) {
+            allocated_image = transient->image;
+        }
+    }
+}
+
+}
+
+RWImage create_transient_rwimage( vk::Common& vulkan, State& engine, VkExtent3D extent,
+    VkFormat format, VkSampleCountFlagBits samples, VkImageUsageFlags usage_flags )
+{
+    TransientImage transient = {
+        .image = {
+            .image_extent = extent,
+            .image_format = format,
+            .samples = samples,
+        },
+    };
+
+    VkImageCreateInfo image_info
+        = vk::create::image_info( format, VK_IMAGE_TYPE_2D, 1, 1, samples, usage_flags, extent );
+
+    vk::check( vkCreateImage( vulkan.device, &image_info, nullptr, &transient.image.image ),
+        "Failed to create transient image" );
+    vulkan.destructor_stack.push( vulkan.device, transient.image.image, vkDestroyImage );
+
+    vkGetImageMemoryRequirements( vulkan.device, transient.image.image, &transient.requirements );
+
+    engine.transient_images.push_back( transient );
+
+    return { std::vector<vk::mem::AllocatedImage>( engine.frame_overlap, transient.image ) };
+}
+
+bool is_unbound( const RWImage& image )
+{
+    return !image.images.empty() && image.images[0].image != VK_NULL_HANDLE
+        && image.images[0].image_view == VK_NULL_HANDLE;
+}
+
+const TransientImage* find_transient_image( const State& engine, VkImage image )
+{
+    auto found = std::find_if( engine.transient_images.begin(), engine.transient_images.end(),
+        [=]( const TransientImage& transient ) { return transient.image.image == image; } );
+
+    return found != engine.transient_images.end() ? &*found : nullptr;
+}
+
+void bind_transient_images( vk::Common& vulkan, State& engine, TaskList& task_list )
+{
+    if ( !task_list.graph ) {
+        return;
+    }
+
+    const std::vector<std::vector<size_t>>& regions = task_list.graph->transient_regions;
+
+    size_t num_images = 0;
+    VkDeviceSize unaliased_size = 0;
+    VkDeviceSize aliased_size = 0;
+
+    for ( size_t region = 0; region < regions.size(); region++ ) {
+        if ( regions[region].empty() || engine.transient_images[regions[region][0]].region ) {
+            continue;
+        }
+
+        VkMemoryRequirements requirements = {
+            .size = 0,
+            .alignment = 1,
+            .memoryTypeBits = ~0u,
+        };
+
+        for ( size_t index : regions[region] ) {
+            const VkMemoryRequirements& image_requirements
+                = engine.transient_images[index].requirements;
+
+            requirements.size = std::max( requirements.size, image_requirements.size );
+            requirements.alignment
+                = std::max( requirements.alignment, image_requirements.alignment );
+            requirements.memoryTypeBits &= image_requirements.memoryTypeBits;
+            unaliased_size += image_requirements.size;
+        }
+
+        VmaAllocationCreateInfo allocation_create_info = {
+            .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+            .requiredFlags = VkMemoryPropertyFlags( VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ),
+        };
+
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        vk::check( vmaAllocateMemory( vulkan.allocator, &requirements, &allocation_create_info,
+                       &allocation, nullptr ),
+            "[VMA] Failed to allocate transient image memory" );
+        vulkan.destructor_stack.push_free_vmamemory( vulkan.allocator, allocation );
+
+        aliased_size += requirements.size;
+
+        for ( size_t index : regions[region] ) {
+            vk::mem::AllocatedImage& image = engine.transient_images[index].image;
+
+            vk::check( vmaBindImageMemory( vulkan.allocator, allocation, image.image ),
+                "[VMA] Failed to bind transient image memory" );
+
+            VkImageViewCreateInfo image_view_info = vk::create::image_view_info(
+                image.image_format, image.image, VK_IMAGE_VIEW_TYPE_2D,
+                vk::utility::is_depth_format( image.image_format ) ? VK_IMAGE_ASPECT_DEPTH_BIT
+                                                                   : VK_IMAGE_ASPECT_COLOR_BIT );
+            vk::check(
+                vkCreateImageView( vulkan.device, &image_view_info, nullptr, &image.image_view ),
+                "Failed to create image view" );
+            vulkan.destructor_stack.push( vulkan.device, image.image_view, vkDestroyImageView );
+
+            image.storage_image_view = image.image_view;
+            engine.transient_images[index].region = region;
+            num_images++;
+        }
+    }
+
+    if ( num_images == 0 ) {
+        return;
+    }
+
+    // Everything that grabbed the views before there were any
+    for ( GfxTask& gfx_task : task_list.gfx_tasks ) {
+        for ( RWImage& attachment : gfx_task.color_attachments ) {
+            fill_in_views( engine, attachment );
+        }
+
+        if ( gfx_task.depth_image ) {
+            fill_in_views( engine, gfx_task.depth_image.value() );
+        }
+
+        for ( DrawTask& draw_task : gfx_task.draw_tasks ) {
+            for ( DescriptorSet* desc_set : draw_task.descriptor_sets ) {
+                flush_deferred_writes( vulkan, engine, *desc_set );
+            }
+        }
+    }
+
+    for ( ComputeTask& cs_task : task_list.cs_tasks ) {
+        for ( DescriptorSet* desc_set : cs_task.descriptor_sets ) {
+            flush_deferred_writes( vulkan, engine, *desc_set );
+        }
+    }
+
+    constexpr double MIB = 1024.0 * 1024.0;
+    log::info( "[Transient] Bound {} images to {} MiB of memory, instead of {} MiB with one image "
+               "each per frame in flight",
+        num_images, static_cast<double>( aliased_size ) / MIB,
+        static_cast<double>( unaliased_size * engine.frame_overlap ) / MIB );
+}
+
+} // namespace racecar::engine
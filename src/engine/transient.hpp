@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../vk/common.hpp"
+#include "rwimage.hpp"
+#include "state.hpp"
+
+#include <volk.h>
+
+/// Transient images are render targets whose contents never outlive the frame, like the G-buffers
+/// and post-processing intermediates. They're created without memory, and once the render graph
+/// has worked out when each of them is used, the ones that are never alive at the same time share
+/// it. All frames in flight use the same image, since the graph orders a frame's first use of it
+/// after the previous frame's last one anyway.
+namespace racecar::engine {
+
+struct TaskList;
+
+/// A 2D, single mip transient image. It has no views until `bind_transient_images`; descriptor
+/// writes for it are held back until then.
+RWImage create_transient_rwimage( vk::Common& vulkan, State& engine, VkExtent3D extent,
+    VkFormat format, VkSampleCountFlagBits samples, VkImageUsageFlags usage_flags );
+
+/// Whether `image` is a transient image still waiting for its memory.
+bool is_unbound( const RWImage& image );
+
+const TransientImage* find_transient_image( const State& engine, VkImage image );
+
+/// Allocates the memory regions the task list's render graph planned, binds the transient images
+/// to them and creates their views. The task list's attachments and descriptor sets then get
+/// those views filled in. Images that are already bound are left alone.
+void bind_transient_images( vk::Common& vulkan, State& engine, TaskList& task_list );
+
+} // namespace racecar::engine
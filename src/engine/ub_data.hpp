@@ -59,12 +59,14 @@ struct SHData {
     glm::vec4 coeff6 = {};
 };
 
+/// One per scene material in the bindless material buffer, see `engine/bindless.hpp`. Texture
+/// indices are into `scene.textures`, -1 if there isn't one.
 struct Material {
-    int has_base_color_texture = false;
+    int32_t base_color_texture_index = -1;
     /// Typically roughness in G, metallic in B
-    int has_metallic_roughness_texture = false;
-    int has_normal_texture = false;
-    int has_emmisive_texture = false;
+    int32_t metallic_roughness_texture_index = -1;
+    int32_t normal_texture_index = -1;
+    int32_t emissive_texture_index = -1;
 
     glm::vec4 base_color = glm::vec4( 1 );
 
@@ -108,6 +110,49 @@ struct Atmosphere {
     float radiance_exposure = 0.f;
 };
 
+/// std140 mirror of `DensityProfileLayer` in `constants.slang`. Structs round up to 16 bytes.
+struct AtmosphereDensityLayer {
+    float width = 0.f;
+    float exp_term = 0.f;
+    float exp_scale = 0.f;
+    float linear_term = 0.f;
+    float constant_term = 0.f;
+    float p0[3] = {};
+};
+
+/// std140 mirror of `Parameters` in `constants.slang`. Padding is zeroed so the bytes can be hashed.
+struct AtmosphereParameters {
+    glm::vec3 solar_irradiance = {};
+    float sun_angular_radius = 0.f;
+    float bottom_radius = 0.f;
+    float top_radius = 0.f;
+    float p0[2] = {};
+
+    AtmosphereDensityLayer rayleigh_density[2] = {};
+    glm::vec3 rayleigh_scattering = {};
+    float p1 = 0.f;
+
+    AtmosphereDensityLayer mie_density[2] = {};
+    glm::vec3 mie_scattering = {};
+    float p2 = 0.f;
+    glm::vec3 mie_extinction = {};
+    float mie_phase_function_g = 0.f;
+
+    AtmosphereDensityLayer absorption_density[2] = {};
+    glm::vec3 absorption_extinction = {};
+    float p3 = 0.f;
+    glm::vec3 ground_albedo = {};
+    float mu_s_min = 0.f;
+};
+
+static_assert( sizeof( AtmosphereParameters ) == 304, "Out of sync with std140 `Parameters`" );
+
+struct AtmospherePrecompute {
+    AtmosphereParameters atmosphere = {};
+    int32_t scattering_order = 0;
+    int32_t p0[3] = {};
+};
+
 struct Clouds {
     glm::mat4 inverse_proj = {};
     glm::mat4 inverse_view = {};
@@ -156,30 +201,78 @@ struct ModelMat {
     glm::mat4 prev_model_mat = {};
 };
 
-struct BLASOffsets {
-    uint32_t vertex_buffer_offset[104];
-    uint32_t index_buffer_offset[104];
+/// One per scene primitive, for the GPU-driven draws. The vertex shader finds its own through the
+/// instance index.
+struct DrawRecord {
+    /// Object-space bounding sphere: center in xyz, radius in w
+    glm::vec4 bounds = {};
+
+    uint32_t index_count = 0;
+    uint32_t first_index = 0;
+    int32_t vertex_offset = 0;
+    uint32_t transform_index = 0;
+
+    /// Coarser versions of the primitive, see `scene::Lod`. Only the first `lod_count` are used,
+    /// errors are in object space.
+    uint32_t lod_count = 0;
+    uint32_t _pad[3] = {};
+    glm::uvec4 lod_first_index = {};
+    glm::uvec4 lod_index_count = {};
+    glm::vec4 lod_error = {};
 };
 
-struct PaddedVertex {
-    glm::vec3 position;
-    float _pad1;
-    glm::vec3 normal;
-    float _pad2;
-    glm::vec4 tangent;
-    glm::vec2 uv;
-    float _pad3[2];
+/// One per meshlet, see `geometry::scene::Meshlet`. Culled on its own and drawn with its primitive's
+/// draw record.
+struct Meshlet {
+    /// Object-space bounding sphere: center in xyz, radius in w
+    glm::vec4 bounds = {};
+    glm::vec4 cone_apex = {};
+    /// Cutoff in w, 1 for meshlets the cone can't cull.
+    glm::vec4 cone_axis = {};
+
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    uint32_t draw_index = 0;
+    uint32_t _pad = 0;
 };
 
-struct RTTextureUniform {
-    glm::vec4 base_color[104];
-    int32_t albedo_texture_index[104];
+/// One per scene primitive, in the order they're drawn and go into the TLAS, so both the instance
+/// index of a draw and the instance a ray hit lead to it.
+struct Instance {
+    uint32_t vertex_offset = 0;
+    uint32_t index_offset = 0;
+    uint32_t material_index = 0;
+};
 
-    float metallic[104];
-    float roughness[104];
-    int32_t metallic_roughness_texture_index[104];
+/// Bind pose of one skinned vertex, see skinning.slang. The result overwrites `target_vertex` of
+/// the scene's vertex buffer.
+struct SkinnedVertex {
+    glm::vec4 position = {};
+    glm::vec4 normal = {};
+    glm::vec4 tangent = {};
+    glm::uvec4 joints = {};
+    glm::vec4 weights = {};
+
+    uint32_t target_vertex = 0;
+    uint32_t joint_offset = 0; ///< Where the vertex's joint matrices start.
+    uint32_t _pad[2] = {};
+};
 
-    int32_t normal_texture_index[104];
+struct Cull {
+    glm::vec2 hiz_size = {};
+    uint32_t hiz_mip_count = 0;
+    uint32_t draw_count = 0;
+
+    uint32_t enable_frustum = 0;
+    uint32_t enable_occlusion = 0;
+    uint32_t enable_cone = 0;
+    uint32_t meshlet_count = 0;
+
+    /// Coarsest LOD whose error stays under this many pixels gets drawn, 0 to always draw the
+    /// primitives themselves.
+    float lod_error = 0.f;
+    float screen_height = 0.f;
+    uint32_t _pad[2] = {};
 };
 
 } // namespace racecar::uniform_buffer
@@ -5,6 +5,8 @@
 
 #include <volk.h>
 
+#include <cstring>
+
 namespace racecar {
 
 struct IUniformBuffer {
@@ -14,8 +16,12 @@ struct IUniformBuffer {
     virtual ~IUniformBuffer() { }
 };
 
+/// For the handful of uniforms there's one of, like the camera. Uniforms there's one of per
+/// object go in an `engine::UniformRing` instead.
 template <typename T> struct UniformBuffer : IUniformBuffer {
-    bool dirty = false;
+    /// A bit per frame in flight whose buffer is behind `data_`. Every frame's descriptor set
+    /// points at that frame's buffer, so a change is only complete once each frame has updated.
+    uint32_t dirty_frames = 0;
 
     UniformBuffer() = default;
 
@@ -29,14 +35,16 @@ template <typename T> struct UniformBuffer : IUniformBuffer {
 
     void update( racecar::vk::Common& vulkan, size_t frame_idx ) override
     {
-        if ( !dirty ) {
+        uint32_t frame_bit = 1u << frame_idx;
+
+        if ( ( dirty_frames & frame_bit ) == 0 ) {
             return;
         }
 
         std::memcpy( buffer_[frame_idx].info.pMappedData, &data_, sizeof( T ) );
         vmaFlushAllocation( vulkan.allocator, buffer_[frame_idx].allocation, 0, sizeof( T ) );
 
-        dirty = false;
+        dirty_frames &= ~frame_bit;
     }
 
     T get_data() const { return data_; }
@@ -44,7 +52,7 @@ template <typename T> struct UniformBuffer : IUniformBuffer {
     void set_data( T t )
     {
         data_ = t;
-        dirty = true;
+        dirty_frames = ( 1u << buffer_.size() ) - 1;
     }
 
 private:
@@ -62,6 +70,10 @@ UniformBuffer<T> create_uniform_buffer( racecar::vk::Common& vulkan, T input, si
         try {
             buffers[i] = vk::mem::create_buffer( vulkan, sizeof( T ),
                 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU );
+
+            // Nothing's in flight yet, so every frame can start out with the initial data
+            std::memcpy( buffers[i].info.pMappedData, &input, sizeof( T ) );
+            vmaFlushAllocation( vulkan.allocator, buffers[i].allocation, 0, sizeof( T ) );
         } catch ( const Exception& ex ) {
             log::error( "Failed to create uniform buffer {} for swapchain", i );
             throw;
@@ -0,0 +1,88 @@
+#include "uniform_ring.hpp"
+
+#include "../exception.hpp"
+#include "../log.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace racecar::engine {
+
+namespace {
+
+VkDeviceSize align_up( VkDeviceSize size, VkDeviceSize alignment )
+{
+    return ( size + alignment - 1 ) / alignment * alignment;
+}
+
+}
+
+UniformRing create_uniform_ring( vk::Common& vulkan, const State& engine,
+    VkDeviceSize max_allocation_size, size_t max_allocations )
+{
+    UniformRing ring;
+
+    ring.alignment = std::max(
+        vulkan.device.physical_device.properties.limits.minUniformBufferOffsetAlignment,
+        VkDeviceSize( 1 ) );
+    ring.region_size = align_up( max_allocation_size, ring.alignment )
+        * std::max( static_cast<VkDeviceSize>( max_allocations ), VkDeviceSize( 1 ) );
+    ring.region_size = std::max( ring.region_size, ring.alignment );
+
+    ring.buffer = vk::mem::create_buffer( vulkan,
+        static_cast<size_t>( ring.region_size * engine.frame_overlap ),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU );
+
+    log::info( "[UniformRing] {} bytes for each of {} frames", ring.region_size,
+        engine.frame_overlap );
+
+    return ring;
+}
+
+uint32_t allocate_uniform( UniformRing& ring, VkDeviceSize size )
+{
+    VkDeviceSize offset = ring.head;
+    VkDeviceSize end = offset + align_up( size, ring.alignment );
+
+    if ( end > ring.region_size ) {
+        throw Exception( "[UniformRing] {} more bytes don't fit in {} with {} taken", size,
+            ring.region_size, ring.head );
+    }
+
+    ring.head = end;
+    return static_cast<uint32_t>( offset );
+}
+
+void write_uniform( UniformRing& ring, const State& engine, uint32_t offset, const void* data,
+    VkDeviceSize size )
+{
+    VkDeviceSize begin = ring.region_size * engine.get_frame_index() + offset;
+    VkDeviceSize end = begin + size;
+
+    std::memcpy( static_cast<std::byte*>( ring.buffer.info.pMappedData ) + begin, data,
+        static_cast<size_t>( size ) );
+
+    if ( ring.dirty_begin == ring.dirty_end ) {
+        ring.dirty_begin = begin;
+        ring.dirty_end = end;
+    } else {
+        ring.dirty_begin = std::min( ring.dirty_begin, begin );
+        ring.dirty_end = std::max( ring.dirty_end, end );
+    }
+}
+
+void flush_uniform_ring( vk::Common& vulkan, UniformRing& ring )
+{
+    if ( ring.dirty_begin == ring.dirty_end ) {
+        return;
+    }
+
+    vmaFlushAllocation( vulkan.allocator, ring.buffer.allocation, ring.dirty_begin,
+        ring.dirty_end - ring.dirty_begin );
+
+    ring.dirty_begin = 0;
+    ring.dirty_end = 0;
+}
+
+} // namespace racecar::engine
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../vk/common.hpp"
+#include "../vk/mem.hpp"
+#include "state.hpp"
+
+#include <volk.h>
+
+namespace racecar::engine {
+
+/// One persistently mapped buffer that uniforms of many objects are suballocated from, instead of
+/// a buffer per object and frame in flight. It's split into a region per frame in flight, and every
+/// allocation takes the same offset in each region. Shaders read them through a
+/// `VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC` binding, with the allocation's offset as the dynamic
+/// offset, see `update_descriptor_set_uniform_ring`.
+///
+/// Allocations are only ever handed out front to back, and live as long as the ring does.
+struct UniformRing {
+    vk::mem::AllocatedBuffer buffer;
+
+    /// Allocations are aligned to `minUniformBufferOffsetAlignment`, as dynamic offsets have to be.
+    VkDeviceSize alignment = 0;
+    VkDeviceSize region_size = 0;
+    VkDeviceSize head = 0;
+
+    /// What was written to the current frame's region since the last flush.
+    VkDeviceSize dirty_begin = 0;
+    VkDeviceSize dirty_end = 0;
+};
+
+/// Makes every frame's region big enough for `max_allocations` of up to `max_allocation_size` each.
+UniformRing create_uniform_ring( vk::Common& vulkan, const State& engine,
+    VkDeviceSize max_allocation_size, size_t max_allocations );
+
+/// Returns the offset of the allocation within every frame's region. Throws if the ring is full.
+uint32_t allocate_uniform( UniformRing& ring, VkDeviceSize size );
+
+/// Copies `data` into the current frame's region, only once the frame's previous submission is
+/// done, i.e. after `engine::begin_frame`. Nothing reaches the GPU until `flush_uniform_ring`.
+void write_uniform( UniformRing& ring, const State& engine, uint32_t offset, const void* data,
+    VkDeviceSize size );
+
+template <typename T>
+void write_uniform( UniformRing& ring, const State& engine, uint32_t offset, const T& data )
+{
+    write_uniform( ring, engine, offset, &data, sizeof( T ) );
+}
+
+/// Flushes everything written to the current frame's region with a single call.
+void flush_uniform_ring( vk::Common& vulkan, UniformRing& ring );
+
+} // namespace racecar::engine
@@ -0,0 +1,537 @@
+#include "mesh_optimizer.hpp"
+
+#include "../log.hpp"
+#include "../parallel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Kept apart from the rest of scene_mesh.cpp so CPU-only tools don't pull in any Vulkan code.
+
+namespace racecar::geometry::scene {
+
+namespace {
+
+using racecar::scene::Primitive;
+using racecar::scene::SkinVertex;
+
+/// Fraction the ACMR of a run may get worse by to be split off from the rest, see `find_clusters`.
+constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+/// FIFO post-transform cache, by when each vertex last went in. Nothing ever has to be evicted.
+struct FifoCache {
+    std::vector<uint32_t> times;
+    uint32_t time = VERTEX_CACHE_SIZE + 1;
+
+    explicit FifoCache( size_t num_vertices )
+        : times( num_vertices, 0 )
+    {
+    }
+
+    /// Whether the vertex had to be transformed.
+    bool access( uint32_t vertex )
+    {
+        if ( time - times[vertex] > VERTEX_CACHE_SIZE ) {
+            times[vertex] = time++;
+            return true;
+        }
+
+        return false;
+    }
+
+    /// Ages everything out at once.
+    void flush() { time += VERTEX_CACHE_SIZE + 1; }
+};
+
+/// One primitive's slice of the global arrays, copied out so it can be worked on in isolation.
+struct PrimitiveGeometry {
+    std::vector<Vertex> vertices;
+    std::vector<SkinVertex> skin_vertices; ///< Empty unless skinned.
+    std::vector<uint32_t> indices;
+};
+
+/// Vertices are compared and hashed byte for byte, which is fine since neither struct has padding.
+static_assert( sizeof( Vertex ) == 14 * sizeof( float ) );
+static_assert( sizeof( SkinVertex ) == 4 * sizeof( uint16_t ) + 4 * sizeof( float ) );
+
+struct VertexHash {
+    const PrimitiveGeometry* geometry;
+
+    size_t operator()( uint32_t vertex ) const
+    {
+        size_t hash = std::hash<std::string_view>()( std::string_view(
+            reinterpret_cast<const char*>( &geometry->vertices[vertex] ), sizeof( Vertex ) ) );
+
+        if ( !geometry->skin_vertices.empty() ) {
+            hash ^= std::hash<std::string_view>()(
+                        std::string_view( reinterpret_cast<const char*>(
+                                              &geometry->skin_vertices[vertex] ),
+                            sizeof( SkinVertex ) ) )
+                * 31;
+        }
+
+        return hash;
+    }
+};
+
+struct VertexEqual {
+    const PrimitiveGeometry* geometry;
+
+    bool operator()( uint32_t a, uint32_t b ) const
+    {
+        const Vertex& vertex_a = geometry->vertices[a];
+        const Vertex& vertex_b = geometry->vertices[b];
+        if ( std::memcmp( &vertex_a, &vertex_b, sizeof( Vertex ) ) != 0 ) {
+            return false;
+        }
+
+        return geometry->skin_vertices.empty()
+            || std::memcmp( &geometry->skin_vertices[a], &geometry->skin_vertices[b],
+                   sizeof( SkinVertex ) )
+            == 0;
+    }
+};
+
+/// Points every index at the first of the vertices identical to the one it referenced.
+void merge_duplicates( PrimitiveGeometry& geometry )
+{
+    std::vector<uint32_t> remap( geometry.vertices.size() );
+    std::unordered_set<uint32_t, VertexHash, VertexEqual> unique( geometry.vertices.size(),
+        VertexHash { &geometry }, VertexEqual { &geometry } );
+
+    for ( uint32_t vertex = 0; vertex < static_cast<uint32_t>( geometry.vertices.size() );
+        vertex++ ) {
+        remap[vertex] = *unique.insert( vertex ).first;
+    }
+
+    for ( uint32_t& index : geometry.indices ) {
+        index = remap[index];
+    }
+}
+
+/// Triangle order from Tipsify. Each entry of `out_hard_boundaries` is the first triangle after a
+/// dead end that continued from a vertex no longer in the cache.
+std::vector<uint32_t> tipsify( std::span<const uint32_t> indices, size_t num_vertices,
+    std::vector<size_t>& out_hard_boundaries )
+{
+    size_t num_triangles = indices.size() / 3;
+
+    // Triangles around each vertex, in one flat array
+    std::vector<uint32_t> live( num_vertices, 0 );
+    for ( uint32_t index : indices ) {
+        live[index]++;
+    }
+
+    std::vector<uint32_t> adjacency_offsets( num_vertices + 1, 0 );
+    std::partial_sum( live.begin(), live.end(), adjacency_offsets.begin() + 1 );
+
+    std::vector<uint32_t> adjacency( indices.size() );
+    {
+        std::vector<uint32_t> cursors( adjacency_offsets.begin(), adjacency_offsets.end() - 1 );
+        for ( size_t i = 0; i < indices.size(); i++ ) {
+            adjacency[cursors[indices[i]]++] = static_cast<uint32_t>( i / 3 );
+        }
+    }
+
+    std::vector<uint32_t> cache_times( num_vertices, 0 );
+    std::vector<uint8_t> emitted( num_triangles, 0 );
+    std::vector<uint32_t> dead_ends;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> order;
+    order.reserve( num_triangles );
+
+    uint32_t time = VERTEX_CACHE_SIZE + 1;
+    size_t scan_cursor = 0;
+    int64_t fanning = 0;
+
+    while ( fanning >= 0 ) {
+        candidates.clear();
+
+        uint32_t vertex = static_cast<uint32_t>( fanning );
+        for ( uint32_t a = adjacency_offsets[vertex]; a < adjacency_offsets[vertex + 1]; a++ ) {
+            uint32_t triangle = adjacency[a];
+            if ( emitted[triangle] ) {
+                continue;
+            }
+
+            for ( size_t corner = 0; corner < 3; corner++ ) {
+                uint32_t v = indices[triangle * 3 + corner];
+
+                dead_ends.push_back( v );
+                candidates.push_back( v );
+                live[v]--;
+
+                if ( time - cache_times[v] > VERTEX_CACHE_SIZE ) {
+                    cache_times[v] = time++;
+                }
+            }
+
+            emitted[triangle] = 1;
+            order.push_back( triangle );
+        }
+
+        // Prefer the candidate that's still in the cache and stays there while its remaining
+        // triangles get fanned, otherwise the oldest one still in the cache
+        int64_t next = -1;
+        int64_t best_priority = -1;
+
+        for ( uint32_t v : candidates ) {
+            if ( live[v] == 0 ) {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if ( time - cache_times[v] + 2 * live[v] <= VERTEX_CACHE_SIZE ) {
+                priority = time - cache_times[v];
+            }
+
+            if ( priority > best_priority ) {
+                best_priority = priority;
+                next = v;
+            }
+        }
+
+        if ( next != -1 ) {
+            fanning = next;
+            continue;
+        }
+
+        // Dead end, back up to a recently used vertex or fall back to scanning for any
+        while ( !dead_ends.empty() && next == -1 ) {
+            uint32_t v = dead_ends.back();
+            dead_ends.pop_back();
+
+            if ( live[v] > 0 ) {
+                next = v;
+            }
+        }
+
+        while ( next == -1 && scan_cursor < num_vertices ) {
+            if ( live[scan_cursor] > 0 ) {
+                next = static_cast<int64_t>( scan_cursor );
+            }
+            scan_cursor++;
+        }
+
+        // Restarting from a vertex that already left the cache is as good as a fresh start
+        bool is_cold = next != -1
+            && time - cache_times[static_cast<size_t>( next )] > VERTEX_CACHE_SIZE;
+        if ( is_cold && !order.empty() ) {
+            out_hard_boundaries.push_back( order.size() );
+        }
+
+        fanning = next;
+    }
+
+    return order;
+}
+
+/// Splits the triangle order into runs that can be moved around without hurting the cache much.
+/// Every hard boundary starts a run. Within a stretch between two of them, a new run starts as soon
+/// as the current one's ACMR is within `OVERDRAW_THRESHOLD` of the whole stretch's, counting each
+/// run from a cold cache since it may end up anywhere.
+std::vector<size_t> find_clusters( std::span<const uint32_t> indices,
+    std::span<const uint32_t> order, std::span<const size_t> hard_boundaries, size_t num_vertices )
+{
+    std::vector<size_t> hard = { 0 };
+    hard.insert( hard.end(), hard_boundaries.begin(), hard_boundaries.end() );
+    hard.push_back( order.size() );
+
+    FifoCache cache( num_vertices );
+    std::vector<size_t> clusters;
+
+    for ( size_t h = 0; h + 1 < hard.size(); h++ ) {
+        size_t begin = hard[h];
+        size_t end = hard[h + 1];
+
+        if ( begin == end ) {
+            continue;
+        }
+
+        size_t misses = 0;
+        cache.flush();
+        for ( size_t t = begin; t < end; t++ ) {
+            for ( size_t corner = 0; corner < 3; corner++ ) {
+                misses += cache.access( indices[order[t] * 3 + corner] );
+            }
+        }
+
+        float threshold = static_cast<float>( misses ) / static_cast<float>( end - begin )
+            * OVERDRAW_THRESHOLD;
+
+        clusters.push_back( begin );
+        cache.flush();
+
+        size_t run_start = begin;
+        size_t run_misses = 0;
+
+        for ( size_t t = begin; t + 1 < end; t++ ) {
+            for ( size_t corner = 0; corner < 3; corner++ ) {
+                run_misses += cache.access( indices[order[t] * 3 + corner] );
+            }
+
+            float run_acmr
+                = static_cast<float>( run_misses ) / static_cast<float>( t + 1 - run_start );
+            if ( run_acmr <= threshold ) {
+                clusters.push_back( t + 1 );
+                run_start = t + 1;
+                run_misses = 0;
+                cache.flush();
+            }
+        }
+    }
+
+    return clusters;
+}
+
+/// Puts the clusters facing farthest out from the primitive's center first. Those are the most
+/// likely to be in front of the rest, whatever the view, so they fill the depth buffer early.
+std::vector<uint32_t> sort_clusters( const PrimitiveGeometry& geometry,
+    std::span<const uint32_t> order, std::span<const size_t> clusters )
+{
+    glm::vec3 center( 0.f );
+    for ( const Vertex& vertex : geometry.vertices ) {
+        center += vertex.position;
+    }
+    center /= static_cast<float>( std::max( geometry.vertices.size(), size_t( 1 ) ) );
+
+    std::vector<float> sort_keys( clusters.size() );
+
+    for ( size_t c = 0; c < clusters.size(); c++ ) {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : order.size();
+
+        // Area weighted, the cross product's length is twice the area
+        glm::vec3 centroid( 0.f );
+        glm::vec3 normal( 0.f );
+        float area = 0.f;
+
+        for ( size_t t = clusters[c]; t < end; t++ ) {
+            const uint32_t* triangle = &geometry.indices[order[t] * 3];
+            const glm::vec3& p0 = geometry.vertices[triangle[0]].position;
+            const glm::vec3& p1 = geometry.vertices[triangle[1]].position;
+            const glm::vec3& p2 = geometry.vertices[triangle[2]].position;
+
+            glm::vec3 cross = glm::cross( p1 - p0, p2 - p0 );
+            float triangle_area = glm::length( cross );
+
+            centroid += ( p0 + p1 + p2 ) * ( triangle_area / 3.f );
+            normal += cross;
+            area += triangle_area;
+        }
+
+        if ( area > 0.f && glm::length( normal ) > 0.f ) {
+            sort_keys[c] = glm::dot( centroid / area - center, glm::normalize( normal ) );
+        }
+    }
+
+    std::vector<size_t> cluster_order( clusters.size() );
+    std::iota( cluster_order.begin(), cluster_order.end(), size_t( 0 ) );
+    std::stable_sort( cluster_order.begin(), cluster_order.end(),
+        [&]( size_t a, size_t b ) { return sort_keys[a] > sort_keys[b]; } );
+
+    std::vector<uint32_t> indices;
+    indices.reserve( order.size() * 3 );
+
+    for ( size_t c : cluster_order ) {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : order.size();
+
+        for ( size_t t = clusters[c]; t < end; t++ ) {
+            const uint32_t* triangle = &geometry.indices[order[t] * 3];
+            indices.insert( indices.end(), triangle, triangle + 3 );
+        }
+    }
+
+    return indices;
+}
+
+/// Renumbers vertices by first use and drops the ones nothing references anymore.
+void remap_fetches( PrimitiveGeometry& geometry )
+{
+    constexpr uint32_t UNUSED = UINT32_MAX;
+
+    std::vector<uint32_t> remap( geometry.vertices.size(), UNUSED );
+    std::vector<Vertex> vertices;
+    std::vector<SkinVertex> skin_vertices;
+
+    for ( uint32_t& index : geometry.indices ) {
+        if ( remap[index] == UNUSED ) {
+            remap[index] = static_cast<uint32_t>( vertices.size() );
+            vertices.push_back( geometry.vertices[index] );
+
+            if ( !geometry.skin_vertices.empty() ) {
+                skin_vertices.push_back( geometry.skin_vertices[index] );
+            }
+        }
+
+        index = remap[index];
+    }
+
+    geometry.vertices = std::move( vertices );
+    geometry.skin_vertices = std::move( skin_vertices );
+}
+
+void optimize_primitive( PrimitiveGeometry& geometry )
+{
+    merge_duplicates( geometry );
+
+    std::vector<size_t> hard_boundaries;
+    std::vector<uint32_t> order
+        = tipsify( geometry.indices, geometry.vertices.size(), hard_boundaries );
+    std::vector<size_t> clusters
+        = find_clusters( geometry.indices, order, hard_boundaries, geometry.vertices.size() );
+
+    geometry.indices = sort_clusters( geometry, order, clusters );
+    remap_fetches( geometry );
+}
+
+void add_stats( CacheStats& total, const CacheStats& stats )
+{
+    total.triangles += stats.triangles;
+    total.vertices += stats.vertices;
+    total.misses += stats.misses;
+}
+
+}
+
+float get_acmr( const CacheStats& stats )
+{
+    return stats.triangles == 0
+        ? 0.f
+        : static_cast<float>( stats.misses ) / static_cast<float>( stats.triangles );
+}
+
+float get_atvr( const CacheStats& stats )
+{
+    return stats.vertices == 0
+        ? 0.f
+        : static_cast<float>( stats.misses ) / static_cast<float>( stats.vertices );
+}
+
+CacheStats simulate_vertex_cache( std::span<const uint32_t> indices )
+{
+    if ( indices.empty() ) {
+        return {};
+    }
+
+    size_t num_vertices
+        = static_cast<size_t>( *std::max_element( indices.begin(), indices.end() ) ) + 1;
+
+    FifoCache cache( num_vertices );
+    std::vector<uint8_t> referenced( num_vertices, 0 );
+    CacheStats stats = { .triangles = indices.size() / 3 };
+
+    for ( uint32_t index : indices ) {
+        stats.misses += cache.access( index );
+
+        if ( !referenced[index] ) {
+            referenced[index] = 1;
+            stats.vertices++;
+        }
+    }
+
+    return stats;
+}
+
+OptimizeReport optimize_mesh( racecar::scene::Scene& scene, Mesh& mesh )
+{
+    std::vector<Primitive*> primitives;
+    for ( const std::unique_ptr<racecar::scene::Node>& node : scene.nodes ) {
+        if ( node->mesh.has_value() ) {
+            for ( Primitive& primitive : node->mesh.value()->primitives ) {
+                primitives.push_back( &primitive );
+            }
+        }
+    }
+
+    // Instances of a mesh only need optimizing once, and keep sharing the result
+    std::vector<std::vector<size_t>> groups = racecar::scene::group_by_geometry( scene );
+
+    std::vector<PrimitiveGeometry> geometries( groups.size() );
+    std::vector<CacheStats> stats_before( groups.size() );
+    std::vector<CacheStats> stats_after( groups.size() );
+
+    // Every geometry owns its vertices, so they can all be worked on side by side
+    parallel::for_each( groups.size(), [&]( size_t i ) {
+        const Primitive& primitive = *primitives[groups[i].front()];
+        PrimitiveGeometry& geometry = geometries[i];
+
+        auto first_index = mesh.indices.begin() + primitive.ind_offset;
+        geometry.indices.assign(
+            first_index, first_index + static_cast<ptrdiff_t>( primitive.ind_count ) );
+
+        size_t num_vertices = geometry.indices.empty()
+            ? 0
+            : static_cast<size_t>(
+                  *std::max_element( geometry.indices.begin(), geometry.indices.end() ) )
+                + 1;
+
+        auto first_vertex = mesh.vertices.begin() + primitive.vertex_offset;
+        geometry.vertices.assign(
+            first_vertex, first_vertex + static_cast<ptrdiff_t>( num_vertices ) );
+
+        if ( primitive.skin_vertex_offset != -1 ) {
+            auto first_skin_vertex = scene.skin_vertices.begin() + primitive.skin_vertex_offset;
+            geometry.skin_vertices.assign(
+                first_skin_vertex, first_skin_vertex + static_cast<ptrdiff_t>( num_vertices ) );
+        }
+
+        stats_before[i] = simulate_vertex_cache( geometry.indices );
+
+        // Anything that isn't a triangle list is left the way it was
+        if ( !geometry.indices.empty() && geometry.indices.size() % 3 == 0 ) {
+            optimize_primitive( geometry );
+        }
+
+        stats_after[i] = simulate_vertex_cache( geometry.indices );
+    } );
+
+    OptimizeReport report = { .vertices_before = mesh.vertices.size() };
+
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    scene.skin_vertices.clear();
+
+    for ( size_t i = 0; i < groups.size(); i++ ) {
+        PrimitiveGeometry& geometry = geometries[i];
+        int vertex_offset = static_cast<int>( mesh.vertices.size() );
+        int ind_offset = static_cast<int>( mesh.indices.size() );
+        int skin_vertex_offset = static_cast<int>( scene.skin_vertices.size() );
+
+        for ( size_t draw_index : groups[i] ) {
+            Primitive& primitive = *primitives[draw_index];
+
+            primitive.vertex_offset = vertex_offset;
+            primitive.ind_offset = ind_offset;
+            primitive.ind_count = geometry.indices.size();
+
+            if ( primitive.skin_vertex_offset != -1 ) {
+                primitive.skin_vertex_offset = skin_vertex_offset;
+            }
+        }
+
+        scene.skin_vertices.insert( scene.skin_vertices.end(), geometry.skin_vertices.begin(),
+            geometry.skin_vertices.end() );
+        mesh.vertices.insert(
+            mesh.vertices.end(), geometry.vertices.begin(), geometry.vertices.end() );
+        mesh.indices.insert( mesh.indices.end(), geometry.indices.begin(), geometry.indices.end() );
+
+        add_stats( report.before, stats_before[i] );
+        add_stats( report.after, stats_after[i] );
+    }
+
+    report.vertices_after = mesh.vertices.size();
+
+    log::info( "[MeshOptimizer] {} primitives sharing {} geometries, {} to {} vertices. ACMR "
+               "{:.3f} to {:.3f}, ATVR {:.3f} to {:.3f}",
+        primitives.size(), groups.size(), report.vertices_before, report.vertices_after,
+        get_acmr( report.before ), get_acmr( report.after ), get_atvr( report.before ),
+        get_atvr( report.after ) );
+
+    return report;
+}
+
+} // namespace racecar::geometry::scene
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../scene/scene.hpp"
+#include "scene_mesh.hpp"
+
+#include <cstdint>
+#include <span>
+
+/// Reorders the scene's geometry for the GPU, one primitive at a time:
+///
+/// 1. Vertices that are identical in every attribute (and skin) get merged.
+/// 2. Triangles are reordered for the post-transform vertex cache (Tipsify, see "Fast Triangle
+///    Reordering for Vertex Locality and Reduced Overdraw", Sander et al. 2007).
+/// 3. The cache-friendly runs of triangles are sorted front to back by how far out they face, so
+///    the depth test rejects more of what's behind them.
+/// 4. Vertices are renumbered in the order the indices first use them, so fetches walk forward
+///    through memory.
+///
+/// Only the order changes, every primitive still draws exactly the same triangles.
+namespace racecar::geometry::scene {
+
+/// Post-transform cache size assumed everywhere, in vertices. Real hardware caches differ, but
+/// orderings that do well with a small FIFO do well with bigger ones too.
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+/// How often the vertex shader runs for an index buffer, with a FIFO cache of `VERTEX_CACHE_SIZE`.
+struct CacheStats {
+    size_t triangles = 0;
+    size_t vertices = 0; ///< Distinct vertices the indices reference.
+    size_t misses = 0; ///< Vertex shader invocations.
+};
+
+/// Average cache miss ratio, vertex shader invocations per triangle. 0.5 is the best a regular
+/// grid gets, 3 means every vertex of every triangle gets transformed.
+float get_acmr( const CacheStats& stats );
+
+/// Average transform to vertex ratio, vertex shader invocations per vertex. 1 is optimal.
+float get_atvr( const CacheStats& stats );
+
+CacheStats simulate_vertex_cache( std::span<const uint32_t> indices );
+
+struct OptimizeReport {
+    CacheStats before;
+    CacheStats after;
+
+    size_t vertices_before = 0;
+    size_t vertices_after = 0;
+};
+
+/// Rewrites `mesh.vertices`, `mesh.indices` and `scene.skin_vertices` in optimized order and
+/// updates every primitive's offsets to match. Has to run after `generate_tangents`, since
+/// vertices with different tangents can't be merged.
+OptimizeReport optimize_mesh( racecar::scene::Scene& scene, Mesh& mesh );
+
+} // namespace racecar::geometry::scene
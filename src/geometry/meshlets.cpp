@@ -0,0 +1,248 @@
+#include "meshlets.hpp"
+
+#include "../log.hpp"
+#include "../parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace racecar::geometry::scene {
+
+namespace {
+
+using racecar::scene::Primitive;
+
+/// Vertices of the triangle that aren't in meshlet `owner` yet, each counted once.
+uint32_t count_new_vertices(
+    std::span<const uint32_t> owners, uint32_t owner, std::span<const uint32_t, 3> triangle )
+{
+    uint32_t count = 0;
+
+    for ( size_t corner = 0; corner < 3; corner++ ) {
+        uint32_t vertex = triangle[corner];
+        bool seen = owners[vertex] == owner || ( corner > 0 && triangle[0] == vertex )
+            || ( corner > 1 && triangle[1] == vertex );
+
+        count += seen ? 0 : 1;
+    }
+
+    return count;
+}
+
+/// Greedily fills meshlets with the primitive's triangles in order, starting a new one whenever
+/// the next triangle would go over either limit.
+std::vector<Meshlet> build_primitive_meshlets( const Mesh& mesh, const Primitive& primitive )
+{
+    std::vector<Meshlet> meshlets;
+
+    std::span<const uint32_t> indices(
+        mesh.indices.data() + primitive.ind_offset, primitive.ind_count );
+    std::span<const Vertex> vertices( mesh.vertices.data() + primitive.vertex_offset,
+        mesh.vertices.size() - static_cast<size_t>( primitive.vertex_offset ) );
+
+    size_t num_vertices = indices.empty()
+        ? 0
+        : static_cast<size_t>( *std::max_element( indices.begin(), indices.end() ) ) + 1;
+
+    auto finish = [&]( size_t first, size_t count, uint32_t vertex_count, bool with_cone ) {
+        Meshlet meshlet
+            = compute_meshlet_bounds( vertices, indices.subspan( first, count ), with_cone );
+        meshlet.first_index
+            = static_cast<uint32_t>( static_cast<size_t>( primitive.ind_offset ) + first );
+        meshlet.index_count = static_cast<uint32_t>( count );
+        meshlet.vertex_count = vertex_count;
+
+        meshlets.push_back( meshlet );
+    };
+
+    // Anything that isn't a triangle list gets drawn whole, as one meshlet without a cone
+    if ( indices.size() % 3 != 0 ) {
+        finish( 0, indices.size(), static_cast<uint32_t>( num_vertices ), false );
+        return meshlets;
+    }
+
+    // Skinned normals move, so a bind pose cone would cull the wrong triangles
+    bool with_cone = primitive.skin_id == -1;
+
+    // Which meshlet last took each vertex, numbered from 1 so that zero means none did
+    std::vector<uint32_t> owners( num_vertices, 0 );
+    uint32_t owner = 1;
+
+    size_t first = 0;
+    uint32_t vertex_count = 0;
+
+    for ( size_t i = 0; i < indices.size(); i += 3 ) {
+        std::span<const uint32_t, 3> triangle = indices.subspan( i ).first<3>();
+        uint32_t new_vertices = count_new_vertices( owners, owner, triangle );
+
+        if ( i - first == MESHLET_MAX_TRIANGLES * 3
+            || vertex_count + new_vertices > MESHLET_MAX_VERTICES ) {
+            finish( first, i - first, vertex_count, with_cone );
+
+            first = i;
+            vertex_count = 0;
+            owner++;
+            new_vertices = count_new_vertices( owners, owner, triangle );
+        }
+
+        for ( uint32_t vertex : triangle ) {
+            owners[vertex] = owner;
+        }
+
+        vertex_count += new_vertices;
+    }
+
+    if ( first < indices.size() ) {
+        finish( first, indices.size() - first, vertex_count, with_cone );
+    }
+
+    return meshlets;
+}
+
+}
+
+Meshlet compute_meshlet_bounds(
+    std::span<const Vertex> vertices, std::span<const uint32_t> indices, bool with_cone )
+{
+    Meshlet meshlet;
+
+    if ( indices.empty() ) {
+        return meshlet;
+    }
+
+    glm::vec3 min( std::numeric_limits<float>::max() );
+    glm::vec3 max( std::numeric_limits<float>::lowest() );
+
+    for ( uint32_t index : indices ) {
+        min = glm::min( min, vertices[index].position );
+        max = glm::max( max, vertices[index].position );
+    }
+
+    // Tighter than the box's corners, the farthest vertex from the box's center
+    glm::vec3 center = ( min + max ) * 0.5f;
+    float radius = 0.f;
+
+    for ( uint32_t index : indices ) {
+        radius = std::max( radius, glm::length( vertices[index].position - center ) );
+    }
+
+    meshlet.bounds = glm::vec4( center, radius );
+    meshlet.cone_apex = center;
+
+    if ( !with_cone ) {
+        return meshlet;
+    }
+
+    // The axis is the average of the triangles' unit normals, ignoring degenerate triangles
+    std::vector<glm::vec3> normals;
+    normals.reserve( indices.size() / 3 );
+
+    glm::vec3 axis( 0.f );
+
+    for ( size_t i = 0; i + 2 < indices.size(); i += 3 ) {
+        const glm::vec3& p0 = vertices[indices[i]].position;
+        const glm::vec3& p1 = vertices[indices[i + 1]].position;
+        const glm::vec3& p2 = vertices[indices[i + 2]].position;
+
+        glm::vec3 normal = glm::cross( p1 - p0, p2 - p0 );
+        float length = glm::length( normal );
+
+        if ( length > 0.f ) {
+            normals.push_back( normal / length );
+            axis += normal / length;
+        } else {
+            normals.push_back( glm::vec3( 0.f ) );
+        }
+    }
+
+    if ( glm::length( axis ) == 0.f ) {
+        return meshlet;
+    }
+
+    axis = glm::normalize( axis );
+
+    float min_dot = 1.f;
+    for ( const glm::vec3& normal : normals ) {
+        if ( normal != glm::vec3( 0.f ) ) {
+            min_dot = std::min( min_dot, glm::dot( axis, normal ) );
+        }
+    }
+
+    if ( min_dot <= MESHLET_MIN_CONE_DOT ) {
+        return meshlet;
+    }
+
+    // Moves the apex back along the axis until it's behind every triangle's plane, so the test
+    // holds for viewers anywhere, not just far away ones
+    float max_t = 0.f;
+
+    for ( size_t t = 0; t < normals.size(); t++ ) {
+        if ( normals[t] == glm::vec3( 0.f ) ) {
+            continue;
+        }
+
+        const glm::vec3& p0 = vertices[indices[t * 3]].position;
+        float distance = glm::dot( center - p0, normals[t] );
+        max_t = std::max( max_t, distance / glm::dot( axis, normals[t] ) );
+    }
+
+    meshlet.cone_apex = center - axis * max_t;
+    meshlet.cone_axis = axis;
+    meshlet.cone_cutoff = std::sqrt( 1.f - min_dot * min_dot );
+
+    return meshlet;
+}
+
+void build_meshlets( const racecar::scene::Scene& scene, Mesh& mesh )
+{
+    std::vector<const Primitive*> primitives;
+    for ( const std::unique_ptr<racecar::scene::Node>& node : scene.nodes ) {
+        if ( node->mesh.has_value() ) {
+            for ( const Primitive& primitive : node->mesh.value()->primitives ) {
+                primitives.push_back( &primitive );
+            }
+        }
+    }
+
+    // Instances of a mesh get the same meshlets, only told apart by their draw
+    std::vector<std::vector<size_t>> groups = racecar::scene::group_by_geometry( scene );
+    std::vector<std::vector<Meshlet>> geometry_meshlets( groups.size() );
+    std::vector<size_t> draw_geometries( primitives.size() );
+
+    for ( size_t i = 0; i < groups.size(); i++ ) {
+        for ( size_t draw_index : groups[i] ) {
+            draw_geometries[draw_index] = i;
+        }
+    }
+
+    parallel::for_each( groups.size(), [&]( size_t i ) {
+        geometry_meshlets[i] = build_primitive_meshlets( mesh, *primitives[groups[i].front()] );
+    } );
+
+    mesh.meshlets.clear();
+
+    size_t num_with_cone = 0;
+    size_t num_vertices = 0;
+
+    // Still laid out in draw order, each draw's meshlets together
+    for ( size_t draw_index = 0; draw_index < primitives.size(); draw_index++ ) {
+        for ( Meshlet meshlet : geometry_meshlets[draw_geometries[draw_index]] ) {
+            num_with_cone += meshlet.cone_cutoff < 1.f ? 1 : 0;
+            num_vertices += meshlet.vertex_count;
+
+            meshlet.draw_index = static_cast<uint32_t>( draw_index );
+            mesh.meshlets.push_back( meshlet );
+        }
+    }
+
+    float count = static_cast<float>( std::max( mesh.meshlets.size(), size_t( 1 ) ) );
+    log::info( "[Meshlets] {} meshlets over {} primitives, {:.1f} triangles and {:.1f} vertices "
+               "each on average, {} with a normal cone",
+        mesh.meshlets.size(), primitives.size(),
+        static_cast<float>( mesh.indices.size() / 3 ) / count,
+        static_cast<float>( num_vertices ) / count, num_with_cone );
+}
+
+} // namespace racecar::geometry::scene
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../scene/scene.hpp"
+#include "scene_mesh.hpp"
+
+#include <cstdint>
+#include <span>
+
+/// Splits every primitive into meshlets, small runs of triangles with their own bounding sphere
+/// and normal cone, so culling can skip the parts of a primitive that can't be seen instead of all
+/// or nothing. Triangles are taken in index buffer order, which `optimize_mesh` already made
+/// spatially coherent, so each meshlet is a contiguous range of the index buffer and nothing has
+/// to be reordered.
+namespace racecar::geometry::scene {
+
+/// The limits most mesh shading hardware is happiest with, kept even though meshlets are drawn
+/// with regular indexed draws for now.
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+/// Below this, the triangles' normals spread too far apart for the cone to ever cull anything.
+constexpr float MESHLET_MIN_CONE_DOT = 0.1f;
+
+/// Bounds and cone of the triangles in `indices`, which index the primitive's vertices starting at
+/// `vertices`. `with_cone` can be false for geometry whose normals move, like skinned primitives.
+Meshlet compute_meshlet_bounds( std::span<const Vertex> vertices,
+    std::span<const uint32_t> indices, bool with_cone );
+
+/// Replaces `mesh.meshlets` with the meshlets of every primitive, in draw order. Has to run after
+/// anything that changes the indices, like `optimize_mesh`.
+void build_meshlets( const racecar::scene::Scene& scene, Mesh& mesh );
+
+} // namespace racecar::geometry::scene
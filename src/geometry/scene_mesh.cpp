@@ -3,12 +3,104 @@
 #include "../engine/imm_submit.hpp"
 #include "../log.hpp"
 
+#include <glm/packing.hpp>
+
 namespace racecar::geometry::scene {
 
+namespace {
+
+/// Maps a direction onto the octahedron and folds the lower half over, in [-1, 1]. The decode in
+/// `vertex_layout.slang` has to agree on the sign of zero.
+glm::vec2 encode_octahedral( glm::vec3 direction )
+{
+    float length = glm::abs( direction.x ) + glm::abs( direction.y ) + glm::abs( direction.z );
+    if ( length == 0.f ) {
+        return glm::vec2( 0.f );
+    }
+
+    direction /= length;
+    glm::vec2 encoded( direction.x, direction.y );
+
+    if ( direction.z < 0.f ) {
+        glm::vec2 sign( encoded.x >= 0.f ? 1.f : -1.f, encoded.y >= 0.f ? 1.f : -1.f );
+        encoded = ( 1.f - glm::abs( glm::vec2( encoded.y, encoded.x ) ) ) * sign;
+    }
+
+    return encoded;
+}
+
+CompactVertex compact_vertex( const Vertex& vertex )
+{
+    return {
+        .position = vertex.position,
+        .normal = glm::packSnorm2x16( encode_octahedral( vertex.normal ) ),
+        .tangent = glm::packSnorm2x16( encode_octahedral( glm::vec3( vertex.tangent ) ) ),
+        .uv = glm::packHalf2x16( vertex.uv ),
+    };
+}
+
+constexpr VkSpecializationMapEntry COMPACT_VERTICES_ENTRY = {
+    .constantID = COMPACT_VERTICES_CONSTANT_ID,
+    .offset = 0,
+    .size = sizeof( VkBool32 ),
+};
+
+constexpr VkBool32 FULL_VERTICES_DATA = VK_FALSE;
+constexpr VkBool32 COMPACT_VERTICES_DATA = VK_TRUE;
+
+const VkSpecializationInfo FULL_VERTICES_SPECIALIZATION = {
+    .mapEntryCount = 1,
+    .pMapEntries = &COMPACT_VERTICES_ENTRY,
+    .dataSize = sizeof( VkBool32 ),
+    .pData = &FULL_VERTICES_DATA,
+};
+
+const VkSpecializationInfo COMPACT_VERTICES_SPECIALIZATION = {
+    .mapEntryCount = 1,
+    .pMapEntries = &COMPACT_VERTICES_ENTRY,
+    .dataSize = sizeof( VkBool32 ),
+    .pData = &COMPACT_VERTICES_DATA,
+};
+
+}
+
+void set_vertex_layout( Mesh& mesh, VertexLayout layout )
+{
+    mesh.layout = layout;
+    mesh.vertex_binding_description.stride = get_vertex_stride( layout );
+
+    if ( layout == VertexLayout::FULL ) {
+        mesh.attribute_descriptions = Mesh().attribute_descriptions;
+        return;
+    }
+
+    mesh.attribute_descriptions = { {
+        { 0, vk::binding::VERTEX_BUFFER, VK_FORMAT_R32G32B32_SFLOAT,
+            offsetof( CompactVertex, position ) },
+        { 1, vk::binding::VERTEX_BUFFER, VK_FORMAT_R16G16_SNORM,
+            offsetof( CompactVertex, normal ) },
+        { 2, vk::binding::VERTEX_BUFFER, VK_FORMAT_R16G16_SNORM,
+            offsetof( CompactVertex, tangent ) },
+        { 3, vk::binding::VERTEX_BUFFER, VK_FORMAT_R16G16_SFLOAT, offsetof( CompactVertex, uv ) },
+    } };
+}
+
+uint32_t get_vertex_stride( VertexLayout layout )
+{
+    return layout == VertexLayout::COMPACT ? uint32_t( sizeof( CompactVertex ) )
+                                           : uint32_t( sizeof( Vertex ) );
+}
+
+const VkSpecializationInfo* get_vertex_layout_specialization( VertexLayout layout )
+{
+    return layout == VertexLayout::COMPACT ? &COMPACT_VERTICES_SPECIALIZATION
+                                           : &FULL_VERTICES_SPECIALIZATION;
+}
+
 GPUMeshBuffers upload_mesh( vk::Common& vulkan, const engine::State& engine,
-    std::span<uint32_t> indices, std::span<Vertex> vertices )
+    std::span<uint32_t> indices, std::span<Vertex> vertices, VertexLayout layout )
 {
-    const size_t vertex_buffer_size = vertices.size() * sizeof( Vertex );
+    const size_t vertex_buffer_size = vertices.size() * get_vertex_stride( layout );
     const size_t index_buffer_size = indices.size() * sizeof( uint32_t );
 
     GPUMeshBuffers new_mesh_buffers;
@@ -47,7 +139,14 @@ GPUMeshBuffers upload_mesh( vk::Common& vulkan, const engine::State& engine,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY );
 
     void* data = staging.info.pMappedData;
-    std::memcpy( data, vertices.data(), vertex_buffer_size );
+    if ( layout == VertexLayout::COMPACT ) {
+        CompactVertex* compact_vertices = static_cast<CompactVertex*>( data );
+        for ( size_t i = 0; i < vertices.size(); i++ ) {
+            compact_vertices[i] = compact_vertex( vertices[i] );
+        }
+    } else {
+        std::memcpy( data, vertices.data(), vertex_buffer_size );
+    }
     std::memcpy(
         static_cast<char*>( data ) + vertex_buffer_size, indices.data(), index_buffer_size );
 
@@ -73,64 +172,12 @@ GPUMeshBuffers upload_mesh( vk::Common& vulkan, const engine::State& engine,
             cmd_buf, staging.handle, new_mesh_buffers.index_buffer.handle, 1, &index_buf_copy );
     } );
 
-    return new_mesh_buffers;
-}
-
-void generate_tangents( Mesh& mesh )
-{
-    std::vector<Vertex>& vertices = mesh.vertices;
-    std::vector<uint32_t>& indices = mesh.indices;
-
-    // Shouldn't be necessary if default constructed to be 0, but do it in case
-    for ( Vertex& vertex : vertices ) {
-        vertex.tangent = glm::vec4( 0.0f );
+    if ( layout == VertexLayout::COMPACT ) {
+        log::info( "[geometry::scene] Compact vertices take {} KiB instead of {} KiB",
+            vertex_buffer_size / 1024, vertices.size() * sizeof( Vertex ) / 1024 );
     }
 
-    for ( uint32_t index = 0; index < static_cast<uint32_t>( indices.size() ); index += 3 ) {
-        uint32_t i0 = indices[index];
-        uint32_t i1 = indices[index + 1];
-        uint32_t i2 = indices[index + 2];
-
-        const glm::vec3& pos0 = vertices[i0].position;
-        const glm::vec3& pos1 = vertices[i1].position;
-        const glm::vec3& pos2 = vertices[i2].position;
-
-        const glm::vec2& uv0 = vertices[i0].uv;
-        const glm::vec2& uv1 = vertices[i1].uv;
-        const glm::vec2& uv2 = vertices[i2].uv;
-
-        // https://learnopengl.com/Advanced-Lighting/Normal-Mapping
-        glm::vec3 edge1 = pos1 - pos0;
-        glm::vec3 edge2 = pos2 - pos0;
-
-        glm::vec2 deltaUV1 = uv1 - uv0;
-        glm::vec2 deltaUV2 = uv2 - uv0;
-
-        float f = 1.0f / ( deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y );
-        glm::vec3 tangent = f * ( deltaUV2.y * edge1 - deltaUV1.y * edge2 );
-        glm::vec3 bitangent = f * ( -deltaUV2.x * edge1 + deltaUV1.x * edge2 );
-
-        float w = glm::dot( normalize( glm::cross( vertices[i0].normal, tangent ) ),
-                      normalize( bitangent ) )
-                < 0.0f
-            ? -1.0f
-            : 0.0f;
-
-        vertices[i0].tangent += glm::vec4( tangent, w );
-        vertices[i1].tangent += glm::vec4( tangent, w );
-        vertices[i2].tangent += glm::vec4( tangent, w );
-    }
-
-    for ( Vertex& vertex : vertices ) {
-        glm::vec normal = glm::normalize( vertex.normal );
-        glm::vec3 tangent
-            = glm::normalize( glm::vec3( vertex.tangent.x, vertex.tangent.y, vertex.tangent.z ) );
-        float tangent_w = vertex.tangent.w < 0.0f ? -1.0f : 1.0f;
-
-        tangent = glm::normalize( tangent - normal * glm::dot( normal, tangent ) );
-
-        vertex.tangent = glm::vec4( tangent, tangent_w );
-    }
+    return new_mesh_buffers;
 }
 
 } // namespace racecar::geometry
@@ -20,10 +20,55 @@ struct Vertex {
     glm::vec2 ids;
 };
 
+/// Vertex as `upload_mesh` writes it with `VertexLayout::COMPACT`. The position stays full
+/// precision since ray tracing, skinning and culling all read it as is. Normal and tangent are
+/// octahedral encoded into two snorm16 each and the uv is two halves. Neither the tangent's
+/// handedness nor `ids` are kept, the full layout doesn't feed them to the shaders either.
+struct CompactVertex {
+    glm::vec3 position;
+    uint32_t normal;
+    uint32_t tangent;
+    uint32_t uv;
+};
+
+static_assert( sizeof( CompactVertex ) == 24 );
+
+/// A run of one primitive's triangles that gets culled on its own, see meshlets.hpp.
+struct Meshlet {
+    /// Object-space bounding sphere: center in xyz, radius in w
+    glm::vec4 bounds = {};
+
+    /// Every triangle faces away from a viewer for whom the direction from the apex is within the
+    /// cone around the axis, i.e. `dot( normalize( apex - viewer ), axis ) >= cutoff`. A cutoff of
+    /// 1 culls nothing.
+    glm::vec3 cone_apex = {};
+    glm::vec3 cone_axis = {};
+    float cone_cutoff = 1.f;
+
+    /// Into all of `Mesh::indices`, not just the primitive's slice of it.
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    uint32_t vertex_count = 0;
+
+    /// The primitive, in the order of the scene's draws and TLAS instances.
+    uint32_t draw_index = 0;
+};
+
+/// How the vertex buffer is laid out on the GPU, the CPU side always keeps full `Vertex`es.
+enum class VertexLayout {
+    FULL,
+    COMPACT,
+};
+
+/// Specialization constant telling shaders the layout, see `vertex_layout.slang`.
+constexpr uint32_t COMPACT_VERTICES_CONSTANT_ID = 0;
+
 struct Mesh {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    std::vector<Meshlet> meshlets;
     GPUMeshBuffers mesh_buffers;
+    VertexLayout layout = VertexLayout::FULL;
 
     VkVertexInputBindingDescription vertex_binding_description = {
         .binding = vk::binding::VERTEX_BUFFER,
@@ -39,8 +84,18 @@ struct Mesh {
     } };
 };
 
+/// Switches the binding and attribute descriptions over, before any pipeline is made from them.
+void set_vertex_layout( Mesh& mesh, VertexLayout layout );
+
+uint32_t get_vertex_stride( VertexLayout layout );
+
+/// For every pipeline that reads the vertex buffer with shader code that depends on the layout.
+const VkSpecializationInfo* get_vertex_layout_specialization( VertexLayout layout );
+
+/// Vertices are encoded into `layout` on the way to the GPU.
 GPUMeshBuffers upload_mesh( vk::Common& vulkan, const engine::State& engine,
-    std::span<uint32_t> indices, std::span<Vertex> vertices );
+    std::span<uint32_t> indices, std::span<Vertex> vertices,
+    VertexLayout layout = VertexLayout::FULL );
 
 /// Should ideally run afer `scene::load_gltf` since it's just too annoying
 /// to generate tangents while geo gets loaded and processed.
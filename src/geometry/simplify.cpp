@@ -0,0 +1,482 @@
+#include "simplify.hpp"
+
+#include "../log.hpp"
+#include "../parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+// Like mesh_optimizer.cpp, this only touches CPU-side data so the baker can link it.
+
+namespace racecar::geometry::scene {
+
+namespace {
+
+using racecar::scene::Primitive;
+
+/// Collapses that tilt a remaining triangle further than this, as the cosine between its normal
+/// before and after, are skipped. Anything below zero would flip it.
+constexpr float MIN_TRIANGLE_COSINE = 0.2f;
+
+/// LODs that don't get at least this much smaller than the one before aren't worth keeping.
+constexpr float LOD_MIN_REDUCTION = 0.85f;
+
+/// Sum of weighted squared distances to planes, as the symmetric matrix A, vector b and scalar c
+/// of `pᵀAp + 2bᵀp + c`. `weight` is the total, to turn the sum into a mean.
+struct Quadric {
+    float a00 = 0.f, a11 = 0.f, a22 = 0.f;
+    float a10 = 0.f, a20 = 0.f, a21 = 0.f;
+    float b0 = 0.f, b1 = 0.f, b2 = 0.f;
+    float c = 0.f;
+    float weight = 0.f;
+};
+
+Quadric plane_quadric( glm::vec3 normal, float distance, float weight )
+{
+    return {
+        .a00 = weight * normal.x * normal.x,
+        .a11 = weight * normal.y * normal.y,
+        .a22 = weight * normal.z * normal.z,
+        .a10 = weight * normal.y * normal.x,
+        .a20 = weight * normal.z * normal.x,
+        .a21 = weight * normal.z * normal.y,
+        .b0 = weight * normal.x * distance,
+        .b1 = weight * normal.y * distance,
+        .b2 = weight * normal.z * distance,
+        .c = weight * distance * distance,
+        .weight = weight,
+    };
+}
+
+void add( Quadric& quadric, const Quadric& other )
+{
+    quadric.a00 += other.a00;
+    quadric.a11 += other.a11;
+    quadric.a22 += other.a22;
+    quadric.a10 += other.a10;
+    quadric.a20 += other.a20;
+    quadric.a21 += other.a21;
+    quadric.b0 += other.b0;
+    quadric.b1 += other.b1;
+    quadric.b2 += other.b2;
+    quadric.c += other.c;
+    quadric.weight += other.weight;
+}
+
+/// Mean squared distance from `p` to the quadric's planes.
+float evaluate( const Quadric& quadric, glm::vec3 p )
+{
+    float rx = 2.f * ( quadric.b0 + quadric.a10 * p.y ) + quadric.a00 * p.x;
+    float ry = 2.f * ( quadric.b1 + quadric.a21 * p.z ) + quadric.a11 * p.y;
+    float rz = 2.f * ( quadric.b2 + quadric.a20 * p.x ) + quadric.a22 * p.z;
+
+    float sum = quadric.c + rx * p.x + ry * p.y + rz * p.z;
+
+    return quadric.weight > 0.f ? std::abs( sum ) / quadric.weight : 0.f;
+}
+
+struct PositionHash {
+    size_t operator()( const glm::vec3& position ) const
+    {
+        std::array<uint32_t, 3> bits;
+        std::memcpy( bits.data(), &position, sizeof( bits ) );
+
+        return ( bits[0] * 73856093u ) ^ ( bits[1] * 19349663u ) ^ ( bits[2] * 83492791u );
+    }
+};
+
+/// For every vertex, the first vertex with the same position. Those stand in for the position.
+std::vector<uint32_t> find_positions( std::span<const Vertex> vertices, size_t num_vertices )
+{
+    std::vector<uint32_t> positions( num_vertices );
+    std::unordered_map<glm::vec3, uint32_t, PositionHash> first_vertices( num_vertices );
+
+    for ( uint32_t vertex = 0; vertex < static_cast<uint32_t>( num_vertices ); vertex++ ) {
+        positions[vertex] = first_vertices.try_emplace( vertices[vertex].position, vertex )
+                                .first->second;
+    }
+
+    return positions;
+}
+
+/// Vertices on a border, a non-manifold edge or an attribute seam.
+std::vector<uint8_t> find_locked(
+    std::span<const uint32_t> indices, std::span<const uint32_t> positions )
+{
+    std::vector<uint8_t> locked_positions( positions.size(), 0 );
+
+    // Vertices that share a position but nothing else, only counting the ones still in use
+    std::vector<uint32_t> wedges( positions.size(), UINT32_MAX );
+    for ( uint32_t vertex : indices ) {
+        uint32_t& wedge = wedges[positions[vertex]];
+
+        if ( wedge != UINT32_MAX && wedge != vertex ) {
+            locked_positions[positions[vertex]] = 1;
+        }
+
+        wedge = vertex;
+    }
+
+    // Edges by position, a closed manifold surface has each one exactly once in either direction
+    auto edge_key = []( uint32_t from, uint32_t to ) {
+        return ( static_cast<uint64_t>( from ) << 32 ) | to;
+    };
+
+    std::unordered_map<uint64_t, uint32_t> edges( indices.size() );
+    for ( size_t i = 0; i < indices.size(); i += 3 ) {
+        for ( size_t corner = 0; corner < 3; corner++ ) {
+            uint32_t from = positions[indices[i + corner]];
+            uint32_t to = positions[indices[i + ( corner + 1 ) % 3]];
+            edges[edge_key( from, to )]++;
+        }
+    }
+
+    for ( const auto& [key, count] : edges ) {
+        uint32_t from = static_cast<uint32_t>( key >> 32 );
+        uint32_t to = static_cast<uint32_t>( key & UINT32_MAX );
+
+        if ( count != 1 || !edges.contains( edge_key( to, from ) ) ) {
+            locked_positions[from] = 1;
+            locked_positions[to] = 1;
+        }
+    }
+
+    std::vector<uint8_t> locked( positions.size() );
+    for ( size_t vertex = 0; vertex < positions.size(); vertex++ ) {
+        locked[vertex] = locked_positions[positions[vertex]];
+    }
+
+    return locked;
+}
+
+struct Collapse {
+    uint32_t from = 0;
+    uint32_t to = 0;
+    float cost = 0.f;
+};
+
+/// Triangles around every vertex, as ranges of one flat array.
+struct Adjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    Adjacency( std::span<const uint32_t> indices, size_t num_vertices )
+        : offsets( num_vertices + 1, 0 )
+        , triangles( indices.size() )
+    {
+        for ( uint32_t vertex : indices ) {
+            offsets[vertex + 1]++;
+        }
+
+        std::partial_sum( offsets.begin(), offsets.end(), offsets.begin() );
+
+        std::vector<uint32_t> cursors( offsets.begin(), offsets.end() - 1 );
+        for ( size_t i = 0; i < indices.size(); i++ ) {
+            triangles[cursors[indices[i]]++] = static_cast<uint32_t>( i / 3 );
+        }
+    }
+
+    std::span<const uint32_t> around( uint32_t vertex ) const
+    {
+        return std::span<const uint32_t>( triangles )
+            .subspan( offsets[vertex], offsets[vertex + 1] - offsets[vertex] );
+    }
+};
+
+/// Whether moving `from` onto `to` turns any triangle that stays around too far.
+bool flips( std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+    const Adjacency& adjacency, const Collapse& collapse )
+{
+    for ( uint32_t triangle : adjacency.around( collapse.from ) ) {
+        const uint32_t* corners = &indices[triangle * 3];
+
+        // These go away entirely
+        if ( corners[0] == collapse.to || corners[1] == collapse.to
+            || corners[2] == collapse.to ) {
+            continue;
+        }
+
+        std::array<glm::vec3, 3> before;
+        std::array<glm::vec3, 3> after;
+        for ( size_t corner = 0; corner < 3; corner++ ) {
+            before[corner] = vertices[corners[corner]].position;
+            after[corner] = corners[corner] == collapse.from ? vertices[collapse.to].position
+                                                             : before[corner];
+        }
+
+        glm::vec3 normal_before = glm::cross( before[1] - before[0], before[2] - before[0] );
+        glm::vec3 normal_after = glm::cross( after[1] - after[0], after[2] - after[0] );
+
+        if ( glm::dot( normal_before, normal_after )
+            < MIN_TRIANGLE_COSINE * glm::length( normal_before ) * glm::length( normal_after ) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// Bounding sphere radius around the center of the box of every vertex `indices` reach.
+float get_radius( std::span<const Vertex> vertices, std::span<const uint32_t> indices )
+{
+    if ( indices.empty() ) {
+        return 0.f;
+    }
+
+    glm::vec3 min( std::numeric_limits<float>::max() );
+    glm::vec3 max( std::numeric_limits<float>::lowest() );
+
+    for ( uint32_t index : indices ) {
+        min = glm::min( min, vertices[index].position );
+        max = glm::max( max, vertices[index].position );
+    }
+
+    return glm::length( max - min ) * 0.5f;
+}
+
+}
+
+std::vector<uint32_t> simplify( std::span<const Vertex> vertices,
+    std::span<const uint32_t> indices, size_t target_index_count, float max_error,
+    float& out_error )
+{
+    out_error = 0.f;
+
+    std::vector<uint32_t> result( indices.begin(), indices.end() );
+    if ( indices.size() % 3 != 0 || indices.size() <= target_index_count ) {
+        return result;
+    }
+
+    size_t num_vertices
+        = static_cast<size_t>( *std::max_element( indices.begin(), indices.end() ) ) + 1;
+
+    std::vector<uint32_t> positions = find_positions( vertices, num_vertices );
+    std::vector<uint8_t> locked = find_locked( indices, positions );
+
+    // Every position gets the planes of the triangles around it, weighted by their area
+    std::vector<Quadric> quadrics( num_vertices );
+    for ( size_t i = 0; i < indices.size(); i += 3 ) {
+        const glm::vec3& p0 = vertices[indices[i]].position;
+        const glm::vec3& p1 = vertices[indices[i + 1]].position;
+        const glm::vec3& p2 = vertices[indices[i + 2]].position;
+
+        glm::vec3 normal = glm::cross( p1 - p0, p2 - p0 );
+        float area = glm::length( normal );
+        if ( area == 0.f ) {
+            continue;
+        }
+
+        normal /= area;
+        Quadric quadric = plane_quadric( normal, -glm::dot( normal, p0 ), area );
+
+        for ( size_t corner = 0; corner < 3; corner++ ) {
+            add( quadrics[positions[indices[i + corner]]], quadric );
+        }
+    }
+
+    float attribute_scale = SIMPLIFY_ATTRIBUTE_WEIGHT * get_radius( vertices, indices );
+    float attribute_weight = attribute_scale * attribute_scale;
+
+    auto get_cost = [&]( uint32_t from, uint32_t to ) {
+        Quadric quadric = quadrics[positions[from]];
+        add( quadric, quadrics[positions[to]] );
+
+        glm::vec3 normal_difference = vertices[from].normal - vertices[to].normal;
+        glm::vec2 uv_difference = vertices[from].uv - vertices[to].uv;
+
+        return evaluate( quadric, vertices[to].position )
+            + attribute_weight
+            * ( glm::dot( normal_difference, normal_difference )
+                + glm::dot( uv_difference, uv_difference ) );
+    };
+
+    float max_cost = max_error * max_error;
+    size_t target_triangles = target_index_count / 3;
+
+    std::vector<uint32_t> collapse_to( num_vertices );
+    std::vector<uint8_t> touched( num_vertices );
+
+    // Collapses are made in passes, each one only touching a vertex's neighbourhood once so the
+    // adjacency it was planned with stays valid
+    while ( result.size() / 3 > target_triangles ) {
+        Adjacency adjacency( result, num_vertices );
+
+        // Every directed edge once, from the triangle it goes around in
+        std::vector<Collapse> collapses;
+        for ( size_t i = 0; i < result.size(); i += 3 ) {
+            for ( size_t corner = 0; corner < 3; corner++ ) {
+                uint32_t from = result[i + corner];
+                uint32_t to = result[i + ( corner + 1 ) % 3];
+
+                if ( locked[from] || from == to ) {
+                    continue;
+                }
+
+                float cost = get_cost( from, to );
+                if ( cost <= max_cost ) {
+                    collapses.push_back( { .from = from, .to = to, .cost = cost } );
+                }
+            }
+        }
+
+        std::sort( collapses.begin(), collapses.end(),
+            []( const Collapse& a, const Collapse& b ) { return a.cost < b.cost; } );
+
+        std::iota( collapse_to.begin(), collapse_to.end(), 0u );
+        std::fill( touched.begin(), touched.end(), uint8_t( 0 ) );
+
+        size_t triangles_left = result.size() / 3;
+        size_t num_collapses = 0;
+
+        for ( const Collapse& collapse : collapses ) {
+            if ( triangles_left <= target_triangles ) {
+                break;
+            }
+
+            if ( touched[collapse.from] || touched[collapse.to]
+                || flips( vertices, result, adjacency, collapse ) ) {
+                continue;
+            }
+
+            collapse_to[collapse.from] = collapse.to;
+            add( quadrics[positions[collapse.to]], quadrics[positions[collapse.from]] );
+            out_error = std::max( out_error, collapse.cost );
+            num_collapses++;
+
+            for ( uint32_t triangle : adjacency.around( collapse.from ) ) {
+                bool has_to = false;
+
+                for ( size_t corner = 0; corner < 3; corner++ ) {
+                    uint32_t vertex = result[triangle * 3 + corner];
+                    touched[vertex] = 1;
+                    has_to = has_to || vertex == collapse.to;
+                }
+
+                triangles_left -= has_to ? 1 : 0;
+            }
+        }
+
+        if ( num_collapses == 0 ) {
+            break;
+        }
+
+        // Drop whatever collapsed to a line or a point
+        size_t write = 0;
+        for ( size_t i = 0; i < result.size(); i += 3 ) {
+            uint32_t a = collapse_to[result[i]];
+            uint32_t b = collapse_to[result[i + 1]];
+            uint32_t c = collapse_to[result[i + 2]];
+
+            if ( positions[a] == positions[b] || positions[b] == positions[c]
+                || positions[c] == positions[a] ) {
+                continue;
+            }
+
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+
+        result.resize( write );
+    }
+
+    out_error = std::sqrt( out_error );
+
+    return result;
+}
+
+void generate_lods( racecar::scene::Scene& scene, Mesh& mesh )
+{
+    std::vector<Primitive*> primitives;
+    for ( const std::unique_ptr<racecar::scene::Node>& node : scene.nodes ) {
+        if ( node->mesh.has_value() ) {
+            for ( Primitive& primitive : node->mesh.value()->primitives ) {
+                primitives.push_back( &primitive );
+            }
+        }
+    }
+
+    struct Level {
+        std::vector<uint32_t> indices;
+        float error = 0.f;
+    };
+
+    // Instances of a mesh share its LODs along with the rest of its geometry
+    std::vector<std::vector<size_t>> groups = racecar::scene::group_by_geometry( scene );
+    std::vector<std::vector<Level>> levels( groups.size() );
+
+    parallel::for_each( groups.size(), [&]( size_t i ) {
+        const Primitive& primitive = *primitives[groups[i].front()];
+
+        std::span<const uint32_t> indices(
+            mesh.indices.data() + primitive.ind_offset, primitive.ind_count );
+        std::span<const Vertex> vertices( mesh.vertices.data() + primitive.vertex_offset,
+            mesh.vertices.size() - static_cast<size_t>( primitive.vertex_offset ) );
+
+        if ( indices.size() % 3 != 0 || indices.size() / 3 < LOD_MIN_TRIANGLES ) {
+            return;
+        }
+
+        float max_error = LOD_MAX_ERROR * get_radius( vertices, indices );
+        size_t previous_count = indices.size();
+        float previous_error = 0.f;
+
+        // Every level starts from the full primitive, so errors don't pile up along the chain
+        while ( levels[i].size() < racecar::scene::MAX_LODS
+            && previous_count / 3 >= LOD_MIN_TRIANGLES ) {
+            size_t target_triangles
+                = static_cast<size_t>( static_cast<float>( previous_count / 3 ) * LOD_REDUCTION );
+
+            float error = 0.f;
+            std::vector<uint32_t> lod
+                = simplify( vertices, indices, target_triangles * 3, max_error, error );
+
+            if ( static_cast<float>( lod.size() )
+                > static_cast<float>( previous_count ) * LOD_MIN_REDUCTION ) {
+                break;
+            }
+
+            previous_count = lod.size();
+            previous_error = std::max( previous_error, error );
+            levels[i].push_back( { .indices = std::move( lod ), .error = previous_error } );
+        }
+    } );
+
+    size_t num_lods = 0;
+    size_t triangles_before = 0;
+    size_t triangles_after = 0;
+
+    for ( size_t i = 0; i < groups.size(); i++ ) {
+        std::vector<racecar::scene::Lod> lods;
+        size_t ind_count = primitives[groups[i].front()]->ind_count;
+
+        triangles_before += ind_count / 3;
+        triangles_after += ( levels[i].empty() ? ind_count : levels[i].back().indices.size() ) / 3;
+
+        for ( const Level& level : levels[i] ) {
+            lods.push_back( {
+                .ind_offset = static_cast<int>( mesh.indices.size() ),
+                .ind_count = level.indices.size(),
+                .error = level.error,
+            } );
+
+            mesh.indices.insert( mesh.indices.end(), level.indices.begin(), level.indices.end() );
+        }
+
+        for ( size_t draw_index : groups[i] ) {
+            primitives[draw_index]->lods = lods;
+        }
+
+        num_lods += levels[i].size();
+    }
+
+    log::info( "[Simplify] {} LODs over {} geometries, {} triangles down to {} at the coarsest",
+        num_lods, groups.size(), triangles_before, triangles_after );
+}
+
+} // namespace racecar::geometry::scene
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../scene/scene.hpp"
+#include "scene_mesh.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// Mesh simplification by edge collapses ordered by quadric error ("Surface Simplification Using
+/// Quadric Error Metrics", Garland and Heckbert 1997). Vertices only ever collapse onto one of
+/// their neighbours, so simplified index buffers keep using the original vertex buffer.
+///
+/// - Borders, and seams where a position is shared by vertices with different attributes, are
+///   locked in place so the silhouette and UV layout survive.
+/// - Normal and uv differences add to the cost of a collapse, so flat shaded and textured detail
+///   goes last.
+/// - Collapses that would flip a triangle are skipped.
+namespace racecar::geometry::scene {
+
+/// How much a difference of 1 in the normal or uv weighs, as a fraction of the primitive's radius
+/// of geometric error.
+constexpr float SIMPLIFY_ATTRIBUTE_WEIGHT = 0.1f;
+
+/// Largest error any LOD may have, as a fraction of the primitive's radius.
+constexpr float LOD_MAX_ERROR = 0.05f;
+
+/// Each LOD aims for this fraction of the triangles of the one before.
+constexpr float LOD_REDUCTION = 0.5f;
+
+/// Primitives with fewer triangles aren't worth simplifying.
+constexpr size_t LOD_MIN_TRIANGLES = 64;
+
+/// Collapses edges of `indices` until there are at most `target_index_count` indices left, or the
+/// next collapse would be off by more than `max_error`. `out_error` is the largest error of the
+/// collapses that were made, in the same units as the positions.
+std::vector<uint32_t> simplify( std::span<const Vertex> vertices,
+    std::span<const uint32_t> indices, size_t target_index_count, float max_error,
+    float& out_error );
+
+/// Fills in every primitive's `lods`, appending their indices to `mesh.indices`. Has to run after
+/// `optimize_mesh`, which rewrites the index buffer from the primitives alone.
+void generate_lods( racecar::scene::Scene& scene, Mesh& mesh );
+
+} // namespace racecar::geometry::scene
@@ -0,0 +1,394 @@
+#include "gpu_driven.hpp"
+
+#include "engine/images.hpp"
+#include "exception.hpp"
+#include "log.hpp"
+#include "vk/create.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+namespace racecar::gpu_driven {
+
+namespace {
+
+constexpr std::string_view CULL_SHADER_PATH = "../shaders/deferred/cull.spv";
+constexpr std::string_view HIZ_SHADER_PATH = "../shaders/deferred/hiz.spv";
+
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+constexpr uint32_t HIZ_GROUP_SIZE = 8;
+
+static_assert( sizeof( ub_data::DrawRecord::lod_error ) / sizeof( float ) == scene::MAX_LODS,
+    "Draw records hold every LOD a primitive can have" );
+
+/// Object-space bounding sphere of every vertex the primitive's indices reach.
+glm::vec4 compute_bounds( const geometry::scene::Mesh& mesh, const scene::Primitive& primitive )
+{
+    glm::vec3 min( std::numeric_limits<float>::max() );
+    glm::vec3 max( std::numeric_limits<float>::lowest() );
+
+    for ( size_t i = 0; i < primitive.ind_count; i++ ) {
+        uint32_t index = mesh.indices[static_cast<size_t>( primitive.ind_offset ) + i];
+        const glm::vec3& position
+            = mesh.vertices[static_cast<size_t>( primitive.vertex_offset ) + index].position;
+
+        min = glm::min( min, position );
+        max = glm::max( max, position );
+    }
+
+    if ( primitive.ind_count == 0 ) {
+        return glm::vec4( 0.f );
+    }
+
+    glm::vec3 center = ( min + max ) * 0.5f;
+    return glm::vec4( center, glm::length( max - center ) );
+}
+
+void flush( vk::Common& vulkan, const vk::mem::AllocatedBuffer& buffer )
+{
+    vmaFlushAllocation( vulkan.allocator, buffer.allocation, 0, VK_WHOLE_SIZE );
+}
+
+/// What the cull pass runs a thread for, and so the most commands it can write.
+uint32_t get_cull_count( const GpuDriven& gpu_driven )
+{
+    return gpu_driven.num_meshlets > 0 ? gpu_driven.num_meshlets : gpu_driven.num_draws;
+}
+
+}
+
+GpuDriven initialize( vk::Common& vulkan, engine::State& engine, const scene::Scene& scene,
+    const geometry::scene::Mesh& mesh, UniformBuffer<ub_data::Camera>& camera_buffer )
+{
+    GpuDriven gpu_driven;
+
+    VkShaderModule cull_shader = vk::create::shader_module( vulkan, CULL_SHADER_PATH );
+    VkShaderModule hiz_shader = vk::create::shader_module( vulkan, HIZ_SHADER_PATH );
+
+    std::vector<ub_data::DrawRecord> records;
+
+    for ( const std::unique_ptr<scene::Node>& node : scene.nodes ) {
+        if ( !node->mesh.has_value() ) {
+            continue;
+        }
+
+        for ( const scene::Primitive& primitive : node->mesh.value()->primitives ) {
+            ub_data::DrawRecord record = {
+                .bounds = compute_bounds( mesh, primitive ),
+                .index_count = static_cast<uint32_t>( primitive.ind_count ),
+                .first_index = static_cast<uint32_t>( primitive.ind_offset ),
+                .vertex_offset = primitive.vertex_offset,
+                .transform_index = static_cast<uint32_t>( primitive.node_id ),
+                .lod_count = static_cast<uint32_t>( primitive.lods.size() ),
+            };
+
+            for ( glm::length_t lod = 0; lod < static_cast<glm::length_t>( primitive.lods.size() );
+                lod++ ) {
+                const scene::Lod& primitive_lod = primitive.lods[static_cast<size_t>( lod )];
+                record.lod_first_index[lod] = static_cast<uint32_t>( primitive_lod.ind_offset );
+                record.lod_index_count[lod] = static_cast<uint32_t>( primitive_lod.ind_count );
+                record.lod_error[lod] = primitive_lod.error;
+            }
+
+            records.push_back( record );
+        }
+    }
+
+    if ( records.empty() ) {
+        throw Exception( "[GpuDriven] The scene has no primitives to draw" );
+    }
+
+    gpu_driven.num_draws = static_cast<uint32_t>( records.size() );
+    gpu_driven.num_meshlets = static_cast<uint32_t>( mesh.meshlets.size() );
+
+    {
+        size_t size = records.size() * sizeof( ub_data::DrawRecord );
+        gpu_driven.draw_records = vk::mem::create_buffer(
+            vulkan, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU );
+
+        std::memcpy( gpu_driven.draw_records.info.pMappedData, records.data(), size );
+        flush( vulkan, gpu_driven.draw_records );
+    }
+
+    {
+        // Never empty, the binding needs something behind it even when culling whole primitives
+        std::vector<ub_data::Meshlet> meshlets( std::max( mesh.meshlets.size(), size_t( 1 ) ) );
+
+        for ( size_t i = 0; i < mesh.meshlets.size(); i++ ) {
+            const geometry::scene::Meshlet& meshlet = mesh.meshlets[i];
+
+            meshlets[i] = {
+                .bounds = meshlet.bounds,
+                .cone_apex = glm::vec4( meshlet.cone_apex, 0.f ),
+                .cone_axis = glm::vec4( meshlet.cone_axis, meshlet.cone_cutoff ),
+                .first_index = meshlet.first_index,
+                .index_count = meshlet.index_count,
+                .draw_index = meshlet.draw_index,
+            };
+        }
+
+        size_t size = meshlets.size() * sizeof( ub_data::Meshlet );
+        gpu_driven.meshlets = vk::mem::create_buffer(
+            vulkan, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU );
+
+        std::memcpy( gpu_driven.meshlets.info.pMappedData, meshlets.data(), size );
+        flush( vulkan, gpu_driven.meshlets );
+    }
+
+    for ( size_t i = 0; i < engine.frame_overlap; i++ ) {
+        gpu_driven.transforms.push_back( vk::mem::create_buffer( vulkan,
+            scene.nodes.size() * sizeof( ub_data::ModelMat ), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU ) );
+
+        gpu_driven.commands.push_back( vk::mem::create_buffer( vulkan,
+            get_cull_count( gpu_driven ) * sizeof( VkDrawIndexedIndirectCommand ),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY ) );
+
+        // Zeroed by the CPU every frame, so there's no need for a pass that resets it
+        gpu_driven.draw_counts.push_back( vk::mem::create_buffer( vulkan, sizeof( uint32_t ),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU ) );
+
+        gpu_driven.cull_buffers.push_back( vk::mem::create_buffer( vulkan, sizeof( ub_data::Cull ),
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU ) );
+    }
+
+    {
+        // The power of two below the screen, so every level after the first halves evenly
+        gpu_driven.hiz_extent = {
+            .width = std::bit_floor( engine.swapchain.extent.width ),
+            .height = std::bit_floor( engine.swapchain.extent.height ),
+        };
+        uint32_t longest_side
+            = std::max( gpu_driven.hiz_extent.width, gpu_driven.hiz_extent.height );
+        gpu_driven.hiz_mip_count = static_cast<uint32_t>( std::bit_width( longest_side ) );
+
+        vk::mem::AllocatedImage hiz_image = engine::allocate_image( vulkan,
+            { gpu_driven.hiz_extent.width, gpu_driven.hiz_extent.height, 1 }, VK_FORMAT_R32_SFLOAT,
+            VK_IMAGE_TYPE_2D, gpu_driven.hiz_mip_count, 1, VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, true );
+
+        gpu_driven.hiz.images.assign( engine.frame_overlap, hiz_image );
+
+        log::info( "[GpuDriven] Hi-Z pyramid of {}×{} with {} levels", gpu_driven.hiz_extent.width,
+            gpu_driven.hiz_extent.height, gpu_driven.hiz_mip_count );
+    }
+
+    {
+        gpu_driven.draw_desc_set = engine::generate_descriptor_set( vulkan, engine,
+            {
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Draw records
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Transforms
+            },
+            VK_SHADER_STAGE_VERTEX_BIT );
+
+        engine::update_descriptor_set_const_storage_buffer(
+            vulkan, engine, gpu_driven.draw_desc_set, gpu_driven.draw_records, 0 );
+        engine::update_descriptor_set_frame_buffers( vulkan, engine, gpu_driven.draw_desc_set,
+            gpu_driven.transforms, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 );
+    }
+
+    {
+        gpu_driven.cull_desc_set = engine::generate_descriptor_set( vulkan, engine,
+            {
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, // Camera
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, // Culling settings
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Draw records
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Transforms
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Commands
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Draw counts
+                VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, // Hi-Z
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Meshlets
+            },
+            VK_SHADER_STAGE_COMPUTE_BIT );
+
+        engine::DescriptorSet& desc_set = gpu_driven.cull_desc_set;
+
+        engine::update_descriptor_set_uniform( vulkan, engine, desc_set, camera_buffer, 0 );
+        engine::update_descriptor_set_frame_buffers( vulkan, engine, desc_set,
+            gpu_driven.cull_buffers, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 );
+        engine::update_descriptor_set_const_storage_buffer(
+            vulkan, engine, desc_set, gpu_driven.draw_records, 2 );
+        engine::update_descriptor_set_frame_buffers( vulkan, engine, desc_set,
+            gpu_driven.transforms, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 );
+        engine::update_descriptor_set_frame_buffers( vulkan, engine, desc_set, gpu_driven.commands,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 );
+        engine::update_descriptor_set_frame_buffers( vulkan, engine, desc_set,
+            gpu_driven.draw_counts, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 );
+        engine::update_descriptor_set_rwimage( vulkan, engine, desc_set, gpu_driven.hiz,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 6 );
+        engine::update_descriptor_set_const_storage_buffer(
+            vulkan, engine, desc_set, gpu_driven.meshlets, 7 );
+
+        gpu_driven.cull_pipeline = engine::create_compute_pipeline( vulkan, { desc_set.layouts[0] },
+            cull_shader, gpu_driven.num_meshlets > 0 ? "cull_meshlets" : "cull" );
+    }
+
+    {
+        // The first level reads the depth image and the rest read the level before, so each set
+        // only has two of the bindings filled in. The depth gets written in `add_hiz_pass`.
+        gpu_driven.hiz_desc_sets.resize( gpu_driven.hiz_mip_count );
+
+        for ( uint32_t mip = 0; mip < gpu_driven.hiz_mip_count; mip++ ) {
+            engine::DescriptorSet& desc_set = gpu_driven.hiz_desc_sets[mip];
+
+            desc_set = engine::generate_descriptor_set( vulkan, engine,
+                {
+                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, // Depth
+                    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, // Output level
+                    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, // Previous level
+                },
+                VK_SHADER_STAGE_COMPUTE_BIT );
+
+            engine::update_descriptor_set_rwimage_mip(
+                vulkan, engine, desc_set, gpu_driven.hiz, VK_IMAGE_LAYOUT_GENERAL, 1, mip );
+
+            if ( mip > 0 ) {
+                engine::update_descriptor_set_rwimage_mip(
+                    vulkan, engine, desc_set, gpu_driven.hiz, VK_IMAGE_LAYOUT_GENERAL, 2, mip - 1 );
+            }
+        }
+
+        VkDescriptorSetLayout layout = gpu_driven.hiz_desc_sets[0].layouts[0];
+        gpu_driven.hiz_from_depth_pipeline = engine::create_compute_pipeline(
+            vulkan, { layout }, hiz_shader, "build_hiz_from_depth" );
+        gpu_driven.hiz_pipeline
+            = engine::create_compute_pipeline( vulkan, { layout }, hiz_shader, "build_hiz" );
+    }
+
+    log::info(
+        "[GpuDriven] {} draw records, {} meshlets", gpu_driven.num_draws, gpu_driven.num_meshlets );
+
+    return gpu_driven;
+}
+
+engine::IndirectDraw get_indirect_draw( const GpuDriven& gpu_driven )
+{
+    engine::IndirectDraw indirect = {
+        .command_offset = 0,
+        .count_offset = 0,
+        .max_draw_count = get_cull_count( gpu_driven ),
+    };
+
+    for ( size_t i = 0; i < gpu_driven.commands.size(); i++ ) {
+        indirect.command_buffers.push_back( gpu_driven.commands[i].handle );
+        indirect.count_buffers.push_back( gpu_driven.draw_counts[i].handle );
+    }
+
+    return indirect;
+}
+
+void add_cull_pass( GpuDriven& gpu_driven, engine::TaskList& task_list )
+{
+    uint32_t group_count = ( get_cull_count( gpu_driven ) + CULL_GROUP_SIZE - 1 ) / CULL_GROUP_SIZE;
+
+    engine::add_cs_task( task_list,
+        {
+            .pipeline = gpu_driven.cull_pipeline,
+            .descriptor_sets = { &gpu_driven.cull_desc_set },
+            .group_size = { static_cast<int>( group_count ), 1, 1 },
+            .image_uses = { { gpu_driven.hiz, engine::ImageAccess::COMPUTE_SAMPLED } },
+        } );
+
+    // The render graph only tracks images, the commands and counts need a barrier of their own.
+    // There's one for every frame's buffers since the barriers are the same each frame.
+    engine::PipelineBarrierDescriptor barrier;
+
+    for ( size_t i = 0; i < gpu_driven.commands.size(); i++ ) {
+        for ( VkBuffer buffer :
+            { gpu_driven.commands[i].handle, gpu_driven.draw_counts[i].handle } ) {
+            barrier.buffer_barriers.push_back( {
+                .buffer = buffer,
+                .src_stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .src_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                .dst_stage = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                .dst_access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+            } );
+        }
+    }
+
+    engine::add_pipeline_barrier( task_list, barrier );
+}
+
+void add_hiz_pass( GpuDriven& gpu_driven, vk::Common& vulkan, engine::State& engine,
+    engine::TaskList& task_list, const engine::RWImage& depth )
+{
+    engine::update_descriptor_set_depth_image(
+        vulkan, engine, gpu_driven.hiz_desc_sets[0], depth, 0 );
+
+    for ( uint32_t mip = 0; mip < gpu_driven.hiz_mip_count; mip++ ) {
+        uint32_t width = std::max( gpu_driven.hiz_extent.width >> mip, 1u );
+        uint32_t height = std::max( gpu_driven.hiz_extent.height >> mip, 1u );
+
+        engine::ComputeTask task = {
+            .pipeline = gpu_driven.hiz_pipeline,
+            .descriptor_sets = { &gpu_driven.hiz_desc_sets[mip] },
+            .group_size = { static_cast<int>( ( width + HIZ_GROUP_SIZE - 1 ) / HIZ_GROUP_SIZE ),
+                static_cast<int>( ( height + HIZ_GROUP_SIZE - 1 ) / HIZ_GROUP_SIZE ), 1 },
+            .image_uses = { { gpu_driven.hiz, engine::ImageAccess::COMPUTE_STORAGE_READ_WRITE } },
+        };
+
+        if ( mip == 0 ) {
+            task.pipeline = gpu_driven.hiz_from_depth_pipeline;
+            task.image_uses = {
+                { depth, engine::ImageAccess::COMPUTE_SAMPLED },
+                { gpu_driven.hiz, engine::ImageAccess::COMPUTE_STORAGE_WRITE },
+            };
+        }
+
+        engine::add_cs_task( task_list, task );
+    }
+
+    // Only the next frame's culling reads it, which comes earlier in the task list
+    engine::keep_image( task_list, gpu_driven.hiz );
+}
+
+void update( GpuDriven& gpu_driven, vk::Common& vulkan, const engine::State& engine,
+    const scene::Transforms& transforms, bool enable_frustum, bool enable_occlusion,
+    bool enable_cone, float max_lod_error )
+{
+    size_t frame_index = engine.get_frame_index();
+
+    {
+        const vk::mem::AllocatedBuffer& buffer = gpu_driven.transforms[frame_index];
+        ub_data::ModelMat* model_mats = static_cast<ub_data::ModelMat*>( buffer.info.pMappedData );
+
+        for ( size_t node_id = 0; node_id < transforms.node_ids.size(); node_id++ ) {
+            model_mats[node_id] = scene::get_model_mat( transforms, node_id );
+        }
+
+        flush( vulkan, buffer );
+    }
+
+    {
+        const vk::mem::AllocatedBuffer& buffer = gpu_driven.draw_counts[frame_index];
+        std::memset( buffer.info.pMappedData, 0, sizeof( uint32_t ) );
+        flush( vulkan, buffer );
+    }
+
+    {
+        // Until every frame in flight has built the pyramid once, it may have never been written
+        bool has_hiz = engine.rendered_frames >= engine.frame_overlap;
+
+        ub_data::Cull cull = {
+            .hiz_size = glm::vec2( gpu_driven.hiz_extent.width, gpu_driven.hiz_extent.height ),
+            .hiz_mip_count = gpu_driven.hiz_mip_count,
+            .draw_count = gpu_driven.num_draws,
+            .enable_frustum = enable_frustum ? 1u : 0u,
+            .enable_occlusion = enable_occlusion && has_hiz ? 1u : 0u,
+            .enable_cone = enable_cone ? 1u : 0u,
+            .meshlet_count = gpu_driven.num_meshlets,
+            .lod_error = max_lod_error,
+            .screen_height = static_cast<float>( engine.swapchain.extent.height ),
+        };
+
+        const vk::mem::AllocatedBuffer& buffer = gpu_driven.cull_buffers[frame_index];
+        std::memcpy( buffer.info.pMappedData, &cull, sizeof( cull ) );
+        flush( vulkan, buffer );
+    }
+}
+
+}
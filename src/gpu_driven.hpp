@@ -0,0 +1,82 @@
+#pragma once
+
+#include "engine/descriptor_set.hpp"
+#include "engine/draw_task.hpp"
+#include "engine/pipeline.hpp"
+#include "engine/rwimage.hpp"
+#include "engine/state.hpp"
+#include "engine/task_list.hpp"
+#include "engine/ub_data.hpp"
+#include "engine/uniform_buffer.hpp"
+#include "geometry/scene_mesh.hpp"
+#include "scene/scene.hpp"
+#include "scene/transforms.hpp"
+#include "vk/common.hpp"
+
+#include <vector>
+
+/// Draws the scene's primitives without a CPU-side draw call each. A compute pass tests a draw
+/// record per primitive against the frustum, and optionally against the previous frame's depth,
+/// then writes a `VkDrawIndexedIndirectCommand` for whatever is left. Materials come from the
+/// bindless set, so a pass draws all of them with a single `vkCmdDrawIndexedIndirectCount`.
+///
+/// If the mesh comes with meshlets, those get culled instead, one command each, which also lets
+/// whole clusters facing away from the camera go.
+///
+/// Primitives with LODs draw the coarsest one whose error still projects to less than a given
+/// number of pixels. Meshlets only cover the finest version, so a primitive drawn with a coarser
+/// one goes as a whole, culled with its own bounds.
+namespace racecar::gpu_driven {
+
+struct GpuDriven {
+    uint32_t num_draws = 0;
+    uint32_t num_meshlets = 0;
+
+    vk::mem::AllocatedBuffer draw_records;
+    vk::mem::AllocatedBuffer meshlets;
+
+    /// One of each per frame in flight.
+    std::vector<vk::mem::AllocatedBuffer> transforms;
+    std::vector<vk::mem::AllocatedBuffer> commands;
+    std::vector<vk::mem::AllocatedBuffer> draw_counts;
+    std::vector<vk::mem::AllocatedBuffer> cull_buffers;
+
+    /// Farthest depth of the frame before, halving every level. Unlike other images there's only
+    /// one for all frames in flight, so it's never more than a frame old.
+    engine::RWImage hiz;
+    VkExtent2D hiz_extent = {};
+    uint32_t hiz_mip_count = 0;
+
+    /// Draw records and transforms, for vertex shaders of indirect draws.
+    engine::DescriptorSet draw_desc_set;
+    engine::DescriptorSet cull_desc_set;
+    std::vector<engine::DescriptorSet> hiz_desc_sets;
+
+    engine::Pipeline cull_pipeline;
+    engine::Pipeline hiz_from_depth_pipeline;
+    engine::Pipeline hiz_pipeline;
+};
+
+/// Throws if the shaders aren't there, the scene can still be drawn one primitive at a time.
+GpuDriven initialize( vk::Common& vulkan, engine::State& engine, const scene::Scene& scene,
+    const geometry::scene::Mesh& mesh, UniformBuffer<ub_data::Camera>& camera_buffer );
+
+/// Draws the primitives that survived culling. The vertex shader has to take the draw record from
+/// the instance index, see `vs_indirect` in prepass.slang.
+engine::IndirectDraw get_indirect_draw( const GpuDriven& gpu_driven );
+
+/// Has to go before the passes drawing the commands.
+void add_cull_pass( GpuDriven& gpu_driven, engine::TaskList& task_list );
+
+/// Builds the pyramid the next frame tests occlusion against. `depth` has to be done by then.
+void add_hiz_pass( GpuDriven& gpu_driven, vk::Common& vulkan, engine::State& engine,
+    engine::TaskList& task_list, const engine::RWImage& depth );
+
+/// Copies the transforms over and resets the draw counts. Only once the frame's previous
+/// submission is done, i.e. after `engine::begin_frame`. `enable_cone` only matters for meshlets.
+/// `max_lod_error` is in pixels, 0 always draws the finest version.
+void update( GpuDriven& gpu_driven, vk::Common& vulkan, const engine::State& engine,
+    const scene::Transforms& transforms, bool enable_frustum, bool enable_occlusion,
+    bool enable_cone, float max_lod_error );
+
+}
@@ -115,8 +115,7 @@ Gui initialize( Context& ctx, const engine::State& engine )
 }
 
 void process_event( Gui& gui, const SDL_Event* event, atmosphere::Atmosphere& atms,
-    camera::OrbitCamera& camera,
-    const std::vector<UniformBuffer<ub_data::Material>>& material_buffers )
+    camera::OrbitCamera& camera, const std::vector<ub_data::Material>& materials )
 {
     // We may want to expand this function later. For now, it serves to remove any ImGui header
     // includes in non-GUI related files.
@@ -165,7 +164,7 @@ void process_event( Gui& gui, const SDL_Event* event, atmosphere::Atmosphere& at
                 if ( new_number != gui.preset.number ) {
                     log::info( "[preset] Decreased preset number to {}", new_number );
                     use_preset( gui.preset.presets[static_cast<size_t>( new_number - 1 )], gui,
-                        atms, camera, material_buffers );
+                        atms, camera, materials );
                 }
 
                 gui.preset.number = new_number;
@@ -179,7 +178,7 @@ void process_event( Gui& gui, const SDL_Event* event, atmosphere::Atmosphere& at
                 if ( new_number != gui.preset.number ) {
                     log::info( "[preset] Increased preset number to {}", new_number );
                     use_preset( gui.preset.presets[static_cast<size_t>( new_number - 1 )], gui,
-                        atms, camera, material_buffers );
+                        atms, camera, materials );
                 }
 
                 gui.preset.number = new_number;
@@ -192,7 +191,7 @@ void process_event( Gui& gui, const SDL_Event* event, atmosphere::Atmosphere& at
                 if ( size_t preset_number = preset_number_opt.value();
                     preset_number <= gui.preset.presets.size() ) {
                     const Preset& preset = gui.preset.presets[preset_number - 1];
-                    use_preset( preset, gui, atms, camera, material_buffers );
+                    use_preset( preset, gui, atms, camera, materials );
                     gui.preset.number = static_cast<int>( preset_number );
                 }
             }
@@ -204,7 +203,7 @@ void process_event( Gui& gui, const SDL_Event* event, atmosphere::Atmosphere& at
 }
 
 void update( Gui& gui, atmosphere::Atmosphere& atms, camera::OrbitCamera& camera,
-    const std::vector<UniformBuffer<ub_data::Material>>& material_buffers )
+    const std::vector<ub_data::Material>& materials )
 {
     if ( !gui.show_window ) {
         return;
@@ -218,6 +217,9 @@ void update( Gui& gui, atmosphere::Atmosphere& atms, camera::OrbitCamera& camera
         const ImGuiIO& io = ImGui::GetIO();
         float average_fps = io.Framerate;
         ImGui::Text( "FPS: %.2f (%.1f ms)", average_fps, 1.f / average_fps * 1000.f );
+        ImGui::Text( "GPU wait: %.2f ms", gui.gpu_wait_ms );
+        ImGui::Text( "Draws: %zu, binds: %zu (%zu skipped)", gui.draw_stats.draws,
+            gui.draw_stats.binds, gui.draw_stats.skipped_binds );
 
         {
             ImGui::SeparatorText( "Camera" );
@@ -284,7 +286,7 @@ void update( Gui& gui, atmosphere::Atmosphere& atms, camera::OrbitCamera& camera
                 for ( const auto& preset : gui.preset.presets ) {
                     ImGui::PushID( preset.name.c_str() );
                     if ( ImGui::Button( "Use" ) ) {
-                        use_preset( preset, gui, atms, camera, material_buffers );
+                        use_preset( preset, gui, atms, camera, materials );
                     }
                     ImGui::PopID();
 
@@ -317,6 +319,13 @@ void update( Gui& gui, atmosphere::Atmosphere& atms, camera::OrbitCamera& camera
                 ImGui::Text( "Spin speed:" );
                 ImGui::SliderFloat( "Min", &gui.demo.rotate_speed, 0, 0.05f );
 
+                ImGui::SeparatorText( "Culling" );
+                ImGui::Checkbox( "Frustum culling", &gui.culling.frustum );
+                ImGui::Checkbox( "Occlusion culling", &gui.culling.occlusion );
+                ImGui::Checkbox( "Backface cone culling", &gui.culling.cone );
+                ImGui::Checkbox( "LODs", &gui.culling.lods );
+                ImGui::SliderFloat( "LOD pixel error", &gui.culling.lod_error, 0.1f, 8.f );
+
                 ImGui::EndTabItem();
             }
 
@@ -435,8 +444,7 @@ void free()
 }
 
 void use_preset( const Preset& preset, gui::Gui& gui, atmosphere::Atmosphere& atms,
-    camera::OrbitCamera& camera,
-    const std::vector<UniformBuffer<ub_data::Material>>& material_buffers )
+    camera::OrbitCamera& camera, const std::vector<ub_data::Material>& materials )
 {
     if ( gui.preset.transition.has_value() ) {
         // Can't start another transition when one is currently happening
@@ -471,7 +479,7 @@ void use_preset( const Preset& preset, gui::Gui& gui, atmosphere::Atmosphere& at
 
         for ( const auto& preset_material : preset.materials ) {
             size_t material_idx = static_cast<size_t>( preset_material.slot );
-            ub_data::Material material = material_buffers[material_idx].get_data();
+            const ub_data::Material& material = materials[material_idx];
 
             Preset::MaterialData before_material = { .slot = preset_material.slot,
                 .data = gui::Material {
@@ -26,6 +26,11 @@ struct Gui {
 
     bool show_window = true;
 
+    /// How long the CPU sat waiting on the GPU this frame, see `engine::State::gpu_wait`.
+    float gpu_wait_ms = 0.f;
+
+    engine::DrawStats draw_stats; ///< See `engine::State::draw_stats`.
+
     struct DebugData : public Material {
         bool enable_albedo_map = false;
         bool enable_normal_map = false;
@@ -95,6 +100,18 @@ struct Gui {
         enum class Mode : int { NONE = 0, TAA } mode = Mode::TAA;
     } aa = {};
 
+    struct CullingData {
+        bool frustum = true;
+        /// Against the previous frame's depth, so things can show up a frame late.
+        bool occlusion = false;
+        /// Meshlets whose triangles all face away from the camera.
+        bool cone = true;
+        /// Draws coarser versions of primitives whose simplification error stays under
+        /// `lod_error` pixels on screen.
+        bool lods = true;
+        float lod_error = 1.f;
+    } culling = {};
+
     struct PresetData {
         std::vector<Preset> presets = load_presets();
         std::optional<PresetTransition> transition;
@@ -115,15 +132,13 @@ struct Gui {
 
 Gui initialize( Context& ctx, const engine::State& engine );
 void process_event( Gui& gui, const SDL_Event* event, atmosphere::Atmosphere& atms,
-    camera::OrbitCamera& camera,
-    const std::vector<UniformBuffer<ub_data::Material>>& material_buffers );
+    camera::OrbitCamera& camera, const std::vector<ub_data::Material>& materials );
 void update( Gui& gui, atmosphere::Atmosphere& atms, camera::OrbitCamera& camera,
-    const std::vector<UniformBuffer<ub_data::Material>>& material_buffers );
+    const std::vector<ub_data::Material>& materials );
 void free();
 
 void use_preset( const Preset& preset, gui::Gui& gui, atmosphere::Atmosphere& atms,
-    camera::OrbitCamera& camera,
-    const std::vector<UniformBuffer<ub_data::Material>>& material_buffers );
+    camera::OrbitCamera& camera, const std::vector<ub_data::Material>& materials );
 void reload_presets( gui::Gui& gui );
 
 } // namespace racecar::engine::gui
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Small fork-join helpers for CPU-side work like asset loading, plus a persistent pool for work
+/// that comes up every frame.
+namespace racecar::parallel {
+
+/// Number of threads `for_each` spreads work over, including the calling thread.
+inline size_t worker_count()
+{
+    return std::max( size_t( 1 ), static_cast<size_t>( std::thread::hardware_concurrency() ) );
+}
+
+/// Like `for_each`, but calls `fn( worker, i )` with the worker the call runs on, which is in
+/// `[0, worker_count())`. Calls with the same worker never overlap, so `fn` can use it to index
+/// per-thread state without locking.
+template <typename F> void for_each_with_worker( size_t count, F&& fn )
+{
+    size_t num_threads = std::min( worker_count(), count );
+
+    if ( num_threads <= 1 ) {
+        for ( size_t i = 0; i < count; i++ ) {
+            fn( size_t( 0 ), i );
+        }
+
+        return;
+    }
+
+    std::atomic<size_t> next = 0;
+    std::exception_ptr error = nullptr;
+    std::mutex error_mutex;
+
+    auto work = [&]( size_t worker ) {
+        for ( size_t i = next++; i < count; i = next++ ) {
+            try {
+                fn( worker, i );
+            } catch ( ... ) {
+                std::scoped_lock lock( error_mutex );
+                if ( !error ) {
+                    error = std::current_exception();
+                }
+
+                // Drain the remaining work, nothing after a failure matters.
+                next = count;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve( num_threads - 1 );
+
+    for ( size_t i = 1; i < num_threads; i++ ) {
+        threads.emplace_back( work, i );
+    }
+
+    work( 0 );
+
+    for ( std::thread& thread : threads ) {
+        thread.join();
+    }
+
+    if ( error ) {
+        std::rethrow_exception( error );
+    }
+}
+
+/// Calls `fn( i )` for every `i` in `[0, count)` across worker threads and blocks until all of
+/// them are done. Indices are handed out one at a time so uneven work balances itself out. `fn`
+/// must be safe to call concurrently for different indices. The first exception thrown by `fn` is
+/// rethrown on the calling thread after everything has joined.
+template <typename F> void for_each( size_t count, F&& fn )
+{
+    for_each_with_worker( count, [&]( size_t, size_t i ) { fn( i ); } );
+}
+
+/// Threads that stay alive between calls, for per-frame work where starting and joining threads
+/// every time would cost about as much as the work itself. Worker 0 is always the calling thread,
+/// so a pool of `size()` workers owns `size() - 1` threads. Only one thread may call
+/// `for_each_with_worker` at a time.
+class WorkerPool {
+public:
+    explicit WorkerPool( size_t num_workers = worker_count() )
+    {
+        threads.reserve( std::max( num_workers, size_t( 1 ) ) - 1 );
+
+        for ( size_t worker = 1; worker < num_workers; worker++ ) {
+            threads.emplace_back( [this, worker]() { run_worker( worker ); } );
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::scoped_lock lock( mutex );
+            stopping = true;
+        }
+
+        start_cv.notify_all();
+
+        for ( std::thread& thread : threads ) {
+            thread.join();
+        }
+    }
+
+    WorkerPool( const WorkerPool& ) = delete;
+    WorkerPool& operator=( const WorkerPool& ) = delete;
+
+    size_t size() const { return threads.size() + 1; }
+
+    /// Same contract as the free `for_each_with_worker`, with `worker` in `[0, size())`.
+    template <typename F> void for_each_with_worker( size_t count, F&& fn )
+    {
+        if ( threads.empty() || count <= 1 ) {
+            for ( size_t i = 0; i < count; i++ ) {
+                fn( size_t( 0 ), i );
+            }
+
+            return;
+        }
+
+        const std::function<void( size_t, size_t )> job_fn = std::ref( fn );
+
+        {
+            std::scoped_lock lock( mutex );
+            job = &job_fn;
+            job_count = count;
+            next = 0;
+            error = nullptr;
+            num_busy = threads.size();
+            generation++;
+        }
+
+        start_cv.notify_all();
+        work( 0 );
+
+        std::exception_ptr job_error = nullptr;
+
+        {
+            std::unique_lock lock( mutex );
+            done_cv.wait( lock, [this]() { return num_busy == 0; } );
+            job = nullptr;
+            job_error = error;
+        }
+
+        if ( job_error ) {
+            std::rethrow_exception( job_error );
+        }
+    }
+
+private:
+    void run_worker( size_t worker )
+    {
+        uint64_t seen_generation = 0;
+
+        while ( true ) {
+            {
+                std::unique_lock lock( mutex );
+                start_cv.wait(
+                    lock, [&]() { return stopping || generation != seen_generation; } );
+
+                if ( stopping ) {
+                    return;
+                }
+
+                seen_generation = generation;
+            }
+
+            work( worker );
+
+            {
+                std::scoped_lock lock( mutex );
+                if ( --num_busy == 0 ) {
+                    done_cv.notify_one();
+                }
+            }
+        }
+    }
+
+    void work( size_t worker )
+    {
+        for ( size_t i = next++; i < job_count; i = next++ ) {
+            try {
+                ( *job )( worker, i );
+            } catch ( ... ) {
+                std::scoped_lock lock( mutex );
+                if ( !error ) {
+                    error = std::current_exception();
+                }
+
+                next = job_count;
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    bool stopping = false;
+
+    /// Bumped once per `for_each_with_worker` call to wake every thread exactly once.
+    uint64_t generation = 0;
+    size_t num_busy = 0; ///< Threads that haven't finished the current generation yet.
+
+    const std::function<void( size_t, size_t )>* job = nullptr;
+    size_t job_count = 0;
+    std::atomic<size_t> next = 0;
+    std::exception_ptr error = nullptr;
+};
+
+} // namespace racecar::parallel
@@ -6,12 +6,16 @@
 #define ENABLE_VOLUMETRICS 1
 #define ENABLE_TERRAIN 1
 #define ENABLE_DEFERRED_AA 1
+#define ENABLE_GPU_DRIVEN_DRAWS 1
+#define ENABLE_COMPACT_VERTICES 1
+#define ENABLE_MESHLETS 1
 
 #include "atmosphere.hpp"
 #include "atmosphere_baker.hpp"
 #include "constants.hpp"
 #include "context.hpp"
 #include "deferred.hpp"
+#include "engine/bindless.hpp"
 #include "engine/descriptor_set.hpp"
 #include "engine/execute.hpp"
 #include "engine/images.hpp"
@@ -21,12 +25,23 @@
 #include "engine/prepass.hpp"
 #include "engine/state.hpp"
 #include "engine/task_list.hpp"
+#include "engine/transient.hpp"
 #include "engine/uniform_buffer.hpp"
+#include "engine/uniform_ring.hpp"
+#include "geometry/mesh_optimizer.hpp"
+#include "geometry/meshlets.hpp"
 #include "geometry/procedural.hpp"
 #include "geometry/quad.hpp"
+#include "geometry/simplify.hpp"
+#include "gpu_driven.hpp"
 #include "gui.hpp"
+#include "rt_scene.hpp"
+#include "scene/animation.hpp"
 #include "scene/scene.hpp"
+#include "scene/scene_cache.hpp"
+#include "scene/transforms.hpp"
 #include "sdl.hpp"
+#include "skinning.hpp"
 #include "vk/create.hpp"
 
 #if ENABLE_TERRAIN
@@ -62,6 +77,11 @@ constexpr std::string_view BRDF_LUT_PATH = "../assets/LUT/brdf.png";
 constexpr std::string_view DEPTH_PREPASS_SHADER_MODULE_PATH
     = "../shaders/deferred/depth_prepass.spv";
 
+constexpr std::string_view SHADER_INDIRECT_MODULE_PATH
+    = "../shaders/deferred/prepass_indirect.spv";
+constexpr std::string_view DEPTH_PREPASS_INDIRECT_SHADER_MODULE_PATH
+    = "../shaders/deferred/depth_prepass_indirect.spv";
+
 }
 
 std::unordered_map<std::string, std::array<glm::vec2, 2>> wheel_centers = {
@@ -95,11 +115,37 @@ void run( bool use_fullscreen )
     // SCENE LOADING/PROCESSING
     scene::Scene scene;
     geometry::scene::Mesh scene_mesh;
-    scene::load_gltf(
-        ctx.vulkan, engine, GLTF_FILE_PATH, scene, scene_mesh.vertices, scene_mesh.indices );
-    geometry::scene::generate_tangents( scene_mesh );
+    std::filesystem::path scene_cache_path = scene::scene_cache_path( GLTF_FILE_PATH );
+
+    // Prefer the baked cache (see racecar-bake), it skips glTF parsing, image decoding, tangent
+    // generation, mesh optimization and LOD generation entirely.
+    if ( std::optional<scene::SceneCache> scene_cache
+        = scene::open_scene_cache( scene_cache_path, GLTF_FILE_PATH ) ) {
+        scene::load_scene_cache( ctx.vulkan, engine, scene_cache.value(), scene,
+            scene_mesh.vertices, scene_mesh.indices );
+    } else {
+        log::info( "[main] No baked scene at \"{}\", loading the glTF directly",
+            scene_cache_path.string() );
+        scene::load_gltf(
+            ctx.vulkan, engine, GLTF_FILE_PATH, scene, scene_mesh.vertices, scene_mesh.indices );
+        geometry::scene::generate_tangents( scene_mesh );
+        geometry::scene::optimize_mesh( scene, scene_mesh );
+        geometry::scene::generate_lods( scene, scene_mesh );
+    }
+
+#if ENABLE_COMPACT_VERTICES
+    geometry::scene::set_vertex_layout( scene_mesh, geometry::scene::VertexLayout::COMPACT );
+#endif
+
     scene_mesh.mesh_buffers = geometry::scene::upload_mesh(
-        ctx.vulkan, engine, scene_mesh.indices, scene_mesh.vertices );
+        ctx.vulkan, engine, scene_mesh.indices, scene_mesh.vertices, scene_mesh.layout );
+    const VkSpecializationInfo* vertex_layout_specialization
+        = geometry::scene::get_vertex_layout_specialization( scene_mesh.layout );
+
+#if ENABLE_MESHLETS
+    // GPU-driven draws cull these instead of whole primitives
+    geometry::scene::build_meshlets( scene, scene_mesh );
+#endif
 
     UniformBuffer camera_buffer = create_uniform_buffer<ub_data::Camera>(
         ctx.vulkan, {}, static_cast<size_t>( engine.frame_overlap ) );
@@ -163,31 +209,23 @@ void run( bool use_fullscreen )
             ctx.vulkan, engine, sampler_desc_set, point_sampler, 1 );
     }
 
+    // Every texture and material goes into one bindless set, shared by everything that draws the
+    // scene. The materials are kept here and copied over every frame, so they can be edited.
     size_t num_materials = scene.materials.size();
-    std::vector<engine::DescriptorSet> material_desc_sets( num_materials );
-    std::vector<UniformBuffer<ub_data::Material>> material_uniform_buffers( num_materials );
+    std::vector<ub_data::Material> materials( num_materials );
 
     for ( size_t i = 0; i < num_materials; i++ ) {
-        // Generate a separate texture descriptor set for each of the materials
-        material_desc_sets[i] = engine::generate_descriptor_set( ctx.vulkan, engine,
-            {
-                VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            },
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT );
-
         scene::Material& mat = scene.materials[i];
 
-        UniformBuffer material_buffer = create_uniform_buffer<ub_data::Material>(
-            ctx.vulkan, {}, static_cast<size_t>( engine.frame_overlap ) );
-        ub_data::Material material_ub = {
-            .has_base_color_texture = mat.base_color_texture_index.has_value() ? 1 : 0,
-            .has_metallic_roughness_texture
-            = mat.metallic_roughness_texture_index.has_value() ? 1 : 0,
-            .has_normal_texture = mat.normal_texture_index.has_value() ? 1 : 0,
-            .has_emmisive_texture = mat.emmisive_texture_index.has_value() ? 1 : 0,
+        if ( mat.type != scene::MaterialType::PBR_ALBEDO_MAP ) {
+            throw Exception( "[main_gfx_task] Unhandled material type" );
+        }
+
+        materials[i] = {
+            .base_color_texture_index = mat.base_color_texture_index.value_or( -1 ),
+            .metallic_roughness_texture_index = mat.metallic_roughness_texture_index.value_or( -1 ),
+            .normal_texture_index = mat.normal_texture_index.value_or( -1 ),
+            .emissive_texture_index = mat.emmisive_texture_index.value_or( -1 ),
 
             .base_color = glm::vec4( mat.base_color, 1.0 ),
 
@@ -210,42 +248,44 @@ void run( bool use_fullscreen )
             .emissive = mat.emissive,
             .unlit = mat.unlit,
         };
-
-        material_buffer.set_data( material_ub );
-        material_buffer.update( ctx.vulkan, engine.get_frame_index() );
-
-        engine::update_descriptor_set_uniform(
-            ctx.vulkan, engine, material_desc_sets[i], material_buffer, 3 );
-        material_uniform_buffers[i] = std::move( material_buffer );
     }
 
-    size_t num_nodes = scene.nodes.size();
-    std::vector<engine::DescriptorSet> model_mat_desc_sets( num_nodes );
-    std::vector<UniformBuffer<ub_data::ModelMat>> model_mat_uniform_buffers( num_nodes );
+    engine::Bindless bindless;
+    {
+        std::vector<std::optional<vk::mem::AllocatedImage>> textures;
 
-    for ( size_t i = 0; i < num_nodes; i++ ) {
-        model_mat_desc_sets[i] = engine::generate_descriptor_set(
-            ctx.vulkan, engine, { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }, VK_SHADER_STAGE_VERTEX_BIT );
-
-        scene::Node* node = scene.nodes[i].get();
-        glm::mat4 transform = node->transform;
-        while ( node->parent != nullptr ) {
-            node = node->parent;
-            transform = node->transform * transform;
+        for ( const scene::Texture& texture : scene.textures ) {
+            textures.push_back( texture.data );
         }
 
-        UniformBuffer model_mat_buffer = create_uniform_buffer<ub_data::ModelMat>(
-            ctx.vulkan, {}, static_cast<size_t>( engine.frame_overlap ) );
+        bindless = engine::create_bindless( ctx.vulkan, engine, textures, num_materials );
+    }
 
-        ub_data::ModelMat model_mat_ub = { .model_mat = transform,
-            .inv_model_mat = glm::inverse( transform ),
-            .prev_model_mat = transform };
-        model_mat_buffer.set_data( model_mat_ub );
-        model_mat_buffer.update( ctx.vulkan, engine.get_frame_index() );
+    // Every node's model matrix is suballocated from one ring and bound through one set, with the
+    // node's offset as the draw's dynamic offset. Whatever changed is written and flushed once a
+    // frame, see `scene::upload_transforms`.
+    size_t num_nodes = scene.nodes.size();
+    scene::Transforms node_transforms = scene::create_transforms( scene, engine.frame_overlap );
+    std::vector<uint32_t> model_mat_offsets( num_nodes );
+
+    // Scenes with animations play the first one, otherwise the wheels get spun by hand below
+    std::optional<scene::AnimationPlayer> animation_player;
+    if ( !scene.animations.empty() ) {
+        animation_player = scene::create_animation_player( scene, 0 );
+        log::info( "[main] Playing animation \"{}\" of {}", scene.animations[0].name,
+            scene.animations.size() );
+    }
 
-        engine::update_descriptor_set_uniform(
-            ctx.vulkan, engine, model_mat_desc_sets[i], model_mat_buffer, 0 );
-        model_mat_uniform_buffers[i] = std::move( model_mat_buffer );
+    engine::UniformRing object_uniforms
+        = engine::create_uniform_ring( ctx.vulkan, engine, sizeof( ub_data::ModelMat ), num_nodes );
+    engine::DescriptorSet model_mat_desc_set = engine::generate_descriptor_set( ctx.vulkan, engine,
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC }, VK_SHADER_STAGE_VERTEX_BIT );
+    engine::update_descriptor_set_uniform_ring(
+        ctx.vulkan, engine, model_mat_desc_set, object_uniforms, sizeof( ub_data::ModelMat ), 0 );
+
+    for ( size_t i = 0; i < num_nodes; i++ ) {
+        model_mat_offsets[i]
+            = engine::allocate_uniform( object_uniforms, sizeof( ub_data::ModelMat ) );
     }
 
     engine::DescriptorSet lut_sets;
@@ -294,35 +334,87 @@ void run( bool use_fullscreen )
 
     engine::Pipeline scene_pipeline;
 
+    std::vector<VkFormat> gbuffer_formats = {
+        VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // POSITION
+        VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // NORMAL
+        VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // TANGENT
+        VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // UV
+        VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // ALBEDO
+        VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // PACKED DATA (metallic, roughness, clearcoat
+                                                 // roughness, clearcoat weight)
+        VkFormat::VK_FORMAT_R16G16_SFLOAT, // VELOCITY
+    };
+
     try {
         size_t frame_index = engine.get_frame_index();
         scene_pipeline = create_gfx_pipeline( engine, ctx.vulkan,
             engine::get_vertex_input_state_create_info( scene_mesh ),
             {
                 uniform_desc_set.layouts[frame_index],
-                material_desc_sets[0].layouts[frame_index],
-                model_mat_desc_sets[0].layouts[frame_index],
+                bindless.desc_set.layouts[frame_index],
+                model_mat_desc_set.layouts[frame_index],
                 lut_sets.layouts[frame_index],
                 sampler_desc_set.layouts[frame_index],
             },
-            {
-                VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // POSITION
-                VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // NORMAL
-                VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // TANGENT
-                VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // UV
-                VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // ALBEDO
-                VkFormat::VK_FORMAT_R16G16B16A16_SFLOAT, // PACKED DATA (metallic, roughness,
-                                                         // clearcoat roughness, clearcoat
-                                                         // weight)
-                VkFormat::VK_FORMAT_R16G16_SFLOAT, // VELOCITY
-            },
-            VK_SAMPLE_COUNT_1_BIT, false, true,
-            vk::create::shader_module( ctx.vulkan, SHADER_MODULE_PATH ), false );
+            gbuffer_formats, VK_SAMPLE_COUNT_1_BIT, false, true,
+            vk::create::shader_module( ctx.vulkan, SHADER_MODULE_PATH ), false,
+            engine::VERTEX_ENTRY_NAME, vertex_layout_specialization );
     } catch ( const Exception& ex ) {
         log::error( "Failed to create graphics pipeline: {}", ex.what() );
         throw;
     }
 
+    // GPU-DRIVEN DRAWS
+    // Culls the scene's primitives in a compute pass and draws the survivors with one indirect
+    // draw. Without the shaders for it, every primitive gets its own draw instead.
+    std::optional<gpu_driven::GpuDriven> gpu_driven_draws;
+    engine::Pipeline scene_indirect_pipeline;
+    engine::Pipeline depth_ms_indirect_pipeline;
+
+#if ENABLE_GPU_DRIVEN_DRAWS
+    try {
+        gpu_driven_draws.emplace(
+            gpu_driven::initialize( ctx.vulkan, engine, scene, scene_mesh, camera_buffer ) );
+
+        size_t frame_index = engine.get_frame_index();
+        VkDescriptorSetLayout draw_layout = gpu_driven_draws->draw_desc_set.layouts[frame_index];
+
+        scene_indirect_pipeline = create_gfx_pipeline( engine, ctx.vulkan,
+            engine::get_vertex_input_state_create_info( scene_mesh ),
+            {
+                uniform_desc_set.layouts[frame_index],
+                bindless.desc_set.layouts[frame_index],
+                model_mat_desc_set.layouts[frame_index],
+                lut_sets.layouts[frame_index],
+                sampler_desc_set.layouts[frame_index],
+                draw_layout,
+            },
+            gbuffer_formats, VK_SAMPLE_COUNT_1_BIT, false, true,
+            vk::create::shader_module( ctx.vulkan, SHADER_INDIRECT_MODULE_PATH ), false,
+            "vs_indirect", vertex_layout_specialization );
+
+        depth_ms_indirect_pipeline = create_gfx_pipeline( engine, ctx.vulkan,
+            engine::get_vertex_input_state_create_info( scene_mesh ),
+            { depth_uniform_desc_set.layouts[frame_index], draw_layout }, {},
+            VK_SAMPLE_COUNT_4_BIT, false, true,
+            vk::create::shader_module( ctx.vulkan, DEPTH_PREPASS_INDIRECT_SHADER_MODULE_PATH ),
+            false, "vs_indirect" );
+    } catch ( const Exception& ex ) {
+        log::warn( "[main] Drawing the scene one primitive at a time: {}", ex.what() );
+        gpu_driven_draws.reset();
+    }
+#endif
+
+    // SKINNING
+    // Poses skinned primitives in the scene's vertex buffer before anything reads it.
+    std::optional<skinning::Skinning> skinned_meshes;
+
+    try {
+        skinned_meshes = skinning::initialize( ctx.vulkan, engine, scene, scene_mesh );
+    } catch ( const Exception& ex ) {
+        log::warn( "[main] Skinned meshes stay in their bind pose: {}", ex.what() );
+    }
+
     geometry::quad::Mesh quad_mesh = geometry::quad::create( ctx.vulkan, engine );
 
     log::info( "[main] pre atmo3!" );
@@ -338,6 +430,7 @@ void run( bool use_fullscreen )
         .color_attachments = {},
         .depth_image = gbuffers.GBuffer_DepthMS,
         .extent = engine.swapchain.extent,
+        .sort_draws = true,
     };
 
     engine::DepthPrepassMS depth_prepass_ms = {
@@ -348,17 +441,17 @@ void run( bool use_fullscreen )
 
 #if ENABLE_DEFERRED_AA
     // Render to an offscreen image, this is what we'll present to the swapchain.
-    engine::RWImage screen_color = engine::create_rwimage( ctx.vulkan, engine,
+    engine::RWImage screen_color = engine::create_transient_rwimage( ctx.vulkan, engine,
         { engine.swapchain.extent.width, engine.swapchain.extent.height, 1 },
-        VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT,
         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
             | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT );
 
     // Buffer needed, this is what the final compute pass will write to.
     // We will later copy the results of this back to `screen_color`, and blit it to the swapchain.
-    engine::RWImage screen_buffer = engine::create_rwimage( ctx.vulkan, engine,
+    engine::RWImage screen_buffer = engine::create_transient_rwimage( ctx.vulkan, engine,
         { engine.swapchain.extent.width, engine.swapchain.extent.height, 1 },
-        VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT,
         VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT );
 
     // Store the last-rendered image here!
@@ -475,6 +568,7 @@ void run( bool use_fullscreen )
         .color_attachments = deferred::get_color_attachments( gbuffers ),
         .depth_image = deferred::get_depth_image( gbuffers ),
         .extent = engine.swapchain.extent,
+        .sort_draws = true,
     };
 
     // INITIAL PRECOMPUTE CMDBUFFER
@@ -484,171 +578,123 @@ void run( bool use_fullscreen )
         "Failed to create precompute fence" );
     VkCommandBufferBeginInfo command_buffer_begin_info
         = vk::create::command_buffer_begin_info( VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT );
-    vkResetCommandBuffer( engine.frames[0].start_cmdbuf, 0 );
+    vkResetCommandBuffer( engine.frames[0].cmdbuf, 0 );
     vkResetFences( ctx.vulkan.device, 1, &precompute_fence );
-    vkBeginCommandBuffer( engine.frames[0].start_cmdbuf, &command_buffer_begin_info );
-
-    int num_blas = 0;
-    ub_data::BLASOffsets blas_offsets {};
-
-    std::vector<vk::mem::AllocatedImage> albedo_textures;
-    std::vector<vk::mem::AllocatedImage> metallic_roughness_textures;
-
-    ub_data::RTTextureUniform rt_texture_uniform;
+    vkBeginCommandBuffer( engine.frames[0].cmdbuf, &command_buffer_begin_info );
 
-    std::vector<glm::mat4> transforms;
+    std::vector<ub_data::Instance> instances;
 
     for ( const std::unique_ptr<scene::Node>& node : scene.nodes ) {
         if ( node->mesh.has_value() ) {
             const std::unique_ptr<scene::Mesh>& mesh = node->mesh.value();
 
             for ( const scene::Primitive& prim : mesh->primitives ) {
-                const scene::Material& current_material
-                    = scene.materials[static_cast<size_t>( prim.material_id )];
-                std::vector<std::optional<scene::Texture>> textures_needed;
-
-                switch ( current_material.type ) {
-                case scene::MaterialType::PBR_ALBEDO_MAP: {
-                    std::optional<int> albedo_index = current_material.base_color_texture_index;
-                    std::optional<int> normal_index = current_material.normal_texture_index;
-                    std::optional<int> metallic_roughness_index
-                        = current_material.metallic_roughness_texture_index;
-
-                    textures_needed.push_back( albedo_index
-                            ? std::optional { (
-                                  scene.textures[static_cast<size_t>( albedo_index.value() )] ) }
-                            : std::nullopt );
-                    textures_needed.push_back( normal_index
-                            ? std::optional { (
-                                  scene.textures[static_cast<size_t>( normal_index.value() )] ) }
-                            : std::nullopt );
-                    textures_needed.push_back( metallic_roughness_index
-                            ? std::optional { ( scene.textures[static_cast<size_t>(
-                                  metallic_roughness_index.value() )] ) }
-                            : std::nullopt );
-
-                    if ( albedo_index ) {
-                        albedo_textures.push_back(
-                            scene.textures[static_cast<size_t>( albedo_index.value() )]
-                                .data.value() );
-                        rt_texture_uniform.albedo_texture_index[num_blas]
-                            = int( albedo_textures.size() - 1 );
-                    } else {
-                        rt_texture_uniform.albedo_texture_index[num_blas] = -1;
-                        rt_texture_uniform.base_color[num_blas]
-                            = glm::vec4( current_material.base_color, 1.0 );
-                    }
-
-                    if ( metallic_roughness_index ) {
-                        metallic_roughness_textures.push_back(
-                            scene.textures[static_cast<size_t>( metallic_roughness_index.value() )]
-                                .data.value() );
-                        rt_texture_uniform.metallic_roughness_texture_index[num_blas]
-                            = int( metallic_roughness_textures.size() - 1 );
-                    } else {
-                        rt_texture_uniform.metallic_roughness_texture_index[num_blas] = -1;
-                        rt_texture_uniform.metallic[num_blas] = current_material.metallic;
-                        rt_texture_uniform.roughness[num_blas] = current_material.roughness;
-                    }
-
-                    break;
-                }
-
-                default:
-                    throw Exception( "[main_gfx_task] Unhandled material type" );
-                }
-
-                // TODO: Not yet connected with a layout
-                if ( scene.hdri_index.has_value() ) {
-                    textures_needed.push_back( scene.textures[scene.hdri_index.value()] );
-                } else {
-                    textures_needed.push_back( std::nullopt );
-                }
-
-                std::vector<vk::mem::AllocatedImage> textures_sent;
-
-                for ( std::optional<scene::Texture>& texture : textures_needed ) {
-                    if ( texture && ( textures_sent.size() < vk::binding::MAX_IMAGES_BINDED ) ) {
-                        textures_sent.push_back( texture->data.value() );
-                    }
-                }
-
-                // Actually bind the texture handle to the descriptorset
-                for ( size_t i = 0; i < textures_sent.size(); i++ ) {
-                    engine::update_descriptor_set_image( ctx.vulkan, engine,
-                        material_desc_sets[static_cast<size_t>( prim.material_id )],
-                        textures_sent[i], static_cast<int>( i ) );
-                }
-
                 engine::DrawResourceDescriptor draw_descriptor
                     = engine::DrawResourceDescriptor::from_mesh(
                         scene_mesh.mesh_buffers.vertex_buffer.handle,
                         scene_mesh.mesh_buffers.index_buffer.handle,
                         static_cast<uint32_t>( scene_mesh.indices.size() ), prim );
 
-                // give the material descriptor set to the draw task
-                prepass_gfx_task.draw_tasks.push_back( {
+                // The shaders find the primitive's material through its instance
+                draw_descriptor.first_instance = static_cast<uint32_t>( instances.size() );
+                instances.push_back( {
+                    .vertex_offset = uint32_t( draw_descriptor.vertex_offset ),
+                    .index_offset = uint32_t( draw_descriptor.index_offset ),
+                    .material_index = static_cast<uint32_t>( prim.material_id ),
+                } );
+
+                if ( !gpu_driven_draws ) {
+                    prepass_gfx_task.draw_tasks.push_back( {
                         .draw_resource_descriptor = draw_descriptor,
                         .descriptor_sets = {
                             &uniform_desc_set,
-                            &material_desc_sets[static_cast<size_t>( prim.material_id )],
-                            &model_mat_desc_sets[static_cast<size_t>(prim.node_id)],
+                            &bindless.desc_set,
+                            &model_mat_desc_set,
                             &lut_sets,
                             &sampler_desc_set,
                         },
+                        .dynamic_offsets
+                        = { model_mat_offsets[static_cast<size_t>( prim.node_id )] },
                         .pipeline = scene_pipeline,
                     } );
-                depth_ms_gfx_task.draw_tasks.push_back( {
-                    .draw_resource_descriptor = draw_descriptor,
-                    .descriptor_sets = { &depth_uniform_desc_set },
-                    .pipeline = depth_ms_pipeline,
-                } );
-
-                uint32_t max_idx = 0;
-                for ( size_t x = 0; x < prim.ind_count; x++ ) {
-                    size_t offset_x = x + size_t( prim.ind_offset );
-                    uint32_t idx = scene_mesh.indices[offset_x];
-                    max_idx = glm::max( max_idx, idx );
+                    depth_ms_gfx_task.draw_tasks.push_back( {
+                        .draw_resource_descriptor = draw_descriptor,
+                        .descriptor_sets = { &depth_uniform_desc_set },
+                        .pipeline = depth_ms_pipeline,
+                    } );
                 }
-                transforms.push_back( model_mat_uniform_buffers[static_cast<size_t>( prim.node_id )]
-                        .get_data()
-                        .model_mat );
-                engine.blas.push_back( vk::rt::build_blas( ctx.vulkan.device, ctx.vulkan.allocator,
-                    ctx.vulkan.ray_tracing_properties,
-                    { .vertex_buffer = scene_mesh.mesh_buffers.vertex_buffer.handle,
-                        .index_buffer = scene_mesh.mesh_buffers.index_buffer.handle,
-                        .max_vertex = uint32_t( max_idx ) - 1,
-                        .index_count = uint32_t( draw_descriptor.index_count ),
-                        .vertex_offset = uint32_t( draw_descriptor.vertex_offset ),
-                        .index_offset = uint32_t( draw_descriptor.index_offset ),
-                        .vertex_stride = sizeof( geometry::scene::Vertex ) },
-                    engine.frames[0].start_cmdbuf, ctx.vulkan.destructor_stack ) );
-
-                blas_offsets.vertex_buffer_offset[num_blas]
-                    = uint32_t( draw_descriptor.vertex_offset );
-                blas_offsets.index_buffer_offset[num_blas]
-                    = uint32_t( draw_descriptor.index_offset );
-
-                num_blas++;
             }
         }
     }
 
-    std::vector<vk::rt::Object> objects;
-    for ( size_t i = 0; i < engine.blas.size(); i++ ) {
-        auto& blas = engine.blas[i];
-        objects.push_back( vk::rt::Object { .blas = &blas, .transform = transforms[i] } );
-    }
+    engine::update_bindless_instances( ctx.vulkan, engine, bindless, instances );
+
+    geometry::Terrain test_terrain;
+    geometry::initialize_terrain( ctx.vulkan, engine, test_terrain );
+
+    // Refittable for when the terrain gets displaced on the GPU, see vk::rt::update_blas
+    test_terrain.blas = vk::rt::create_dynamic_blas( ctx.vulkan,
+        { .vertex_buffer = test_terrain.tri_buffers.vertex_buffer.handle,
+            .index_buffer = test_terrain.tri_buffers.index_buffer.handle,
+            .max_vertex = uint32_t( test_terrain.vertices.size() ) - 1,
+            .index_count = uint32_t( test_terrain.tri_indices.size() ),
+            .vertex_offset = uint32_t( 0 ),
+            .index_offset = uint32_t( 0 ),
+            .vertex_stride = sizeof( geometry::TerrainVertex ) },
+        engine.frames[0].cmdbuf );
 
-    engine.tlas = vk::rt::build_tlas( ctx.vulkan.device, ctx.vulkan.allocator,
-        ctx.vulkan.ray_tracing_properties, objects, engine.frames[0].start_cmdbuf,
-        ctx.vulkan.destructor_stack );
+    rt_scene::ExtraInstance terrain_instance = {
+        .blas_address = test_terrain.blas.blas.device_address,
+        .mask = rt_scene::TERRAIN_INSTANCE_MASK,
+    };
+    rt_scene::RtScene ray_traced_scene = rt_scene::initialize( ctx.vulkan, engine, scene,
+        scene_mesh, node_transforms, { &terrain_instance, 1 }, engine.frames[0].cmdbuf );
 
     engine::DescriptorSet as_desc_set = engine::generate_descriptor_set( ctx.vulkan, engine,
         { VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR },
         VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_FRAGMENT_BIT
             | VK_SHADER_STAGE_COMPUTE_BIT );
 
+    if ( gpu_driven_draws ) {
+        engine::DrawResourceDescriptor draw_descriptor = engine::DrawResourceDescriptor::from_mesh(
+            scene_mesh.mesh_buffers.vertex_buffer.handle,
+            scene_mesh.mesh_buffers.index_buffer.handle,
+            static_cast<uint32_t>( scene_mesh.indices.size() ), std::nullopt );
+
+        engine::IndirectDraw indirect = gpu_driven::get_indirect_draw( *gpu_driven_draws );
+
+        // vs_indirect takes the transforms from the draw records, the model matrix set is only
+        // there to keep the set numbers the same as the per-primitive pipeline
+        prepass_gfx_task.draw_tasks.push_back( {
+            .draw_resource_descriptor = draw_descriptor,
+            .descriptor_sets = {
+                &uniform_desc_set,
+                &bindless.desc_set,
+                &model_mat_desc_set,
+                &lut_sets,
+                &sampler_desc_set,
+                &gpu_driven_draws->draw_desc_set,
+            },
+            .dynamic_offsets = { 0 },
+            .pipeline = scene_indirect_pipeline,
+            .indirect = indirect,
+        } );
+        depth_ms_gfx_task.draw_tasks.push_back( {
+            .draw_resource_descriptor = draw_descriptor,
+            .descriptor_sets = { &depth_uniform_desc_set, &gpu_driven_draws->draw_desc_set },
+            .pipeline = depth_ms_indirect_pipeline,
+            .indirect = indirect,
+        } );
+
+        gpu_driven::add_cull_pass( *gpu_driven_draws, task_list );
+    }
+
+    if ( skinned_meshes ) {
+        skinning::add_skinning_pass( *skinned_meshes, task_list );
+    }
+
+    rt_scene::add_tlas_pass( ray_traced_scene, engine, task_list );
+
     engine::add_gfx_task( task_list, prepass_gfx_task );
 
 #if ENABLE_TERRAIN
@@ -660,136 +706,54 @@ void run( bool use_fullscreen )
         &glint_noise,
     };
 
-    geometry::Terrain test_terrain;
-    geometry::initialize_terrain( ctx.vulkan, engine, test_terrain );
     geometry::draw_terrain_prepass(
         test_terrain, ctx.vulkan, engine, prepass_terrain_info, depth_prepass_ms, task_list );
     test_terrain.accel_structure_desc_set = &as_desc_set;
 #endif
 
-    test_terrain.blas = vk::rt::build_blas( ctx.vulkan.device, ctx.vulkan.allocator,
-        ctx.vulkan.ray_tracing_properties,
-        { .vertex_buffer = test_terrain.tri_buffers.vertex_buffer.handle,
-            .index_buffer = test_terrain.tri_buffers.index_buffer.handle,
-            .max_vertex = uint32_t( test_terrain.vertices.size() ) - 1,
-            .index_count = uint32_t( test_terrain.tri_indices.size() ),
-            .vertex_offset = uint32_t( 0 ),
-            .index_offset = uint32_t( 0 ),
-            .vertex_stride = sizeof( geometry::TerrainVertex ) },
-        engine.frames[0].start_cmdbuf, ctx.vulkan.destructor_stack );
-
-    test_terrain.tlas = vk::rt::build_tlas( ctx.vulkan.device, ctx.vulkan.allocator,
-        ctx.vulkan.ray_tracing_properties,
-        { vk::rt::Object { .blas = &test_terrain.blas, .transform = glm::identity<glm::mat4>() } },
-        engine.frames[0].start_cmdbuf, ctx.vulkan.destructor_stack );
-
-    engine::DescriptorSet terrain_as_desc_set = engine::generate_descriptor_set( ctx.vulkan, engine,
-        { VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR },
-        VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_FRAGMENT_BIT
-            | VK_SHADER_STAGE_COMPUTE_BIT );
-
-    engine::update_descriptor_set_acceleration_structure(
-        ctx.vulkan, engine, terrain_as_desc_set, test_terrain.tlas.handle, 0 );
+    if ( gpu_driven_draws ) {
+        gpu_driven::add_hiz_pass(
+            *gpu_driven_draws, ctx.vulkan, engine, task_list, gbuffers.GBuffer_Depth );
+    }
 
-    vkEndCommandBuffer( engine.frames[0].start_cmdbuf );
+    vkEndCommandBuffer( engine.frames[0].cmdbuf );
     VkSubmitInfo submit_info = {};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &engine.frames[0].start_cmdbuf;
+    submit_info.pCommandBuffers = &engine.frames[0].cmdbuf;
     vkQueueSubmit( ctx.vulkan.graphics_queue, 1, &submit_info, precompute_fence );
     vkWaitForFences( ctx.vulkan.device, 1, &precompute_fence, VK_TRUE, UINT64_MAX );
     vkResetFences( ctx.vulkan.device, 1, &precompute_fence );
     vkDestroyFence( ctx.vulkan.device, precompute_fence, VK_NULL_HANDLE );
-    vkResetCommandBuffer( engine.frames[0].start_cmdbuf, 0 );
+    vkResetCommandBuffer( engine.frames[0].cmdbuf, 0 );
 
     engine::DescriptorSet car_descriptor_set = engine::generate_descriptor_set( ctx.vulkan, engine,
         {
             VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // vertex_data
             VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // index_data
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, // blas_offsets
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, // rt_texture_uniform,
             VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, // BRDF_LUT
             VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, // octahedral_sky_mips
             VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, // octahedral_sky_irradiance
         },
         VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT );
 
-    std::vector<ub_data::PaddedVertex> padded_vertex_data {};
-    for ( geometry::scene::Vertex& v : scene_mesh.vertices ) {
-        padded_vertex_data.push_back(
-            { .position = v.position, .normal = v.normal, .tangent = v.tangent, .uv = v.uv } );
-    }
-
-    vk::mem::AllocatedBuffer padded_vertex_data_buffer = vk::mem::create_buffer( ctx.vulkan,
-        padded_vertex_data.size() * sizeof( ub_data::PaddedVertex ),
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU );
-
-    {
-        vk::mem::AllocatedBuffer staging = vk::mem::create_buffer( ctx.vulkan,
-            padded_vertex_data.size() * sizeof( ub_data::PaddedVertex ),
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY );
-
-        void* data = staging.info.pMappedData;
-        std::memcpy( data, padded_vertex_data.data(),
-            padded_vertex_data.size() * sizeof( ub_data::PaddedVertex ) );
-
-        engine::immediate_submit(
-            ctx.vulkan, engine.immediate_submit, [&]( VkCommandBuffer cmd_buf ) {
-                VkBufferCopy vertex_buf_copy = {
-                    .srcOffset = 0,
-                    .dstOffset = 0,
-                    .size = padded_vertex_data.size() * sizeof( ub_data::PaddedVertex ),
-                };
-
-                vkCmdCopyBuffer( cmd_buf, staging.handle, padded_vertex_data_buffer.handle, 1,
-                    &vertex_buf_copy );
-            } );
-    }
-
+    // Reflections decode the scene's vertices in place, whatever their layout
     engine::update_descriptor_set_const_storage_buffer(
-        ctx.vulkan, engine, car_descriptor_set, padded_vertex_data_buffer, 0 );
+        ctx.vulkan, engine, car_descriptor_set, scene_mesh.mesh_buffers.vertex_buffer, 0 );
 
     engine::update_descriptor_set_const_storage_buffer(
         ctx.vulkan, engine, car_descriptor_set, scene_mesh.mesh_buffers.index_buffer, 1 );
 
-    UniformBuffer<ub_data::BLASOffsets> offset_data = create_uniform_buffer(
-        ctx.vulkan, blas_offsets, static_cast<size_t>( engine.frame_overlap ) );
     {
-        offset_data.set_data( blas_offsets );
-        engine::update_descriptor_set_uniform(
-            ctx.vulkan, engine, car_descriptor_set, offset_data, 2 );
-
-        engine::update_descriptor_set_image( ctx.vulkan, engine, car_descriptor_set, lut_brdf, 4 );
+        engine::update_descriptor_set_image( ctx.vulkan, engine, car_descriptor_set, lut_brdf, 2 );
         engine::update_descriptor_set_rwimage( ctx.vulkan, engine, car_descriptor_set,
-            atms_baker.octahedral_sky_test, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 5 );
+            atms_baker.octahedral_sky_test, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 3 );
         engine::update_descriptor_set_rwimage( ctx.vulkan, engine, car_descriptor_set,
-            atms_baker.octahedral_sky_irradiance, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 6 );
+            atms_baker.octahedral_sky_irradiance, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 4 );
     }
 
     engine::add_gfx_task( task_list, depth_ms_gfx_task );
 
-    // number of albedo textures to bind
-    engine::DescriptorSet combined_textures_desc_set
-        = engine::generate_array_descriptor_set( ctx.vulkan, engine,
-            {
-                VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, // albedo_textures array
-                VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, // metallic_roughness_textures array
-            },
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            uint32_t( albedo_textures.size() ) );
-
-    engine::update_descriptor_set_image_array(
-        ctx.vulkan, engine, combined_textures_desc_set, albedo_textures, 0 );
-    engine::update_descriptor_set_image_array(
-        ctx.vulkan, engine, combined_textures_desc_set, metallic_roughness_textures, 1 );
-
-    UniformBuffer<ub_data::RTTextureUniform> rt_texture_uniform_data
-        = create_uniform_buffer( ctx.vulkan, rt_texture_uniform, engine.frame_overlap );
-    rt_texture_uniform_data.set_data( rt_texture_uniform );
-    engine::update_descriptor_set_uniform(
-        ctx.vulkan, engine, car_descriptor_set, rt_texture_uniform_data, 3 );
-
     // reflection data pass
     engine::RWImage reflection_data = engine::create_rwimage( ctx.vulkan, engine,
         VkExtent3D( engine.swapchain.extent.width, engine.swapchain.extent.height, 1 ),
@@ -819,10 +783,10 @@ void run( bool use_fullscreen )
     engine::Pipeline reflection_pipeline = engine::create_gfx_pipeline( engine, ctx.vulkan,
         engine::get_vertex_input_state_create_info( quad_mesh ),
         { uniform_desc_set.layouts[0], sampler_desc_set.layouts[0], gbuffers.desc_set.layouts[0],
-            as_desc_set.layouts[0], terrain_as_desc_set.layouts[0], car_descriptor_set.layouts[0],
-            combined_textures_desc_set.layouts[0] },
+            as_desc_set.layouts[0], car_descriptor_set.layouts[0], bindless.desc_set.layouts[0] },
         { VK_FORMAT_R16G16B16A16_SFLOAT }, VK_SAMPLE_COUNT_1_BIT, false, false,
-        vk::create::shader_module( ctx.vulkan, REFLECTION_PASS_SHADER_MODULE_PATH ), false );
+        vk::create::shader_module( ctx.vulkan, REFLECTION_PASS_SHADER_MODULE_PATH ), false,
+        engine::VERTEX_ENTRY_NAME, vertex_layout_specialization );
 
     engine::DrawResourceDescriptor reflection_prepass_desc {
         .vertex_buffers = { quad_mesh.mesh_buffers.vertex_buffer.handle },
@@ -833,7 +797,7 @@ void run( bool use_fullscreen )
 
     engine::DrawTask reflection_prepass_task { .draw_resource_descriptor = reflection_prepass_desc,
         .descriptor_sets = { &uniform_desc_set, &sampler_desc_set, &gbuffers.desc_set, &as_desc_set,
-            &terrain_as_desc_set, &car_descriptor_set, &combined_textures_desc_set },
+            &car_descriptor_set, &bindless.desc_set },
         .pipeline = reflection_pipeline };
 
     reflection_gfx_task.draw_tasks.push_back( reflection_prepass_task );
@@ -928,7 +892,7 @@ void run( bool use_fullscreen )
         try {
             lighting_pass_gfx_pipeline = engine::create_gfx_pipeline( engine, ctx.vulkan,
                 engine::get_vertex_input_state_create_info( lighting_pass_quad_mesh ),
-                { uniform_desc_set.layouts[frame_index], material_desc_sets[0].layouts[frame_index],
+                { uniform_desc_set.layouts[frame_index], bindless.desc_set.layouts[frame_index],
                     lut_sets.layouts[frame_index], sampler_desc_set.layouts[frame_index],
                     gbuffers.desc_set.layouts[frame_index], as_desc_set.layouts[frame_index],
                     reflection_buffer_desc_set.layouts[0] },
@@ -947,7 +911,7 @@ void run( bool use_fullscreen )
             reflection_data, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0 );
 
         engine::update_descriptor_set_acceleration_structure(
-            ctx.vulkan, engine, as_desc_set, engine.tlas.handle, 0 );
+            ctx.vulkan, engine, as_desc_set, ray_traced_scene.tlas.tlas.handle, 0 );
 
         lighting_pass_gfx_task.draw_tasks.push_back({
                 .draw_resource_descriptor = {
@@ -958,7 +922,7 @@ void run( bool use_fullscreen )
                 },
                 .descriptor_sets = {
                     &uniform_desc_set,
-                    &material_desc_sets[static_cast<size_t>( 0 )], // THIS IS WRONG; NEEDS FIX
+                    &bindless.desc_set,
                     &lut_sets,
                     &sampler_desc_set,
                     &gbuffers.desc_set,
@@ -977,39 +941,8 @@ void run( bool use_fullscreen )
     engine::post::BloomPass bloom_pass;
     engine::post::TonemappingPass tm_pass;
     {
-        // Convert the screen_color/rendered image to read-only.
-        // Output screen buffer must be converted to write-only.
-        // These are special pipeline barriers, since it is assumed that
-        // the scene color was rendered to via gfx draw calls, hence the attachment.
-        // We may need future helpers to convert from attachment to cs write, etc. and vice versa.
-        //
-        // Current limitation assumes that all post-processing calls are done via compute shader
-        // hence the VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT stage.
-        engine::add_pipeline_barrier( task_list,
-            engine::PipelineBarrierDescriptor { .buffer_barriers = {},
-                .image_barriers = {
-                    engine::ImageBarrier {
-                        .src_stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-                        .src_access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-                        .src_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        .dst_stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-                        .dst_access = VK_ACCESS_2_SHADER_READ_BIT,
-                        .dst_layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
-                        .image = screen_color,
-                        .range = engine::VK_IMAGE_SUBRESOURCE_RANGE_DEFAULT_COLOR,
-                    },
-                    engine::ImageBarrier {
-                        .src_stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-                        .src_access = VK_ACCESS_2_NONE,
-                        .src_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                        .dst_stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-                        .dst_access = VK_ACCESS_2_SHADER_WRITE_BIT,
-                        .dst_layout = VK_IMAGE_LAYOUT_GENERAL,
-                        .image = screen_buffer,
-                        .range = engine::VK_IMAGE_SUBRESOURCE_RANGE_DEFAULT_COLOR,
-                    },
-                } } );
-
+        // The post passes declare what they read and write, so the render graph works out the
+        // transitions between them, from the lighting pass' color attachment up to the blit.
         bloom_pass
             = engine::post::add_bloom( ctx.vulkan, engine, task_list, screen_color, screen_buffer );
 
@@ -1022,41 +955,20 @@ void run( bool use_fullscreen )
         };
         add_ao( ao_pass, ctx.vulkan, engine, task_list );
 
-        engine::transition_cs_read_to_write( task_list, screen_color );
-        engine::transition_cs_write_to_read( task_list, screen_buffer );
         tm_pass = engine::post::add_tonemapping(
             ctx.vulkan, engine, screen_buffer, screen_color, task_list );
 
         // Anti-aliasing solution, run this post-tonemapping. Read prev. rendered frame into here
-        engine::transition_cs_read_to_write( task_list, screen_buffer );
-        engine::transition_cs_write_to_read( task_list, screen_color );
         aa_pass = engine::post::add_aa( ctx.vulkan, engine, screen_color, gbuffers.GBuffer_Depth,
             gbuffers.GBuffer_Velocity, screen_buffer, screen_history, task_list, camera_buffer );
 
-        // This is the final pipeline barrier necessary for transitioning the chosen out_color to
-        // the screen.
-        engine::add_pipeline_barrier( task_list,
-            engine::PipelineBarrierDescriptor { .buffer_barriers = {},
-                .image_barriers = {
-                    engine::ImageBarrier {
-                        .src_stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-                        .src_access = VK_ACCESS_2_SHADER_WRITE_BIT,
-                        .src_layout = VK_IMAGE_LAYOUT_GENERAL,
-                        .dst_stage = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                        .dst_access = VK_ACCESS_2_TRANSFER_READ_BIT,
-                        .dst_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                        .image = screen_buffer,
-                        .range = engine::VK_IMAGE_SUBRESOURCE_RANGE_DEFAULT_COLOR,
-                    },
-                } } );
-
         engine::add_blit_task( task_list, { screen_buffer } );
     }
 
     // TERRIBLY EVIL HACK. THIS IS BAD. DON'T BE DOING THIS GANG.
     task_list.junk_tasks.push_back(
         [&atms_baker]( engine::State&, Context&, engine::FrameData& frame ) {
-            atmosphere::bake_octahedral_sky_task( atms_baker, frame.render_cmdbuf );
+            atmosphere::bake_octahedral_sky_task( atms_baker, frame.cmdbuf );
         } );
 
     bool will_quit = false;
@@ -1069,7 +981,7 @@ void run( bool use_fullscreen )
         current_tick = std::chrono::steady_clock::now();
 
         while ( SDL_PollEvent( &event ) ) {
-            gui::process_event( gui, &event, atms, engine.camera, material_uniform_buffers );
+            gui::process_event( gui, &event, atms, engine.camera, materials );
             camera::process_event( ctx, &event, engine.camera, gui.show_window );
 
             if ( event.type == SDL_EVENT_QUIT ) {
@@ -1089,6 +1001,10 @@ void run( bool use_fullscreen )
             continue;
         }
 
+        // Everything below writes into this frame's uniform buffer slices, so wait for the GPU to
+        // be done with them first. With more than one frame in flight this rarely blocks.
+        engine::begin_frame( engine, ctx.vulkan );
+
         if ( gui.preset.transition.has_value() ) {
             PresetTransition& transition = gui.preset.transition.value();
 
@@ -1163,7 +1079,7 @@ void run( bool use_fullscreen )
                     = glm::mix( i_mat.glint_randomness, f_mat.glint_randomness, t );
 
                 size_t material_idx = static_cast<size_t>( i.materials[idx].slot );
-                auto mat_data = material_uniform_buffers[material_idx].get_data();
+                ub_data::Material& mat_data = materials[material_idx];
 
                 mat_data.base_color = color;
                 mat_data.roughness = roughness;
@@ -1184,10 +1100,6 @@ void run( bool use_fullscreen )
                 gui.debug.glint_log_density = glint_log_density;
                 gui.debug.glint_roughness = glint_roughness;
                 gui.debug.glint_randomness = glint_randomness;
-
-                material_uniform_buffers[material_idx].set_data( mat_data );
-                material_uniform_buffers[material_idx].update(
-                    ctx.vulkan, engine.get_frame_index() );
             }
 
             engine.camera.center = glm::mix( i.camera_center, f.camera_center, t );
@@ -1208,10 +1120,8 @@ void run( bool use_fullscreen )
 
         if ( scene.demo_scene_nodes.car_parent_id.has_value()
             && gui.demo.enable_camera_lock_on_car ) {
-            camera.center
-                = model_mat_uniform_buffers.at( scene.demo_scene_nodes.car_parent_id.value() )
-                      .get_data()
-                      .model_mat[3];
+            size_t car_id = scene.demo_scene_nodes.car_parent_id.value();
+            camera.center = scene::get_world( node_transforms, car_id )[3];
         }
 
         camera.center.y += gui.demo.bumpiness
@@ -1289,7 +1199,7 @@ void run( bool use_fullscreen )
 
             // Store modded frame index, used for the jitter
             camera_ub.camera_constants1
-                = glm::vec4( engine.get_frame_index() % 16, 0.0f, 0.0f, 0.0f );
+                = glm::vec4( engine.rendered_frames % 16, 0.0f, 0.0f, 0.0f );
 
             camera_buffer.set_data( camera_ub );
             camera_buffer.update( ctx.vulkan, engine.get_frame_index() );
@@ -1370,9 +1280,9 @@ void run( bool use_fullscreen )
         // update materials
         {
             gui.debug.current_editing_material
-                = glm::clamp( gui.debug.current_editing_material, 0, int( num_materials ) );
+                = glm::clamp( gui.debug.current_editing_material, 0, int( num_materials ) - 1 );
             int mat_idx = gui.debug.current_editing_material;
-            auto mat_data = material_uniform_buffers[size_t( mat_idx )].get_data();
+            ub_data::Material& mat_data = materials[size_t( mat_idx )];
             if ( gui.debug.load_material_into_gui ) {
                 gui.debug.color = mat_data.base_color;
                 gui.debug.roughness = mat_data.roughness;
@@ -1392,17 +1302,9 @@ void run( bool use_fullscreen )
             mat_data.glint_roughness = gui.debug.glint_roughness;
             mat_data.glint_randomness = gui.debug.glint_randomness;
 
-            material_uniform_buffers[size_t( mat_idx )].set_data( mat_data );
-            material_uniform_buffers[size_t( mat_idx )].update(
-                ctx.vulkan, engine.get_frame_index() );
-        }
-
-        {
-            offset_data.update( ctx.vulkan, engine.get_frame_index() );
-            rt_texture_uniform_data.update( ctx.vulkan, engine.get_frame_index() );
+            engine::update_bindless_materials( ctx.vulkan, engine, bindless, materials );
         }
 
-        std::vector<bool> discovered = std::vector<bool>( scene.nodes.size(), false );
         // Update terrain
         {
             ub_data::TerrainData terrain_ub = test_terrain.terrain_uniform.get_data();
@@ -1445,13 +1347,15 @@ void run( bool use_fullscreen )
             glm::mat4 transform = glm::translate( glm::identity<glm::mat4>(), velocity );
 
             if ( gui.demo.enable_translation ) {
-                scene::propagate_transform( ctx.vulkan, engine, scene, model_mat_uniform_buffers,
-                    scene.demo_scene_nodes.car_parent_id.value(), transform, discovered );
+                scene::apply_local_transform(
+                    node_transforms, scene.demo_scene_nodes.car_parent_id.value(), transform );
             }
         }
 
-        // wheel rotation
-        {
+        if ( animation_player.has_value() ) {
+            scene::advance_animation( *animation_player, scene, engine.delta, node_transforms );
+        } else {
+            // wheel rotation
             // front wheels
             glm::vec3 pivot = -glm::vec3( 0.0f, wheel_centers[std::string( GLTF_FILE_PATH )][0] );
             float angle
@@ -1462,12 +1366,12 @@ void run( bool use_fullscreen )
             model = glm::translate( model, -pivot );
 
             if ( scene.demo_scene_nodes.wheel_front_left_id.has_value() ) {
-                scene::propagate_transform( ctx.vulkan, engine, scene, model_mat_uniform_buffers,
-                    scene.demo_scene_nodes.wheel_front_left_id.value(), model, discovered );
+                scene::apply_local_transform(
+                    node_transforms, scene.demo_scene_nodes.wheel_front_left_id.value(), model );
             }
             if ( scene.demo_scene_nodes.wheel_front_right_id.has_value() ) {
-                scene::propagate_transform( ctx.vulkan, engine, scene, model_mat_uniform_buffers,
-                    scene.demo_scene_nodes.wheel_front_right_id.value(), model, discovered );
+                scene::apply_local_transform(
+                    node_transforms, scene.demo_scene_nodes.wheel_front_right_id.value(), model );
             }
             // back wheels
             pivot = -glm::vec3( 0.0f, wheel_centers[std::string( GLTF_FILE_PATH )][1] );
@@ -1477,15 +1381,31 @@ void run( bool use_fullscreen )
             model = glm::translate( model, -pivot );
 
             if ( scene.demo_scene_nodes.wheel_back_left_id.has_value() ) {
-                scene::propagate_transform( ctx.vulkan, engine, scene, model_mat_uniform_buffers,
-                    scene.demo_scene_nodes.wheel_back_left_id.value(), model, discovered );
+                scene::apply_local_transform(
+                    node_transforms, scene.demo_scene_nodes.wheel_back_left_id.value(), model );
             }
             if ( scene.demo_scene_nodes.wheel_back_right_id.has_value() ) {
-                scene::propagate_transform( ctx.vulkan, engine, scene, model_mat_uniform_buffers,
-                    scene.demo_scene_nodes.wheel_back_right_id.value(), model, discovered );
+                scene::apply_local_transform(
+                    node_transforms, scene.demo_scene_nodes.wheel_back_right_id.value(), model );
             }
         }
 
+        scene::update_transforms( node_transforms );
+        scene::upload_transforms(
+            node_transforms, ctx.vulkan, engine, object_uniforms, model_mat_offsets );
+
+        if ( skinned_meshes ) {
+            skinning::update( *skinned_meshes, ctx.vulkan, engine, scene, node_transforms );
+        }
+
+        rt_scene::update( ray_traced_scene, ctx.vulkan, engine, node_transforms );
+
+        if ( gpu_driven_draws ) {
+            gpu_driven::update( *gpu_driven_draws, ctx.vulkan, engine, node_transforms,
+                gui.culling.frustum, gui.culling.occlusion, gui.culling.cone,
+                gui.culling.lods ? gui.culling.lod_error : 0.f );
+        }
+
         // Update bloom settings
         {
             ub_data::Bloom bloom_ub = bloom_pass.bloom_ub.get_data();
@@ -1498,11 +1418,13 @@ void run( bool use_fullscreen )
             bloom_pass.bloom_ub.update( ctx.vulkan, engine.get_frame_index() );
         }
 
-        gui::update( gui, atms, camera, material_uniform_buffers );
+        gui.gpu_wait_ms = static_cast<float>( engine.gpu_wait * 1000.0 );
+        gui.draw_stats = engine.draw_stats;
+        gui::update( gui, atms, camera, materials );
 
         engine::execute( engine, ctx, task_list, gui );
         engine.rendered_frames = engine.rendered_frames + 1;
-        engine.frame_number = ( engine.rendered_frames + 1 ) % engine.frame_overlap;
+        engine.frame_number = engine.rendered_frames % engine.frame_overlap;
 
         // Make new screen visible
         SDL_UpdateWindowSurface( ctx.window );
@@ -0,0 +1,241 @@
+#include "rt_scene.hpp"
+
+#include "log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace racecar::rt_scene {
+
+namespace {
+
+/// Every stage that traces rays against the scene, with ray queries or otherwise.
+constexpr VkPipelineStageFlags2 TLAS_READERS = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT
+    | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+
+/// Highest vertex the primitive's indices reach.
+uint32_t find_max_vertex( const geometry::scene::Mesh& mesh, const scene::Primitive& primitive )
+{
+    uint32_t max_vertex = 0;
+
+    for ( size_t i = 0; i < primitive.ind_count; i++ ) {
+        max_vertex = std::max(
+            max_vertex, mesh.indices[static_cast<size_t>( primitive.ind_offset ) + i] );
+    }
+
+    return max_vertex;
+}
+
+VkDeviceAddress get_buffer_address( VkDevice device, VkBuffer buffer )
+{
+    VkBufferDeviceAddressInfo info
+        = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = buffer };
+    return vkGetBufferDeviceAddress( device, &info );
+}
+
+/// Copies every instance into the frame's buffer for the next build to read.
+void write_instances( RtScene& rt_scene, vk::Common& vulkan, size_t frame_index )
+{
+    const vk::mem::AllocatedBuffer& buffer = rt_scene.instance_buffers[frame_index];
+
+    std::memcpy( buffer.info.pMappedData, rt_scene.instances.data(),
+        rt_scene.instances.size() * sizeof( VkAccelerationStructureInstanceKHR ) );
+    vmaFlushAllocation( vulkan.allocator, buffer.allocation, 0, VK_WHOLE_SIZE );
+}
+
+}
+
+RtScene initialize( vk::Common& vulkan, engine::State& engine, const scene::Scene& scene,
+    const geometry::scene::Mesh& mesh, const scene::Transforms& transforms,
+    std::span<const ExtraInstance> extra_instances, VkCommandBuffer cmd_buf )
+{
+    RtScene rt_scene;
+    std::vector<const scene::Primitive*> primitives;
+
+    for ( const std::unique_ptr<scene::Node>& node : scene.nodes ) {
+        if ( !node->mesh.has_value() ) {
+            continue;
+        }
+
+        for ( const scene::Primitive& primitive : node->mesh.value()->primitives ) {
+            primitives.push_back( &primitive );
+            rt_scene.instance_nodes.push_back( static_cast<size_t>( primitive.node_id ) );
+        }
+    }
+
+    // Instances of a mesh share one BLAS, their materials come from the custom index
+    std::vector<std::vector<size_t>> groups = scene::group_by_geometry( scene );
+    std::vector<vk::rt::MeshData> blas_meshes;
+    std::vector<size_t> instance_blases( primitives.size() );
+
+    for ( size_t i = 0; i < groups.size(); i++ ) {
+        const scene::Primitive& primitive = *primitives[groups[i].front()];
+
+        blas_meshes.push_back( {
+            .vertex_buffer = mesh.mesh_buffers.vertex_buffer.handle,
+            .index_buffer = mesh.mesh_buffers.index_buffer.handle,
+            .max_vertex = find_max_vertex( mesh, primitive ),
+            .index_count = static_cast<uint32_t>( primitive.ind_count ),
+            .vertex_offset = static_cast<uint32_t>( primitive.vertex_offset ),
+            .index_offset = static_cast<uint32_t>( primitive.ind_offset ),
+            .vertex_stride = geometry::scene::get_vertex_stride( mesh.layout ),
+        } );
+
+        for ( size_t draw_index : groups[i] ) {
+            instance_blases[draw_index] = i;
+        }
+    }
+
+    rt_scene.blases = vk::rt::build_blases( vulkan, engine.immediate_submit, blas_meshes );
+
+    for ( size_t i = 0; i < primitives.size(); i++ ) {
+        rt_scene.instances.push_back( {
+            .transform = vk::rt::to_transform_matrix(
+                scene::get_world( transforms, rt_scene.instance_nodes[i] ) ),
+            // Shaders find the primitive's bindless instance through this
+            .instanceCustomIndex = static_cast<uint32_t>( i ),
+            .mask = SCENE_INSTANCE_MASK,
+            .instanceShaderBindingTableRecordOffset = 0,
+            .flags = VK_GEOMETRY_INSTANCE_FORCE_OPAQUE_BIT_KHR,
+            .accelerationStructureReference = rt_scene.blases[instance_blases[i]].device_address,
+        } );
+    }
+
+    for ( const ExtraInstance& extra : extra_instances ) {
+        rt_scene.instances.push_back( {
+            .transform = vk::rt::to_transform_matrix( extra.transform ),
+            .instanceCustomIndex = static_cast<uint32_t>( rt_scene.instances.size() ),
+            .mask = extra.mask,
+            .instanceShaderBindingTableRecordOffset = 0,
+            .flags = VK_GEOMETRY_INSTANCE_FORCE_OPAQUE_BIT_KHR,
+            .accelerationStructureReference = extra.blas_address,
+        } );
+    }
+
+    uint32_t instance_count = static_cast<uint32_t>( rt_scene.instances.size() );
+    rt_scene.tlas = vk::rt::create_dynamic_tlas( vulkan, instance_count );
+
+    for ( uint32_t i = 0; i < engine.frame_overlap; i++ ) {
+        vk::mem::AllocatedBuffer buffer = vk::mem::create_buffer( vulkan,
+            std::max( instance_count, 1u ) * sizeof( VkAccelerationStructureInstanceKHR ),
+            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+                | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+            VMA_MEMORY_USAGE_CPU_TO_GPU );
+
+        rt_scene.instance_buffers.push_back( buffer );
+        rt_scene.instance_addresses.push_back( get_buffer_address( vulkan.device, buffer.handle ) );
+    }
+
+    write_instances( rt_scene, vulkan, 0 );
+    vk::rt::record_tlas_build( cmd_buf, rt_scene.tlas, rt_scene.instance_addresses[0], false );
+
+    VkMemoryBarrier2 barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        .srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        .dstStageMask = TLAS_READERS | VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
+            | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+    };
+    VkDependencyInfo dependency_info = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &barrier,
+    };
+    vkCmdPipelineBarrier2( cmd_buf, &dependency_info );
+
+    log::info( "[RtScene] {} BLASes for {} instances, TLAS updated in place and rebuilt every {} "
+               "updates",
+        rt_scene.blases.size(), rt_scene.instances.size(), TLAS_REBUILD_INTERVAL );
+
+    return rt_scene;
+}
+
+void add_tlas_pass( RtScene& rt_scene, const engine::State& engine, engine::TaskList& task_list )
+{
+    constexpr VkPipelineStageFlags2 BUILD
+        = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+    constexpr VkAccessFlags2 BUILD_ACCESS = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
+        | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+    // Frames in flight all share the one TLAS and scratch, so the previous frame has to be done
+    // tracing against the one and building with the other
+    engine::add_pipeline_barrier( task_list,
+        { .buffer_barriers = {
+              {
+                  .buffer = rt_scene.tlas.tlas.buffer,
+                  .src_stage = TLAS_READERS | BUILD,
+                  .src_access = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+                  .dst_stage = BUILD,
+                  .dst_access = BUILD_ACCESS,
+              },
+              {
+                  .buffer = rt_scene.tlas.scratch,
+                  .src_stage = BUILD,
+                  .src_access = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+                  .dst_stage = BUILD,
+                  .dst_access = BUILD_ACCESS,
+              },
+          } } );
+
+    engine::add_record_task( task_list, [&rt_scene, &engine]( VkCommandBuffer cmd_buf ) {
+        if ( rt_scene.next_build == RtScene::Build::NONE ) {
+            return;
+        }
+
+        vk::rt::record_tlas_build( cmd_buf, rt_scene.tlas,
+            rt_scene.instance_addresses[engine.get_frame_index()],
+            rt_scene.next_build == RtScene::Build::UPDATE );
+    } );
+
+    // The render graph only tracks images, so the TLAS needs a barrier of its own
+    engine::add_pipeline_barrier( task_list,
+        { .buffer_barriers = { {
+              .buffer = rt_scene.tlas.tlas.buffer,
+              .src_stage = BUILD,
+              .src_access = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+              .dst_stage = TLAS_READERS,
+              .dst_access = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+          } } } );
+}
+
+void update( RtScene& rt_scene, vk::Common& vulkan, const engine::State& engine,
+    const scene::Transforms& transforms )
+{
+    bool has_moved = rt_scene.is_invalidated;
+    rt_scene.is_invalidated = false;
+
+    for ( size_t i = 0; i < rt_scene.instance_nodes.size(); i++ ) {
+        VkTransformMatrixKHR transform = vk::rt::to_transform_matrix(
+            scene::get_world( transforms, rt_scene.instance_nodes[i] ) );
+
+        if ( std::memcmp( &transform, &rt_scene.instances[i].transform, sizeof( transform ) )
+            != 0 ) {
+            rt_scene.instances[i].transform = transform;
+            has_moved = true;
+        }
+    }
+
+    // A TLAS that nothing moved or changed in is still good, whichever frame built it
+    if ( !has_moved ) {
+        rt_scene.next_build = RtScene::Build::NONE;
+        return;
+    }
+
+    if ( rt_scene.updates_since_build >= TLAS_REBUILD_INTERVAL ) {
+        rt_scene.next_build = RtScene::Build::FULL;
+        rt_scene.updates_since_build = 0;
+    } else {
+        rt_scene.next_build = RtScene::Build::UPDATE;
+        rt_scene.updates_since_build++;
+    }
+
+    write_instances( rt_scene, vulkan, engine.get_frame_index() );
+}
+
+void invalidate( RtScene& rt_scene )
+{
+    rt_scene.is_invalidated = true;
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "engine/state.hpp"
+#include "engine/task_list.hpp"
+#include "geometry/scene_mesh.hpp"
+#include "scene/scene.hpp"
+#include "scene/transforms.hpp"
+#include "vk/common.hpp"
+#include "vk/ray_tracing.hpp"
+
+#include <span>
+#include <vector>
+
+/// The scene's acceleration structures for ray traced shadows and reflections. Every geometry gets
+/// a BLAS, and the TLAS has an instance per primitive that follows its node around. Whenever a node
+/// moves, the instances are written to a per-frame buffer and the TLAS is updated in place on the
+/// frame's command buffer, which only refits the bounds of the tree the last full build made.
+/// Those get looser as instances wander off, so every so often it's built from scratch instead.
+namespace racecar::rt_scene {
+
+/// Updates in a row before the TLAS gets built from scratch again.
+constexpr uint32_t TLAS_REBUILD_INTERVAL = 64;
+
+/// Instance masks, so rays can pick what they hit. Mirrored in `common.slang`.
+constexpr uint8_t SCENE_INSTANCE_MASK = 0x01;
+constexpr uint8_t TERRAIN_INSTANCE_MASK = 0x02;
+
+/// Geometry for rays to hit besides the scene's primitives, like the terrain. It never moves, but
+/// its BLAS may get refit, see `invalidate`. There's no bindless instance behind it, so shaders
+/// have to tell it apart by its mask.
+struct ExtraInstance {
+    VkDeviceAddress blas_address = 0;
+    glm::mat4 transform = glm::mat4( 1.f );
+    uint8_t mask = 0;
+};
+
+struct RtScene {
+    /// One per geometry, in the order of `scene::group_by_geometry`.
+    std::vector<vk::rt::AccelerationStructure> blases;
+
+    /// One instance per primitive, in draw order like the bindless instances, and then the extra
+    /// ones. The node each primitive's instance follows, and every instance as last written.
+    std::vector<size_t> instance_nodes;
+    std::vector<VkAccelerationStructureInstanceKHR> instances;
+
+    vk::rt::DynamicTlas tlas;
+
+    /// One per frame in flight, so writing this frame's doesn't race the GPU reading the last.
+    std::vector<vk::mem::AllocatedBuffer> instance_buffers;
+    std::vector<VkDeviceAddress> instance_addresses;
+
+    enum class Build { NONE, UPDATE, FULL } next_build = Build::NONE;
+    uint32_t updates_since_build = 0;
+    bool is_invalidated = false; ///< See `invalidate`.
+};
+
+/// Builds the BLASes right away. The first TLAS build gets recorded into `cmd_buf`, which has to be
+/// submitted before anything traces against it.
+RtScene initialize( vk::Common& vulkan, engine::State& engine, const scene::Scene& scene,
+    const geometry::scene::Mesh& mesh, const scene::Transforms& transforms,
+    std::span<const ExtraInstance> extra_instances, VkCommandBuffer cmd_buf );
+
+/// Has to go before anything tracing rays against the scene, and after any BLAS refits.
+void add_tlas_pass( RtScene& rt_scene, const engine::State& engine, engine::TaskList& task_list );
+
+/// Picks up this frame's node transforms and decides how the TLAS gets brought along, so after
+/// `scene::update_transforms`. Only once the frame's previous submission is done, i.e. after
+/// `engine::begin_frame`.
+void update( RtScene& rt_scene, vk::Common& vulkan, const engine::State& engine,
+    const scene::Transforms& transforms );
+
+/// Brings the TLAS along this frame even if nothing moved, for when the BLAS of an extra instance
+/// gets refit with `vk::rt::update_blas`. Before `update`.
+void invalidate( RtScene& rt_scene );
+
+}
@@ -0,0 +1,167 @@
+#include "animation.hpp"
+
+#include "../exception.hpp"
+
+#define GLM_ENABLE_EXPERIMENTAL // Needed for matrix_decompose.hpp
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace racecar::scene {
+
+namespace {
+
+/// Moves the cursor to the last key at or before `time`. Only walks back to the start when time
+/// went backwards, i.e. when the animation looped.
+uint32_t seek( const std::vector<float>& times, uint32_t cursor, float time )
+{
+    if ( cursor >= times.size() || time < times[cursor] ) {
+        cursor = 0;
+    }
+
+    while ( cursor + 1 < times.size() && time >= times[cursor + 1] ) {
+        cursor++;
+    }
+
+    return cursor;
+}
+
+glm::quat to_quat( const glm::vec4& xyzw )
+{
+    // GLM's quat expects WXYZ order, but GLTF uses XYZW order
+    return glm::quat( xyzw.w, xyzw.x, xyzw.y, xyzw.z );
+}
+
+/// Value at `key`, skipping over the tangents of cubic splines.
+glm::vec4 key_value( const AnimationChannel& channel, size_t key )
+{
+    return channel.interpolation == Interpolation::CUBIC_SPLINE ? channel.values[key * 3 + 1]
+                                                                : channel.values[key];
+}
+
+glm::vec4 sample_cubic( const AnimationChannel& channel, size_t key, float t, float dt )
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    glm::vec4 value = channel.values[key * 3 + 1];
+    glm::vec4 out_tangent = channel.values[key * 3 + 2];
+    glm::vec4 next_in_tangent = channel.values[( key + 1 ) * 3];
+    glm::vec4 next_value = channel.values[( key + 1 ) * 3 + 1];
+
+    // Hermite spline, tangents are scaled by the time between the keys
+    return ( 2.f * t3 - 3.f * t2 + 1.f ) * value + ( t3 - 2.f * t2 + t ) * dt * out_tangent
+        + ( -2.f * t3 + 3.f * t2 ) * next_value + ( t3 - t2 ) * dt * next_in_tangent;
+}
+
+}
+
+AnimationPlayer create_animation_player( const Scene& scene, size_t animation )
+{
+    if ( animation >= scene.animations.size() ) {
+        throw Exception( "[Animation] Scene has no animation {}, only {}", animation,
+            scene.animations.size() );
+    }
+
+    const Animation& source = scene.animations[animation];
+
+    AnimationPlayer player = { .animation = animation };
+    player.cursors.assign( source.channels.size(), 0 );
+
+    std::unordered_map<size_t, uint32_t> targets;
+
+    for ( const AnimationChannel& channel : source.channels ) {
+        uint32_t next_target = static_cast<uint32_t>( player.node_ids.size() );
+        auto [it, inserted] = targets.try_emplace( channel.node_id, next_target );
+
+        if ( inserted ) {
+            const glm::mat4& rest = scene.nodes.at( channel.node_id )->transform;
+
+            glm::vec3 translation;
+            glm::quat rotation;
+            glm::vec3 scale;
+            glm::vec3 skew;
+            glm::vec4 perspective;
+            glm::decompose( rest, scale, rotation, translation, skew, perspective );
+
+            player.node_ids.push_back( channel.node_id );
+            player.translations.push_back( translation );
+            player.rotations.push_back( rotation );
+            player.scales.push_back( scale );
+        }
+
+        player.channel_targets.push_back( it->second );
+    }
+
+    return player;
+}
+
+void advance_animation( AnimationPlayer& player, const Scene& scene, double delta,
+    Transforms& transforms )
+{
+    const Animation& animation = scene.animations[player.animation];
+
+    if ( !player.playing || animation.duration <= 0.f ) {
+        return;
+    }
+
+    player.time = std::fmod( player.time + delta * static_cast<double>( player.speed ),
+        static_cast<double>( animation.duration ) );
+    if ( player.time < 0.0 ) {
+        player.time += static_cast<double>( animation.duration );
+    }
+
+    float time = static_cast<float>( player.time );
+
+    for ( size_t i = 0; i < animation.channels.size(); i++ ) {
+        const AnimationChannel& channel = animation.channels[i];
+        uint32_t key = seek( channel.times, player.cursors[i], time );
+        player.cursors[i] = key;
+
+        glm::vec4 value = key_value( channel, key );
+        bool is_rotation = channel.path == AnimationPath::ROTATION;
+
+        // Before the first key and after the last one the value is held
+        if ( key + 1 < channel.times.size() && time > channel.times[key]
+            && channel.interpolation != Interpolation::STEP ) {
+            float dt = channel.times[key + 1] - channel.times[key];
+            float t = ( time - channel.times[key] ) / dt;
+
+            if ( channel.interpolation == Interpolation::CUBIC_SPLINE ) {
+                value = sample_cubic( channel, key, t, dt );
+            } else if ( is_rotation ) {
+                glm::quat rotation = glm::slerp(
+                    to_quat( value ), to_quat( key_value( channel, key + 1 ) ), t );
+                value = glm::vec4( rotation.x, rotation.y, rotation.z, rotation.w );
+            } else {
+                value = glm::mix( value, key_value( channel, key + 1 ), t );
+            }
+        }
+
+        uint32_t target = player.channel_targets[i];
+        switch ( channel.path ) {
+        case AnimationPath::TRANSLATION:
+            player.translations[target] = glm::vec3( value );
+            break;
+        case AnimationPath::ROTATION:
+            player.rotations[target] = glm::normalize( to_quat( value ) );
+            break;
+        case AnimationPath::SCALE:
+            player.scales[target] = glm::vec3( value );
+            break;
+        }
+    }
+
+    for ( size_t i = 0; i < player.node_ids.size(); i++ ) {
+        glm::mat4 local = glm::translate( glm::mat4( 1.f ), player.translations[i] )
+            * glm::mat4_cast( player.rotations[i] )
+            * glm::scale( glm::mat4( 1.f ), player.scales[i] );
+
+        set_local_transform( transforms, player.node_ids[i], local );
+    }
+}
+
+} // namespace racecar::scene
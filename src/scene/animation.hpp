@@ -0,0 +1,44 @@
+#pragma once
+
+#include "scene.hpp"
+#include "transforms.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/// Playback of glTF animations. Channels are sampled into a translation, rotation and scale per
+/// animated node, which then replace those nodes' local transforms so `update_transforms` takes it
+/// from there like for any other movement.
+namespace racecar::scene {
+
+struct AnimationPlayer {
+    size_t animation = 0; ///< Into `Scene::animations`.
+    double time = 0.0; ///< In seconds, always within the animation's duration.
+    float speed = 1.f;
+    bool playing = true;
+
+    /// Last keyframe each channel was at. Time mostly moves forward by less than a keyframe, so
+    /// searching from here is constant time instead of a binary search over all keys.
+    std::vector<uint32_t> cursors;
+
+    /// Every node the animation touches, and which of those each channel writes to.
+    std::vector<size_t> node_ids;
+    std::vector<uint32_t> channel_targets;
+
+    /// Pose of each animated node. Paths without a channel keep the node's rest pose.
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+};
+
+AnimationPlayer create_animation_player( const Scene& scene, size_t animation );
+
+/// Moves the animation along by `delta` seconds (looping), samples every channel and writes the
+/// resulting local transforms. Does nothing while paused.
+void advance_animation( AnimationPlayer& player, const Scene& scene, double delta,
+    Transforms& transforms );
+
+} // namespace racecar::scene
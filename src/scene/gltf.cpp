@@ -0,0 +1,1121 @@
+#include "scene.hpp"
+
+#include "../log.hpp"
+#include "../parallel.hpp"
+
+#include <SDL3/SDL.h>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#define GLM_ENABLE_EXPERIMENTAL // Needed for quaternion.hpp
+#include <glm/gtx/quaternion.hpp>
+#include <stb_image.h>
+#define TINYGLTF_IMPLEMENTATION
+#include <tiny_gltf.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <numeric>
+#include <span>
+#include <tuple>
+
+namespace racecar::scene {
+
+static inline glm::vec3 double_array_to_vec3( std::vector<double> arr )
+{
+    return glm::vec3( arr[0], arr[1], arr[2] );
+}
+
+namespace {
+
+/// Encoded image bytes stashed by `defer_image_decode`, indexed like `model.images`.
+using EncodedImages = std::vector<std::vector<unsigned char>>;
+
+/// tinygltf image loader that doesn't decode anything. Only the header is read so the image's
+/// dimensions are valid, the actual decoding happens in parallel with `decode_image` once tinygltf
+/// is done parsing.
+bool defer_image_decode( tinygltf::Image* image, const int image_idx, std::string* err,
+    [[maybe_unused]] std::string* warn, [[maybe_unused]] int req_width,
+    [[maybe_unused]] int req_height, const unsigned char* bytes, int size, void* user_data )
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    if ( !stbi_info_from_memory( bytes, size, &width, &height, &channels ) ) {
+        if ( err != nullptr ) {
+            *err += std::format(
+                "Unknown image format for image {}: {}\n", image_idx, stbi_failure_reason() );
+        }
+
+        return false;
+    }
+
+    // Always expanded to RGBA when decoding, same as tinygltf's own loader.
+    image->width = width;
+    image->height = height;
+    image->component = 4;
+    image->bits = stbi_is_16_bit_from_memory( bytes, size ) ? 16 : 8;
+    image->pixel_type = image->bits == 16 ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                                          : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+
+    EncodedImages& encoded_images = *static_cast<EncodedImages*>( user_data );
+    size_t index = static_cast<size_t>( image_idx );
+    if ( encoded_images.size() <= index ) {
+        encoded_images.resize( index + 1 );
+    }
+
+    encoded_images[index].assign( bytes, bytes + size );
+    return true;
+}
+
+void decode_image( tinygltf::Image& image, const std::vector<unsigned char>& encoded )
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    int size = static_cast<int>( encoded.size() );
+
+    void* pixels = image.bits == 16
+        ? static_cast<void*>(
+              stbi_load_16_from_memory( encoded.data(), size, &width, &height, &channels, 4 ) )
+        : static_cast<void*>(
+              stbi_load_from_memory( encoded.data(), size, &width, &height, &channels, 4 ) );
+
+    if ( pixels == nullptr ) {
+        throw Exception( "[Scene] GLTF loading: Failed to decode image \"{}\": {}", image.name,
+            stbi_failure_reason() );
+    }
+
+    size_t byte_size = static_cast<size_t>( width ) * static_cast<size_t>( height ) * 4
+        * static_cast<size_t>( image.bits / 8 );
+    const unsigned char* begin = static_cast<const unsigned char*>( pixels );
+    image.image.assign( begin, begin + byte_size );
+
+    stbi_image_free( pixels );
+}
+
+/// Vulkan has no 16-bit sRGB format, so 16-bit color textures are brought down to 8 bits to get
+/// sampled through an `_SRGB` format like every other color texture. Values stay sRGB encoded,
+/// which is what 8 bits are spent on best anyway.
+std::vector<unsigned char> narrow_to_8_bit( const std::vector<unsigned char>& pixels )
+{
+    std::vector<unsigned char> narrowed( pixels.size() / 2 );
+
+    for ( size_t i = 0; i < narrowed.size(); i++ ) {
+        uint16_t value = 0;
+        std::memcpy( &value, &pixels[i * 2], sizeof( value ) );
+        narrowed[i] = static_cast<unsigned char>( ( uint32_t( value ) * 255 + 32767 ) / 65535 );
+    }
+
+    return narrowed;
+}
+
+/// Bytes written into the global vertex/index arrays while ingesting, per stage.
+struct IngestStats {
+    size_t position_bytes = 0;
+    size_t normal_bytes = 0;
+    size_t uv_bytes = 0;
+    size_t index_bytes = 0;
+};
+
+/// Where a primitive's vertices and indices land in the global arrays. Filled out by a counting
+/// pass so the global arrays only get sized once.
+struct PrimitiveRange {
+    size_t vertex_offset = 0;
+    size_t vertex_count = 0;
+    size_t index_offset = 0;
+    size_t index_count = 0;
+
+    /// Into `Scene::skin_vertices`, only for skinned primitives.
+    std::optional<size_t> skin_vertex_offset;
+
+    /// Decoded for an earlier node instancing the same mesh, which this one draws as well.
+    bool is_shared = false;
+};
+
+/// View over the bytes of a buffer view, straight out of the tinygltf buffer. Nothing is copied.
+std::span<const unsigned char> view_buffer( const tinygltf::Model& model, int buffer_view_id )
+{
+    const tinygltf::BufferView& buffer_view
+        = model.bufferViews.at( static_cast<size_t>( buffer_view_id ) );
+    const tinygltf::Buffer& buffer = model.buffers.at( static_cast<size_t>( buffer_view.buffer ) );
+
+    if ( buffer_view.byteOffset + buffer_view.byteLength > buffer.data.size() ) {
+        throw Exception( "[Scene] GLTF loading: Buffer view {} is out of bounds", buffer_view_id );
+    }
+
+    return std::span( buffer.data ).subspan( buffer_view.byteOffset, buffer_view.byteLength );
+}
+
+uint32_t read_index( const unsigned char* bytes, int component_type )
+{
+    switch ( component_type ) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        return static_cast<uint32_t>( *bytes );
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+        uint16_t index = 0;
+        std::memcpy( &index, bytes, sizeof( uint16_t ) );
+        return static_cast<uint32_t>( index );
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+        uint32_t index = 0;
+        std::memcpy( &index, bytes, sizeof( uint32_t ) );
+        return index;
+    }
+    default:
+        throw Exception(
+            "[Scene] GLTF loading: Unsupported index component type {}", component_type );
+    }
+}
+
+bool is_index_type( int component_type )
+{
+    return component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE
+        || component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+        || component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+}
+
+/// Calls `visit( element_index, element_bytes )` for every element of an accessor while reading
+/// the buffer in place. Interleaved buffer views are handled through byteStride. Sparse
+/// substitutions get visited after the dense elements so that they overwrite them.
+template <typename F>
+void visit_accessor( const tinygltf::Model& model, const tinygltf::Accessor& accessor, F&& visit )
+{
+    int component_size
+        = tinygltf::GetComponentSizeInBytes( static_cast<uint32_t>( accessor.componentType ) );
+    int num_components = tinygltf::GetNumComponentsInType( static_cast<uint32_t>( accessor.type ) );
+
+    if ( component_size <= 0 || num_components <= 0 ) {
+        throw Exception( "[Scene] GLTF loading: Accessor has an invalid type" );
+    }
+
+    size_t element_size = static_cast<size_t>( component_size * num_components );
+
+    if ( accessor.bufferView != -1 ) {
+        std::span<const unsigned char> bytes = view_buffer( model, accessor.bufferView );
+        int byte_stride
+            = accessor.ByteStride( model.bufferViews[static_cast<size_t>( accessor.bufferView )] );
+
+        if ( byte_stride <= 0 ) {
+            throw Exception( "[Scene] GLTF loading: Accessor has an invalid byte stride" );
+        }
+
+        size_t stride = static_cast<size_t>( byte_stride );
+
+        if ( accessor.count > 0
+            && accessor.byteOffset + stride * ( accessor.count - 1 ) + element_size
+                > bytes.size() ) {
+            throw Exception(
+                "[Scene] GLTF loading: Accessor reads past the end of its buffer view" );
+        }
+
+        const unsigned char* base = bytes.data() + accessor.byteOffset;
+        for ( size_t i = 0; i < accessor.count; i++ ) {
+            visit( i, base + i * stride );
+        }
+    } else {
+        // Accessors without a buffer view are initialized to zeros by the spec. mat4 is the
+        // largest element type.
+        std::array<unsigned char, 16 * sizeof( double )> zeroes = {};
+        for ( size_t i = 0; i < accessor.count; i++ ) {
+            visit( i, zeroes.data() );
+        }
+    }
+
+    if ( !accessor.sparse.isSparse ) {
+        return;
+    }
+
+    const auto& sparse = accessor.sparse;
+    size_t sparse_count = static_cast<size_t>( sparse.count );
+    size_t index_size = static_cast<size_t>( tinygltf::GetComponentSizeInBytes(
+        static_cast<uint32_t>( sparse.indices.componentType ) ) );
+
+    std::span<const unsigned char> sparse_indices = view_buffer( model, sparse.indices.bufferView );
+    std::span<const unsigned char> sparse_values = view_buffer( model, sparse.values.bufferView );
+
+    // Sparse indices and values are always tightly packed.
+    if ( !is_index_type( sparse.indices.componentType )
+        || static_cast<size_t>( sparse.indices.byteOffset ) + sparse_count * index_size
+            > sparse_indices.size()
+        || static_cast<size_t>( sparse.values.byteOffset ) + sparse_count * element_size
+            > sparse_values.size() ) {
+        throw Exception( "[Scene] GLTF loading: Sparse accessor is malformed" );
+    }
+
+    for ( size_t i = 0; i < sparse_count; i++ ) {
+        size_t target = read_index(
+            sparse_indices.data() + sparse.indices.byteOffset + i * index_size,
+            sparse.indices.componentType );
+
+        if ( target >= accessor.count ) {
+            throw Exception( "[Scene] GLTF loading: Sparse index {} is out of range", target );
+        }
+
+        visit( target, sparse_values.data() + sparse.values.byteOffset + i * element_size );
+    }
+}
+
+const tinygltf::Accessor* find_attribute(
+    const tinygltf::Model& model, const tinygltf::Primitive& loaded_prim, const std::string& name )
+{
+    auto it = loaded_prim.attributes.find( name );
+    if ( it == loaded_prim.attributes.end() ) {
+        return nullptr;
+    }
+
+    return &model.accessors.at( static_cast<size_t>( it->second ) );
+}
+
+bool check_float_attribute(
+    const tinygltf::Accessor& accessor, int expected_type, const char* name )
+{
+    if ( accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ) {
+        log::warn( "[Scene] GLTF Loading: Expected all vertex attributes to be float - unsupported "
+                   "component type detected on {}, skipping",
+            name );
+        return false;
+    }
+
+    if ( accessor.type != expected_type ) {
+        log::warn( "[Scene] GLTF Loading: Unexpected type on {}, skipping", name );
+        return false;
+    }
+
+    return true;
+}
+
+PrimitiveRange count_primitive( const tinygltf::Model& model,
+    const tinygltf::Primitive& loaded_prim, size_t vertex_offset, size_t index_offset )
+{
+    PrimitiveRange range = {
+        .vertex_offset = vertex_offset,
+        .index_offset = index_offset,
+    };
+
+    // Assume position data always exists
+    if ( const tinygltf::Accessor* position = find_attribute( model, loaded_prim, "POSITION" ) ) {
+        range.vertex_count = position->count;
+    }
+
+    if ( loaded_prim.indices != -1 ) {
+        range.index_count = model.accessors.at( static_cast<size_t>( loaded_prim.indices ) ).count;
+    } else {
+        range.index_count = range.vertex_count;
+    }
+
+    return range;
+}
+
+/// Writes a primitive's interleaved vertices and its indices directly into their slices of the
+/// global arrays.
+void decode_primitive( const tinygltf::Model& model, const tinygltf::Primitive& loaded_prim,
+    std::span<geometry::scene::Vertex> vertices, std::span<uint32_t> indices, IngestStats& stats )
+{
+    std::fill( vertices.begin(), vertices.end(),
+        geometry::scene::Vertex {
+            .position = glm::vec3( 0.f ),
+            .normal = glm::vec3( 0, 0, 1 ),
+            .tangent = glm::vec4( 0.f ),
+            .uv = glm::vec2( 0.5, 0.5 ),
+            .ids = glm::vec2( 0.f ),
+        } );
+
+    const tinygltf::Accessor* position = find_attribute( model, loaded_prim, "POSITION" );
+    if ( position != nullptr
+        && check_float_attribute( *position, TINYGLTF_TYPE_VEC3, "POSITION" ) ) {
+        visit_accessor( model, *position, [&]( size_t i, const unsigned char* bytes ) {
+            std::memcpy( &vertices[i].position, bytes, sizeof( glm::vec3 ) );
+        } );
+        stats.position_bytes += vertices.size() * sizeof( glm::vec3 );
+    }
+
+    const tinygltf::Accessor* normal = find_attribute( model, loaded_prim, "NORMAL" );
+    if ( normal != nullptr && check_float_attribute( *normal, TINYGLTF_TYPE_VEC3, "NORMAL" ) ) {
+        if ( normal->count != vertices.size() ) {
+            log::warn( "[Scene] GLTF Loading: nonzero nor or uv count does not match up with pos "
+                       "count" );
+        }
+
+        visit_accessor( model, *normal, [&]( size_t i, const unsigned char* bytes ) {
+            if ( i < vertices.size() ) {
+                std::memcpy( &vertices[i].normal, bytes, sizeof( glm::vec3 ) );
+            }
+        } );
+        stats.normal_bytes += std::min( normal->count, vertices.size() ) * sizeof( glm::vec3 );
+    }
+
+    // Currently only accepting one uv coordinate per primative.
+    const tinygltf::Accessor* uv = find_attribute( model, loaded_prim, "TEXCOORD_0" );
+    if ( uv != nullptr && check_float_attribute( *uv, TINYGLTF_TYPE_VEC2, "TEXCOORD_0" ) ) {
+        if ( uv->count != vertices.size() ) {
+            log::warn( "[Scene] GLTF Loading: nonzero nor or uv count does not match up with pos "
+                       "count" );
+        }
+
+        visit_accessor( model, *uv, [&]( size_t i, const unsigned char* bytes ) {
+            if ( i < vertices.size() ) {
+                std::memcpy( &vertices[i].uv, bytes, sizeof( glm::vec2 ) );
+            }
+        } );
+        stats.uv_bytes += std::min( uv->count, vertices.size() ) * sizeof( glm::vec2 );
+    }
+
+    if ( loaded_prim.indices == -1 ) {
+        // If there are no indices, assume position vector will lay out all triangles
+        std::iota( indices.begin(), indices.end(), 0u );
+        stats.index_bytes += indices.size_bytes();
+        return;
+    }
+
+    const tinygltf::Accessor& accessor
+        = model.accessors.at( static_cast<size_t>( loaded_prim.indices ) );
+
+    if ( accessor.type != TINYGLTF_TYPE_SCALAR || !is_index_type( accessor.componentType ) ) {
+        log::warn( "[Scene] GLTF Loading: Expected all indices to be unsigned byte, short or int "
+                   "scalars - unsupported type detected" );
+        std::fill( indices.begin(), indices.end(), 0u );
+        return;
+    }
+
+    visit_accessor( model, accessor, [&]( size_t i, const unsigned char* bytes ) {
+        indices[i] = read_index( bytes, accessor.componentType );
+    } );
+    stats.index_bytes += indices.size_bytes();
+}
+
+bool has_skin_attributes( const tinygltf::Model& model, const tinygltf::Primitive& loaded_prim )
+{
+    return find_attribute( model, loaded_prim, "JOINTS_0" ) != nullptr
+        && find_attribute( model, loaded_prim, "WEIGHTS_0" ) != nullptr;
+}
+
+/// Floats as is, normalized unsigned bytes and shorts mapped to [0, 1].
+float read_normalized( const unsigned char* bytes, int component_type )
+{
+    switch ( component_type ) {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+        float value = 0.f;
+        std::memcpy( &value, bytes, sizeof( float ) );
+        return value;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        return static_cast<float>( read_index( bytes, component_type ) ) / 255.f;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        return static_cast<float>( read_index( bytes, component_type ) ) / 65535.f;
+    default:
+        throw Exception(
+            "[Scene] GLTF loading: Unsupported normalized component type {}", component_type );
+    }
+}
+
+/// Writes JOINTS_0 and WEIGHTS_0 into the primitive's slice of `Scene::skin_vertices`.
+void decode_skin( const tinygltf::Model& model, const tinygltf::Primitive& loaded_prim,
+    std::span<SkinVertex> skin_vertices )
+{
+    const tinygltf::Accessor& joints = *find_attribute( model, loaded_prim, "JOINTS_0" );
+    const tinygltf::Accessor& weights = *find_attribute( model, loaded_prim, "WEIGHTS_0" );
+
+    bool joints_valid = joints.type == TINYGLTF_TYPE_VEC4
+        && ( joints.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE
+            || joints.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT );
+    bool weights_valid = weights.type == TINYGLTF_TYPE_VEC4
+        && ( weights.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT
+            || weights.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE
+            || weights.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT );
+
+    if ( !joints_valid || !weights_valid ) {
+        log::warn( "[Scene] GLTF Loading: Unsupported JOINTS_0 or WEIGHTS_0 type, the primitive "
+                   "won't be skinned" );
+
+        // Everything on the first joint with a weight of zero, which skinning leaves alone
+        std::fill( skin_vertices.begin(), skin_vertices.end(), SkinVertex {} );
+        return;
+    }
+
+    size_t joint_size = static_cast<size_t>(
+        tinygltf::GetComponentSizeInBytes( static_cast<uint32_t>( joints.componentType ) ) );
+    size_t weight_size = static_cast<size_t>(
+        tinygltf::GetComponentSizeInBytes( static_cast<uint32_t>( weights.componentType ) ) );
+
+    visit_accessor( model, joints, [&]( size_t i, const unsigned char* bytes ) {
+        if ( i < skin_vertices.size() ) {
+            for ( glm::length_t c = 0; c < 4; c++ ) {
+                skin_vertices[i].joints[c] = static_cast<uint16_t>( read_index(
+                    bytes + static_cast<size_t>( c ) * joint_size, joints.componentType ) );
+            }
+        }
+    } );
+
+    visit_accessor( model, weights, [&]( size_t i, const unsigned char* bytes ) {
+        if ( i < skin_vertices.size() ) {
+            for ( glm::length_t c = 0; c < 4; c++ ) {
+                skin_vertices[i].weights[c] = read_normalized(
+                    bytes + static_cast<size_t>( c ) * weight_size, weights.componentType );
+            }
+        }
+    } );
+}
+
+void parse_skins( const tinygltf::Model& model, Scene& scene )
+{
+    for ( const tinygltf::Skin& loaded_skin : model.skins ) {
+        Skin skin;
+
+        for ( int joint : loaded_skin.joints ) {
+            if ( joint < 0 || static_cast<size_t>( joint ) >= model.nodes.size() ) {
+                throw Exception( "[Scene] GLTF loading: Skin has invalid joint {}", joint );
+            }
+
+            skin.joints.push_back( static_cast<size_t>( joint ) );
+        }
+
+        skin.inverse_binds.assign( skin.joints.size(), glm::mat4( 1.f ) );
+
+        if ( loaded_skin.inverseBindMatrices != -1 ) {
+            const tinygltf::Accessor& accessor
+                = model.accessors.at( static_cast<size_t>( loaded_skin.inverseBindMatrices ) );
+
+            if ( accessor.type != TINYGLTF_TYPE_MAT4
+                || accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ) {
+                throw Exception( "[Scene] GLTF loading: Inverse bind matrices have to be float "
+                                 "mat4s" );
+            }
+
+            // Both glTF and GLM are column major
+            visit_accessor( model, accessor, [&]( size_t i, const unsigned char* bytes ) {
+                if ( i < skin.inverse_binds.size() ) {
+                    std::memcpy( &skin.inverse_binds[i], bytes, sizeof( glm::mat4 ) );
+                }
+            } );
+        }
+
+        scene.skins.push_back( std::move( skin ) );
+    }
+}
+
+void parse_animations( const tinygltf::Model& model, Scene& scene )
+{
+    for ( const tinygltf::Animation& loaded_animation : model.animations ) {
+        Animation animation = { .name = loaded_animation.name };
+
+        for ( const tinygltf::AnimationChannel& loaded_channel : loaded_animation.channels ) {
+            const tinygltf::AnimationSampler& sampler
+                = loaded_animation.samplers.at( static_cast<size_t>( loaded_channel.sampler ) );
+
+            AnimationChannel channel;
+
+            if ( loaded_channel.target_node < 0
+                || static_cast<size_t>( loaded_channel.target_node ) >= model.nodes.size() ) {
+                continue;
+            }
+
+            channel.node_id = static_cast<size_t>( loaded_channel.target_node );
+
+            if ( loaded_channel.target_path == "translation" ) {
+                channel.path = AnimationPath::TRANSLATION;
+            } else if ( loaded_channel.target_path == "rotation" ) {
+                channel.path = AnimationPath::ROTATION;
+            } else if ( loaded_channel.target_path == "scale" ) {
+                channel.path = AnimationPath::SCALE;
+            } else {
+                log::warn( "[Scene] GLTF Loading: Animating {} isn't supported, skipping it",
+                    loaded_channel.target_path );
+                continue;
+            }
+
+            if ( sampler.interpolation == "STEP" ) {
+                channel.interpolation = Interpolation::STEP;
+            } else if ( sampler.interpolation == "CUBICSPLINE" ) {
+                channel.interpolation = Interpolation::CUBIC_SPLINE;
+            } else {
+                channel.interpolation = Interpolation::LINEAR;
+            }
+
+            const tinygltf::Accessor& input
+                = model.accessors.at( static_cast<size_t>( sampler.input ) );
+            const tinygltf::Accessor& output
+                = model.accessors.at( static_cast<size_t>( sampler.output ) );
+
+            int expected_type = ( channel.path == AnimationPath::ROTATION ) ? TINYGLTF_TYPE_VEC4
+                                                                            : TINYGLTF_TYPE_VEC3;
+
+            if ( input.type != TINYGLTF_TYPE_SCALAR
+                || input.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT
+                || output.type != expected_type
+                || output.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ) {
+                log::warn( "[Scene] GLTF Loading: Only float keyframes are supported, skipping a "
+                           "channel of animation \"{}\"",
+                    loaded_animation.name );
+                continue;
+            }
+
+            channel.times.resize( input.count );
+            visit_accessor( model, input, [&]( size_t i, const unsigned char* bytes ) {
+                std::memcpy( &channel.times[i], bytes, sizeof( float ) );
+            } );
+
+            size_t values_per_key
+                = ( channel.interpolation == Interpolation::CUBIC_SPLINE ) ? 3 : 1;
+            size_t value_size = ( expected_type == TINYGLTF_TYPE_VEC4 ) ? sizeof( glm::vec4 )
+                                                                          : sizeof( glm::vec3 );
+
+            if ( channel.times.empty() || output.count != channel.times.size() * values_per_key ) {
+                log::warn( "[Scene] GLTF Loading: Keyframe counts don't match up, skipping a "
+                           "channel of animation \"{}\"",
+                    loaded_animation.name );
+                continue;
+            }
+
+            channel.values.assign( output.count, glm::vec4( 0.f ) );
+            visit_accessor( model, output, [&]( size_t i, const unsigned char* bytes ) {
+                std::memcpy( &channel.values[i], bytes, value_size );
+            } );
+
+            animation.duration = std::max( animation.duration, channel.times.back() );
+            animation.channels.push_back( std::move( channel ) );
+        }
+
+        if ( !animation.channels.empty() ) {
+            scene.animations.push_back( std::move( animation ) );
+        }
+    }
+}
+
+}
+
+// These are all the image formats currently supported. If more formats are required, also add to
+// vk::utility::bytes_from_format
+VkFormat get_vk_format( int bits_per_channel, int num_channels, ColorSpace color_space )
+{
+    if ( bits_per_channel == 32 ) {
+        // Assume floating point formats for 32 bits per channel
+        switch ( num_channels ) {
+        case 4:
+            return VK_FORMAT_R32G32B32A32_SFLOAT;
+        default:
+            log::warn(
+                "[Scene] Texture loading: Unsupported 32-bit channel count: {}", num_channels );
+        }
+    } else if ( bits_per_channel == 16 ) {
+        // parse_gltf narrows sRGB images to 8 bits, there's no 16-bit format that decodes them
+        if ( color_space == ColorSpace::SRGB ) {
+            log::warn( "[Scene] Texture loading: 16-bit sRGB textures are sampled as linear" );
+        }
+
+        switch ( num_channels ) {
+        case 4:
+            return VK_FORMAT_R16G16B16A16_UNORM;
+        default:
+            log::warn(
+                "[Scene] Texture loading: Unsupported 16-bit channel count: {}", num_channels );
+        }
+    } else if ( bits_per_channel == 8 ) {
+        switch ( num_channels ) {
+        case 1:
+            return VK_FORMAT_R8_UNORM;
+        case 3:
+            return VK_FORMAT_R8G8B8_UNORM;
+        case 4:
+            if ( color_space == ColorSpace::SRGB ) {
+                return VK_FORMAT_R8G8B8A8_SRGB;
+            }
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        default:
+            log::warn(
+                "[Scene] Texture loading: Unsupported 8-bit channel count: {}", num_channels );
+        }
+    }
+
+    log::warn( "[Scene] Texture loading: Unknown texture format. Returning "
+               "VK_FORMAT_R8G8B8A8_UNORM as default" );
+    return VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+std::vector<std::vector<size_t>> group_by_geometry( const Scene& scene )
+{
+    // Skinned primitives each get their own skin vertices, so they never share with anything
+    using GeometryKey = std::tuple<int, int, size_t, int>;
+
+    std::map<GeometryKey, size_t> group_indices;
+    std::vector<std::vector<size_t>> groups;
+    size_t draw_index = 0;
+
+    for ( const std::unique_ptr<Node>& node : scene.nodes ) {
+        if ( !node->mesh.has_value() ) {
+            continue;
+        }
+
+        for ( const Primitive& primitive : node->mesh.value()->primitives ) {
+            GeometryKey key = { primitive.vertex_offset, primitive.ind_offset, primitive.ind_count,
+                primitive.skin_vertex_offset };
+            auto [it, is_new] = group_indices.try_emplace( key, groups.size() );
+
+            if ( is_new ) {
+                groups.emplace_back();
+            }
+
+            groups[it->second].push_back( draw_index++ );
+        }
+    }
+
+    return groups;
+}
+
+void parse_gltf( std::filesystem::path file_path, Scene& scene,
+    std::vector<geometry::scene::Vertex>& out_global_vertices,
+    std::vector<uint32_t>& out_global_indices,
+    std::vector<std::vector<unsigned char>>& out_texture_pixels )
+{
+    if ( !std::filesystem::exists( file_path ) ) {
+        throw Exception(
+            "[Scene] File \"{}\" does not exist", std::filesystem::absolute( file_path ).string() );
+    }
+
+    std::string ext = file_path.extension().string();
+
+    if ( ext != ".gltf" && ext != ".glb" ) {
+        throw Exception( "[Scene] Invalid file extension loaded: {}", ext );
+    }
+
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    std::string err;
+    std::string warn;
+
+    EncodedImages encoded_images;
+    loader.SetImageLoader( defer_image_decode, &encoded_images );
+
+    bool has_loaded_successfully = false;
+    // Binary files
+    if ( ext == ".glb" ) {
+        has_loaded_successfully
+            = loader.LoadBinaryFromFile( &model, &err, &warn, file_path.string() );
+    } else { // ASCII files
+        has_loaded_successfully
+            = loader.LoadASCIIFromFile( &model, &err, &warn, file_path.string() );
+    }
+
+    // Check for errors and warnings
+    if ( !warn.empty() ) {
+        log::warn( "[Scene] GLTF load: {}", warn.c_str() );
+    }
+
+    if ( !err.empty() ) {
+        log::error( "[Scene] GLTF load: {}", err.c_str() );
+    }
+
+    if ( !has_loaded_successfully ) {
+        throw Exception( "[Scene] An error occurred while loading the scene" );
+    }
+
+    // Image decoding is the bulk of the load time for textured cars, so spread it over all cores.
+    parallel::for_each( encoded_images.size(), [&]( size_t i ) {
+        if ( !encoded_images[i].empty() ) {
+            decode_image( model.images[i], encoded_images[i] );
+        }
+    } );
+    encoded_images = {};
+
+    for ( tinygltf::Material& loaded_mat : model.materials ) {
+        Material new_mat = {};
+
+        new_mat.base_color
+            = double_array_to_vec3( loaded_mat.pbrMetallicRoughness.baseColorFactor );
+        new_mat.base_color_texture_index = loaded_mat.pbrMetallicRoughness.baseColorTexture.index;
+
+        if ( new_mat.base_color_texture_index.value() == -1 ) {
+            new_mat.base_color_texture_index = std::nullopt;
+        }
+
+        new_mat.metallic = static_cast<float>( loaded_mat.pbrMetallicRoughness.metallicFactor );
+        new_mat.roughness = static_cast<float>( loaded_mat.pbrMetallicRoughness.roughnessFactor );
+        new_mat.metallic_roughness_texture_index
+            = loaded_mat.pbrMetallicRoughness.metallicRoughnessTexture.index;
+        if ( new_mat.metallic_roughness_texture_index.value() == -1 ) {
+            new_mat.metallic_roughness_texture_index = std::nullopt;
+        }
+
+        if ( loaded_mat.extensions.count( "KHR_materials_specular" ) != 0 ) {
+            auto specular = loaded_mat.extensions.find( "KHR_materials_specular" )->second;
+            new_mat.specular
+                = static_cast<float>( specular.Get( "specularFactor" ).GetNumberAsDouble() );
+            // newMat.specularTint = specular.Get("specularColorFactor")
+        }
+        if ( loaded_mat.extensions.count( "KHR_materials_ior" ) != 0 ) {
+            new_mat.ior = static_cast<float>( loaded_mat.extensions.find( "KHR_materials_ior" )
+                    ->second.Get( "ior" )
+                    .GetNumberAsDouble() );
+        }
+
+        if ( loaded_mat.extensions.count( "KHR_materials_clearcoat" ) ) {
+            new_mat.clearcoat
+                = static_cast<float>( loaded_mat.extensions.find( "KHR_materials_clearcoat" )
+                        ->second.Get( "clearcoatFactor" )
+                        .GetNumberAsDouble() );
+            new_mat.clearcoat_roughness
+                = static_cast<float>( loaded_mat.extensions.find( "KHR_materials_clearcoat" )
+                        ->second.Get( "clearcoatRoughnessFactor" )
+                        .GetNumberAsDouble() );
+        }
+
+        if ( loaded_mat.extensions.count( "KHR_materials_sheen" ) ) {
+            auto sheen = loaded_mat.extensions.find( "KHR_materials_sheen" )->second;
+            new_mat.sheen_weight = 1.f;
+
+            const tinygltf::Value& color_factor = sheen.Get( "sheenColorFactor" );
+
+            if ( color_factor.IsArray() && color_factor.Size() == 3 ) {
+                new_mat.sheen_tint = glm::vec3( color_factor.Get( 0 ).GetNumberAsDouble(),
+                    color_factor.Get( 1 ).GetNumberAsDouble(),
+                    color_factor.Get( 2 ).GetNumberAsDouble() );
+            }
+            new_mat.sheen_roughness
+                = static_cast<float>( sheen.Get( "sheenRoughnessFactor" ).GetNumberAsDouble() );
+        }
+
+        if ( loaded_mat.extensions.count( "KHR_materials_transmission" ) ) {
+            new_mat.transmission
+                = static_cast<float>( loaded_mat.extensions.find( "KHR_materials_transmission" )
+                        ->second.Get( "transmissionFactor" )
+                        .GetNumberAsDouble() );
+        }
+
+        new_mat.emissive = double_array_to_vec3( loaded_mat.emissiveFactor );
+        if ( loaded_mat.extensions.count( "KHR_materials_emissive_strength" ) ) {
+            new_mat.emissive *= loaded_mat.extensions.find( "KHR_materials_emissive_strength" )
+                                    ->second.Get( "emissiveStrength" )
+                                    .GetNumberAsDouble();
+        }
+        new_mat.emmisive_texture_index = loaded_mat.emissiveTexture.index;
+        if ( new_mat.emmisive_texture_index.value() == -1 ) {
+            new_mat.emmisive_texture_index = std::nullopt;
+        }
+
+        new_mat.normal_texture_index = loaded_mat.normalTexture.index;
+        if ( new_mat.normal_texture_index.value() == -1 ) {
+            new_mat.normal_texture_index = std::nullopt;
+        }
+        new_mat.normal_texture_weight = static_cast<int>( loaded_mat.normalTexture.scale );
+        new_mat.occulusion_texture_index = loaded_mat.occlusionTexture.index;
+        if ( new_mat.occulusion_texture_index.value() == -1 ) {
+            new_mat.occulusion_texture_index = std::nullopt;
+        }
+
+        new_mat.double_sided = loaded_mat.doubleSided;
+        new_mat.unlit = false;
+
+        scene.materials.push_back( new_mat );
+    }
+
+    // Textures
+    for ( tinygltf::Texture& loaded_tex : model.textures ) {
+        Texture new_tex;
+        const tinygltf::Image& loaded_img = model.images[size_t( loaded_tex.source )];
+
+        new_tex.width = loaded_img.width;
+        new_tex.height = loaded_img.height;
+        new_tex.bits_per_channel = loaded_img.bits;
+        new_tex.num_channels = loaded_img.component;
+        scene.textures.push_back( new_tex );
+    }
+
+    // Mark albedo and emission as SRGB.
+    for ( Material& mat : scene.materials ) {
+        if ( mat.base_color_texture_index.has_value() ) {
+            scene.textures[size_t( mat.base_color_texture_index.value() )].color_space
+                = ColorSpace::SRGB;
+        }
+        if ( mat.emmisive_texture_index.has_value() ) {
+            scene.textures[size_t( mat.emmisive_texture_index.value() )].color_space
+                = ColorSpace::SRGB;
+        }
+    }
+
+    // Hand the decoded pixels over. Images are moved out of the model unless a texture shares its
+    // source with an earlier one.
+    std::vector<std::optional<size_t>> image_owners( model.images.size() );
+    out_texture_pixels.resize( model.textures.size() );
+
+    for ( size_t i = 0; i < model.textures.size(); i++ ) {
+        size_t image_idx = size_t( model.textures[i].source );
+
+        if ( image_owners[image_idx].has_value() ) {
+            out_texture_pixels[i] = out_texture_pixels[image_owners[image_idx].value()];
+        } else {
+            out_texture_pixels[i] = std::move( model.images[image_idx].image );
+            image_owners[image_idx] = i;
+        }
+    }
+
+    // Separate pass, since a texture sharing its image with an earlier one copies it unconverted.
+    for ( size_t i = 0; i < model.textures.size(); i++ ) {
+        Texture& texture = scene.textures[i];
+
+        if ( texture.bits_per_channel == 16 && texture.color_space == ColorSpace::SRGB ) {
+            out_texture_pixels[i] = narrow_to_8_bit( out_texture_pixels[i] );
+            texture.bits_per_channel = 8;
+        }
+
+        texture.format
+            = get_vk_format( texture.bits_per_channel, texture.num_channels, texture.color_space );
+    }
+
+    int default_material_id = -1;
+    // Used for pairing children and parents in the scene graph
+    std::vector<std::vector<int>> children_lists;
+
+    // Counting pass: lay out every primitive in the global arrays up front so they get sized once
+    // and the decode below can write vertices in place.
+    std::vector<PrimitiveRange> prim_ranges;
+    size_t vertex_cursor = out_global_vertices.size();
+    size_t index_cursor = out_global_indices.size();
+    size_t skin_vertex_cursor = scene.skin_vertices.size();
+
+    // Where the ranges of each mesh's primitives start in `prim_ranges`, for the nodes after the
+    // first one instancing it. Skinned nodes get geometry of their own to skin.
+    std::vector<std::optional<size_t>> mesh_first_ranges( model.meshes.size() );
+    size_t num_shared = 0;
+
+    for ( const tinygltf::Node& loaded_node : model.nodes ) {
+        if ( loaded_node.mesh == -1 ) {
+            continue;
+        }
+
+        size_t mesh_idx = static_cast<size_t>( loaded_node.mesh );
+        const tinygltf::Mesh& loaded_mesh = model.meshes[mesh_idx];
+        bool can_share = loaded_node.skin == -1;
+
+        if ( can_share && mesh_first_ranges[mesh_idx].has_value() ) {
+            size_t first_range = mesh_first_ranges[mesh_idx].value();
+
+            for ( size_t i = 0; i < loaded_mesh.primitives.size(); i++ ) {
+                PrimitiveRange range = prim_ranges[first_range + i];
+                range.is_shared = true;
+                prim_ranges.push_back( range );
+            }
+
+            num_shared += loaded_mesh.primitives.size();
+            continue;
+        }
+
+        if ( can_share ) {
+            mesh_first_ranges[mesh_idx] = prim_ranges.size();
+        }
+
+        for ( const tinygltf::Primitive& loaded_prim : loaded_mesh.primitives ) {
+            PrimitiveRange range
+                = count_primitive( model, loaded_prim, vertex_cursor, index_cursor );
+            vertex_cursor += range.vertex_count;
+            index_cursor += range.index_count;
+
+            if ( loaded_node.skin != -1 && has_skin_attributes( model, loaded_prim ) ) {
+                range.skin_vertex_offset = skin_vertex_cursor;
+                skin_vertex_cursor += range.vertex_count;
+            }
+
+            prim_ranges.push_back( range );
+        }
+    }
+
+    out_global_vertices.resize( vertex_cursor );
+    out_global_indices.resize( index_cursor );
+    scene.skin_vertices.resize( skin_vertex_cursor );
+
+    // Decoding is deferred until every primitive has its slice, then done in parallel below.
+    struct DecodeJob {
+        const tinygltf::Primitive* loaded_prim;
+        PrimitiveRange range;
+    };
+
+    std::vector<DecodeJob> decode_jobs;
+    decode_jobs.reserve( prim_ranges.size() );
+    size_t prim_cursor = 0;
+
+    // Load Nodes
+    for ( size_t node_idx = 0; node_idx < model.nodes.size(); node_idx++ ) {
+        tinygltf::Node& loaded_node = model.nodes[node_idx];
+        std::unique_ptr<Node> new_node = std::make_unique<Node>();
+
+        // save relavant nodes for demo
+        if ( loaded_node.name == "car_root" ) {
+            scene.demo_scene_nodes.car_parent_id = node_idx;
+        } else if ( loaded_node.name == "wheel_front_left" ) {
+            scene.demo_scene_nodes.wheel_front_left_id = node_idx;
+        } else if ( loaded_node.name == "wheel_front_right" ) {
+            scene.demo_scene_nodes.wheel_front_right_id = node_idx;
+        } else if ( loaded_node.name == "wheel_back_left" ) {
+            scene.demo_scene_nodes.wheel_back_left_id = node_idx;
+        } else if ( loaded_node.name == "wheel_back_right" ) {
+            scene.demo_scene_nodes.wheel_back_right_id = node_idx;
+        }
+
+        new_node->id = node_idx;
+        // Get node transform
+        if ( loaded_node.matrix.size() ) {
+            const std::vector<double>& mat = loaded_node.matrix;
+            new_node->transform = glm::mat4( mat[0], mat[1], mat[2], mat[3], mat[4], mat[5], mat[6],
+                mat[7], mat[8], mat[9], mat[10], mat[11], mat[12], mat[13], mat[14], mat[15] );
+        } else {
+            // Attempt to recover from individual transforms
+
+            glm::vec3 translation = glm::vec3( 0.f );
+            glm::quat rotation = glm::quat();
+            glm::vec3 scale = glm::vec3( 1.f );
+
+            if ( loaded_node.translation.size() ) {
+                translation = glm::vec3( loaded_node.translation[0], loaded_node.translation[1],
+                    loaded_node.translation[2] );
+            }
+            if ( loaded_node.rotation.size() ) {
+                // GLM's quat expects WXYZ order, but GLTF uses XYZW order
+                rotation = glm::quat( static_cast<float>( loaded_node.rotation[3] ),
+                    static_cast<float>( loaded_node.rotation[0] ),
+                    static_cast<float>( loaded_node.rotation[1] ),
+                    static_cast<float>( loaded_node.rotation[2] ) );
+            }
+            if ( loaded_node.scale.size() ) {
+                scale
+                    = glm::vec3( loaded_node.scale[0], loaded_node.scale[1], loaded_node.scale[2] );
+            }
+
+            // Combine translate, rotation, and scale
+            // Build transform: translate * rotate * scale
+            new_node->transform = glm::translate( glm::mat4( 1.0f ), translation )
+                * glm::mat4_cast( rotation ) * glm::scale( glm::mat4( 1.0f ), scale );
+        }
+
+        new_node->inv_transform = glm::inverse( new_node->transform );
+        new_node->inv_transpose = glm::inverseTranspose( new_node->transform );
+
+        children_lists.push_back( loaded_node.children );
+
+        // Load the mesh or camera of the node. Every node gets a Mesh of its own since the
+        // primitives carry their node, but instances of a mesh share its vertices and indices.
+        if ( loaded_node.mesh != -1 ) {
+            new_node->mesh = std::make_unique<Mesh>();
+            const tinygltf::Mesh& loaded_mesh
+                = model.meshes[static_cast<size_t>( loaded_node.mesh )];
+
+            // Load primitives
+            for ( const tinygltf::Primitive& loaded_prim : loaded_mesh.primitives ) {
+                Primitive new_prim;
+                new_prim.node_id = static_cast<int>( node_idx );
+                new_prim.material_id = loaded_prim.material;
+                if ( new_prim.material_id == -1 ) {
+                    // Creates a default, white material if a prim is not assigned a material in
+                    // the gltf file
+                    if ( default_material_id == -1 ) {
+                        Material default_material = Material();
+                        default_material_id = static_cast<int>( scene.materials.size() );
+                        scene.materials.push_back( default_material );
+                    }
+                    new_prim.material_id = default_material_id;
+                }
+                if ( loaded_prim.mode != 4 ) {
+                    log::warn( "[Scene] GLTF Loading: Mesh detected that uses a mode other than "
+                               "TRIANGLES. This is "
+                               "currently unsupported." );
+                }
+
+                const PrimitiveRange& range = prim_ranges[prim_cursor++];
+
+                new_prim.vertex_offset = static_cast<int>( range.vertex_offset );
+                new_prim.ind_offset = static_cast<int>( range.index_offset );
+                new_prim.ind_count = range.index_count;
+                new_prim.is_indexed = loaded_prim.indices != -1;
+
+                if ( range.skin_vertex_offset.has_value() ) {
+                    new_prim.skin_id = loaded_node.skin;
+                    new_prim.skin_vertex_offset = static_cast<int>( *range.skin_vertex_offset );
+                }
+
+                if ( !range.is_shared ) {
+                    decode_jobs.push_back( { &loaded_prim, range } );
+                }
+
+                new_node->mesh.value()->primitives.push_back( new_prim );
+            }
+        } else {
+            new_node->mesh = std::nullopt;
+        }
+
+        scene.nodes.push_back( std::move( new_node ) );
+    }
+
+    // Every job writes to a disjoint slice of the global arrays and only reads from the model, so
+    // there's nothing to synchronize besides the per-job stats.
+    std::vector<IngestStats> job_stats( decode_jobs.size() );
+
+    parallel::for_each( decode_jobs.size(), [&]( size_t i ) {
+        const DecodeJob& job = decode_jobs[i];
+        decode_primitive( model, *job.loaded_prim,
+            std::span( out_global_vertices )
+                .subspan( job.range.vertex_offset, job.range.vertex_count ),
+            std::span( out_global_indices )
+                .subspan( job.range.index_offset, job.range.index_count ),
+            job_stats[i] );
+
+        if ( job.range.skin_vertex_offset.has_value() ) {
+            decode_skin( model, *job.loaded_prim,
+                std::span( scene.skin_vertices )
+                    .subspan( *job.range.skin_vertex_offset, job.range.vertex_count ) );
+        }
+    } );
+
+    IngestStats stats;
+    for ( const IngestStats& job_stat : job_stats ) {
+        stats.position_bytes += job_stat.position_bytes;
+        stats.normal_bytes += job_stat.normal_bytes;
+        stats.uv_bytes += job_stat.uv_bytes;
+        stats.index_bytes += job_stat.index_bytes;
+    }
+
+    size_t source_bytes = 0;
+    for ( const tinygltf::Buffer& buffer : model.buffers ) {
+        source_bytes += buffer.data.size();
+    }
+
+    log::info( "[Scene] GLTF ingestion: {} vertices, {} indices from {} bytes of buffers over {} "
+               "threads, {} of {} primitives instanced. Bytes copied: positions {}, normals {}, "
+               "uvs {}, indices {}",
+        out_global_vertices.size(), out_global_indices.size(), source_bytes,
+        std::min( parallel::worker_count(), decode_jobs.size() ), num_shared, prim_ranges.size(),
+        stats.position_bytes, stats.normal_bytes, stats.uv_bytes, stats.index_bytes );
+
+    // Nodes are created serially above, so scene.nodes[i] is always GLTF node i no matter how
+    // decoding is scheduled. Still check it here since the wiring relies on it.
+    for ( size_t i = 0; i < scene.nodes.size(); i++ ) {
+        std::unique_ptr<Node>& node = scene.nodes[i];
+        if ( node->id != i ) {
+            throw Exception( "[Scene] GLTF loading: Node {} was stored at index {}", node->id, i );
+        }
+
+        for ( int child : children_lists[i] ) {
+            if ( child < 0 || static_cast<size_t>( child ) >= scene.nodes.size() ) {
+                throw Exception( "[Scene] GLTF loading: Node {} has invalid child {}", i, child );
+            }
+
+            std::unique_ptr<Node>& child_node = scene.nodes[static_cast<size_t>( child )];
+            if ( child_node->parent != nullptr ) {
+                throw Exception(
+                    "[Scene] GLTF loading: Node {} has more than one parent", child_node->id );
+            }
+
+            child_node->parent = node.get();
+            node->children.push_back( child_node.get() );
+        }
+    }
+
+    parse_skins( model, scene );
+    parse_animations( model, scene );
+
+    log::info( "[Scene] GLTF loading: {} skins over {} vertices, {} animations", scene.skins.size(),
+        scene.skin_vertices.size(), scene.animations.size() );
+}
+
+} // namespace racecar::scene
@@ -4,6 +4,7 @@
 #include "../engine/uniform_buffer.hpp"
 #include "../geometry/scene_mesh.hpp"
 
+#include <glm/ext/vector_uint4_sized.hpp>
 #include <glm/glm.hpp>
 #include <tiny_gltf.h>
 
@@ -65,6 +66,21 @@ struct Texture {
     int num_channels = 0;
 
     ColorSpace color_space = ColorSpace::UNORM;
+
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t mip_levels = 1; ///< Levels present in the source pixels, not necessarily on the GPU.
+};
+
+/// Most coarser versions a primitive gets, see `geometry::scene::generate_lods`.
+constexpr size_t MAX_LODS = 4;
+
+/// A coarser version of a primitive, drawn with the primitive's vertices but its own indices.
+struct Lod {
+    int ind_offset = -1;
+    size_t ind_count = 0;
+
+    /// How far off the simplified surface may be from the original, in object space.
+    float error = 0.f;
 };
 
 /// A primitive is a basic association of geometry data along with a single material.
@@ -78,6 +94,13 @@ struct Primitive {
     int ind_offset = -1;
     size_t ind_count = 0; /// Index count is in actual indices, not in bytes.
     bool is_indexed = true;
+
+    /// Skinned primitives have a `SkinVertex` per vertex in `Scene::skin_vertices`, starting here.
+    int skin_id = -1;
+    int skin_vertex_offset = -1;
+
+    /// From finer to coarser, the primitive itself being the finest. At most `MAX_LODS`.
+    std::vector<Lod> lods;
 };
 
 /// A mesh is divided into primitive surfaces that may each have a different material
@@ -98,6 +121,39 @@ struct Node {
     size_t id;
 };
 
+/// JOINTS_0 and WEIGHTS_0 of a vertex. The joints index into `Skin::joints`.
+struct SkinVertex {
+    glm::u16vec4 joints = glm::u16vec4( 0 );
+    glm::vec4 weights = glm::vec4( 0.f );
+};
+
+struct Skin {
+    std::vector<size_t> joints; ///< Node ids.
+    std::vector<glm::mat4> inverse_binds; ///< One per joint, identity when the file has none.
+};
+
+enum class AnimationPath : uint32_t { TRANSLATION, ROTATION, SCALE };
+
+enum class Interpolation : uint32_t { LINEAR, STEP, CUBIC_SPLINE };
+
+/// Keyframes of one property of one node. Rotations are XYZW quaternions, translations and scales
+/// leave W unused. Cubic splines have an in-tangent, the value and an out-tangent per key, in that
+/// order, so three values for every time.
+struct AnimationChannel {
+    size_t node_id = 0;
+    AnimationPath path = AnimationPath::TRANSLATION;
+    Interpolation interpolation = Interpolation::LINEAR;
+
+    std::vector<float> times;
+    std::vector<glm::vec4> values;
+};
+
+struct Animation {
+    std::string name;
+    std::vector<AnimationChannel> channels;
+    float duration = 0.f; ///< Last keyframe time of any channel, in seconds.
+};
+
 struct DemoSceneNodes {
     // Node Ids for getting and setting model matrices
     std::optional<size_t> car_parent_id = std::nullopt;
@@ -114,16 +170,30 @@ struct Scene {
 
     std::optional<size_t> hdri_index;
     DemoSceneNodes demo_scene_nodes;
+
+    std::vector<Skin> skins;
+    std::vector<SkinVertex> skin_vertices;
+    std::vector<Animation> animations;
 };
 
+VkFormat get_vk_format( int bits_per_channel, int num_channels, ColorSpace color_space );
+
+/// Draw indices of every node's primitives, grouped by the vertices and indices they draw. Nodes
+/// instancing the same glTF mesh share its geometry, see `parse_gltf`, so work on the geometry
+/// itself only has to be done for the first primitive of each group. Groups are in the order of
+/// their first draw, and each group in draw order.
+std::vector<std::vector<size_t>> group_by_geometry( const Scene& scene );
+
+/// CPU-only half of `load_gltf`, doesn't touch Vulkan so tools can use it too.
+/// `out_texture_pixels[i]` receives the decoded pixels of `scene.textures[i]`.
+void parse_gltf( std::filesystem::path file_path, Scene& scene,
+    std::vector<geometry::scene::Vertex>& out_vertices, std::vector<uint32_t>& out_indices,
+    std::vector<std::vector<unsigned char>>& out_texture_pixels );
+
 void load_gltf( vk::Common& vulkan, engine::State& engine, std::filesystem::path file_path,
     Scene& scene, std::vector<geometry::scene::Vertex>& out_vertices,
     std::vector<uint32_t>& out_indices );
 
 bool load_hdri( vk::Common vulkan, engine::State& engine, std::string file_path, Scene& scene );
 
-void propagate_transform( vk::Common vulkan, engine::State& engine, Scene& scene,
-    std::vector<UniformBuffer<ub_data::ModelMat>>& model_mat_uniform_buffers, size_t start_node_id,
-    glm::mat4 transform, std::vector<bool>& discovered );
-
 } // namespace racecar::scene
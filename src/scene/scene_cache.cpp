@@ -0,0 +1,915 @@
+#include "scene_cache.hpp"
+
+#include "../log.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace racecar::scene {
+
+namespace {
+
+constexpr std::array<char, 4> MAGIC = { 'R', 'C', 'S', 'C' };
+
+/// Every section starts on this alignment so views into the mapping are aligned too.
+constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+struct Section {
+    uint64_t offset = 0; ///< From the start of the file.
+    uint64_t count = 0; ///< In elements, not bytes.
+};
+
+struct Header {
+    std::array<char, 4> magic = MAGIC;
+    uint32_t version = SCENE_CACHE_VERSION;
+    uint64_t source_size = 0;
+    int64_t source_write_time = 0;
+    uint32_t vertex_size = sizeof( geometry::scene::Vertex );
+    uint32_t padding = 0;
+
+    Section vertices;
+    Section indices;
+    Section primitives;
+    Section nodes;
+    Section children;
+    Section materials;
+    Section textures;
+    Section texture_data;
+
+    Section animations;
+    Section channels;
+    Section key_times;
+    Section key_values;
+    Section skins;
+    Section skin_joints;
+    Section inverse_binds;
+    Section skin_vertices;
+    Section lods;
+
+    /// car_root, then wheels front left/right and back left/right. -1 if missing.
+    std::array<int64_t, 5> demo_nodes = { -1, -1, -1, -1, -1 };
+};
+
+struct CachedPrimitive {
+    int32_t material_id = -1;
+    int32_t vertex_offset = -1;
+    int32_t ind_offset = -1;
+    uint32_t is_indexed = 1;
+    uint64_t ind_count = 0;
+    int32_t skin_id = -1;
+    int32_t skin_vertex_offset = -1;
+    uint32_t first_lod = 0; ///< Into the LODs section.
+    uint32_t lod_count = 0;
+};
+
+struct CachedLod {
+    int32_t ind_offset = -1;
+    float error = 0.f;
+    uint64_t ind_count = 0;
+};
+
+struct CachedNode {
+    glm::mat4 transform = glm::mat4( 1.f );
+    uint32_t has_mesh = 0;
+    uint32_t first_primitive = 0;
+    uint32_t primitive_count = 0;
+    uint32_t first_child = 0;
+    uint32_t child_count = 0;
+    uint32_t padding[3] = {};
+};
+
+struct CachedMaterial {
+    glm::vec3 base_color;
+    float metallic;
+    glm::vec3 specular_tint;
+    float roughness;
+    glm::vec3 sheen_tint;
+    float specular;
+    glm::vec3 emissive;
+    float ior;
+
+    float sheen_weight;
+    float sheen_roughness;
+    float transmission;
+    float clearcoat;
+    float clearcoat_roughness;
+    int32_t normal_texture_weight;
+    uint32_t unlit;
+    uint32_t double_sided;
+
+    int32_t base_color_texture_index;
+    int32_t metallic_roughness_texture_index;
+    int32_t emissive_texture_index;
+    int32_t normal_texture_index;
+    int32_t occlusion_texture_index;
+    uint32_t type;
+    uint32_t padding[2];
+};
+
+struct CachedTexture {
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t bits_per_channel = 0;
+    int32_t num_channels = 0;
+    uint32_t color_space = 0;
+    uint32_t format = 0;
+    uint32_t mip_levels = 1;
+    uint32_t padding = 0;
+    uint64_t offset = 0; ///< Into the texture data section.
+    uint64_t size = 0;
+};
+
+/// Names longer than this get cut off, they're only used for the GUI.
+constexpr size_t MAX_ANIMATION_NAME = 64;
+
+struct CachedAnimation {
+    std::array<char, MAX_ANIMATION_NAME> name = {};
+    float duration = 0.f;
+    uint32_t first_channel = 0;
+    uint32_t channel_count = 0;
+    uint32_t padding = 0;
+};
+
+struct CachedChannel {
+    uint64_t node_id = 0;
+    uint32_t path = 0;
+    uint32_t interpolation = 0;
+    uint64_t first_time = 0; ///< Into the key times section.
+    uint64_t time_count = 0;
+    uint64_t first_value = 0; ///< Into the key values section.
+    uint64_t value_count = 0;
+};
+
+/// Joints and inverse bind matrices are parallel, so they share a range.
+struct CachedSkin {
+    uint64_t first_joint = 0;
+    uint64_t joint_count = 0;
+};
+
+static_assert( std::is_trivially_copyable_v<Header> );
+static_assert( std::is_trivially_copyable_v<CachedPrimitive> );
+static_assert( std::is_trivially_copyable_v<CachedLod> );
+static_assert( std::is_trivially_copyable_v<CachedNode> );
+static_assert( std::is_trivially_copyable_v<CachedMaterial> );
+static_assert( std::is_trivially_copyable_v<CachedTexture> );
+static_assert( std::is_trivially_copyable_v<CachedAnimation> );
+static_assert( std::is_trivially_copyable_v<CachedChannel> );
+static_assert( std::is_trivially_copyable_v<CachedSkin> );
+static_assert( std::is_trivially_copyable_v<SkinVertex> );
+static_assert( std::is_trivially_copyable_v<geometry::scene::Vertex> );
+
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t write_time = 0;
+};
+
+std::optional<SourceStamp> stamp_source( const std::filesystem::path& source_path )
+{
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size( source_path, error );
+    if ( error ) {
+        return std::nullopt;
+    }
+
+    std::filesystem::file_time_type write_time
+        = std::filesystem::last_write_time( source_path, error );
+    if ( error ) {
+        return std::nullopt;
+    }
+
+    return SourceStamp {
+        .size = size,
+        .write_time = static_cast<int64_t>( write_time.time_since_epoch().count() ),
+    };
+}
+
+int32_t from_optional( std::optional<int> index )
+{
+    return index.has_value() ? index.value() : -1;
+}
+
+std::optional<int> to_optional( int32_t index )
+{
+    return index == -1 ? std::nullopt : std::optional<int>( index );
+}
+
+std::optional<int64_t> from_optional_id( std::optional<size_t> id )
+{
+    return id.has_value() ? std::optional<int64_t>( static_cast<int64_t>( id.value() ) )
+                          : std::nullopt;
+}
+
+std::optional<size_t> to_optional_id( int64_t id )
+{
+    return id < 0 ? std::nullopt : std::optional<size_t>( static_cast<size_t>( id ) );
+}
+
+CachedMaterial to_cached( const Material& material )
+{
+    return {
+        .base_color = material.base_color,
+        .metallic = material.metallic,
+        .specular_tint = material.specular_tint,
+        .roughness = material.roughness,
+        .sheen_tint = material.sheen_tint,
+        .specular = material.specular,
+        .emissive = material.emissive,
+        .ior = material.ior,
+        .sheen_weight = material.sheen_weight,
+        .sheen_roughness = material.sheen_roughness,
+        .transmission = material.transmission,
+        .clearcoat = material.clearcoat,
+        .clearcoat_roughness = material.clearcoat_roughness,
+        .normal_texture_weight = material.normal_texture_weight,
+        .unlit = material.unlit,
+        .double_sided = material.double_sided,
+        .base_color_texture_index = from_optional( material.base_color_texture_index ),
+        .metallic_roughness_texture_index
+        = from_optional( material.metallic_roughness_texture_index ),
+        .emissive_texture_index = from_optional( material.emmisive_texture_index ),
+        .normal_texture_index = from_optional( material.normal_texture_index ),
+        .occlusion_texture_index = from_optional( material.occulusion_texture_index ),
+        .type = static_cast<uint32_t>( material.type ),
+        .padding = {},
+    };
+}
+
+Material from_cached( const CachedMaterial& cached )
+{
+    return {
+        .base_color = cached.base_color,
+        .base_color_texture_index = to_optional( cached.base_color_texture_index ),
+        .metallic = cached.metallic,
+        .roughness = cached.roughness,
+        .metallic_roughness_texture_index = to_optional( cached.metallic_roughness_texture_index ),
+        .specular = cached.specular,
+        .specular_tint = cached.specular_tint,
+        .ior = cached.ior,
+        .sheen_weight = cached.sheen_weight,
+        .sheen_tint = cached.sheen_tint,
+        .sheen_roughness = cached.sheen_roughness,
+        .transmission = cached.transmission,
+        .clearcoat = cached.clearcoat,
+        .clearcoat_roughness = cached.clearcoat_roughness,
+        .emissive = cached.emissive,
+        .emmisive_texture_index = to_optional( cached.emissive_texture_index ),
+        .unlit = cached.unlit != 0,
+        .normal_texture_index = to_optional( cached.normal_texture_index ),
+        .normal_texture_weight = cached.normal_texture_weight,
+        .occulusion_texture_index = to_optional( cached.occlusion_texture_index ),
+        .double_sided = cached.double_sided != 0,
+        .type = static_cast<MaterialType>( cached.type ),
+    };
+}
+
+/// Maps a whole file read-only. Returns nullptr if it can't be opened or is empty.
+std::shared_ptr<const unsigned char> map_file( const std::filesystem::path& path, size_t& out_size )
+{
+#if defined( _WIN32 )
+    HANDLE file = CreateFileW( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+    if ( file == INVALID_HANDLE_VALUE ) {
+        return nullptr;
+    }
+
+    LARGE_INTEGER file_size = {};
+    if ( !GetFileSizeEx( file, &file_size ) || file_size.QuadPart == 0 ) {
+        CloseHandle( file );
+        return nullptr;
+    }
+
+    // The view keeps the file alive, so the handles can go right away.
+    HANDLE mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    CloseHandle( file );
+    if ( mapping == nullptr ) {
+        return nullptr;
+    }
+
+    void* view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( mapping );
+    if ( view == nullptr ) {
+        return nullptr;
+    }
+
+    out_size = static_cast<size_t>( file_size.QuadPart );
+    return std::shared_ptr<const unsigned char>( static_cast<const unsigned char*>( view ),
+        []( const unsigned char* data ) { UnmapViewOfFile( data ); } );
+#else
+    int file = open( path.c_str(), O_RDONLY );
+    if ( file == -1 ) {
+        return nullptr;
+    }
+
+    struct stat file_stat = {};
+    if ( fstat( file, &file_stat ) != 0 || file_stat.st_size <= 0 ) {
+        close( file );
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>( file_stat.st_size );
+    void* view = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, file, 0 );
+    close( file );
+    if ( view == MAP_FAILED ) {
+        return nullptr;
+    }
+
+    out_size = size;
+    return std::shared_ptr<const unsigned char>( static_cast<const unsigned char*>( view ),
+        [size]( const unsigned char* data ) {
+            munmap( const_cast<unsigned char*>( data ), size );
+        } );
+#endif
+}
+
+template <typename T> bool section_fits( const Section& section, size_t file_size )
+{
+    if ( section.offset % SECTION_ALIGNMENT != 0 || section.offset > file_size ) {
+        return false;
+    }
+
+    return section.count <= ( file_size - section.offset ) / sizeof( T );
+}
+
+/// Whether `[offset, offset + count)` lies within `size` elements. An offset of -1 means unset and
+/// never fits.
+bool range_fits( int32_t offset, uint64_t count, uint64_t size )
+{
+    return offset >= 0 && static_cast<uint64_t>( offset ) <= size
+        && count <= size - static_cast<uint64_t>( offset );
+}
+
+/// Whether every index in `[ind_offset, ind_offset + ind_count)` stays within the `num_vertices`
+/// after the primitive's vertex offset. The range itself has to fit already.
+bool indices_fit( const uint32_t* indices, int32_t ind_offset, uint64_t ind_count,
+    uint64_t num_vertices )
+{
+    const uint32_t* begin = indices + ind_offset;
+    const uint32_t* end = begin + ind_count;
+    return std::all_of( begin, end, [&]( uint32_t index ) { return index < num_vertices; } );
+}
+
+/// Checks every primitive's and LOD's geometry ranges against the vertex and index sections, so a
+/// malformed cache gets rejected instead of handing out-of-range draws to the GPU.
+bool primitives_fit( const SceneCache& cache, const Header& header )
+{
+    std::vector<CachedPrimitive> primitives( header.primitives.count );
+    std::memcpy( primitives.data(), cache.mapping.get() + header.primitives.offset,
+        primitives.size() * sizeof( CachedPrimitive ) );
+
+    std::vector<CachedLod> lods( header.lods.count );
+    std::memcpy(
+        lods.data(), cache.mapping.get() + header.lods.offset, lods.size() * sizeof( CachedLod ) );
+
+    // Sections start on `SECTION_ALIGNMENT`, so the indices can be read in place
+    const uint32_t* indices
+        = reinterpret_cast<const uint32_t*>( cache.mapping.get() + header.indices.offset );
+
+    for ( const CachedPrimitive& prim : primitives ) {
+        if ( !range_fits( prim.vertex_offset, 0, header.vertices.count )
+            || !range_fits( prim.ind_offset, prim.ind_count, header.indices.count )
+            || static_cast<uint64_t>( prim.first_lod ) + prim.lod_count > lods.size() ) {
+            return false;
+        }
+
+        uint64_t num_vertices = header.vertices.count - static_cast<uint64_t>( prim.vertex_offset );
+
+        if ( !indices_fit( indices, prim.ind_offset, prim.ind_count, num_vertices ) ) {
+            return false;
+        }
+
+        for ( uint32_t lod = 0; lod < prim.lod_count; lod++ ) {
+            const CachedLod& cached_lod = lods[prim.first_lod + lod];
+
+            if ( !range_fits( cached_lod.ind_offset, cached_lod.ind_count, header.indices.count )
+                || !indices_fit(
+                    indices, cached_lod.ind_offset, cached_lod.ind_count, num_vertices ) ) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/// Copies a section's elements out of the mapping. Sections were validated on open.
+template <typename T> std::vector<T> read_section( const SceneCache& cache, const Section& section )
+{
+    std::vector<T> elements( section.count );
+    std::memcpy( elements.data(), cache.mapping.get() + section.offset, section.count * sizeof( T ) );
+    return elements;
+}
+
+Header read_header( const SceneCache& cache )
+{
+    Header header;
+    std::memcpy( &header, cache.mapping.get(), sizeof( Header ) );
+    return header;
+}
+
+}
+
+std::filesystem::path scene_cache_path( const std::filesystem::path& source_path )
+{
+    std::filesystem::path cache_path = source_path;
+    return cache_path.replace_extension( SCENE_CACHE_EXTENSION );
+}
+
+void write_scene_cache( const std::filesystem::path& cache_path,
+    const std::filesystem::path& source_path, const Scene& scene,
+    std::span<const geometry::scene::Vertex> vertices, std::span<const uint32_t> indices,
+    std::span<const std::vector<unsigned char>> texture_pixels )
+{
+    if ( texture_pixels.size() != scene.textures.size() ) {
+        throw Exception( "[Scene] Cache: Got {} texture blobs for {} textures",
+            texture_pixels.size(), scene.textures.size() );
+    }
+
+    // Flatten the hierarchy into tables that index into each other.
+    std::vector<CachedNode> nodes;
+    std::vector<CachedPrimitive> primitives;
+    std::vector<CachedLod> lods;
+    std::vector<uint32_t> children;
+
+    for ( const std::unique_ptr<Node>& node : scene.nodes ) {
+        CachedNode cached_node = {
+            .transform = node->transform,
+            .has_mesh = node->mesh.has_value(),
+            .first_primitive = static_cast<uint32_t>( primitives.size() ),
+            .first_child = static_cast<uint32_t>( children.size() ),
+        };
+
+        if ( node->mesh.has_value() ) {
+            for ( const Primitive& prim : node->mesh.value()->primitives ) {
+                primitives.push_back( {
+                    .material_id = prim.material_id,
+                    .vertex_offset = prim.vertex_offset,
+                    .ind_offset = prim.ind_offset,
+                    .is_indexed = prim.is_indexed,
+                    .ind_count = prim.ind_count,
+                    .skin_id = prim.skin_id,
+                    .skin_vertex_offset = prim.skin_vertex_offset,
+                    .first_lod = static_cast<uint32_t>( lods.size() ),
+                    .lod_count = static_cast<uint32_t>( prim.lods.size() ),
+                } );
+
+                for ( const Lod& lod : prim.lods ) {
+                    lods.push_back( {
+                        .ind_offset = lod.ind_offset,
+                        .error = lod.error,
+                        .ind_count = lod.ind_count,
+                    } );
+                }
+            }
+        }
+
+        for ( const Node* child : node->children ) {
+            children.push_back( static_cast<uint32_t>( child->id ) );
+        }
+
+        cached_node.primitive_count
+            = static_cast<uint32_t>( primitives.size() ) - cached_node.first_primitive;
+        cached_node.child_count = static_cast<uint32_t>( children.size() ) - cached_node.first_child;
+        nodes.push_back( cached_node );
+    }
+
+    std::vector<CachedMaterial> materials;
+    for ( const Material& material : scene.materials ) {
+        materials.push_back( to_cached( material ) );
+    }
+
+    // Keyframes of all animations go into two flat arrays that channels index into.
+    std::vector<CachedAnimation> animations;
+    std::vector<CachedChannel> channels;
+    std::vector<float> key_times;
+    std::vector<glm::vec4> key_values;
+
+    for ( const Animation& animation : scene.animations ) {
+        CachedAnimation cached_animation = {
+            .duration = animation.duration,
+            .first_channel = static_cast<uint32_t>( channels.size() ),
+            .channel_count = static_cast<uint32_t>( animation.channels.size() ),
+        };
+        std::copy_n( animation.name.begin(),
+            std::min( animation.name.size(), MAX_ANIMATION_NAME - 1 ),
+            cached_animation.name.begin() );
+
+        for ( const AnimationChannel& channel : animation.channels ) {
+            channels.push_back( {
+                .node_id = channel.node_id,
+                .path = static_cast<uint32_t>( channel.path ),
+                .interpolation = static_cast<uint32_t>( channel.interpolation ),
+                .first_time = key_times.size(),
+                .time_count = channel.times.size(),
+                .first_value = key_values.size(),
+                .value_count = channel.values.size(),
+            } );
+            key_times.insert( key_times.end(), channel.times.begin(), channel.times.end() );
+            key_values.insert( key_values.end(), channel.values.begin(), channel.values.end() );
+        }
+
+        animations.push_back( cached_animation );
+    }
+
+    std::vector<CachedSkin> skins;
+    std::vector<uint64_t> skin_joints;
+    std::vector<glm::mat4> inverse_binds;
+
+    for ( const Skin& skin : scene.skins ) {
+        skins.push_back( { .first_joint = skin_joints.size(), .joint_count = skin.joints.size() } );
+        skin_joints.insert( skin_joints.end(), skin.joints.begin(), skin.joints.end() );
+        inverse_binds.insert(
+            inverse_binds.end(), skin.inverse_binds.begin(), skin.inverse_binds.end() );
+    }
+
+    std::vector<CachedTexture> textures;
+    uint64_t texture_data_size = 0;
+
+    for ( size_t i = 0; i < scene.textures.size(); i++ ) {
+        const Texture& texture = scene.textures[i];
+        textures.push_back( {
+            .width = texture.width,
+            .height = texture.height,
+            .bits_per_channel = texture.bits_per_channel,
+            .num_channels = texture.num_channels,
+            .color_space = static_cast<uint32_t>( texture.color_space ),
+            .format = static_cast<uint32_t>( texture.format ),
+            .mip_levels = texture.mip_levels,
+            .offset = texture_data_size,
+            .size = texture_pixels[i].size(),
+        } );
+
+        texture_data_size = ( texture_data_size + texture_pixels[i].size() + SECTION_ALIGNMENT - 1 )
+            / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    std::ofstream file( cache_path, std::ios::binary | std::ios::trunc );
+    if ( !file.is_open() ) {
+        throw Exception( "[Scene] Cache: Could not open \"{}\" for writing", cache_path.string() );
+    }
+
+    Header header;
+    if ( std::optional<SourceStamp> stamp = stamp_source( source_path ) ) {
+        header.source_size = stamp->size;
+        header.source_write_time = stamp->write_time;
+    }
+
+    const DemoSceneNodes& demo = scene.demo_scene_nodes;
+    std::array<std::optional<int64_t>, 5> demo_nodes = {
+        from_optional_id( demo.car_parent_id ),
+        from_optional_id( demo.wheel_front_left_id ),
+        from_optional_id( demo.wheel_front_right_id ),
+        from_optional_id( demo.wheel_back_left_id ),
+        from_optional_id( demo.wheel_back_right_id ),
+    };
+    for ( size_t i = 0; i < demo_nodes.size(); i++ ) {
+        header.demo_nodes[i] = demo_nodes[i].value_or( -1 );
+    }
+
+    // Header gets rewritten at the end once all the section offsets are known.
+    file.write( reinterpret_cast<const char*>( &header ), sizeof( Header ) );
+
+    auto pad_to_alignment = [&]() {
+        static constexpr std::array<char, SECTION_ALIGNMENT> zeroes = {};
+        uint64_t position = static_cast<uint64_t>( file.tellp() );
+        uint64_t padding = ( SECTION_ALIGNMENT - position % SECTION_ALIGNMENT ) % SECTION_ALIGNMENT;
+        file.write( zeroes.data(), static_cast<std::streamsize>( padding ) );
+    };
+
+    auto write_section = [&]<typename T>( std::span<const T> elements ) -> Section {
+        pad_to_alignment();
+        Section section = {
+            .offset = static_cast<uint64_t>( file.tellp() ),
+            .count = elements.size(),
+        };
+        file.write( reinterpret_cast<const char*>( elements.data() ),
+            static_cast<std::streamsize>( elements.size_bytes() ) );
+        return section;
+    };
+
+    header.vertices = write_section( vertices );
+    header.indices = write_section( indices );
+    header.primitives = write_section( std::span<const CachedPrimitive>( primitives ) );
+    header.nodes = write_section( std::span<const CachedNode>( nodes ) );
+    header.children = write_section( std::span<const uint32_t>( children ) );
+    header.materials = write_section( std::span<const CachedMaterial>( materials ) );
+    header.textures = write_section( std::span<const CachedTexture>( textures ) );
+    header.animations = write_section( std::span<const CachedAnimation>( animations ) );
+    header.channels = write_section( std::span<const CachedChannel>( channels ) );
+    header.key_times = write_section( std::span<const float>( key_times ) );
+    header.key_values = write_section( std::span<const glm::vec4>( key_values ) );
+    header.skins = write_section( std::span<const CachedSkin>( skins ) );
+    header.skin_joints = write_section( std::span<const uint64_t>( skin_joints ) );
+    header.inverse_binds = write_section( std::span<const glm::mat4>( inverse_binds ) );
+    header.skin_vertices = write_section( std::span<const SkinVertex>( scene.skin_vertices ) );
+    header.lods = write_section( std::span<const CachedLod>( lods ) );
+
+    pad_to_alignment();
+    header.texture_data = {
+        .offset = static_cast<uint64_t>( file.tellp() ),
+        .count = texture_data_size,
+    };
+
+    for ( size_t i = 0; i < texture_pixels.size(); i++ ) {
+        file.write( reinterpret_cast<const char*>( texture_pixels[i].data() ),
+            static_cast<std::streamsize>( texture_pixels[i].size() ) );
+        if ( i + 1 < texture_pixels.size() ) {
+            pad_to_alignment();
+        }
+    }
+
+    // The last texture may not be padded all the way, make sure the section's size is in the file.
+    uint64_t end = header.texture_data.offset + texture_data_size;
+    while ( static_cast<uint64_t>( file.tellp() ) < end ) {
+        file.put( 0 );
+    }
+
+    file.seekp( 0 );
+    file.write( reinterpret_cast<const char*>( &header ), sizeof( Header ) );
+
+    if ( !file.good() ) {
+        throw Exception( "[Scene] Cache: Failed writing \"{}\"", cache_path.string() );
+    }
+
+    log::info( "[Scene] Cache: Wrote \"{}\" ({} vertices, {} indices, {} nodes, {} textures, {} "
+               "bytes of texture data)",
+        cache_path.string(), vertices.size(), indices.size(), nodes.size(), textures.size(),
+        texture_data_size );
+}
+
+std::optional<SceneCache> open_scene_cache(
+    const std::filesystem::path& cache_path, const std::filesystem::path& source_path )
+{
+    SceneCache cache;
+    cache.mapping = map_file( cache_path, cache.size );
+
+    if ( cache.mapping == nullptr ) {
+        return std::nullopt;
+    }
+
+    if ( cache.size < sizeof( Header ) ) {
+        log::warn( "[Scene] Cache: \"{}\" is too small, ignoring it", cache_path.string() );
+        return std::nullopt;
+    }
+
+    Header header = read_header( cache );
+
+    if ( header.magic != MAGIC || header.version != SCENE_CACHE_VERSION
+        || header.vertex_size != sizeof( geometry::scene::Vertex ) ) {
+        log::warn( "[Scene] Cache: \"{}\" is from another version (v{}, expected v{}), rebake it",
+            cache_path.string(), header.version, SCENE_CACHE_VERSION );
+        return std::nullopt;
+    }
+
+    // A cache without its source is fine, e.g. when only the baked files get shipped.
+    std::optional<SourceStamp> stamp = stamp_source( source_path );
+    if ( stamp.has_value()
+        && ( stamp->size != header.source_size
+            || stamp->write_time != header.source_write_time ) ) {
+        log::warn( "[Scene] Cache: \"{}\" is out of date with \"{}\", rebake it",
+            cache_path.string(), source_path.string() );
+        return std::nullopt;
+    }
+
+    bool sections_fit = section_fits<geometry::scene::Vertex>( header.vertices, cache.size )
+        && section_fits<uint32_t>( header.indices, cache.size )
+        && section_fits<CachedPrimitive>( header.primitives, cache.size )
+        && section_fits<CachedNode>( header.nodes, cache.size )
+        && section_fits<uint32_t>( header.children, cache.size )
+        && section_fits<CachedMaterial>( header.materials, cache.size )
+        && section_fits<CachedTexture>( header.textures, cache.size )
+        && section_fits<unsigned char>( header.texture_data, cache.size )
+        && section_fits<CachedAnimation>( header.animations, cache.size )
+        && section_fits<CachedChannel>( header.channels, cache.size )
+        && section_fits<float>( header.key_times, cache.size )
+        && section_fits<glm::vec4>( header.key_values, cache.size )
+        && section_fits<CachedSkin>( header.skins, cache.size )
+        && section_fits<uint64_t>( header.skin_joints, cache.size )
+        && section_fits<glm::mat4>( header.inverse_binds, cache.size )
+        && section_fits<SkinVertex>( header.skin_vertices, cache.size )
+        && section_fits<CachedLod>( header.lods, cache.size );
+
+    if ( !sections_fit ) {
+        log::warn( "[Scene] Cache: \"{}\" is truncated or malformed, ignoring it",
+            cache_path.string() );
+        return std::nullopt;
+    }
+
+    if ( !primitives_fit( cache, header ) ) {
+        log::warn( "[Scene] Cache: \"{}\" has geometry ranges past its vertices or indices, "
+                   "ignoring it",
+            cache_path.string() );
+        return std::nullopt;
+    }
+
+    return cache;
+}
+
+void read_scene_cache( const SceneCache& cache, Scene& scene,
+    std::vector<geometry::scene::Vertex>& out_vertices, std::vector<uint32_t>& out_indices,
+    std::vector<std::span<const unsigned char>>& out_texture_pixels )
+{
+    Header header = read_header( cache );
+
+    // Geometry is stored exactly how it's laid out in memory, one bulk copy each.
+    out_vertices = read_section<geometry::scene::Vertex>( cache, header.vertices );
+    out_indices = read_section<uint32_t>( cache, header.indices );
+
+    std::vector<CachedPrimitive> primitives = read_section<CachedPrimitive>( cache, header.primitives );
+    std::vector<CachedNode> nodes = read_section<CachedNode>( cache, header.nodes );
+    std::vector<uint32_t> children = read_section<uint32_t>( cache, header.children );
+    std::vector<CachedLod> lods = read_section<CachedLod>( cache, header.lods );
+
+    for ( size_t node_idx = 0; node_idx < nodes.size(); node_idx++ ) {
+        const CachedNode& cached_node = nodes[node_idx];
+        std::unique_ptr<Node> new_node = std::make_unique<Node>();
+
+        new_node->id = node_idx;
+        new_node->transform = cached_node.transform;
+        new_node->inv_transform = glm::inverse( new_node->transform );
+        new_node->inv_transpose = glm::inverseTranspose( new_node->transform );
+
+        if ( static_cast<size_t>( cached_node.first_primitive ) + cached_node.primitive_count
+            > primitives.size() ) {
+            throw Exception( "[Scene] Cache: Node {} has out of range primitives", node_idx );
+        }
+
+        if ( cached_node.has_mesh ) {
+            new_node->mesh = std::make_unique<Mesh>();
+
+            for ( uint32_t i = 0; i < cached_node.primitive_count; i++ ) {
+                const CachedPrimitive& cached_prim = primitives[cached_node.first_primitive + i];
+
+                if ( static_cast<size_t>( cached_prim.first_lod ) + cached_prim.lod_count
+                        > lods.size()
+                    || cached_prim.lod_count > MAX_LODS ) {
+                    throw Exception( "[Scene] Cache: Node {} has out of range LODs", node_idx );
+                }
+
+                std::vector<Lod> prim_lods;
+                for ( uint32_t lod = 0; lod < cached_prim.lod_count; lod++ ) {
+                    const CachedLod& cached_lod = lods[cached_prim.first_lod + lod];
+                    prim_lods.push_back( {
+                        .ind_offset = cached_lod.ind_offset,
+                        .ind_count = static_cast<size_t>( cached_lod.ind_count ),
+                        .error = cached_lod.error,
+                    } );
+                }
+
+                new_node->mesh.value()->primitives.push_back( {
+                    .material_id = cached_prim.material_id,
+                    .node_id = static_cast<int>( node_idx ),
+                    .vertex_offset = cached_prim.vertex_offset,
+                    .ind_offset = cached_prim.ind_offset,
+                    .ind_count = static_cast<size_t>( cached_prim.ind_count ),
+                    .is_indexed = cached_prim.is_indexed != 0,
+                    .skin_id = cached_prim.skin_id,
+                    .skin_vertex_offset = cached_prim.skin_vertex_offset,
+                    .lods = std::move( prim_lods ),
+                } );
+            }
+        }
+
+        scene.nodes.push_back( std::move( new_node ) );
+    }
+
+    for ( size_t node_idx = 0; node_idx < nodes.size(); node_idx++ ) {
+        const CachedNode& cached_node = nodes[node_idx];
+
+        if ( static_cast<size_t>( cached_node.first_child ) + cached_node.child_count
+            > children.size() ) {
+            throw Exception( "[Scene] Cache: Node {} has out of range children", node_idx );
+        }
+
+        for ( uint32_t i = 0; i < cached_node.child_count; i++ ) {
+            size_t child = children[cached_node.first_child + i];
+            if ( child >= scene.nodes.size() ) {
+                throw Exception( "[Scene] Cache: Node {} has invalid child {}", node_idx, child );
+            }
+
+            scene.nodes[child]->parent = scene.nodes[node_idx].get();
+            scene.nodes[node_idx]->children.push_back( scene.nodes[child].get() );
+        }
+    }
+
+    for ( const CachedMaterial& cached_material :
+        read_section<CachedMaterial>( cache, header.materials ) ) {
+        scene.materials.push_back( from_cached( cached_material ) );
+    }
+
+    const unsigned char* texture_data = cache.mapping.get() + header.texture_data.offset;
+
+    for ( const CachedTexture& cached_texture :
+        read_section<CachedTexture>( cache, header.textures ) ) {
+        if ( cached_texture.offset + cached_texture.size > header.texture_data.count ) {
+            throw Exception( "[Scene] Cache: Texture data is out of range" );
+        }
+
+        scene.textures.push_back( {
+            .data = std::nullopt,
+            .width = cached_texture.width,
+            .height = cached_texture.height,
+            .bits_per_channel = cached_texture.bits_per_channel,
+            .num_channels = cached_texture.num_channels,
+            .color_space = static_cast<ColorSpace>( cached_texture.color_space ),
+            .format = static_cast<VkFormat>( cached_texture.format ),
+            .mip_levels = cached_texture.mip_levels,
+        } );
+
+        out_texture_pixels.push_back(
+            { texture_data + cached_texture.offset, static_cast<size_t>( cached_texture.size ) } );
+    }
+
+    std::vector<CachedChannel> channels = read_section<CachedChannel>( cache, header.channels );
+    std::vector<float> key_times = read_section<float>( cache, header.key_times );
+    std::vector<glm::vec4> key_values = read_section<glm::vec4>( cache, header.key_values );
+
+    for ( const CachedAnimation& cached_animation :
+        read_section<CachedAnimation>( cache, header.animations ) ) {
+        if ( static_cast<size_t>( cached_animation.first_channel ) + cached_animation.channel_count
+            > channels.size() ) {
+            throw Exception( "[Scene] Cache: Animation has out of range channels" );
+        }
+
+        Animation animation = {
+            .name = std::string( cached_animation.name.data(),
+                strnlen( cached_animation.name.data(), MAX_ANIMATION_NAME ) ),
+            .duration = cached_animation.duration,
+        };
+
+        for ( uint32_t i = 0; i < cached_animation.channel_count; i++ ) {
+            const CachedChannel& cached_channel = channels[cached_animation.first_channel + i];
+
+            if ( cached_channel.first_time + cached_channel.time_count > key_times.size()
+                || cached_channel.first_value + cached_channel.value_count > key_values.size()
+                || cached_channel.node_id >= scene.nodes.size() ) {
+                throw Exception( "[Scene] Cache: Animation channel is out of range" );
+            }
+
+            auto times_begin
+                = key_times.begin() + static_cast<ptrdiff_t>( cached_channel.first_time );
+            auto times_end = times_begin + static_cast<ptrdiff_t>( cached_channel.time_count );
+            auto values_begin
+                = key_values.begin() + static_cast<ptrdiff_t>( cached_channel.first_value );
+            auto values_end = values_begin + static_cast<ptrdiff_t>( cached_channel.value_count );
+
+            animation.channels.push_back( {
+                .node_id = static_cast<size_t>( cached_channel.node_id ),
+                .path = static_cast<AnimationPath>( cached_channel.path ),
+                .interpolation = static_cast<Interpolation>( cached_channel.interpolation ),
+                .times = std::vector<float>( times_begin, times_end ),
+                .values = std::vector<glm::vec4>( values_begin, values_end ),
+            } );
+        }
+
+        scene.animations.push_back( std::move( animation ) );
+    }
+
+    std::vector<uint64_t> skin_joints = read_section<uint64_t>( cache, header.skin_joints );
+    std::vector<glm::mat4> inverse_binds = read_section<glm::mat4>( cache, header.inverse_binds );
+
+    for ( const CachedSkin& cached_skin : read_section<CachedSkin>( cache, header.skins ) ) {
+        if ( cached_skin.first_joint + cached_skin.joint_count > skin_joints.size()
+            || cached_skin.first_joint + cached_skin.joint_count > inverse_binds.size() ) {
+            throw Exception( "[Scene] Cache: Skin has out of range joints" );
+        }
+
+        auto first = static_cast<ptrdiff_t>( cached_skin.first_joint );
+        auto last = first + static_cast<ptrdiff_t>( cached_skin.joint_count );
+        scene.skins.push_back( {
+            .joints
+            = std::vector<size_t>( skin_joints.begin() + first, skin_joints.begin() + last ),
+            .inverse_binds
+            = std::vector<glm::mat4>( inverse_binds.begin() + first, inverse_binds.begin() + last ),
+        } );
+    }
+
+    scene.skin_vertices = read_section<SkinVertex>( cache, header.skin_vertices );
+
+    DemoSceneNodes& demo = scene.demo_scene_nodes;
+    demo.car_parent_id = to_optional_id( header.demo_nodes[0] );
+    demo.wheel_front_left_id = to_optional_id( header.demo_nodes[1] );
+    demo.wheel_front_right_id = to_optional_id( header.demo_nodes[2] );
+    demo.wheel_back_left_id = to_optional_id( header.demo_nodes[3] );
+    demo.wheel_back_right_id = to_optional_id( header.demo_nodes[4] );
+
+    log::info( "[Scene] Cache: Loaded {} vertices, {} indices, {} nodes and {} textures",
+        out_vertices.size(), out_indices.size(), scene.nodes.size(), scene.textures.size() );
+}
+
+} // namespace racecar::scene
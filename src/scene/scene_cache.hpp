@@ -0,0 +1,57 @@
+#pragma once
+
+#include "scene.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/// Baked scene caches (.rcscene). `racecar-bake` writes everything `load_gltf` would produce,
+/// including tangents, optimized geometry and pre-mipped textures, into one versioned binary file.
+/// Loading one is just a memory map plus a few bulk copies, no glTF parsing or image decoding.
+namespace racecar::scene {
+
+/// Bump whenever the layout of the file, or how what's in it gets processed, changes. Caches with
+/// another version are ignored.
+constexpr uint32_t SCENE_CACHE_VERSION = 4;
+
+constexpr std::string_view SCENE_CACHE_EXTENSION = ".rcscene";
+
+/// A memory-mapped cache file. The file is unmapped once the last copy goes away, and texture
+/// pixels handed out by `read_scene_cache` point into it.
+struct SceneCache {
+    std::shared_ptr<const unsigned char> mapping;
+    size_t size = 0;
+};
+
+/// Where the cache for a given glTF file lives, i.e. right next to it.
+std::filesystem::path scene_cache_path( const std::filesystem::path& source_path );
+
+/// `texture_pixels[i]` is the packed mip chain of `scene.textures[i]`. `source_path` is stamped
+/// into the header so stale caches can be detected.
+void write_scene_cache( const std::filesystem::path& cache_path,
+    const std::filesystem::path& source_path, const Scene& scene,
+    std::span<const geometry::scene::Vertex> vertices, std::span<const uint32_t> indices,
+    std::span<const std::vector<unsigned char>> texture_pixels );
+
+/// Maps a cache and validates it. Returns nothing if it's missing, from another version, malformed
+/// or older than `source_path` (when that still exists).
+std::optional<SceneCache> open_scene_cache(
+    const std::filesystem::path& cache_path, const std::filesystem::path& source_path );
+
+/// CPU-only half of `load_scene_cache`.
+void read_scene_cache( const SceneCache& cache, Scene& scene,
+    std::vector<geometry::scene::Vertex>& out_vertices, std::vector<uint32_t>& out_indices,
+    std::vector<std::span<const unsigned char>>& out_texture_pixels );
+
+/// Drop-in replacement for `load_gltf` + `geometry::scene::generate_tangents` +
+/// `geometry::scene::optimize_mesh`. Textures are uploaded straight out of the mapped file.
+void load_scene_cache( vk::Common& vulkan, engine::State& engine, const SceneCache& cache,
+    Scene& scene, std::vector<geometry::scene::Vertex>& out_vertices,
+    std::vector<uint32_t>& out_indices );
+
+} // namespace racecar::scene
@@ -0,0 +1,145 @@
+#include "transforms.hpp"
+
+#include "../exception.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+
+namespace racecar::scene {
+
+Transforms create_transforms( const Scene& scene, uint32_t frame_overlap )
+{
+    size_t num_nodes = scene.nodes.size();
+
+    Transforms transforms;
+    transforms.node_ids.reserve( num_nodes );
+    transforms.positions.assign( num_nodes, NO_PARENT );
+    transforms.parents.reserve( num_nodes );
+
+    // Depth first from every root, so parents are placed before their children
+    std::vector<const Node*> stack;
+    for ( const std::unique_ptr<Node>& node : scene.nodes ) {
+        if ( node->parent == nullptr ) {
+            stack.push_back( node.get() );
+        }
+    }
+
+    while ( !stack.empty() ) {
+        const Node* node = stack.back();
+        stack.pop_back();
+
+        uint32_t position = static_cast<uint32_t>( transforms.node_ids.size() );
+        transforms.positions[node->id] = position;
+        transforms.node_ids.push_back( node->id );
+        transforms.parents.push_back(
+            node->parent != nullptr ? transforms.positions[node->parent->id] : NO_PARENT );
+        transforms.locals.push_back( node->transform );
+
+        for ( const Node* child : node->children ) {
+            stack.push_back( child );
+        }
+    }
+
+    if ( transforms.node_ids.size() != num_nodes ) {
+        throw Exception( "[Transforms] Only {} of {} nodes are reachable from a root",
+            transforms.node_ids.size(), num_nodes );
+    }
+
+    transforms.worlds.resize( num_nodes );
+    transforms.inv_worlds.resize( num_nodes );
+    transforms.dirty.assign( num_nodes, 1 );
+    transforms.upload_frames = frame_overlap;
+    transforms.pending_uploads.assign( num_nodes, transforms.upload_frames );
+
+    update_transforms( transforms );
+
+    // Nothing has moved yet
+    transforms.prev_worlds = transforms.worlds;
+
+    return transforms;
+}
+
+void apply_local_transform( Transforms& transforms, size_t node_id, const glm::mat4& transform )
+{
+    uint32_t position = transforms.positions.at( node_id );
+
+    transforms.locals[position] *= transform;
+    transforms.dirty[position] = 1;
+}
+
+void set_local_transform( Transforms& transforms, size_t node_id, const glm::mat4& transform )
+{
+    uint32_t position = transforms.positions.at( node_id );
+
+    transforms.locals[position] = transform;
+    transforms.dirty[position] = 1;
+}
+
+void update_transforms( Transforms& transforms )
+{
+    size_t num_nodes = transforms.node_ids.size();
+
+    transforms.prev_worlds.resize( num_nodes );
+
+    for ( size_t i = 0; i < num_nodes; i++ ) {
+        uint32_t parent = transforms.parents[i];
+        bool parent_dirty = parent != NO_PARENT && transforms.dirty[parent];
+
+        // A node that moved last frame still needs its previous world matrix caught up
+        if ( transforms.prev_worlds[i] != transforms.worlds[i] ) {
+            transforms.prev_worlds[i] = transforms.worlds[i];
+            transforms.pending_uploads[i] = transforms.upload_frames;
+        }
+
+        if ( !transforms.dirty[i] && !parent_dirty ) {
+            continue;
+        }
+
+        // Parents come first, so the parent's world matrix is already up to date
+        transforms.worlds[i] = ( parent != NO_PARENT )
+            ? transforms.worlds[parent] * transforms.locals[i]
+            : transforms.locals[i];
+        transforms.inv_worlds[i] = glm::affineInverse( transforms.worlds[i] );
+
+        transforms.dirty[i] = 1;
+        transforms.pending_uploads[i] = transforms.upload_frames;
+    }
+
+    std::fill( transforms.dirty.begin(), transforms.dirty.end(), uint8_t( 0 ) );
+}
+
+const glm::mat4& get_world( const Transforms& transforms, size_t node_id )
+{
+    return transforms.worlds[transforms.positions.at( node_id )];
+}
+
+ub_data::ModelMat get_model_mat( const Transforms& transforms, size_t node_id )
+{
+    uint32_t position = transforms.positions.at( node_id );
+
+    return {
+        .model_mat = transforms.worlds[position],
+        .inv_model_mat = transforms.inv_worlds[position],
+        .prev_model_mat = transforms.prev_worlds[position],
+    };
+}
+
+void upload_transforms( Transforms& transforms, vk::Common& vulkan, const engine::State& engine,
+    engine::UniformRing& ring, std::span<const uint32_t> offsets )
+{
+    for ( size_t i = 0; i < transforms.node_ids.size(); i++ ) {
+        if ( transforms.pending_uploads[i] == 0 ) {
+            continue;
+        }
+
+        size_t node_id = transforms.node_ids[i];
+        engine::write_uniform(
+            ring, engine, offsets[node_id], get_model_mat( transforms, node_id ) );
+        transforms.pending_uploads[i]--;
+    }
+
+    engine::flush_uniform_ring( vulkan, ring );
+}
+
+} // namespace racecar::scene
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../engine/state.hpp"
+#include "../engine/ub_data.hpp"
+#include "../engine/uniform_ring.hpp"
+#include "scene.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// Node transforms of a scene, flattened so every parent comes before its children. Each matrix
+/// kind is its own array indexed by a node's position in that order, so `update_transforms` is one
+/// front-to-back pass over contiguous memory instead of a walk over the node graph.
+namespace racecar::scene {
+
+constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+struct Transforms {
+    /// Node id at every position, and the other way around.
+    std::vector<size_t> node_ids;
+    std::vector<uint32_t> positions;
+
+    /// Position of the parent, always lower than the child's, or `NO_PARENT`.
+    std::vector<uint32_t> parents;
+
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<glm::mat4> prev_worlds;
+    std::vector<glm::mat4> inv_worlds;
+
+    /// Locals changed since the last update, its subtree's worlds have to be recomputed.
+    std::vector<uint8_t> dirty;
+
+    /// How many more frames the node has to be written to the GPU for, see `upload_transforms`.
+    std::vector<uint32_t> pending_uploads;
+    uint32_t upload_frames = 1;
+};
+
+/// `frame_overlap` is how many copies of each matrix the GPU keeps, so that a change reaches all.
+Transforms create_transforms( const Scene& scene, uint32_t frame_overlap );
+
+/// Post-multiplies the node's local transform, which moves its whole subtree along on the next
+/// update.
+void apply_local_transform( Transforms& transforms, size_t node_id, const glm::mat4& transform );
+
+/// Replaces the node's local transform outright, e.g. with a sampled animation pose.
+void set_local_transform( Transforms& transforms, size_t node_id, const glm::mat4& transform );
+
+/// Recomputes the world matrices of dirty subtrees and their inverses. Previous world matrices are
+/// whatever the world matrices were before the call, for every node.
+void update_transforms( Transforms& transforms );
+
+const glm::mat4& get_world( const Transforms& transforms, size_t node_id );
+
+ub_data::ModelMat get_model_mat( const Transforms& transforms, size_t node_id );
+
+/// Writes the model matrices of the nodes that changed to the current frame's region, then flushes
+/// them all at once. `offsets` holds every node's allocation in the ring, by node id.
+void upload_transforms( Transforms& transforms, vk::Common& vulkan, const engine::State& engine,
+    engine::UniformRing& ring, std::span<const uint32_t> offsets );
+
+} // namespace racecar::scene
@@ -0,0 +1,216 @@
+#include "skinning.hpp"
+
+#include "exception.hpp"
+#include "log.hpp"
+#include "vk/create.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+namespace racecar::skinning {
+
+namespace {
+
+constexpr std::string_view SKINNING_SHADER_PATH = "../shaders/deferred/skinning.spv";
+
+constexpr uint32_t SKINNING_GROUP_SIZE = 64;
+
+/// Vertices the primitive's indices reach, which are all of its own.
+uint32_t count_vertices( const geometry::scene::Mesh& mesh, const scene::Primitive& primitive )
+{
+    uint32_t num_vertices = 0;
+
+    for ( size_t i = 0; i < primitive.ind_count; i++ ) {
+        uint32_t index = mesh.indices[static_cast<size_t>( primitive.ind_offset ) + i];
+        num_vertices = std::max( num_vertices, index + 1 );
+    }
+
+    return num_vertices;
+}
+
+void flush( vk::Common& vulkan, const vk::mem::AllocatedBuffer& buffer )
+{
+    vmaFlushAllocation( vulkan.allocator, buffer.allocation, 0, VK_WHOLE_SIZE );
+}
+
+}
+
+std::optional<Skinning> initialize( vk::Common& vulkan, engine::State& engine,
+    const scene::Scene& scene, const geometry::scene::Mesh& mesh )
+{
+    if ( !std::filesystem::exists( SKINNING_SHADER_PATH ) ) {
+        log::warn( "[Skinning] \"{}\" is missing, build it with compile_deferred.ps1. Skinned "
+                   "meshes stay in their bind pose",
+            SKINNING_SHADER_PATH );
+        return std::nullopt;
+    }
+
+    Skinning skinning;
+
+    std::vector<ub_data::SkinnedVertex> skinned_vertices;
+
+    // Where each (skin, mesh node) pair's joint matrices start
+    std::map<std::pair<size_t, size_t>, uint32_t> joint_offsets;
+
+    for ( const std::unique_ptr<scene::Node>& node : scene.nodes ) {
+        if ( !node->mesh.has_value() ) {
+            continue;
+        }
+
+        for ( const scene::Primitive& primitive : node->mesh.value()->primitives ) {
+            if ( primitive.skin_id == -1 ) {
+                continue;
+            }
+
+            size_t skin_id = static_cast<size_t>( primitive.skin_id );
+            if ( skin_id >= scene.skins.size() ) {
+                throw Exception( "[Skinning] Primitive of node {} has invalid skin {}", node->id,
+                    primitive.skin_id );
+            }
+
+            auto [it, inserted]
+                = joint_offsets.try_emplace( { skin_id, node->id }, skinning.num_joint_matrices );
+
+            if ( inserted ) {
+                skinning.instances.push_back( {
+                    .skin_id = skin_id,
+                    .node_id = node->id,
+                    .joint_offset = skinning.num_joint_matrices,
+                } );
+                skinning.num_joint_matrices
+                    += static_cast<uint32_t>( scene.skins[skin_id].joints.size() );
+            }
+
+            uint32_t num_vertices = count_vertices( mesh, primitive );
+
+            for ( uint32_t i = 0; i < num_vertices; i++ ) {
+                size_t vertex_idx = static_cast<size_t>( primitive.vertex_offset ) + i;
+                const geometry::scene::Vertex& vertex = mesh.vertices[vertex_idx];
+                const scene::SkinVertex& skin_vertex
+                    = scene.skin_vertices[static_cast<size_t>( primitive.skin_vertex_offset ) + i];
+
+                skinned_vertices.push_back( {
+                    .position = glm::vec4( vertex.position, 1.f ),
+                    .normal = glm::vec4( vertex.normal, 0.f ),
+                    .tangent = vertex.tangent,
+                    .joints = glm::uvec4( skin_vertex.joints ),
+                    .weights = skin_vertex.weights,
+                    .target_vertex = static_cast<uint32_t>( vertex_idx ),
+                    .joint_offset = it->second,
+                } );
+            }
+        }
+    }
+
+    if ( skinned_vertices.empty() ) {
+        return std::nullopt;
+    }
+
+    VkShaderModule shader = vk::create::shader_module( vulkan, SKINNING_SHADER_PATH );
+
+    skinning.num_vertices = static_cast<uint32_t>( skinned_vertices.size() );
+    skinning.vertex_buffer = mesh.mesh_buffers.vertex_buffer.handle;
+
+    {
+        size_t size = skinned_vertices.size() * sizeof( ub_data::SkinnedVertex );
+        skinning.skinned_vertices = vk::mem::create_buffer(
+            vulkan, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU );
+
+        std::memcpy( skinning.skinned_vertices.info.pMappedData, skinned_vertices.data(), size );
+        flush( vulkan, skinning.skinned_vertices );
+    }
+
+    for ( size_t i = 0; i < engine.frame_overlap; i++ ) {
+        skinning.joint_matrices.push_back( vk::mem::create_buffer( vulkan,
+            std::max( skinning.num_joint_matrices, 1u ) * sizeof( glm::mat4 ),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU ) );
+    }
+
+    skinning.desc_set = engine::generate_descriptor_set( vulkan, engine,
+        {
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Skinned vertices
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Joint matrices
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // Scene vertices
+        },
+        VK_SHADER_STAGE_COMPUTE_BIT );
+
+    engine::update_descriptor_set_const_storage_buffer(
+        vulkan, engine, skinning.desc_set, skinning.skinned_vertices, 0 );
+    engine::update_descriptor_set_frame_buffers( vulkan, engine, skinning.desc_set,
+        skinning.joint_matrices, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 );
+    engine::update_descriptor_set_const_storage_buffer(
+        vulkan, engine, skinning.desc_set, mesh.mesh_buffers.vertex_buffer, 2 );
+
+    skinning.pipeline = engine::create_compute_pipeline( vulkan, { skinning.desc_set.layouts[0] },
+        shader, "skin", geometry::scene::get_vertex_layout_specialization( mesh.layout ) );
+
+    log::info( "[Skinning] {} skinned vertices over {} skin instances, {} joint matrices",
+        skinning.num_vertices, skinning.instances.size(), skinning.num_joint_matrices );
+
+    return skinning;
+}
+
+void add_skinning_pass( Skinning& skinning, engine::TaskList& task_list )
+{
+    constexpr VkPipelineStageFlags2 VERTEX_READERS = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT
+        | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT
+        | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
+        | VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+
+    // The previous frame may still be reading the vertices, there's only one vertex buffer
+    engine::add_pipeline_barrier( task_list,
+        { .buffer_barriers = { {
+              .buffer = skinning.vertex_buffer,
+              .src_stage = VERTEX_READERS,
+              .src_access = VK_ACCESS_2_NONE,
+              .dst_stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+              .dst_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+          } } } );
+
+    uint32_t group_count
+        = ( skinning.num_vertices + SKINNING_GROUP_SIZE - 1 ) / SKINNING_GROUP_SIZE;
+
+    engine::add_cs_task( task_list,
+        {
+            .pipeline = skinning.pipeline,
+            .descriptor_sets = { &skinning.desc_set },
+            .group_size = { static_cast<int>( group_count ), 1, 1 },
+            .image_uses = {},
+        } );
+
+    // The render graph only tracks images, so the vertex buffer needs a barrier of its own
+    engine::add_pipeline_barrier( task_list,
+        { .buffer_barriers = { {
+              .buffer = skinning.vertex_buffer,
+              .src_stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+              .src_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+              .dst_stage = VERTEX_READERS,
+              .dst_access = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT
+                  | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT,
+          } } } );
+}
+
+void update( Skinning& skinning, vk::Common& vulkan, const engine::State& engine,
+    const scene::Scene& scene, const scene::Transforms& transforms )
+{
+    const vk::mem::AllocatedBuffer& buffer = skinning.joint_matrices[engine.get_frame_index()];
+    glm::mat4* joint_matrices = static_cast<glm::mat4*>( buffer.info.pMappedData );
+
+    for ( const SkinInstance& instance : skinning.instances ) {
+        const scene::Skin& skin = scene.skins[instance.skin_id];
+        glm::mat4 inv_mesh_world
+            = scene::get_model_mat( transforms, instance.node_id ).inv_model_mat;
+
+        // Vertices end up in the mesh node's space, its model matrix is applied when drawing
+        for ( size_t i = 0; i < skin.joints.size(); i++ ) {
+            joint_matrices[instance.joint_offset + i] = inv_mesh_world
+                * scene::get_world( transforms, skin.joints[i] ) * skin.inverse_binds[i];
+        }
+    }
+
+    flush( vulkan, buffer );
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "engine/descriptor_set.hpp"
+#include "engine/pipeline.hpp"
+#include "engine/state.hpp"
+#include "engine/task_list.hpp"
+#include "engine/ub_data.hpp"
+#include "geometry/scene_mesh.hpp"
+#include "scene/scene.hpp"
+#include "scene/transforms.hpp"
+#include "vk/common.hpp"
+
+#include <optional>
+#include <vector>
+
+/// Skins the scene's skinned primitives on the GPU. A compute pass blends every skinned vertex's
+/// bind pose by its joint matrices and writes the result straight into the scene's vertex buffer,
+/// so everything drawing or tracing the scene afterwards sees the posed mesh without knowing about
+/// skins at all.
+namespace racecar::skinning {
+
+/// A skin as used by one mesh node. Joint matrices are relative to the mesh node, so each of these
+/// gets a block of its own even when several nodes share a skin.
+struct SkinInstance {
+    size_t skin_id = 0;
+    size_t node_id = 0;
+    uint32_t joint_offset = 0;
+};
+
+struct Skinning {
+    uint32_t num_vertices = 0;
+    uint32_t num_joint_matrices = 0;
+
+    std::vector<SkinInstance> instances;
+
+    vk::mem::AllocatedBuffer skinned_vertices;
+
+    /// One per frame in flight.
+    std::vector<vk::mem::AllocatedBuffer> joint_matrices;
+
+    /// The scene's vertex buffer, which gets skinned in place.
+    VkBuffer vertex_buffer = VK_NULL_HANDLE;
+
+    engine::DescriptorSet desc_set;
+    engine::Pipeline pipeline;
+};
+
+/// Returns nothing if the scene has no skinned primitives or skinning.spv hasn't been built.
+/// `mesh` has to be uploaded already, and its CPU-side vertices are taken as the bind pose.
+std::optional<Skinning> initialize( vk::Common& vulkan, engine::State& engine,
+    const scene::Scene& scene, const geometry::scene::Mesh& mesh );
+
+/// Has to go before anything reading the scene's vertices, including BLAS builds.
+void add_skinning_pass( Skinning& skinning, engine::TaskList& task_list );
+
+/// Computes the joint matrices from this frame's transforms, so after `scene::update_transforms`.
+/// Only once the frame's previous submission is done, i.e. after `engine::begin_frame`.
+void update( Skinning& skinning, vk::Common& vulkan, const engine::State& engine,
+    const scene::Scene& scene, const scene::Transforms& transforms );
+
+}
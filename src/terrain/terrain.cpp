@@ -6,6 +6,8 @@
 #include "../geometry/gpu_mesh_buffers.hpp"
 #include "../vk/create.hpp"
 
+#include <array>
+
 const std::filesystem::path TERRAIN_SHADER_PREPASS_MODULE_PATH
     = "../shaders/terrain/terrain_prepass.spv";
 const std::filesystem::path TERRAIN_SHADER_LIGHTING_MODULE_PATH
@@ -122,23 +124,51 @@ void initialize_terrain( vk::Common& vulkan, engine::State& engine, Terrain& ter
     terrain.terrain_uniform
         = create_uniform_buffer<ub_data::TerrainData>( vulkan, {}, engine.frame_overlap );
 
-    terrain.test_layer_mask = engine::load_image(
-        TEST_LAYER_MASK_PATH, vulkan, engine, 2, VK_FORMAT_R8G8_UNORM, false );
-
-    terrain.grass_albedo_roughness = engine::load_image(
-        TEST_GRASS_ALBEDO_ROUGHNESS_PATH, vulkan, engine, 4, VK_FORMAT_R8G8B8A8_UNORM, true );
-
-    terrain.grass_normal_ao = engine::load_image(
-        TEST_GRASS_NORMAL_AO_PATH, vulkan, engine, 4, VK_FORMAT_R16G16B16A16_SFLOAT, true );
-
-    terrain.asphalt_albedo_roughness = engine::load_image(
-        TEST_ASPHALT_ALBEDO_ROUGHNESS_PATH, vulkan, engine, 4, VK_FORMAT_R8G8B8A8_UNORM, true );
+    // Everything here is block-compressed, see load_image for where the compressed data comes
+    // from. Normals and AO share a texture, so they go to BC7 along with the albedo and roughness.
+    // All of them go up in one batch.
+    std::array<engine::CompressedImageLoad, 6> loads = { {
+        {
+            .file_path = TEST_LAYER_MASK_PATH,
+            .format = VK_FORMAT_BC5_UNORM_BLOCK,
+            .mipmapped = false,
+        },
+        {
+            .file_path = TEST_GRASS_ALBEDO_ROUGHNESS_PATH,
+            .format = VK_FORMAT_BC7_UNORM_BLOCK,
+            .mipmapped = true,
+        },
+        {
+            .file_path = TEST_GRASS_NORMAL_AO_PATH,
+            .format = VK_FORMAT_BC7_UNORM_BLOCK,
+            .mipmapped = true,
+        },
+        {
+            .file_path = TEST_ASPHALT_ALBEDO_ROUGHNESS_PATH,
+            .format = VK_FORMAT_BC7_UNORM_BLOCK,
+            .mipmapped = true,
+        },
+        {
+            .file_path = TEST_ASPHALT_NORMAL_AO_PATH,
+            .format = VK_FORMAT_BC7_UNORM_BLOCK,
+            .mipmapped = true,
+        },
+        {
+            .file_path = TERRAIN_NOISE_PAPTH,
+            .format = VK_FORMAT_BC5_UNORM_BLOCK,
+            .mipmapped = true,
+        },
+    } };
 
-    terrain.asphalt_normal_ao = engine::load_image(
-        TEST_ASPHALT_NORMAL_AO_PATH, vulkan, engine, 4, VK_FORMAT_R16G16B16A16_SFLOAT, true );
+    std::vector<vk::mem::AllocatedImage> images
+        = engine::load_compressed_images( vulkan, engine, loads );
 
-    terrain.terrain_noise
-        = engine::load_image( TERRAIN_NOISE_PAPTH, vulkan, engine, 2, VK_FORMAT_R8G8_UNORM, true );
+    terrain.test_layer_mask = images[0];
+    terrain.grass_albedo_roughness = images[1];
+    terrain.grass_normal_ao = images[2];
+    terrain.asphalt_albedo_roughness = images[3];
+    terrain.asphalt_normal_ao = images[4];
+    terrain.terrain_noise = images[5];
 }
 
 void draw_terrain_prepass( Terrain& terrain, vk::Common& vulkan, engine::State& engine,
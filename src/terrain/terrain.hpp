@@ -69,8 +69,7 @@ struct Terrain {
     engine::GfxTask terrain_prepass_task;
 
     UniformBuffer<ub_data::TerrainData> terrain_uniform;
-    vk::rt::AccelerationStructure blas;
-    vk::rt::AccelerationStructure tlas;
+    vk::rt::DynamicBlas blas; ///< Instanced in the scene's TLAS, see `rt_scene::ExtraInstance`.
 
     // Crap-ton of images. We need a bindless-texture solution or something.
     // Maybe one giant atlas will work, actually.
@@ -0,0 +1,173 @@
+#include "../engine/dds.hpp"
+#include "../engine/texture_compression.hpp"
+#include "../exception.hpp"
+#include "../geometry/mesh_optimizer.hpp"
+#include "../geometry/scene_mesh.hpp"
+#include "../geometry/simplify.hpp"
+#include "../log.hpp"
+#include "../parallel.hpp"
+#include "../scene/scene.hpp"
+#include "../scene/scene_cache.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+/// racecar-bake: turns a glTF scene into a .rcscene cache that the renderer can load without any
+/// parsing, decoding or tangent generation, or a standalone image into a block-compressed .dds.
+///
+///     racecar-bake <scene.glb|scene.gltf> [output.rcscene]
+///     racecar-bake <image> <bc1|bc1-srgb|bc4|bc5|bc6h|bc7|bc7-srgb> [output.dds]
+///
+/// The output defaults to the input path with the .rcscene/.dds extension, which is where the
+/// renderer looks for it.
+namespace racecar::bake {
+
+namespace {
+
+struct FormatName {
+    std::string_view name;
+    VkFormat format;
+};
+
+constexpr std::array<FormatName, 7> FORMAT_NAMES = { {
+    { "bc1", VK_FORMAT_BC1_RGB_UNORM_BLOCK },
+    { "bc1-srgb", VK_FORMAT_BC1_RGB_SRGB_BLOCK },
+    { "bc4", VK_FORMAT_BC4_UNORM_BLOCK },
+    { "bc5", VK_FORMAT_BC5_UNORM_BLOCK },
+    { "bc6h", VK_FORMAT_BC6H_UFLOAT_BLOCK },
+    { "bc7", VK_FORMAT_BC7_UNORM_BLOCK },
+    { "bc7-srgb", VK_FORMAT_BC7_SRGB_BLOCK },
+} };
+
+std::optional<VkFormat> parse_format( std::string_view name )
+{
+    for ( const FormatName& format_name : FORMAT_NAMES ) {
+        if ( format_name.name == name ) {
+            return format_name.format;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void bake( const std::filesystem::path& source_path, const std::filesystem::path& cache_path )
+{
+    auto start = std::chrono::steady_clock::now();
+
+    scene::Scene scene;
+    geometry::scene::Mesh mesh;
+    std::vector<std::vector<unsigned char>> texture_pixels;
+
+    scene::parse_gltf( source_path, scene, mesh.vertices, mesh.indices, texture_pixels );
+    geometry::scene::generate_tangents( mesh );
+    geometry::scene::optimize_mesh( scene, mesh );
+    geometry::scene::generate_lods( scene, mesh );
+
+    parallel::for_each( scene.textures.size(), [&]( size_t i ) {
+        scene::Texture& texture = scene.textures[i];
+        texture.mip_levels = engine::generate_mip_chain( texture_pixels[i],
+            static_cast<uint32_t>( texture.width ), static_cast<uint32_t>( texture.height ),
+            texture.format );
+    } );
+
+    // Normal maps go to BC7 along with everything else. BC5 would be smaller still, but every
+    // shader sampling them would have to reconstruct Z first.
+    size_t uncompressed_size = 0;
+    size_t compressed_size = 0;
+
+    for ( size_t i = 0; i < scene.textures.size(); i++ ) {
+        scene::Texture& texture = scene.textures[i];
+        uncompressed_size += texture_pixels[i].size();
+
+        VkFormat compressed_format = engine::compressed_format_for( texture.format );
+        if ( compressed_format != VK_FORMAT_UNDEFINED ) {
+            texture_pixels[i] = engine::compress_texture( texture_pixels[i],
+                static_cast<uint32_t>( texture.width ), static_cast<uint32_t>( texture.height ),
+                texture.mip_levels, texture.format, compressed_format );
+            texture.format = compressed_format;
+        }
+
+        compressed_size += texture_pixels[i].size();
+    }
+
+    log::info( "[Bake] Compressed {} textures from {} to {} bytes", scene.textures.size(),
+        uncompressed_size, compressed_size );
+
+    scene::write_scene_cache(
+        cache_path, source_path, scene, mesh.vertices, mesh.indices, texture_pixels );
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start );
+    log::info( "[Bake] Baked \"{}\" in {} ms", source_path.string(), elapsed.count() );
+}
+
+void bake_texture( const std::filesystem::path& source_path, VkFormat format,
+    const std::filesystem::path& output_path )
+{
+    auto start = std::chrono::steady_clock::now();
+
+    engine::CompressedImage image = engine::compress_image_file( source_path, format, true );
+    engine::write_dds( output_path, image );
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start );
+    log::info( "[Bake] Baked \"{}\" ({}x{}, {} mips, {} bytes) in {} ms", source_path.string(),
+        image.width, image.height, image.mip_levels, image.data.size(), elapsed.count() );
+}
+
+}
+
+}
+
+int main( int argc, char* argv[] )
+{
+    if ( argc < 2 ) {
+        racecar::log::error( "[Bake] Usage: racecar-bake <scene.glb|scene.gltf> [output.rcscene]\n"
+                             "       racecar-bake <image> <bc1|bc1-srgb|bc4|bc5|bc6h|bc7|bc7-srgb> "
+                             "[output.dds]" );
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::path source_path = argv[1];
+    std::filesystem::path extension = source_path.extension();
+
+    try {
+        if ( extension == ".gltf" || extension == ".glb" ) {
+            std::filesystem::path cache_path = argc >= 3
+                ? std::filesystem::path( argv[2] )
+                : racecar::scene::scene_cache_path( source_path );
+
+            racecar::bake::bake( source_path, cache_path );
+            return EXIT_SUCCESS;
+        }
+
+        if ( argc < 3 ) {
+            racecar::log::error( "[Bake] Images need a target format" );
+            return EXIT_FAILURE;
+        }
+
+        std::optional<VkFormat> format = racecar::bake::parse_format( argv[2] );
+        if ( !format ) {
+            racecar::log::error( "[Bake] Unknown format \"{}\"", argv[2] );
+            return EXIT_FAILURE;
+        }
+
+        std::filesystem::path output_path = argc >= 4
+            ? std::filesystem::path( argv[3] )
+            : racecar::engine::baked_texture_path( source_path );
+
+        racecar::bake::bake_texture( source_path, format.value(), output_path );
+    } catch ( const racecar::Exception& ex ) {
+        racecar::log::error( "[Bake] {}", ex.what() );
+        return EXIT_FAILURE;
+    } catch ( const std::exception& ex ) {
+        racecar::log::error( "[Bake] Caught standard exception: {}", ex.what() );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
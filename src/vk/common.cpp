@@ -118,7 +118,14 @@ vkb::Device pick_and_create_device( const Common& vulkan )
 
     VkPhysicalDeviceVulkan12Features required_features_12 = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .drawIndirectCount = VK_TRUE,
         .shaderFloat16 = VK_TRUE,
+        .descriptorIndexing = VK_TRUE,
+        .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .runtimeDescriptorArray = VK_TRUE,
+        .timelineSemaphore = VK_TRUE,
         .bufferDeviceAddress = VK_TRUE,
     };
 
@@ -131,6 +138,9 @@ vkb::Device pick_and_create_device( const Common& vulkan )
 
     VkPhysicalDeviceFeatures required_features = {
         .tessellationShader = VK_TRUE,
+        .multiDrawIndirect = VK_TRUE,
+        .drawIndirectFirstInstance = VK_TRUE,
+        .textureCompressionBC = VK_TRUE,
         .shaderInt16 = VK_TRUE,
     };
 
@@ -42,6 +42,15 @@ VkSemaphoreCreateInfo semaphore_info()
     return { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
 }
 
+VkSemaphoreTypeCreateInfo timeline_semaphore_type_info( uint64_t initial_value )
+{
+    return {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = initial_value,
+    };
+}
+
 VkCommandBufferBeginInfo command_buffer_begin_info( VkCommandBufferUsageFlags flags )
 {
     return {
@@ -119,12 +128,12 @@ VkSamplerCreateInfo sampler_info( VkFilter filter_type, VkSamplerAddressMode add
 }
 
 VkSemaphoreSubmitInfo semaphore_submit_info(
-    VkPipelineStageFlags2 stage_mask, VkSemaphore semaphore )
+    VkPipelineStageFlags2 stage_mask, VkSemaphore semaphore, uint64_t value )
 {
     return {
         .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
         .semaphore = semaphore,
-        .value = 1,
+        .value = value,
         .stageMask = stage_mask,
         .deviceIndex = 0,
     };
@@ -30,8 +30,11 @@ VkSamplerCreateInfo sampler_info( VkFilter filter_type, VkSamplerAddressMode add
 // Sync related
 VkFenceCreateInfo fence_info( VkFenceCreateFlags flags );
 VkSemaphoreCreateInfo semaphore_info();
+/// Chain into `semaphore_info().pNext` to create a timeline semaphore.
+VkSemaphoreTypeCreateInfo timeline_semaphore_type_info( uint64_t initial_value );
+/// `value` is ignored for binary semaphores.
 VkSemaphoreSubmitInfo semaphore_submit_info(
-    VkPipelineStageFlags2 stage_mask, VkSemaphore semaphore );
+    VkPipelineStageFlags2 stage_mask, VkSemaphore semaphore, uint64_t value = 1 );
 VkCommandBufferSubmitInfo command_buffer_submit_info( VkCommandBuffer command_buffer );
 VkSubmitInfo2 submit_info( VkCommandBufferSubmitInfo* command_buffer_info,
     VkSemaphoreSubmitInfo* signal_semaphore_info, VkSemaphoreSubmitInfo* wait_semaphore_info );
@@ -18,6 +18,7 @@ struct AllocatedImage {
     VmaAllocation allocation = VK_NULL_HANDLE;
     VkExtent3D image_extent = {};
     VkFormat image_format = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
 
     std::vector<VkImageView> mip_levels;
 };
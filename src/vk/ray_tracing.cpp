@@ -1,9 +1,88 @@
 #include "ray_tracing.hpp"
+#include "common.hpp"
 #include "mem.hpp"
+#include "../engine/imm_submit.hpp"
 #include "../log.hpp"
 
+#include <algorithm>
+#include <utility>
+
 namespace racecar::vk::rt {
 
+namespace {
+
+/// Acceleration structures have to start on this alignment within their buffer.
+constexpr VkDeviceSize ACCELERATION_STRUCTURE_ALIGNMENT = 256;
+
+VkDeviceAddress get_buffer_address( VkDevice device, VkBuffer buffer )
+{
+    VkBufferDeviceAddressInfo info
+        = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = buffer };
+    return vkGetBufferDeviceAddress( device, &info );
+}
+
+mem::AllocatedBuffer create_device_buffer(
+    VmaAllocator allocator, VkDeviceSize size, VkBufferUsageFlags usage )
+{
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+    };
+    VmaAllocationCreateInfo allocation_info = { .usage = VMA_MEMORY_USAGE_GPU_ONLY };
+
+    mem::AllocatedBuffer buffer;
+    vk::check( vmaCreateBuffer( allocator, &buffer_info, &allocation_info, &buffer.handle,
+                   &buffer.allocation, &buffer.info ),
+        "Failed to allocate acceleration structure memory" );
+
+    return buffer;
+}
+
+VkAccelerationStructureKHR create_blas(
+    VkDevice device, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size )
+{
+    VkAccelerationStructureCreateInfoKHR info = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        .buffer = buffer,
+        .offset = offset,
+        .size = size,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+    };
+
+    VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
+    vk::check( vkCreateAccelerationStructureKHR( device, &info, nullptr, &handle ),
+        "Failed to call vkCreateAccelerationStructureKHR for BLAS" );
+
+    return handle;
+}
+
+VkDeviceAddress get_acceleration_structure_address(
+    VkDevice device, VkAccelerationStructureKHR handle )
+{
+    VkAccelerationStructureDeviceAddressInfoKHR info = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
+        .accelerationStructure = handle,
+    };
+    return vkGetAccelerationStructureDeviceAddressKHR( device, &info );
+}
+
+/// Makes acceleration structure writes so far visible to whatever reads or writes them next.
+void acceleration_structure_barrier( VkCommandBuffer cmd_buf, VkPipelineStageFlags dst_stages )
+{
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR
+            | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+    };
+
+    vkCmdPipelineBarrier( cmd_buf, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        dst_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr );
+}
+
+}
+
 RayTracingProperties query_rt_properties( VkPhysicalDevice physical_device )
 {
     VkPhysicalDeviceAccelerationStructurePropertiesKHR as_properties
@@ -197,6 +276,195 @@ AccelerationStructure build_blas( VkDevice device, VmaAllocator allocator,
     return blas;
 }
 
+std::vector<AccelerationStructure> build_blases( Common& vulkan,
+    const engine::ImmediateSubmit& immediate_submit, std::span<const MeshData> meshes )
+{
+    if ( meshes.empty() ) {
+        return {};
+    }
+
+    VkDevice device = vulkan.device;
+    VkDeviceSize scratch_alignment
+        = vulkan.ray_tracing_properties.min_acceleration_structure_scratch_offset_alignment;
+    size_t count = meshes.size();
+
+    std::vector<VkAccelerationStructureGeometryKHR> geometries( count );
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR> ranges( count );
+    std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> range_pointers( count );
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> build_infos( count );
+    std::vector<VkAccelerationStructureBuildSizesInfoKHR> sizes(
+        count, { .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR } );
+
+    // Where every BLAS goes in the shared storage, and where its scratch goes in its batch's
+    std::vector<VkDeviceSize> storage_offsets( count );
+    std::vector<VkDeviceSize> scratch_offsets( count );
+    VkDeviceSize storage_size = 0;
+    VkDeviceSize scratch_size = 0;
+
+    // Ranges of meshes that get built by the same call
+    std::vector<std::pair<size_t, size_t>> batches;
+    size_t batch_first = 0;
+    VkDeviceSize batch_scratch_size = 0;
+
+    for ( size_t i = 0; i < count; i++ ) {
+        MeshData mesh = meshes[i];
+
+        if ( mesh.vertex_buffer == VK_NULL_HANDLE || mesh.index_buffer == VK_NULL_HANDLE ) {
+            throw Exception( "[Build BLAS] Mesh {} has no vertex or index buffer", i );
+        }
+
+        mesh.vertex_buffer_address = get_buffer_address( device, mesh.vertex_buffer );
+        mesh.index_buffer_address = get_buffer_address( device, mesh.index_buffer );
+
+        uint32_t triangle_count = mesh.index_count / 3;
+
+        geometries[i] = create_acceleration_structure_from_geometry( mesh );
+        ranges[i] = { .primitiveCount = triangle_count };
+        range_pointers[i] = &ranges[i];
+        build_infos[i] = {
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+            .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+            .flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR
+                | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR,
+            .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+            .geometryCount = 1,
+            .pGeometries = &geometries[i],
+        };
+
+        vkGetAccelerationStructureBuildSizesKHR( device,
+            VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &build_infos[i], &triangle_count,
+            &sizes[i] );
+
+        storage_offsets[i] = storage_size;
+        storage_size
+            += align_up( sizes[i].accelerationStructureSize, ACCELERATION_STRUCTURE_ALIGNMENT );
+
+        VkDeviceSize mesh_scratch_size = align_up( sizes[i].buildScratchSize, scratch_alignment );
+
+        if ( i > batch_first && batch_scratch_size + mesh_scratch_size > BLAS_SCRATCH_BUDGET ) {
+            batches.push_back( { batch_first, i } );
+            batch_first = i;
+            batch_scratch_size = 0;
+        }
+
+        scratch_offsets[i] = batch_scratch_size;
+        batch_scratch_size += mesh_scratch_size;
+        scratch_size = std::max( scratch_size, batch_scratch_size );
+    }
+
+    batches.push_back( { batch_first, count } );
+
+    mem::AllocatedBuffer storage = create_device_buffer(
+        vulkan.allocator, storage_size, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR );
+
+    // The buffer's own address isn't necessarily aligned, so there's room to move it up
+    mem::AllocatedBuffer scratch = create_device_buffer(
+        vulkan.allocator, scratch_size + scratch_alignment, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT );
+    VkDeviceAddress scratch_address
+        = align_up( get_buffer_address( device, scratch.handle ), scratch_alignment );
+
+    std::vector<VkAccelerationStructureKHR> built( count );
+    for ( size_t i = 0; i < count; i++ ) {
+        built[i] = create_blas(
+            device, storage.handle, storage_offsets[i], sizes[i].accelerationStructureSize );
+        build_infos[i].dstAccelerationStructure = built[i];
+        build_infos[i].scratchData.deviceAddress = scratch_address + scratch_offsets[i];
+    }
+
+    VkQueryPoolCreateInfo query_pool_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+        .queryCount = static_cast<uint32_t>( count ),
+    };
+    VkQueryPool query_pool = VK_NULL_HANDLE;
+    vk::check( vkCreateQueryPool( device, &query_pool_info, nullptr, &query_pool ),
+        "Failed to create the BLAS compaction query pool" );
+
+    engine::immediate_submit( vulkan, immediate_submit, [&]( VkCommandBuffer cmd_buf ) {
+        vkCmdResetQueryPool( cmd_buf, query_pool, 0, static_cast<uint32_t>( count ) );
+
+        for ( const auto& [first, end] : batches ) {
+            // Batches share the scratch, so the one before has to be done with it
+            if ( first > 0 ) {
+                acceleration_structure_barrier(
+                    cmd_buf, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR );
+            }
+
+            vkCmdBuildAccelerationStructuresKHR( cmd_buf, static_cast<uint32_t>( end - first ),
+                &build_infos[first], &range_pointers[first] );
+        }
+
+        acceleration_structure_barrier(
+            cmd_buf, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR );
+        vkCmdWriteAccelerationStructuresPropertiesKHR( cmd_buf, static_cast<uint32_t>( count ),
+            built.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, query_pool,
+            0 );
+    } );
+
+    std::vector<VkDeviceSize> compacted_sizes( count );
+    vk::check( vkGetQueryPoolResults( device, query_pool, 0, static_cast<uint32_t>( count ),
+                   count * sizeof( VkDeviceSize ), compacted_sizes.data(), sizeof( VkDeviceSize ),
+                   VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT ),
+        "Failed to read back compacted BLAS sizes" );
+    vkDestroyQueryPool( device, query_pool, nullptr );
+
+    std::vector<VkDeviceSize> compacted_offsets( count );
+    VkDeviceSize compacted_size = 0;
+
+    for ( size_t i = 0; i < count; i++ ) {
+        compacted_offsets[i] = compacted_size;
+        compacted_size += align_up( compacted_sizes[i], ACCELERATION_STRUCTURE_ALIGNMENT );
+    }
+
+    mem::AllocatedBuffer compacted = create_device_buffer(
+        vulkan.allocator, compacted_size, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR );
+    vulkan.destructor_stack.push_free_vmabuffer( vulkan.allocator, compacted );
+
+    std::vector<AccelerationStructure> blases( count );
+
+    for ( size_t i = 0; i < count; i++ ) {
+        AccelerationStructure& blas = blases[i];
+
+        blas.type = AccelerationStructure::Type::BLAS;
+        blas.handle
+            = create_blas( device, compacted.handle, compacted_offsets[i], compacted_sizes[i] );
+        blas.buffer = compacted.handle;
+        blas.allocation = compacted.allocation;
+        blas.device_address = get_acceleration_structure_address( device, blas.handle );
+
+        vulkan.destructor_stack.push( device, blas.handle, vkDestroyAccelerationStructureKHR );
+    }
+
+    engine::immediate_submit( vulkan, immediate_submit, [&]( VkCommandBuffer cmd_buf ) {
+        for ( size_t i = 0; i < count; i++ ) {
+            VkCopyAccelerationStructureInfoKHR copy = {
+                .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
+                .src = built[i],
+                .dst = blases[i].handle,
+                .mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR,
+            };
+            vkCmdCopyAccelerationStructureKHR( cmd_buf, &copy );
+        }
+
+        // TLAS builds and ray queries in any stage read them from here on
+        acceleration_structure_barrier( cmd_buf, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT );
+    } );
+
+    for ( VkAccelerationStructureKHR handle : built ) {
+        vkDestroyAccelerationStructureKHR( device, handle, nullptr );
+    }
+
+    vmaDestroyBuffer( vulkan.allocator, storage.handle, storage.allocation );
+    vmaDestroyBuffer( vulkan.allocator, scratch.handle, scratch.allocation );
+
+    constexpr float MIB = 1024.f * 1024.f;
+    log::info( "[Build BLAS] {} BLASes in {} build calls, compacted from {:.1f} MiB to {:.1f} MiB",
+        count, batches.size(), static_cast<float>( storage_size ) / MIB,
+        static_cast<float>( compacted_size ) / MIB );
+
+    return blases;
+}
+
 AccelerationStructure build_tlas(
     VkDevice device, VmaAllocator allocator,
     const RayTracingProperties& rt_props, const std::vector<Object>& objects, 
@@ -223,11 +491,8 @@ AccelerationStructure build_tlas(
             log::warn("[Build TLAS] The provided object at index {} has a zeroed transform matrix. This will cause the BLAS to completely not appear in the TLAS", i);
         }
 
-        VkTransformMatrixKHR transform_matrix;
-        memcpy(&transform_matrix.matrix, glm::value_ptr(obj.transform), sizeof(float) * 12);
-        
         VkAccelerationStructureInstanceKHR instance = {};
-        instance.transform = transform_matrix;
+        instance.transform = to_transform_matrix( obj.transform );
         
         instance.accelerationStructureReference = obj.blas->device_address;
         
@@ -427,4 +692,215 @@ AccelerationStructure build_tlas(
     return tlas;
 }
 
+VkTransformMatrixKHR to_transform_matrix( const glm::mat4& transform )
+{
+    VkTransformMatrixKHR matrix;
+
+    for ( glm::length_t row = 0; row < 3; row++ ) {
+        for ( glm::length_t column = 0; column < 4; column++ ) {
+            matrix.matrix[row][column] = transform[column][row];
+        }
+    }
+
+    return matrix;
+}
+
+namespace {
+
+VkAccelerationStructureGeometryKHR get_instances_geometry( VkDeviceAddress instances )
+{
+    return {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+        .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+        .geometry = { .instances = {
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+            .arrayOfPointers = VK_FALSE,
+            .data = { .deviceAddress = instances },
+        } },
+        .flags = VK_GEOMETRY_OPAQUE_BIT_KHR,
+    };
+}
+
+/// Updates have to use the exact flags of the build they refit.
+constexpr VkBuildAccelerationStructureFlagsKHR DYNAMIC_TLAS_FLAGS
+    = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR
+    | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+
+/// Refit geometry drifts from what the tree was built for, so trace speed matters less than for
+/// the TLAS, which gets rebuilt every so often.
+constexpr VkBuildAccelerationStructureFlagsKHR DYNAMIC_BLAS_FLAGS
+    = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR
+    | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+
+void record_blas_build( VkCommandBuffer cmd_buf, const DynamicBlas& blas, bool update )
+{
+    VkAccelerationStructureGeometryKHR geometry
+        = create_acceleration_structure_from_geometry( blas.mesh );
+
+    VkAccelerationStructureBuildGeometryInfoKHR build_info = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        .flags = DYNAMIC_BLAS_FLAGS,
+        .mode = update ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR
+                       : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+        .srcAccelerationStructure = update ? blas.blas.handle : VK_NULL_HANDLE,
+        .dstAccelerationStructure = blas.blas.handle,
+        .geometryCount = 1,
+        .pGeometries = &geometry,
+        .scratchData = { .deviceAddress = blas.scratch_address },
+    };
+
+    VkAccelerationStructureBuildRangeInfoKHR range
+        = { .primitiveCount = blas.mesh.index_count / 3 };
+    const VkAccelerationStructureBuildRangeInfoKHR* range_pointer = &range;
+
+    vkCmdBuildAccelerationStructuresKHR( cmd_buf, 1, &build_info, &range_pointer );
+}
+
+}
+
+DynamicTlas create_dynamic_tlas( Common& vulkan, uint32_t instance_count )
+{
+    VkDevice device = vulkan.device;
+    VkDeviceSize scratch_alignment
+        = vulkan.ray_tracing_properties.min_acceleration_structure_scratch_offset_alignment;
+
+    VkAccelerationStructureGeometryKHR geometry = get_instances_geometry( 0 );
+    VkAccelerationStructureBuildGeometryInfoKHR build_info = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+        .flags = DYNAMIC_TLAS_FLAGS,
+        .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+        .geometryCount = 1,
+        .pGeometries = &geometry,
+    };
+
+    VkAccelerationStructureBuildSizesInfoKHR sizes
+        = { .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR };
+    vkGetAccelerationStructureBuildSizesKHR( device,
+        VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &build_info, &instance_count, &sizes );
+
+    DynamicTlas dynamic_tlas = { .instance_count = instance_count };
+    AccelerationStructure& tlas = dynamic_tlas.tlas;
+
+    mem::AllocatedBuffer storage = create_device_buffer( vulkan.allocator,
+        sizes.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR );
+    vulkan.destructor_stack.push_free_vmabuffer( vulkan.allocator, storage );
+
+    VkAccelerationStructureCreateInfoKHR create_info = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        .buffer = storage.handle,
+        .size = sizes.accelerationStructureSize,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+    };
+    vk::check( vkCreateAccelerationStructureKHR( device, &create_info, nullptr, &tlas.handle ),
+        "Failed to call vkCreateAccelerationStructureKHR for TLAS" );
+    vulkan.destructor_stack.push( device, tlas.handle, vkDestroyAccelerationStructureKHR );
+
+    tlas.type = AccelerationStructure::Type::TLAS;
+    tlas.buffer = storage.handle;
+    tlas.allocation = storage.allocation;
+    tlas.device_address = get_acceleration_structure_address( device, tlas.handle );
+
+    VkDeviceSize scratch_size = std::max( sizes.buildScratchSize, sizes.updateScratchSize );
+    mem::AllocatedBuffer scratch = create_device_buffer(
+        vulkan.allocator, scratch_size + scratch_alignment, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT );
+    vulkan.destructor_stack.push_free_vmabuffer( vulkan.allocator, scratch );
+
+    dynamic_tlas.scratch = scratch.handle;
+    dynamic_tlas.scratch_address
+        = align_up( get_buffer_address( device, scratch.handle ), scratch_alignment );
+
+    return dynamic_tlas;
+}
+
+void record_tlas_build( VkCommandBuffer cmd_buf, const DynamicTlas& tlas,
+    VkDeviceAddress instances, bool update )
+{
+    VkAccelerationStructureGeometryKHR geometry = get_instances_geometry( instances );
+
+    VkAccelerationStructureBuildGeometryInfoKHR build_info = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+        .flags = DYNAMIC_TLAS_FLAGS,
+        .mode = update ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR
+                       : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+        .srcAccelerationStructure = update ? tlas.tlas.handle : VK_NULL_HANDLE,
+        .dstAccelerationStructure = tlas.tlas.handle,
+        .geometryCount = 1,
+        .pGeometries = &geometry,
+        .scratchData = { .deviceAddress = tlas.scratch_address },
+    };
+
+    VkAccelerationStructureBuildRangeInfoKHR range = { .primitiveCount = tlas.instance_count };
+    const VkAccelerationStructureBuildRangeInfoKHR* range_pointer = &range;
+
+    vkCmdBuildAccelerationStructuresKHR( cmd_buf, 1, &build_info, &range_pointer );
+}
+
+DynamicBlas create_dynamic_blas( Common& vulkan, const MeshData& mesh, VkCommandBuffer cmd_buf )
+{
+    VkDevice device = vulkan.device;
+    VkDeviceSize scratch_alignment
+        = vulkan.ray_tracing_properties.min_acceleration_structure_scratch_offset_alignment;
+
+    if ( mesh.vertex_buffer == VK_NULL_HANDLE || mesh.index_buffer == VK_NULL_HANDLE ) {
+        throw Exception( "[Build BLAS] Dynamic BLAS mesh has no vertex or index buffer" );
+    }
+
+    DynamicBlas dynamic_blas = { .mesh = mesh };
+    dynamic_blas.mesh.vertex_buffer_address = get_buffer_address( device, mesh.vertex_buffer );
+    dynamic_blas.mesh.index_buffer_address = get_buffer_address( device, mesh.index_buffer );
+
+    VkAccelerationStructureGeometryKHR geometry
+        = create_acceleration_structure_from_geometry( dynamic_blas.mesh );
+    VkAccelerationStructureBuildGeometryInfoKHR build_info = {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        .flags = DYNAMIC_BLAS_FLAGS,
+        .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+        .geometryCount = 1,
+        .pGeometries = &geometry,
+    };
+
+    uint32_t triangle_count = mesh.index_count / 3;
+    VkAccelerationStructureBuildSizesInfoKHR sizes
+        = { .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR };
+    vkGetAccelerationStructureBuildSizesKHR( device,
+        VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &build_info, &triangle_count, &sizes );
+
+    AccelerationStructure& blas = dynamic_blas.blas;
+
+    mem::AllocatedBuffer storage = create_device_buffer( vulkan.allocator,
+        sizes.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR );
+    vulkan.destructor_stack.push_free_vmabuffer( vulkan.allocator, storage );
+
+    blas.type = AccelerationStructure::Type::BLAS;
+    blas.handle = create_blas( device, storage.handle, 0, sizes.accelerationStructureSize );
+    blas.buffer = storage.handle;
+    blas.allocation = storage.allocation;
+    blas.device_address = get_acceleration_structure_address( device, blas.handle );
+    vulkan.destructor_stack.push( device, blas.handle, vkDestroyAccelerationStructureKHR );
+
+    VkDeviceSize scratch_size = std::max( sizes.buildScratchSize, sizes.updateScratchSize );
+    mem::AllocatedBuffer scratch = create_device_buffer(
+        vulkan.allocator, scratch_size + scratch_alignment, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT );
+    vulkan.destructor_stack.push_free_vmabuffer( vulkan.allocator, scratch );
+
+    dynamic_blas.scratch = scratch.handle;
+    dynamic_blas.scratch_address
+        = align_up( get_buffer_address( device, scratch.handle ), scratch_alignment );
+
+    record_blas_build( cmd_buf, dynamic_blas, false );
+    acceleration_structure_barrier(
+        cmd_buf, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR );
+
+    return dynamic_blas;
+}
+
+void update_blas( VkCommandBuffer cmd_buf, const DynamicBlas& blas )
+{
+    record_blas_build( cmd_buf, blas, true );
+}
+
 }
@@ -7,6 +7,20 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <volk.h>
 
+#include <span>
+#include <vector>
+
+namespace racecar::engine {
+
+struct ImmediateSubmit;
+
+}
+
+namespace racecar::vk {
+
+struct Common;
+
+}
 
 namespace racecar::vk::rt {
 
@@ -51,6 +65,20 @@ VkAccelerationStructureGeometryKHR create_acceleration_structure_from_geometry(
 AccelerationStructure build_blas( VkDevice device, VmaAllocator allocator,
     RayTracingProperties& rt_props, MeshData mesh, VkCommandBuffer cmd_buf, DestructorStack& destructor_stack );
 
+/// BLASes don't get built with more scratch than this at once. Anything past it goes in another
+/// build call, reusing the same scratch.
+constexpr VkDeviceSize BLAS_SCRATCH_BUDGET = 128ull << 20;
+
+/// Builds a BLAS per mesh, in order, and compacts them. Sizes are queried up front so every build
+/// shares one storage buffer and one scratch buffer, and as few build calls as the scratch budget
+/// allows. Once built, the compacted sizes are read back and the BLASes get copied into a buffer
+/// of exactly that size, the originals going away right after.
+///
+/// Submits and waits on its own commands, since compacted sizes are only known after the build.
+/// The results all share one buffer, which is freed with `vulkan.destructor_stack`.
+std::vector<AccelerationStructure> build_blases( Common& vulkan,
+    const engine::ImmediateSubmit& immediate_submit, std::span<const MeshData> meshes );
+
 struct Object {
     AccelerationStructure* blas;
     glm::mat4 transform;
@@ -61,4 +89,50 @@ AccelerationStructure build_tlas(
     const RayTracingProperties& rt_props, const std::vector<Object>& objects, 
     VkCommandBuffer cmd_buf, DestructorStack& destructor_stack );
 
+/// A BLAS that allows updates, for geometry whose vertices get moved on the GPU after it's built,
+/// like displaced terrain. Updates only refit the bounds of the tree the build made, so they're
+/// for vertices moving around, not for triangles coming and going.
+struct DynamicBlas {
+    AccelerationStructure blas;
+    MeshData mesh;
+
+    /// Big enough for both builds and updates.
+    VkBuffer scratch = VK_NULL_HANDLE;
+    VkDeviceAddress scratch_address = 0;
+};
+
+/// Records the initial build of `mesh` into `cmd_buf`, along with a barrier so TLAS builds after it
+/// on `cmd_buf` can use it. Everything is freed with `vulkan.destructor_stack`.
+DynamicBlas create_dynamic_blas( Common& vulkan, const MeshData& mesh, VkCommandBuffer cmd_buf );
+
+/// Refits the BLAS in place to wherever its vertices are now. Writes to the vertices have to be
+/// visible to acceleration structure builds by the time this runs, and any TLAS holding the BLAS
+/// has to be built or updated again after it.
+void update_blas( VkCommandBuffer cmd_buf, const DynamicBlas& blas );
+
+/// Instances take their transform as the top three rows, row by row, unlike glm's columns.
+VkTransformMatrixKHR to_transform_matrix( const glm::mat4& transform );
+
+/// A TLAS built on the frame's command buffer from instances the caller writes, rather than once
+/// up front. It allows updates, which refit the tree of the last full build to where the instances
+/// are now instead of building a new one.
+struct DynamicTlas {
+    AccelerationStructure tlas;
+    uint32_t instance_count = 0;
+
+    /// Big enough for both builds and updates. Only one of either is ever in flight, see
+    /// `record_tlas_build`.
+    VkBuffer scratch = VK_NULL_HANDLE;
+    VkDeviceAddress scratch_address = 0;
+};
+
+/// Allocates the TLAS and its scratch without building anything yet.
+DynamicTlas create_dynamic_tlas( Common& vulkan, uint32_t instance_count );
+
+/// Builds the TLAS from `instance_count` `VkAccelerationStructureInstanceKHR` at `instances`, or
+/// with `update` refits the previous build in place, which needs the same instances in the same
+/// order. Previous builds and readers of the TLAS have to be done by the time this runs.
+void record_tlas_build( VkCommandBuffer cmd_buf, const DynamicTlas& tlas,
+    VkDeviceAddress instances, bool update );
+
 }
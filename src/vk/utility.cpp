@@ -2,6 +2,8 @@
 
 #include "create.hpp"
 
+#include <algorithm>
+
 namespace racecar::vk::utility {
 
 void transition_image_mips( VkCommandBuffer command_buffer, VkImage image, VkImageLayout old_layout,
@@ -87,8 +89,16 @@ uint32_t bytes_from_format( VkFormat format )
     case VK_FORMAT_R8G8B8A8_UNORM:
         return 4;
     case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
         return 8;
     case VK_FORMAT_R32G32B32A32_SFLOAT:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
         return 16;
 
     default:
@@ -96,6 +106,44 @@ uint32_t bytes_from_format( VkFormat format )
     }
 }
 
+bool is_block_compressed( VkFormat format )
+{
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+bool is_depth_format( VkFormat format )
+{
+    switch ( format ) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+size_t image_data_size( VkFormat format, VkExtent3D extent, uint32_t mip_levels )
+{
+    size_t size = 0;
+
+    // Block-compressed formats are counted in whole blocks instead of texels.
+    uint32_t block_size = is_block_compressed( format ) ? 4 : 1;
+
+    for ( uint32_t mip = 0; mip < mip_levels; mip++ ) {
+        size_t width = ( std::max( extent.width >> mip, 1u ) + block_size - 1 ) / block_size;
+        size_t height = ( std::max( extent.height >> mip, 1u ) + block_size - 1 ) / block_size;
+        size_t depth = std::max( extent.depth >> mip, 1u );
+        size += width * height * depth * bytes_from_format( format );
+    }
+
+    return size;
+}
+
 uint16_t float_to_half( float f )
 {
     uint32_t x = *(uint32_t*)&f;
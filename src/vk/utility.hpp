@@ -23,8 +23,18 @@ void transition_image_mips( VkCommandBuffer command_buffer, VkImage image, VkIma
     VkPipelineStageFlags2 src_stage_mask, VkPipelineStageFlags2 dst_stage_mask,
     VkImageAspectFlags aspect_flags, uint32_t mip_levels );
 
+/// Bytes per texel, or per 4x4 block for block-compressed formats.
 uint32_t bytes_from_format( VkFormat format );
 
+/// BC1-7. These are stored in 4x4 blocks and can't be blitted to, so no GPU mip generation.
+bool is_block_compressed( VkFormat format );
+
+/// Formats with a depth aspect, with or without stencil.
+bool is_depth_format( VkFormat format );
+
+/// Size of a tightly packed mip chain, levels stored one after the other starting with mip 0.
+size_t image_data_size( VkFormat format, VkExtent3D extent, uint32_t mip_levels );
+
 uint16_t float_to_half( float f );
 float half_to_float( uint16_t h );
 